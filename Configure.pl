@@ -33,7 +33,7 @@ GetOptions(\%args, qw(
     cc=s ld=s make=s
     static use-readline
     build=s host=s big-endian
-    prefix=s make-install profilecalls
+    prefix=s make-install
 )) or die "See --help for further information\n";
 
 pod2usage(1) if $args{help};
@@ -62,7 +62,6 @@ $args{optimize}     = 1 if not defined $args{optimize} or $args{optimize} eq "";
 $args{debug}        = 3 if defined $args{debug} and $args{debug} eq "";
 $args{instrument} //= 0;
 $args{static}     //= 0;
-$args{profilecalls} //= 0;
 
 $args{'use-readline'} //= 0;
 $args{'big-endian'}   //= 0;
@@ -82,7 +81,6 @@ $config{perl}   = $^X;
 $config{config} = join ' ', map { / / ? "\"$_\"" : $_ } @args;
 $config{osname} = $^O;
 $config{osvers} = $Config{osvers};
-$config{profilecalls} = $args{profilecalls};
 
 # set options that take priority over all others
 my @keys = qw( cc ld make );
@@ -194,6 +194,10 @@ struct MVMSTable {
     /* By-name method dispatch cache. */
     MVMObject *method_cache;
 
+    /* Bumped each time a method cache is published, so that the inline
+     * caches of method lookup sites can tell their entries are stale. */
+    AO_t method_cache_gen;
+
     /* The computed v-table for static dispatch. */
     MVMObject **vtable;
 
@@ -254,6 +258,10 @@ struct MVMSTable {
     
     /* The role that the type plays in the HLL, if any. */
     MVMint64 hll_role;
+
+    /* Allocation counts of the allocation profiler (see allocprofile.h);
+     * NULL unless it is on and something of this type was allocated. */
+    MVMAllocProfileType *alloc_profile;
 };
 
 /* The representation operations table. Note that representations are not
@@ -495,6 +503,17 @@ struct MVMREPROps {
     /* Does this representation reference frames (either MVMStaticFrame or
      * MVMFrame)? */
     MVMuint32 refs_frames;
+
+    /* May gc_free be run after the GC run that found the object dead, on a
+     * copy of it? If so, it must not look at the STable. See finalize.c. */
+    MVMuint32 defer_free;
+
+    /* Optional. Used instead of gc_mark when the object is a generation 2
+     * object that is being scanned as an inter-generational root in a
+     * nursery collection. May leave out any references that it knows are
+     * not to nursery objects, such as those outside of the parts of the
+     * body written to since; see MVMArray's card marking. */
+    void (*gc_mark_young) (MVMThreadContext *tc, MVMSTable *st, void *data, MVMGCWorklist *worklist);
 };
 
 /* Various handy macros for getting at important stuff. */
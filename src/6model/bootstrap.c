@@ -589,6 +589,7 @@ void MVM_6model_bootstrap(MVMThreadContext *tc) {
     create_stub_boot_type(tc, MVM_REPR_ID_MVMCompUnit, boot_types.BOOTCompUnit, 0, MVM_BOOL_MODE_NOT_TYPE_OBJECT);
     create_stub_boot_type(tc, MVM_REPR_ID_MVMMultiCache, boot_types.BOOTMultiCache, 0, MVM_BOOL_MODE_NOT_TYPE_OBJECT);
     create_stub_boot_type(tc, MVM_REPR_ID_MVMContinuation, boot_types.BOOTContinuation, 0, MVM_BOOL_MODE_NOT_TYPE_OBJECT);
+    create_stub_boot_type(tc, MVM_REPR_ID_MVMStrBuilder, boot_types.BOOTStrBuilder, 0, MVM_BOOL_MODE_NOT_TYPE_OBJECT);
 
     /* Set up some strings. */
 #define string_creator(tc, variable, name) do { \
@@ -632,6 +633,7 @@ void MVM_6model_bootstrap(MVMThreadContext *tc) {
     meta_objectifier(tc, boot_types.BOOTCompUnit, "BOOTCompUnit");
     meta_objectifier(tc, boot_types.BOOTMultiCache, "BOOTMultiCache");
     meta_objectifier(tc, boot_types.BOOTContinuation, "BOOTContinuation");
+    meta_objectifier(tc, boot_types.BOOTStrBuilder, "BOOTStrBuilder");
 
     /* Create the KnowHOWAttribute type. */
     create_KnowHOWAttribute(tc);
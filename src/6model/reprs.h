@@ -27,6 +27,7 @@
 #include "6model/reprs/MVMDLLSym.h"
 #include "6model/reprs/MVMMultiCache.h"
 #include "6model/reprs/MVMContinuation.h"
+#include "6model/reprs/MVMStrBuilder.h"
 
 /* REPR related functions. */
 void MVM_repr_initialize_registry(MVMThreadContext *tc);
@@ -64,8 +65,9 @@ const MVMREPROps * MVM_repr_get_by_name(MVMThreadContext *tc, MVMString *name);
 #define MVM_REPR_ID_MVMDLLSym               25
 #define MVM_REPR_ID_MVMMultiCache           26
 #define MVM_REPR_ID_MVMContinuation         27
+#define MVM_REPR_ID_MVMStrBuilder           28
 
-#define MVM_REPR_CORE_COUNT                 28
+#define MVM_REPR_CORE_COUNT                 29
 #define MVM_REPR_MAX_COUNT                  64
 
 /* Default attribute functions for a REPR that lacks them. */
@@ -7,6 +7,22 @@ static const MVMREPROps this_repr;
 static MVMString *str_array = NULL;
 static MVMString *str_type  = NULL;
 
+/* Stores a reference into an object or string slot, applying the write
+ * barrier. If the array has a card table, a nursery object going in marks
+ * the card that the slot is in. */
+#define ASSIGN_SLOT(tc, root, body, kind, slot, value) do { \
+    MVMuint64 _slot = (slot); \
+    MVM_ASSIGN_REF(tc, &((root)->header), (body)->slots.kind[_slot], value); \
+    if ((body)->cards && (value) && !(((MVMCollectable *)(value))->flags & MVM_CF_SECOND_GEN)) \
+        (body)->cards[_slot >> MVM_ARRAY_CARD_BITS] = 1; \
+} while (0)
+
+/* Throws away an array's card table, when the slots are moved around or
+ * reallocated. The whole array is scanned the next time it is needed. */
+static void drop_cards(MVMArrayBody *body) {
+    MVM_checked_free_null(body->cards);
+}
+
 /* Creates a new type object of this representation, and associates it with
  * the given HOW. */
 static MVMObject * type_object_for(MVMThreadContext *tc, MVMObject *HOW) {
@@ -43,6 +59,7 @@ static void copy_to(MVMThreadContext *tc, MVMSTable *st, void *src, MVMObject *d
     dest_body->elems = src_body->elems;
     dest_body->ssize = src_body->elems;
     dest_body->start = 0;
+    dest_body->cards = NULL;
     if (dest_body->elems > 0) {
         size_t  mem_size     = dest_body->ssize * repr_data->elem_size;
         size_t  start_pos    = src_body->start * repr_data->elem_size;
@@ -84,10 +101,61 @@ static void gc_mark(MVMThreadContext *tc, MVMSTable *st, void *data, MVMGCWorkli
     }
 }
 
+/* Adds held objects that may be in the nursery to the GC worklist, for when
+ * a generation 2 array is scanned as an inter-generational root. A big
+ * enough array gets a card table, so that only the cards written to since
+ * need scanning; a card stays marked while it still holds nursery objects. */
+static void gc_mark_young(MVMThreadContext *tc, MVMSTable *st, void *data, MVMGCWorklist *worklist) {
+    MVMArrayREPRData *repr_data = (MVMArrayREPRData *)st->REPR_data;
+    MVMArrayBody     *body      = (MVMArrayBody *)data;
+    MVMuint64         first     = body->start;
+    MVMuint64         last      = body->start + body->elems;
+    MVMuint64         num_cards, card;
+    MVMCollectable  **slots;
+
+    if (repr_data->slot_type != MVM_ARRAY_OBJ && repr_data->slot_type != MVM_ARRAY_STR)
+        return;
+    if (!body->cards) {
+        if (body->ssize < MVM_ARRAY_CARD_MIN_SLOTS) {
+            gc_mark(tc, st, data, worklist);
+            return;
+        }
+
+        /* First time; we don't know where anything is, so scan it all. */
+        num_cards   = (body->ssize + (1 << MVM_ARRAY_CARD_BITS) - 1) >> MVM_ARRAY_CARD_BITS;
+        body->cards = malloc(num_cards);
+        memset(body->cards, 1, num_cards);
+    }
+
+    slots     = (MVMCollectable **)body->slots.any;
+    num_cards = (body->ssize + (1 << MVM_ARRAY_CARD_BITS) - 1) >> MVM_ARRAY_CARD_BITS;
+    for (card = first >> MVM_ARRAY_CARD_BITS; card < num_cards; card++) {
+        MVMuint64 i   = card << MVM_ARRAY_CARD_BITS;
+        MVMuint64 end = i + (1 << MVM_ARRAY_CARD_BITS);
+        MVMuint8  young = 0;
+        if (i >= last)
+            break;
+        if (!body->cards[card])
+            continue;
+        if (i < first)
+            i = first;
+        if (end > last)
+            end = last;
+        for (; i < end; i++) {
+            if (slots[i] && !(slots[i]->flags & MVM_CF_SECOND_GEN)) {
+                MVM_gc_worklist_add(tc, worklist, &slots[i]);
+                young = 1;
+            }
+        }
+        body->cards[card] = young;
+    }
+}
+
 /* Called by the VM in order to free memory associated with this object. */
 static void gc_free(MVMThreadContext *tc, MVMObject *obj) {
     MVMArray *arr = (MVMArray *)obj;
     MVM_checked_free_null(arr->body.slots.any);
+    MVM_checked_free_null(arr->body.cards);
 }
 
 /* Marks the representation data in an STable.*/
@@ -299,6 +367,7 @@ static void set_size_internal(MVMThreadContext *tc, MVMArrayBody *body, MVMint64
     /* if there aren't enough slots at the end, shift off empty slots
      * from the beginning first */
     if (start > 0 && n + start > ssize) {
+        drop_cards(body);
         if (elems > 0)
             memmove(slots,
                 (char *)slots + start * repr_data->elem_size,
@@ -328,6 +397,7 @@ static void set_size_internal(MVMThreadContext *tc, MVMArrayBody *body, MVMint64
     }
 
     /* now allocate the new slot buffer */
+    drop_cards(body);
     slots = (slots)
             ? realloc(slots, ssize * repr_data->elem_size)
             : malloc(ssize * repr_data->elem_size);
@@ -357,12 +427,12 @@ static void bind_pos(MVMThreadContext *tc, MVMSTable *st, MVMObject *root, void
         case MVM_ARRAY_OBJ:
             if (kind != MVM_reg_obj)
                 MVM_exception_throw_adhoc(tc, "MVMArray: bindpos expected object register");
-            MVM_ASSIGN_REF(tc, &(root->header), body->slots.o[body->start + index], value.o);
+            ASSIGN_SLOT(tc, root, body, o, body->start + index, value.o);
             break;
         case MVM_ARRAY_STR:
             if (kind != MVM_reg_str)
                 MVM_exception_throw_adhoc(tc, "MVMArray: bindpos expected string register");
-            MVM_ASSIGN_REF(tc, &(root->header), body->slots.s[body->start + index], value.s);
+            ASSIGN_SLOT(tc, root, body, s, body->start + index, value.s);
             break;
         case MVM_ARRAY_I64:
             if (kind != MVM_reg_int64)
@@ -453,12 +523,12 @@ static void push(MVMThreadContext *tc, MVMSTable *st, MVMObject *root, void *dat
         case MVM_ARRAY_OBJ:
             if (kind != MVM_reg_obj)
                 MVM_exception_throw_adhoc(tc, "MVMArray: push expected object register");
-            MVM_ASSIGN_REF(tc, &(root->header), body->slots.o[body->start + body->elems - 1], value.o);
+            ASSIGN_SLOT(tc, root, body, o, body->start + body->elems - 1, value.o);
             break;
         case MVM_ARRAY_STR:
             if (kind != MVM_reg_str)
                 MVM_exception_throw_adhoc(tc, "MVMArray: push expected string register");
-            MVM_ASSIGN_REF(tc, &(root->header), body->slots.s[body->start + body->elems - 1], value.s);
+            ASSIGN_SLOT(tc, root, body, s, body->start + body->elems - 1, value.s);
             break;
         case MVM_ARRAY_I64:
             if (kind != MVM_reg_int64)
@@ -605,6 +675,7 @@ static void unshift(MVMThreadContext *tc, MVMSTable *st, MVMObject *root, void *
         set_size_internal(tc, body, elems + n, repr_data);
 
         /* move elements and set start */
+        drop_cards(body);
         memmove(
             (char *)body->slots.any + n * repr_data->elem_size,
             body->slots.any,
@@ -622,12 +693,12 @@ static void unshift(MVMThreadContext *tc, MVMSTable *st, MVMObject *root, void *
         case MVM_ARRAY_OBJ:
             if (kind != MVM_reg_obj)
                 MVM_exception_throw_adhoc(tc, "MVMArray: unshift expected object register");
-            MVM_ASSIGN_REF(tc, &(root->header), body->slots.o[body->start], value.o);
+            ASSIGN_SLOT(tc, root, body, o, body->start, value.o);
             break;
         case MVM_ARRAY_STR:
             if (kind != MVM_reg_str)
                 MVM_exception_throw_adhoc(tc, "MVMArray: unshift expected string register");
-            MVM_ASSIGN_REF(tc, &(root->header), body->slots.s[body->start], value.s);
+            ASSIGN_SLOT(tc, root, body, s, body->start, value.s);
             break;
         case MVM_ARRAY_I64:
             if (kind != MVM_reg_int64)
@@ -818,6 +889,7 @@ static void splice(MVMThreadContext *tc, MVMSTable *st, MVMObject *root, void *d
     else if (tail > 0 && count > elems1) {
         /* We're shrinking the array, so first move the tail left */
         start = body->start;
+        drop_cards(body);
         memmove(
             (char *)body->slots.any + (start + offset + elems1) * repr_data->elem_size,
             (char *)body->slots.any + (start + offset + count) * repr_data->elem_size,
@@ -830,6 +902,7 @@ static void splice(MVMThreadContext *tc, MVMSTable *st, MVMObject *root, void *d
     start = body->start;
     if (tail > 0 && count < elems1) {
         /* The array grew, so move the tail to the right */
+        drop_cards(body);
         memmove(
             (char *)body->slots.any + (start + offset + elems1) * repr_data->elem_size,
             (char *)body->slots.any + (start + offset + count) * repr_data->elem_size,
@@ -1220,4 +1293,6 @@ static const MVMREPROps this_repr = {
     "VMArray", /* name */
     MVM_REPR_ID_MVMArray,
     0, /* refs_frames */
+    0, /* defer_free */
+    gc_mark_young,
 };
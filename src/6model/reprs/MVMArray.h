@@ -26,6 +26,13 @@ struct MVMArrayBody {
         MVMuint8   *u8;
         void       *any;
     } slots;
+
+    /* For a big array of objects or strings in generation 2, a card table:
+     * a flag for each run of 2 ** MVM_ARRAY_CARD_BITS slots (counting from
+     * the start of the slot storage) that is set if it may hold references
+     * to nursery objects. NULL if we have none, in which case all of the
+     * slots may. */
+    MVMuint8   *cards;
 };
 struct MVMArray {
     MVMObject common;
@@ -46,6 +53,12 @@ struct MVMArray {
 #define MVM_ARRAY_U16   10
 #define MVM_ARRAY_U8    11
 
+/* Each card in an array's card table covers 2 ** MVM_ARRAY_CARD_BITS slots.
+ * Only arrays with at least MVM_ARRAY_CARD_MIN_SLOTS slots get a card table,
+ * when they are first scanned as inter-generational roots. */
+#define MVM_ARRAY_CARD_BITS         7
+#define MVM_ARRAY_CARD_MIN_SLOTS    1024
+
 /* Function for REPR setup. */
 const MVMREPROps * MVMArray_initialize(MVMThreadContext *tc);
 
@@ -204,4 +204,5 @@ static const MVMREPROps this_repr = {
     "VMHash", /* name */
     MVM_REPR_ID_MVMHash,
     0, /* refs_frames */
+    1, /* defer_free */
 };
@@ -95,4 +95,5 @@ static const MVMREPROps this_repr = {
     "MVMOSHandle", /* name */
     MVM_REPR_ID_MVMOSHandle,
     0, /* refs_frames */
+    1, /* defer_free */
 };
\ No newline at end of file
@@ -130,6 +130,12 @@ static void gc_mark(MVMThreadContext *tc, MVMSTable *st, void *data, MVMGCWorkli
             if (type_map[i] == MVM_reg_str || type_map[i] == MVM_reg_obj)
                 MVM_gc_worklist_add(tc, worklist, &body->static_env[i].o);
     }
+
+    /* Specializations. */
+    MVM_spesh_candidate_mark(tc, body, worklist);
+
+    /* Inline caches. */
+    MVM_inline_cache_mark(tc, body, worklist);
 }
 
 /* Called by the VM in order to free memory associated with this object. */
@@ -137,12 +143,16 @@ static void gc_free(MVMThreadContext *tc, MVMObject *obj) {
     MVMStaticFrame *sf = (MVMStaticFrame *)obj;
     MVMStaticFrameBody *body = &sf->body;
     MVM_checked_free_null(body->handlers);
+    MVM_checked_free_null(body->superinstr_bytecode);
     MVM_checked_free_null(body->static_env);
     MVM_checked_free_null(body->static_env_flags);
     MVM_checked_free_null(body->local_types);
     MVM_checked_free_null(body->lexical_types);
     MVM_checked_free_null(body->lexical_names_list);
     MVM_HASH_DESTROY(hash_handle, MVMLexicalRegistry, body->lexical_names);
+    MVM_spesh_candidate_destroy_all(tc, body);
+    MVM_jit_code_destroy(tc, body->jit_code);
+    MVM_inline_cache_destroy(tc, body);
 }
 
 /* Gets the storage specification for this representation. */
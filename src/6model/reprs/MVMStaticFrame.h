@@ -70,8 +70,38 @@ struct MVMStaticFrameBody {
     /* Cached instruction offsets */
     MVMuint8 *instr_offsets;
 
+    /* A copy of the bytecode using superinstructions, with the same layout;
+     * NULL if there was nothing to fuse. */
+    MVMuint8 *superinstr_bytecode;
+
     /* Does the frame have an exit handler we need to run? */
     MVMuint8 has_exit_handler;
+
+    /* Number of invocations since we last considered specializing this
+     * frame, and the number of times we tried to do so. */
+    MVMuint32 spesh_invocations;
+    MVMuint32 spesh_attempts;
+
+    /* Specializations of the frame's bytecode. */
+    MVMuint32          num_spesh_candidates;
+    MVMSpeshCandidate *spesh_candidates;
+
+    /* Number of invocations counted towards JIT-compiling the frame, and
+     * the JIT-compiled code for its unspecialized bytecode. */
+    MVMuint32   jit_invocations;
+    MVMJitCode *jit_code;
+
+    /* Inline caches for method lookups, indexed by the bytecode offset of
+     * the lookup instruction (see inlinecache.h); NULL until needed. */
+    MVMInlineCache **inline_caches;
+
+    /* Per-instruction counts of the op-level profiler (see opprofile.h);
+     * NULL unless it is compiled in and the frame was run. */
+    MVMOpProfileFrame *op_profile;
+
+    /* Allocation counts of the allocation profiler (see allocprofile.h);
+     * NULL unless it is on and something was allocated in the frame. */
+    MVMAllocProfileFrame *alloc_profile;
 };
 struct MVMStaticFrame {
     MVMObject common;
@@ -0,0 +1,244 @@
+#include "moar.h"
+
+/* This representation's function pointer table. */
+static const MVMREPROps this_repr;
+
+/* Creates a new type object of this representation, and associates it with
+ * the given HOW. */
+static MVMObject * type_object_for(MVMThreadContext *tc, MVMObject *HOW) {
+    MVMSTable *st = MVM_gc_allocate_stable(tc, &this_repr, HOW);
+
+    MVMROOT(tc, st, {
+        MVMObject *obj = MVM_gc_allocate_type_object(tc, st);
+        MVM_ASSIGN_REF(tc, &(st->header), st->WHAT, obj);
+        st->size = sizeof(MVMStrBuilder);
+    });
+
+    return st->WHAT;
+}
+
+/* Creates a new instance based on the type object. */
+static MVMObject * allocate(MVMThreadContext *tc, MVMSTable *st) {
+    return MVM_gc_allocate_object(tc, st);
+}
+
+/* Copies the body of one object to another. */
+static void copy_to(MVMThreadContext *tc, MVMSTable *st, void *src, MVMObject *dest_root, void *dest) {
+    MVMStrBuilderBody *src_body  = (MVMStrBuilderBody *)src;
+    MVMStrBuilderBody *dest_body = (MVMStrBuilderBody *)dest;
+    size_t size = src_body->wide ? sizeof(MVMCodepoint32) : sizeof(MVMCodepoint8);
+    dest_body->elems = src_body->elems;
+    dest_body->alloc = src_body->elems;
+    dest_body->wide  = src_body->wide;
+    if (src_body->elems) {
+        dest_body->storage = malloc(src_body->elems * size);
+        memcpy(dest_body->storage, src_body->storage, src_body->elems * size);
+    }
+}
+
+/* Called by the VM in order to free memory associated with this object. */
+static void gc_free(MVMThreadContext *tc, MVMObject *obj) {
+    MVMStrBuilder *sb = (MVMStrBuilder *)obj;
+    MVM_checked_free_null(sb->body.storage);
+}
+
+/* Gets the number of graphemes appended so far. */
+static MVMuint64 elems(MVMThreadContext *tc, MVMSTable *st, MVMObject *root, void *data) {
+    return ((MVMStrBuilderBody *)data)->elems;
+}
+
+/* Gets the storage specification for this representation. */
+static MVMStorageSpec get_storage_spec(MVMThreadContext *tc, MVMSTable *st) {
+    MVMStorageSpec spec;
+    spec.inlineable      = MVM_STORAGE_SPEC_REFERENCE;
+    spec.boxed_primitive = MVM_STORAGE_SPEC_BP_NONE;
+    spec.can_box         = 0;
+    return spec;
+}
+
+/* Compose the representation. */
+static void compose(MVMThreadContext *tc, MVMSTable *st, MVMObject *info) {
+    /* Nothing to do for this REPR. */
+}
+
+/* Initializes the representation. */
+const MVMREPROps * MVMStrBuilder_initialize(MVMThreadContext *tc) {
+    return &this_repr;
+}
+
+static const MVMREPROps this_repr = {
+    type_object_for,
+    allocate,
+    NULL, /* initialize */
+    copy_to,
+    MVM_REPR_DEFAULT_ATTR_FUNCS,
+    MVM_REPR_DEFAULT_BOX_FUNCS,
+    MVM_REPR_DEFAULT_POS_FUNCS,
+    MVM_REPR_DEFAULT_ASS_FUNCS,
+    elems,
+    get_storage_spec,
+    NULL, /* change_type */
+    NULL, /* serialize */
+    NULL, /* deserialize */
+    NULL, /* serialize_repr_data */
+    NULL, /* deserialize_repr_data */
+    NULL, /* deserialize_stable_size */
+    NULL, /* gc_mark */
+    gc_free,
+    NULL, /* gc_cleanup */
+    NULL, /* gc_mark_repr_data */
+    NULL, /* gc_free_repr_data */
+    compose,
+    "MVMStrBuilder", /* name */
+    MVM_REPR_ID_MVMStrBuilder,
+    0, /* refs_frames */
+};
+
+/* Checks we have a string builder to work on, and gets its body. */
+static MVMStrBuilderBody * get_body(MVMThreadContext *tc, MVMObject *sb, const char *op) {
+    if (REPR(sb)->ID != MVM_REPR_ID_MVMStrBuilder || !IS_CONCRETE(sb))
+        MVM_exception_throw_adhoc(tc, "%s requires a concrete MVMStrBuilder", op);
+    return &((MVMStrBuilder *)sb)->body;
+}
+
+/* Makes room for another needed graphemes, at least doubling the buffer
+ * when it has to grow so appends take amortized constant time. */
+static void ensure_room(MVMThreadContext *tc, MVMStrBuilderBody *body, MVMStringIndex needed) {
+    MVMStringIndex alloc = body->alloc;
+    if (body->elems + needed <= alloc)
+        return;
+    alloc = alloc ? alloc * 2 : 16;
+    if (alloc < body->elems + needed)
+        alloc = body->elems + needed;
+    body->storage = realloc(body->storage,
+        alloc * (body->wide ? sizeof(MVMCodepoint32) : sizeof(MVMCodepoint8)));
+    body->alloc = alloc;
+}
+
+/* Switches the buffer over to 32-bit codepoints. */
+static void widen(MVMThreadContext *tc, MVMStrBuilderBody *body) {
+    MVMStringIndex alloc = body->alloc ? body->alloc : 16, i;
+    MVMCodepoint32 *wide = malloc(alloc * sizeof(MVMCodepoint32));
+    for (i = 0; i < body->elems; i++)
+        wide[i] = body->uint8s[i];
+    free(body->storage);
+    body->int32s = wide;
+    body->alloc  = alloc;
+    body->wide   = 1;
+}
+
+/* Appends a flat piece of a string, widening the buffer if it turns out to
+ * have codepoints that don't fit in 8 bits. */
+static MVM_SUBSTRING_CONSUMER(append_consumer) {
+    MVMStrBuilderBody *body = (MVMStrBuilderBody *)data;
+    MVMStringIndex i;
+    if (IS_WIDE(string)) {
+        MVMCodepoint32 *cps = string->body.int32s + start;
+        if (!body->wide) {
+            for (i = 0; i < length; i++) {
+                if (cps[i] < 0 || cps[i] > 255) {
+                    widen(tc, body);
+                    break;
+                }
+            }
+        }
+        ensure_room(tc, body, length);
+        if (body->wide) {
+            memcpy(body->int32s + body->elems, cps, length * sizeof(MVMCodepoint32));
+        }
+        else {
+            for (i = 0; i < length; i++)
+                body->uint8s[body->elems + i] = (MVMCodepoint8)cps[i];
+        }
+    }
+    else {
+        MVMCodepoint8 *cps = string->body.uint8s + start;
+        ensure_room(tc, body, length);
+        if (body->wide) {
+            for (i = 0; i < length; i++)
+                body->int32s[body->elems + i] = cps[i];
+        }
+        else {
+            memcpy(body->uint8s + body->elems, cps, length);
+        }
+    }
+    body->elems += length;
+    return 0;
+}
+
+/* Appends a string, walking the strands of a rope rather than flattening. */
+void MVM_strbuilder_append_s(MVMThreadContext *tc, MVMObject *sb, MVMString *s) {
+    MVMStrBuilderBody *body = get_body(tc, sb, "strbuilderappend");
+    MVMStringIndex graphs;
+    if (!IS_CONCRETE((MVMObject *)s))
+        MVM_exception_throw_adhoc(tc, "strbuilderappend needs a concrete string");
+    graphs = NUM_GRAPHS(s);
+    if (graphs)
+        MVM_string_traverse_substring(tc, s, 0, graphs, 0, append_consumer, body);
+}
+
+/* Appends a single codepoint. */
+void MVM_strbuilder_append_cp(MVMThreadContext *tc, MVMObject *sb, MVMint64 cp) {
+    MVMStrBuilderBody *body = get_body(tc, sb, "strbuilderappendcp");
+    if (cp < 0)
+        MVM_exception_throw_adhoc(tc, "strbuilderappendcp codepoint cannot be negative");
+    if (cp > 0x10FFFF)
+        MVM_exception_throw_adhoc(tc, "strbuilderappendcp codepoint %lld is out of range",
+            (long long int)cp);
+    if (!body->wide && cp > 255)
+        widen(tc, body);
+    ensure_room(tc, body, 1);
+    if (body->wide)
+        body->int32s[body->elems++] = (MVMCodepoint32)cp;
+    else
+        body->uint8s[body->elems++] = (MVMCodepoint8)cp;
+}
+
+/* Appends the decimal form of an integer. */
+void MVM_strbuilder_append_i(MVMThreadContext *tc, MVMObject *sb, MVMint64 i) {
+    MVMStrBuilderBody *body = get_body(tc, sb, "strbuilderappendint");
+    char buffer[64];
+    int len = snprintf(buffer, 64, "%lld", (long long int)i), j;
+    if (len < 0)
+        MVM_exception_throw_adhoc(tc, "Could not stringify integer");
+    ensure_room(tc, body, len);
+    if (body->wide) {
+        for (j = 0; j < len; j++)
+            body->int32s[body->elems + j] = buffer[j];
+    }
+    else {
+        memcpy(body->uint8s + body->elems, buffer, len);
+    }
+    body->elems += len;
+}
+
+/* Makes a string of everything appended so far. The buffer is handed over
+ * to the string rather than copied, so the builder is left empty, ready to
+ * build another. */
+MVMString * MVM_strbuilder_to_str(MVMThreadContext *tc, MVMObject *sb) {
+    MVMStrBuilderBody *body = get_body(tc, sb, "strbuildertostr");
+    MVMString *result;
+
+    if (!body->elems)
+        return tc->instance->str_consts.empty;
+
+    MVMROOT(tc, sb, {
+        result = (MVMString *)MVM_repr_alloc_init(tc, tc->instance->VMString);
+    });
+    body = &((MVMStrBuilder *)sb)->body;
+
+    /* give back any slack from the doubling */
+    if (body->alloc > body->elems)
+        body->storage = realloc(body->storage,
+            body->elems * (body->wide ? sizeof(MVMCodepoint32) : sizeof(MVMCodepoint8)));
+    result->body.storage = body->storage;
+    result->body.graphs  = body->elems;
+    result->body.flags   = body->wide ? MVM_STRING_TYPE_INT32 : MVM_STRING_TYPE_UINT8;
+
+    body->storage = NULL;
+    body->elems   = 0;
+    body->alloc   = 0;
+    body->wide    = 0;
+
+    return result;
+}
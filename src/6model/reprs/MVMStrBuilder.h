@@ -0,0 +1,32 @@
+/* Representation for a string builder: a buffer that strings, codepoints
+ * and integers are appended to in place, and that is turned into a string
+ * once at the end. */
+struct MVMStrBuilderBody {
+    /* The graphemes so far. These are 8-bit until something that doesn't
+     * fit is appended, at which point the whole buffer is widened. */
+    union {
+        MVMCodepoint32 *int32s;
+        MVMCodepoint8  *uint8s;
+        void           *storage;
+    };
+
+    /* How many graphemes there are, and how many there is room for. */
+    MVMStringIndex elems;
+    MVMStringIndex alloc;
+
+    /* Whether the buffer holds 32-bit codepoints. */
+    MVMuint8 wide;
+};
+struct MVMStrBuilder {
+    MVMObject common;
+    MVMStrBuilderBody body;
+};
+
+/* Function for REPR setup. */
+const MVMREPROps * MVMStrBuilder_initialize(MVMThreadContext *tc);
+
+/* Operations on a string builder. */
+void MVM_strbuilder_append_s(MVMThreadContext *tc, MVMObject *sb, MVMString *s);
+void MVM_strbuilder_append_cp(MVMThreadContext *tc, MVMObject *sb, MVMint64 cp);
+void MVM_strbuilder_append_i(MVMThreadContext *tc, MVMObject *sb, MVMint64 i);
+MVMString * MVM_strbuilder_to_str(MVMThreadContext *tc, MVMObject *sb);
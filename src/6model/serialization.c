@@ -1936,6 +1936,7 @@ static void deserialize_stable(MVMThreadContext *tc, MVMSerializationReader *rea
 
     /* Method cache and v-table. */
     MVM_ASSIGN_REF(tc, &(st->header), st->method_cache, read_ref_func(tc, reader));
+    MVM_incr(&st->method_cache_gen);
     st->vtable_length = read_int_func(tc, reader);
     if (st->vtable_length > 0)
         st->vtable = (MVMObject **)malloc(st->vtable_length * sizeof(MVMObject *));
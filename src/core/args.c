@@ -5,7 +5,15 @@ static MVMCallsiteEntry one_arg_flags[] = { MVM_CALLSITE_ARG_OBJ };
 static MVMCallsite     one_arg_callsite = { one_arg_flags, 1, 1, 0 };
 
 static void init_named_used(MVMThreadContext *tc, MVMArgProcContext *ctx, MVMuint16 num) {
-    if (ctx->named_used && ctx->named_used_size >= num) { /* reuse the old one */
+    ctx->named_used_bits = 0;
+    if (num <= MVM_ARGS_NAMED_USED_BITS) { /* the bit field will do */
+        if (ctx->named_used) {
+            free(ctx->named_used);
+            ctx->named_used = NULL;
+            ctx->named_used_size = 0;
+        }
+    }
+    else if (ctx->named_used && ctx->named_used_size >= num) { /* reuse the old one */
         memset(ctx->named_used, 0, ctx->named_used_size * sizeof(MVMuint8));
     }
     else {
@@ -14,10 +22,21 @@ static void init_named_used(MVMThreadContext *tc, MVMArgProcContext *ctx, MVMuin
             ctx->named_used = NULL;
         }
         ctx->named_used_size = num;
-        ctx->named_used = ctx->named_used_size ? calloc(sizeof(MVMuint8), ctx->named_used_size) : NULL;
+        ctx->named_used = calloc(sizeof(MVMuint8), ctx->named_used_size);
     }
 }
 
+/* Checks and marks whether the named at the specified index was used. */
+#define named_was_used(ctx, idx) ((ctx)->named_used \
+    ? (ctx)->named_used[idx] \
+    : (MVMuint8)(((ctx)->named_used_bits >> (idx)) & 1))
+#define mark_named_used(ctx, idx) do { \
+    if ((ctx)->named_used) \
+        (ctx)->named_used[idx] = 1; \
+    else \
+        (ctx)->named_used_bits |= (MVMuint64)1 << (idx); \
+} while (0)
+
 /* Initialize arguments processing context. */
 void MVM_args_proc_init(MVMThreadContext *tc, MVMArgProcContext *ctx, MVMCallsite *callsite, MVMRegister *args) {
     /* Stash callsite and argument counts/pointers. */
@@ -68,6 +87,8 @@ MVMCallsite * MVM_args_proc_to_callsite(MVMThreadContext *tc, MVMArgProcContext
         res->arg_count = ctx->arg_count;
         res->num_pos   = ctx->num_pos;
         res->has_flattening = 0;
+        res->with_invocant = NULL;
+        res->named_plan = NULL;
         return res;
     }
     else {
@@ -284,23 +305,46 @@ MVMArgInfo MVM_args_get_pos_str(MVMThreadContext *tc, MVMArgProcContext *ctx, MV
     return result;
 }
 
+/* Finds the index of the named argument with the specified name, or -1 if
+ * there is none. Where the callsite has a binding plan and no flattening
+ * took place, we first try the argument that the name was bound to last
+ * time, and record where we found it otherwise. */
+static MVMint32 find_named_arg(MVMThreadContext *tc, MVMArgProcContext *ctx, MVMString *name) {
+    MVMString **plan = ctx->arg_flags ? NULL : ctx->callsite->named_plan;
+    MVMuint32   num_nameds = (ctx->arg_count - ctx->num_pos) / 2;
+    MVMuint32   i;
+    if (plan) {
+        for (i = 0; i < num_nameds; i++)
+            if (plan[i] == name) {
+                if (MVM_string_equal(tc, ctx->args[ctx->num_pos + 2 * i].s, name))
+                    return i;
+                break;
+            }
+    }
+    for (i = 0; i < num_nameds; i++) {
+        if (MVM_string_equal(tc, ctx->args[ctx->num_pos + 2 * i].s, name)) {
+            if (plan)
+                plan[i] = name;
+            return i;
+        }
+    }
+    return -1;
+}
+
 #define args_get_named(tc, ctx, name, required, _type) do { \
      \
-    MVMuint32 flag_pos, arg_pos; \
+    MVMint32 named_idx = find_named_arg(tc, ctx, name); \
     result.arg.s = NULL; \
     result.exists = 0; \
      \
-    for (flag_pos = arg_pos = ctx->num_pos; arg_pos < ctx->arg_count; flag_pos++, arg_pos += 2) { \
-        if (MVM_string_equal(tc, ctx->args[arg_pos].s, name)) { \
-            if (ctx->named_used[(arg_pos - ctx->num_pos)/2]) { \
-                MVM_exception_throw_adhoc(tc, "Named argument '%s' already used", MVM_string_utf8_encode_C_string(tc, name)); \
-            } \
-            result.arg    = ctx->args[arg_pos + 1]; \
-            result.flags  = (ctx->arg_flags ? ctx->arg_flags : ctx->callsite->arg_flags)[flag_pos]; \
-            result.exists = 1; \
-            ctx->named_used[(arg_pos - ctx->num_pos)/2] = 1; \
-            break; \
+    if (named_idx >= 0) { \
+        if (named_was_used(ctx, named_idx)) { \
+            MVM_exception_throw_adhoc(tc, "Named argument '%s' already used", MVM_string_utf8_encode_C_string(tc, name)); \
         } \
+        result.arg    = ctx->args[ctx->num_pos + 2 * named_idx + 1]; \
+        result.flags  = (ctx->arg_flags ? ctx->arg_flags : ctx->callsite->arg_flags)[ctx->num_pos + named_idx]; \
+        result.exists = 1; \
+        mark_named_used(ctx, named_idx); \
     } \
     if (!result.exists && required) \
         MVM_exception_throw_adhoc(tc, "Required named parameter '%s' not passed", MVM_string_utf8_encode_C_string(tc, name)); \
@@ -332,23 +376,17 @@ MVMArgInfo MVM_args_get_named_str(MVMThreadContext *tc, MVMArgProcContext *ctx,
     return result;
 }
 MVMint64 MVM_args_has_named(MVMThreadContext *tc, MVMArgProcContext *ctx, MVMString *name) {
-    MVMuint32 flag_pos, arg_pos;
-    for (flag_pos = arg_pos = ctx->num_pos; arg_pos < ctx->arg_count; flag_pos++, arg_pos += 2)
-        if (MVM_string_equal(tc, ctx->args[arg_pos].s, name))
-            return 1;
-    return 0;
+    return find_named_arg(tc, ctx, name) >= 0;
 }
 void MVM_args_assert_nameds_used(MVMThreadContext *tc, MVMArgProcContext *ctx) {
-    if (ctx->named_used) {
-        MVMuint16 size = (ctx->arg_count - ctx->num_pos) / 2;
-        MVMuint16 i;
-        for (i = 0; i < size; i++)
-            if (!ctx->named_used[i])
-                MVM_exception_throw_adhoc(tc,
-                    "Unexpected named parameter '%s' passed",
-                    MVM_string_utf8_encode_C_string(tc,
-                        ctx->args[ctx->num_pos + 2 * i].s));
-    }
+    MVMuint16 size = (ctx->arg_count - ctx->num_pos) / 2;
+    MVMuint16 i;
+    for (i = 0; i < size; i++)
+        if (!named_was_used(ctx, i))
+            MVM_exception_throw_adhoc(tc,
+                "Unexpected named parameter '%s' passed",
+                MVM_string_utf8_encode_C_string(tc,
+                    ctx->args[ctx->num_pos + 2 * i].s));
 }
 
 /* Result setting. The frameless flag indicates that the currently
@@ -567,7 +605,7 @@ MVMObject * MVM_args_slurpy_named(MVMThreadContext *tc, MVMArgProcContext *ctx)
     for (flag_pos = arg_pos = ctx->num_pos; arg_pos < ctx->arg_count; flag_pos++, arg_pos += 2) {
         MVMString *key;
 
-        if (ctx->named_used[flag_pos - ctx->num_pos]) continue;
+        if (named_was_used(ctx, flag_pos - ctx->num_pos)) continue;
 
         key = ctx->args[arg_pos].s;
 
@@ -49,10 +49,14 @@ struct MVMCallsite {
     /* Cached version of this callsite with an extra invocant arg. */
     MVMCallsite *with_invocant;
 
-#if MVM_HLL_PROFILE_CALLS
-    MVMuint32 static_frame_id;
-    MVMuint8 *cuuid, *name;
-#endif
+    /* Binding plan for the named arguments: for each of them, the parameter
+     * name that was last bound to it. Binding the same signature again can
+     * then find each argument by pointer comparison instead of scanning all
+     * the names. Since the names are passed in the argument buffer rather
+     * than being part of the callsite, a plan entry is only a guess, which
+     * is checked before it is used. NULL if the callsite has no nameds, or
+     * was not loaded from bytecode. */
+    MVMString **named_plan;
 };
 
 /* Minimum callsite size is due to certain things internally expecting us to
@@ -72,9 +76,11 @@ struct MVMArgProcContext {
     /* The arguments. */
     MVMRegister *args;
 
-    /* Bytemap of indexes of used nameds, so the
-     * named slurpy knows which ones not to grab.
-     * XXX cache and free this at the proper times. */
+    /* Which nameds have been used, so the named slurpy knows which ones not
+     * to grab. Up to MVM_ARGS_NAMED_USED_BITS of them are tracked in a bit
+     * field, so the common case needs no allocation; with more, a bytemap
+     * of them is allocated and kept around for reuse. */
+    MVMuint64 named_used_bits;
     MVMuint8 *named_used;
     MVMuint16 named_used_size;
 
@@ -86,6 +92,9 @@ struct MVMArgProcContext {
     MVMuint16 num_pos;
 };
 
+/* Number of nameds that can be tracked in named_used_bits. */
+#define MVM_ARGS_NAMED_USED_BITS 64
+
 /* Expected return type flags. */
 typedef enum {
     /* Argument is an object. */
@@ -687,6 +687,9 @@ static MVMCallsite ** deserialize_callsites(MVMThreadContext *tc, MVMCompUnit *c
         callsites[i]->arg_count      = positionals + nameds;
         callsites[i]->has_flattening = has_flattening;
         callsites[i]->with_invocant  = NULL; 
+        callsites[i]->named_plan     = nameds
+            ? calloc(nameds / 2, sizeof(MVMString *))
+            : NULL;
 
         /* Track maximum callsite size we've seen. (Used for now, though
          * in the end we probably should calculate it by frame.) */
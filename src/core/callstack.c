@@ -0,0 +1,80 @@
+#include "moar.h"
+
+/* Allocates a call stack block with room for at least the given number of
+ * bytes. */
+static MVMCallStackBlock * create_block(size_t size) {
+    MVMCallStackBlock *block = malloc(sizeof(MVMCallStackBlock));
+    if (size < MVM_CALLSTACK_BLOCK_SIZE)
+        size = MVM_CALLSTACK_BLOCK_SIZE;
+    block->start       = malloc(size);
+    block->alloc       = block->start;
+    block->alloc_limit = block->start + size;
+    block->prev        = NULL;
+    block->next        = NULL;
+    return block;
+}
+
+/* Sets up the call stack region for a thread. */
+void MVM_callstack_init(MVMThreadContext *tc) {
+    tc->stack_first   = create_block(MVM_CALLSTACK_BLOCK_SIZE);
+    tc->stack_current = tc->stack_first;
+}
+
+/* Moves on to the next block of the call stack region, making sure it has
+ * room for at least the given number of bytes. */
+MVMCallStackBlock * MVM_callstack_next_block(MVMThreadContext *tc, size_t size) {
+    MVMCallStackBlock *cur  = tc->stack_current;
+    MVMCallStackBlock *next = cur->next;
+
+    /* If the next block we kept around is too small, toss it. */
+    if (next && (size_t)(next->alloc_limit - next->start) < size) {
+        if (next->next)
+            next->next->prev = cur;
+        cur->next = next->next;
+        free(next->start);
+        free(next);
+        next = cur->next;
+    }
+
+    /* If we have no suitable next block, make one. */
+    if (!next) {
+        next = create_block(size);
+        next->prev = cur;
+        next->next = cur->next;
+        if (cur->next)
+            cur->next->prev = next;
+        cur->next = next;
+    }
+
+    next->alloc = next->start;
+    tc->stack_current = next;
+    return next;
+}
+
+/* Frees everything in the call stack region that was allocated at or after
+ * the given position. */
+void MVM_callstack_free_to(MVMThreadContext *tc, void *pos) {
+    MVMCallStackBlock *block = tc->stack_current;
+    char              *target = (char *)pos;
+    while (target < block->start || target > block->alloc) {
+        block->alloc = block->start;
+        block = block->prev;
+        if (!block)
+            MVM_panic(1, "Call stack region corrupted: freed position not found");
+    }
+    block->alloc = target;
+    tc->stack_current = block;
+}
+
+/* Frees all of a thread's call stack region. */
+void MVM_callstack_destroy(MVMThreadContext *tc) {
+    MVMCallStackBlock *block = tc->stack_first;
+    while (block) {
+        MVMCallStackBlock *next = block->next;
+        free(block->start);
+        free(block);
+        block = next;
+    }
+    tc->stack_first   = NULL;
+    tc->stack_current = NULL;
+}
@@ -0,0 +1,37 @@
+/* Size of a block of a thread's call stack region. A block is made bigger
+ * than this if a single frame needs more space. */
+#define MVM_CALLSTACK_BLOCK_SIZE    131072
+
+/* A block of memory in a thread's call stack region. The env and work areas
+ * of frames are bump-allocated in the region as frames are invoked, and
+ * freed again as they return. Frames that outlive their invocation have
+ * their areas moved to the heap. */
+struct MVMCallStackBlock {
+    /* The start of the memory in the block. */
+    char *start;
+
+    /* The current allocation position and the end of the block. */
+    char *alloc;
+    char *alloc_limit;
+
+    /* The previous and next blocks; we keep the next one around even when
+     * we are not using it, to avoid repeatedly freeing and allocating. */
+    MVMCallStackBlock *prev;
+    MVMCallStackBlock *next;
+};
+
+void MVM_callstack_init(MVMThreadContext *tc);
+MVMCallStackBlock * MVM_callstack_next_block(MVMThreadContext *tc, size_t size);
+void MVM_callstack_free_to(MVMThreadContext *tc, void *pos);
+void MVM_callstack_destroy(MVMThreadContext *tc);
+
+/* Allocates the given number of bytes in the call stack region. */
+MVM_STATIC_INLINE void * MVM_callstack_alloc(MVMThreadContext *tc, size_t size) {
+    MVMCallStackBlock *block = tc->stack_current;
+    void *result;
+    if ((size_t)(block->alloc_limit - block->alloc) < size)
+        block = MVM_callstack_next_block(tc, size);
+    result = block->alloc;
+    block->alloc += size;
+    return result;
+}
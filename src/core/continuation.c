@@ -68,6 +68,24 @@ void MVM_continuation_control(MVMThreadContext *tc, MVMint64 protect,
     if (!root_frame)
         MVM_exception_throw_adhoc(tc, "No continuation root frame found");
 
+    /* The frames we're capturing will outlive their place in the call stack
+     * region, so move their areas to the heap. After that, nothing above
+     * the jump frame is using the region any more. */
+    {
+        MVMFrame *callee = NULL;
+        MVMFrame *cur    = tc->cur_frame;
+        void     *areas  = NULL;
+        while (cur != jump_frame) {
+            if (cur->callstack_areas)
+                areas = cur->callstack_areas;
+            MVM_frame_move_to_heap(tc, cur, callee, cur == tc->cur_frame ? &res_reg : NULL);
+            callee = cur;
+            cur    = cur->caller;
+        }
+        if (areas)
+            MVM_callstack_free_to(tc, areas);
+    }
+
     /* Create continuation. */
     MVMROOT(tc, code, {
         cont = MVM_repr_alloc_init(tc, tc->instance->boot_types.BOOTContinuation);
@@ -97,7 +115,7 @@ void MVM_continuation_control(MVMThreadContext *tc, MVMint64 protect,
     MVM_frame_dec_ref(tc, tc->cur_frame);
     tc->cur_frame = MVM_frame_inc_ref(tc, jump_frame);
     *(tc->interp_cur_op) = tc->cur_frame->return_address;
-    *(tc->interp_bytecode_start) = tc->cur_frame->static_info->body.bytecode;
+    *(tc->interp_bytecode_start) = tc->cur_frame->effective_bytecode;
     *(tc->interp_reg_base) = tc->cur_frame->work;
     *(tc->interp_cu) = tc->cur_frame->static_info->body.cu;
 
@@ -121,8 +139,11 @@ void MVM_continuation_control(MVMThreadContext *tc, MVMint64 protect,
 
 void MVM_continuation_invoke(MVMThreadContext *tc, MVMContinuation *cont,
                              MVMObject *code, MVMRegister *res_reg) {
-    /* Switch caller of the root to current invoker. */
+    /* Switch caller of the root to current invoker. Frames in the
+     * continuation may be flagged as having their callers' lexicals on the
+     * heap, so make sure that holds for the new callers too. */
     MVMFrame *orig_caller = cont->body.root->caller;
+    MVM_frame_move_caller_envs_to_heap(tc, tc->cur_frame);
     cont->body.root->caller = MVM_frame_inc_ref(tc, tc->cur_frame);
     MVM_frame_dec_ref(tc, orig_caller);
 
@@ -135,7 +156,7 @@ void MVM_continuation_invoke(MVMThreadContext *tc, MVMContinuation *cont,
     MVM_frame_dec_ref(tc, tc->cur_frame);
     tc->cur_frame = MVM_frame_inc_ref(tc, cont->body.top);
     *(tc->interp_cur_op) = cont->body.addr;
-    *(tc->interp_bytecode_start) = tc->cur_frame->static_info->body.bytecode;
+    *(tc->interp_bytecode_start) = tc->cur_frame->effective_bytecode;
     *(tc->interp_reg_base) = tc->cur_frame->work;
     *(tc->interp_cu) = tc->cur_frame->static_info->body.cu;
 
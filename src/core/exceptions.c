@@ -66,7 +66,7 @@ static MVMFrameHandler * search_frame_handlers(MVMThreadContext *tc, MVMFrame *f
     if (f == tc->cur_frame)
         pc = (MVMuint32)(*tc->interp_cur_op - *tc->interp_bytecode_start);
     else
-        pc = (MVMuint32)(f->return_address - sf->body.bytecode);
+        pc = (MVMuint32)(f->return_address - f->effective_bytecode);
     for (i = 0; i < sf->body.num_handlers; i++) {
         MVMuint32 category_mask = sf->body.handlers[i].category_mask;
         if ((category_mask & cat) || ((category_mask & MVM_EX_CAT_CONTROL) && cat != MVM_EX_CAT_CATCH))
@@ -218,29 +218,42 @@ static void cleanup_active_handler(MVMThreadContext *tc, void *sr_data) {
     free(ah);
 }
 
-char * MVM_exception_backtrace_line(MVMThreadContext *tc, MVMFrame *cur_frame, MVMuint16 not_top) {
-    MVMString *filename = cur_frame->static_info->body.cu->body.filename;
-    MVMString *name = cur_frame->static_info->body.name;
+/* Finds the offset into the bytecode that a frame is at, for the purpose of
+ * producing a backtrace. If it is in the body of a frame that was inlined,
+ * hands back the inline too; the offset is then relative to the start of
+ * the inlined body. */
+static MVMSpeshInline * backtrace_position(MVMThreadContext *tc, MVMFrame *cur_frame,
+                                           MVMuint16 not_top, MVMuint32 *offset) {
+    MVMuint8       *cur_op = not_top ? cur_frame->return_address : cur_frame->throw_address;
+    MVMSpeshInline *inl;
+    *offset = cur_op - cur_frame->effective_bytecode;
+    inl = MVM_spesh_inline_at(tc, cur_frame->spesh_cand, *offset > 0 ? *offset - 1 : 0);
+    if (inl)
+        *offset -= inl->start;
+    return inl;
+}
+
+static char * backtrace_line(MVMThreadContext *tc, MVMStaticFrame *sf, MVMuint32 offset, MVMuint16 not_top) {
+    MVMString *filename = sf->body.cu->body.filename;
+    MVMString *name = sf->body.name;
     /* XXX TODO: make the caller pass in a char ** and a length pointer so
      * we can update it if necessary, and the caller can cache it. */
     char *o = malloc(1024);
-    MVMuint8 *cur_op = not_top ? cur_frame->return_address : cur_frame->throw_address;
-    MVMuint32 offset = cur_op - cur_frame->static_info->body.bytecode;
-    MVMuint32 instr = MVM_bytecode_offset_to_instr_idx(tc, cur_frame->static_info, offset);
-    MVMBytecodeAnnotation *annot = MVM_bytecode_resolve_annotation(tc, &cur_frame->static_info->body,
+    MVMuint32 instr = MVM_bytecode_offset_to_instr_idx(tc, sf, offset);
+    MVMBytecodeAnnotation *annot = MVM_bytecode_resolve_annotation(tc, &sf->body,
                                         offset > 0 ? offset - 1 : 0);
 
     MVMuint32 line_number = annot ? annot->line_number : 1;
     MVMuint16 string_heap_index = annot ? annot->filename_string_heap_index : 0;
-    char *tmp1 = annot && string_heap_index < cur_frame->static_info->body.cu->body.num_strings
+    char *tmp1 = annot && string_heap_index < sf->body.cu->body.num_strings
         ? MVM_string_utf8_encode(tc,
-            cur_frame->static_info->body.cu->body.strings[string_heap_index], NULL)
+            sf->body.cu->body.strings[string_heap_index], NULL)
         : NULL;
 
     /* We may be mid-instruction if exception was thrown at an unfortunate
      * point; try to cope with that. */
     if (instr == MVM_BC_ILLEGAL_OFFSET && offset >= 2)
-        instr = MVM_bytecode_offset_to_instr_idx(tc, cur_frame->static_info, offset - 2);
+        instr = MVM_bytecode_offset_to_instr_idx(tc, sf, offset - 2);
 
     snprintf(o, 1024, " %s %s:%u  (%s:%s:%u)",
         not_top ? "from" : "  at",
@@ -259,6 +272,23 @@ char * MVM_exception_backtrace_line(MVMThreadContext *tc, MVMFrame *cur_frame, M
     return o;
 }
 
+/* Produces a backtrace line for a frame. If it is in the body of a frame that
+ * was inlined into it, that gets a line of its own before it. */
+char * MVM_exception_backtrace_line(MVMThreadContext *tc, MVMFrame *cur_frame, MVMuint16 not_top) {
+    MVMuint32       offset;
+    MVMSpeshInline *inl = backtrace_position(tc, cur_frame, not_top, &offset);
+    if (inl) {
+        char *inlined = backtrace_line(tc, inl->sf, offset, not_top);
+        char *caller  = backtrace_line(tc, cur_frame->static_info, inl->return_offset, 1);
+        char *o       = malloc(strlen(inlined) + strlen(caller) + 2);
+        sprintf(o, "%s\n%s", inlined, caller);
+        free(inlined);
+        free(caller);
+        return o;
+    }
+    return backtrace_line(tc, cur_frame->static_info, offset, not_top);
+}
+
 /* Returns a list of hashes containing file, line, sub and annotations. */
 MVMObject * MVM_exception_backtrace(MVMThreadContext *tc, MVMObject *ex_obj) {
     MVMFrame *cur_frame;
@@ -288,38 +318,48 @@ MVMObject * MVM_exception_backtrace(MVMThreadContext *tc, MVMObject *ex_obj) {
     arr = MVM_repr_alloc_init(tc, tc->instance->boot_types.BOOTArray);
 
     while (cur_frame != NULL) {
-        MVMuint8             *cur_op = count ? cur_frame->return_address : cur_frame->throw_address;
-        MVMuint32             offset = cur_op - cur_frame->static_info->body.bytecode;
-        MVMBytecodeAnnotation *annot = MVM_bytecode_resolve_annotation(tc, &cur_frame->static_info->body,
-                                            offset > 0 ? offset - 1 : 0);
-        MVMint32              fshi   = annot ? (MVMint32)annot->filename_string_heap_index : -1;
-        char            *line_number = malloc(16);
-        snprintf(line_number, 16, "%d", annot ? annot->line_number : 1);
-
-        /* annotations hash will contain "file" and "line" */
-        annotations = MVM_repr_alloc_init(tc, tc->instance->boot_types.BOOTHash);
-
-        /* file */
-        if (fshi >= 0 && fshi < cur_frame->static_info->body.cu->body.num_strings)
-            value = MVM_repr_box_str(tc, MVM_hll_current(tc)->str_box_type,
-                        cur_frame->static_info->body.cu->body.strings[fshi]);
-        else
-            value = MVM_repr_box_str(tc, MVM_hll_current(tc)->str_box_type,
-                        cur_frame->static_info->body.cu->body.filename);
-        MVM_repr_bind_key_o(tc, annotations, k_file, value);
-
-        /* line */
-        value = (MVMObject *)MVM_string_ascii_decode_nt(tc, tc->instance->VMString, line_number);
-        value = MVM_repr_box_str(tc, MVM_hll_current(tc)->str_box_type, (MVMString *)value);
-        MVM_repr_bind_key_o(tc, annotations, k_line, value);
-        free(line_number);
-
-        /* row will contain "sub" and "annotations" */
-        row = MVM_repr_alloc_init(tc, tc->instance->boot_types.BOOTHash);
-        MVM_repr_bind_key_o(tc, row, k_sub, cur_frame->code_ref);
-        MVM_repr_bind_key_o(tc, row, k_anno, annotations);
-
-        MVM_repr_push_o(tc, arr, row);
+        /* If the frame is in the body of an inlined frame, we produce a row
+         * for that first, then one for the frame itself. */
+        MVMuint32       frame_offset;
+        MVMSpeshInline *inl = backtrace_position(tc, cur_frame, count, &frame_offset);
+        MVMuint32       i;
+        for (i = inl ? 0 : 1; i < 2; i++) {
+            MVMStaticFrame       *sf     = i ? cur_frame->static_info : inl->sf;
+            MVMuint32             offset = !i ? frame_offset : inl ? inl->return_offset : frame_offset;
+            MVMBytecodeAnnotation *annot = MVM_bytecode_resolve_annotation(tc, &sf->body,
+                                                offset > 0 ? offset - 1 : 0);
+            MVMint32              fshi   = annot ? (MVMint32)annot->filename_string_heap_index : -1;
+            char            *line_number = malloc(16);
+            snprintf(line_number, 16, "%d", annot ? annot->line_number : 1);
+            if (annot)
+                free(annot);
+
+            /* annotations hash will contain "file" and "line" */
+            annotations = MVM_repr_alloc_init(tc, tc->instance->boot_types.BOOTHash);
+
+            /* file */
+            sf = i ? cur_frame->static_info : inl->sf;
+            if (fshi >= 0 && fshi < sf->body.cu->body.num_strings)
+                value = MVM_repr_box_str(tc, MVM_hll_current(tc)->str_box_type,
+                            sf->body.cu->body.strings[fshi]);
+            else
+                value = MVM_repr_box_str(tc, MVM_hll_current(tc)->str_box_type,
+                            sf->body.cu->body.filename);
+            MVM_repr_bind_key_o(tc, annotations, k_file, value);
+
+            /* line */
+            value = (MVMObject *)MVM_string_ascii_decode_nt(tc, tc->instance->VMString, line_number);
+            value = MVM_repr_box_str(tc, MVM_hll_current(tc)->str_box_type, (MVMString *)value);
+            MVM_repr_bind_key_o(tc, annotations, k_line, value);
+            free(line_number);
+
+            /* row will contain "sub" and "annotations" */
+            row = MVM_repr_alloc_init(tc, tc->instance->boot_types.BOOTHash);
+            MVM_repr_bind_key_o(tc, row, k_sub, i ? cur_frame->code_ref : inl->code);
+            MVM_repr_bind_key_o(tc, row, k_anno, annotations);
+
+            MVM_repr_push_o(tc, arr, row);
+        }
         cur_frame = cur_frame->caller;
         count++;
     }
@@ -346,12 +386,22 @@ MVMObject * MVM_exception_backtrace_strings(MVMThreadContext *tc, MVMObject *ex_
     MVMROOT(tc, arr, {
         MVMuint32 count = 0;
         while (cur_frame != NULL) {
-            char      *line     = MVM_exception_backtrace_line(tc, cur_frame, count++);
-            MVMString *line_str = MVM_string_utf8_decode(tc, tc->instance->VMString, line, strlen(line));
-            MVMObject *line_obj = MVM_repr_box_str(tc, tc->instance->boot_types.BOOTStr, line_str);
-            MVM_repr_push_o(tc, arr, line_obj);
+            /* An inlined frame gets an entry of its own. */
+            MVMuint32       offset;
+            MVMSpeshInline *inl = backtrace_position(tc, cur_frame, count, &offset);
+            MVMuint32       i;
+            for (i = inl ? 0 : 1; i < 2; i++) {
+                char      *line     = i
+                    ? backtrace_line(tc, cur_frame->static_info, inl ? inl->return_offset : offset,
+                        inl ? 1 : count)
+                    : backtrace_line(tc, inl->sf, offset, count);
+                MVMString *line_str = MVM_string_utf8_decode(tc, tc->instance->VMString, line, strlen(line));
+                MVMObject *line_obj = MVM_repr_box_str(tc, tc->instance->boot_types.BOOTStr, line_str);
+                MVM_repr_push_o(tc, arr, line_obj);
+                free(line);
+            }
             cur_frame = cur_frame->caller;
-            free(line);
+            count++;
         }
     });
 
@@ -442,6 +492,7 @@ void MVM_exception_throwobj(MVMThreadContext *tc, MVMuint8 mode, MVMObject *ex_o
         panic_unhandled_ex(tc, ex);
 
     if (!ex->body.origin) {
+        MVM_frame_move_caller_envs_to_heap(tc, tc->cur_frame);
         ex->body.origin = MVM_frame_inc_ref(tc, tc->cur_frame);
         tc->cur_frame->throw_address = *(tc->interp_cur_op);
         tc->cur_frame->keep_caller   = 1;
@@ -569,6 +620,7 @@ void MVM_exception_throw_adhoc_va(MVMThreadContext *tc, const char *messageForma
         free(c_message);
         MVM_ASSIGN_REF(tc, &(ex->common.header), ex->body.message, message);
         if (tc->cur_frame) {
+            MVM_frame_move_caller_envs_to_heap(tc, tc->cur_frame);
             ex->body.origin = MVM_frame_inc_ref(tc, tc->cur_frame);
             tc->cur_frame->throw_address = *(tc->interp_cur_op);
             tc->cur_frame->keep_caller   = 1;
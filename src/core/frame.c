@@ -17,6 +17,12 @@ void prepare_and_verify_static_frame(MVMThreadContext *tc, MVMStaticFrame *stati
     /* Validate the bytecode. */
     MVM_validate_static_frame(tc, static_frame);
 
+    /* Make a copy of the bytecode using superinstructions, if it helps. */
+    if (tc->instance->superinstr_enabled)
+        static_frame_body->superinstr_bytecode = MVM_superinstr_fuse(tc,
+            static_frame_body->cu, static_frame_body->bytecode,
+            static_frame_body->bytecode_size);
+
     /* Obtain an index to each threadcontext's pool table */
     static_frame_body->pool_index = MVM_incr(&tc->instance->num_frame_pools);
     if (static_frame_body->pool_index >= tc->frame_pool_table_size) {
@@ -58,17 +64,20 @@ MVMFrame * MVM_frame_dec_ref(MVMThreadContext *tc, MVMFrame *frame) {
         if (frame->caller)
             frame->caller = MVM_frame_dec_ref(tc, frame->caller);
 
+        /* Any env and work areas it has are on the heap by now; free them,
+         * as next time it's used they'll come from the call stack region. */
+        if (frame->env) {
+            free(frame->env);
+            frame->env = NULL;
+        }
+        if (frame->work) {
+            free(frame->work);
+            frame->work = NULL;
+        }
+
         if (node && MVM_load(&node->ref_count) >= MVMFramePoolLengthLimit) {
             /* There's no room on the free list, so destruction.*/
-            if (frame->env) {
-                free(frame->env);
-                frame->env = NULL;
-            }
-            if (frame->work) {
-                MVM_args_proc_cleanup(tc, &frame->params);
-                free(frame->work);
-                frame->work = NULL;
-            }
+            MVM_args_proc_cleanup(tc, &frame->params);
             free(frame);
         }
         else { /* Unshift it to the free list */
@@ -89,11 +98,14 @@ MVMFrame * MVM_frame_dec_ref(MVMThreadContext *tc, MVMFrame *frame) {
 MVMFrame * autoclose(MVMThreadContext *tc, MVMStaticFrame *needed) {
     MVMFrame *result;
 
-    /* First, see if we can find one on the call stack; return it if so. */
+    /* First, see if we can find one on the call stack; return it if so. It
+     * is captured, so its lexicals have to go to the heap. */
     MVMFrame *candidate = tc->cur_frame;
     while (candidate) {
-        if (candidate->static_info->body.bytecode == needed->body.bytecode)
+        if (candidate->static_info->body.bytecode == needed->body.bytecode) {
+            MVM_frame_move_env_to_heap(tc, candidate);
             return candidate;
+        }
         candidate = candidate->caller;
     }
 
@@ -123,21 +135,33 @@ void MVM_frame_invoke(MVMThreadContext *tc, MVMStaticFrame *static_frame,
 
     MVMuint32 pool_index;
     MVMFrame *node;
-    int fresh = 0;
+    MVMuint32 env_size, work_size, num_locals;
     MVMStaticFrameBody *static_frame_body = &static_frame->body;
+    MVMSpeshCandidate *spesh_cand;
+    MVMJitCode *jit_code;
 
     /* If the frame was never invoked before, need initial calculations
      * and verification. */
     if (!static_frame_body->invoked)
         prepare_and_verify_static_frame(tc, static_frame);
 
+    /* See if there's a specialization of the bytecode that we can use for
+     * this call (or if it's time to make one). */
+    spesh_cand = MVM_spesh_candidate_select(tc, static_frame, callsite, args);
+
+    /* Also see if we've JIT-compiled code for it. */
+    jit_code = tc->instance->jit_enabled
+        ? MVM_jit_select(tc, static_frame, spesh_cand)
+        : NULL;
+
     pool_index = static_frame_body->pool_index;
     node = tc->frame_pool_table[pool_index];
 
     if (node == NULL) {
-        fresh = 1;
         frame = malloc(sizeof(MVMFrame));
         frame->params.named_used = NULL;
+        frame->env  = NULL;
+        frame->work = NULL;
 
         /* Ensure special return pointers and continuation tags are null. */
         frame->special_return = NULL;
@@ -150,54 +174,74 @@ void MVM_frame_invoke(MVMThreadContext *tc, MVMStaticFrame *static_frame,
         frame = node;
     }
 
-#if MVM_HLL_PROFILE_CALLS
-    frame->profile_index = tc->profile_index;
-    tc->profile_data[frame->profile_index].duration_nanos = MVM_platform_now();
-    tc->profile_data[frame->profile_index].callsite_id = 0; /* XXX get a real callsite id */
-    tc->profile_data[frame->profile_index].code_id = 0; /* XXX get a real code id */
-
-    /* increment the profile data index */
-    ++tc->profile_index;
-
-    if (tc->profile_index == tc->profile_data_size) {
-        tc->profile_data_size *= 2;
-        tc->profile_data = realloc(tc->profile_data, tc->profile_data_size);
-    }
-#endif
-
     /* Copy thread context (back?) into the frame. */
     frame->tc = tc;
 
     /* Set static frame. */
     frame->static_info = static_frame;
 
-    /* Store the code ref (NULL at the top-level). */
-    frame->code_ref = code_ref;
-
-    /* Allocate space for lexicals and work area, copying the default lexical
-     * environment into place. */
-    if (static_frame_body->env_size) {
-        if (fresh)
-            frame->env = malloc(static_frame_body->env_size);
-        memcpy(frame->env, static_frame_body->static_env, static_frame_body->env_size);
+    /* Set the bytecode we'll run. A specialization may have more locals
+     * than the static frame, if it has frames inlined into it. */
+    frame->spesh_cand = spesh_cand;
+    if (spesh_cand) {
+        frame->effective_bytecode    = spesh_cand->superinstr_bytecode
+            ? spesh_cand->superinstr_bytecode
+            : spesh_cand->bytecode;
+        frame->effective_spesh_slots = spesh_cand->spesh_slots;
+        work_size  = spesh_cand->work_size;
+        num_locals = spesh_cand->num_locals;
     }
     else {
-        frame->env = NULL;
+        frame->effective_bytecode    = static_frame_body->superinstr_bytecode
+            ? static_frame_body->superinstr_bytecode
+            : static_frame_body->bytecode;
+        frame->effective_spesh_slots = NULL;
+        work_size  = static_frame_body->work_size;
+        num_locals = static_frame_body->num_locals;
     }
-    if (static_frame_body->work_size) {
-        if (fresh || !frame->work)
-            frame->work = malloc(static_frame_body->work_size);
-        memset(frame->work, 0, static_frame_body->work_size);
+    if (jit_code)
+        frame->effective_bytecode = jit_code->bytecode;
+    frame->jit_code = jit_code;
+
+    /* Store the code ref (NULL at the top-level). */
+    frame->code_ref = code_ref;
+
+    /* Allocate space for lexicals and work area in the call stack region,
+     * copying the default lexical environment into place. Only the env and
+     * work areas live in the region; the MVMFrame itself still comes from
+     * the frame pool and is reference counted, since closures, contexts,
+     * continuations and exceptions all hold on to it directly. */
+    env_size = static_frame_body->env_size;
+    if (env_size || work_size) {
+        char *areas = MVM_callstack_alloc(tc, env_size + work_size);
+        if (env_size) {
+            frame->env = (MVMRegister *)areas;
+            memcpy(frame->env, static_frame_body->static_env, env_size);
+        }
+        else {
+            frame->env = NULL;
+        }
+        if (work_size) {
+            /* Only the locals need zeroing, for the GC's sake; the args
+             * buffer after them is not scanned until a callsite is set up,
+             * by which point its arguments have been written. */
+            frame->work = (MVMRegister *)(areas + env_size);
+            memset(frame->work, 0, num_locals * sizeof(MVMRegister));
+        }
+        else {
+            frame->work = NULL;
+        }
+        frame->callstack_areas = areas;
     }
     else {
+        frame->env  = NULL;
         frame->work = NULL;
+        frame->callstack_areas = NULL;
     }
 
     /* Calculate args buffer position and make sure current call site starts
      * empty. */
-    frame->args = static_frame_body->work_size ?
-        frame->work + static_frame_body->num_locals :
-        NULL;
+    frame->args = work_size ? frame->work + num_locals : NULL;
     frame->cur_args_callsite = NULL;
 
     /* Outer. */
@@ -240,6 +284,7 @@ void MVM_frame_invoke(MVMThreadContext *tc, MVMStaticFrame *static_frame,
     else
         frame->caller = NULL;
     frame->keep_caller = 0;
+    frame->callers_on_heap = 0;
     frame->in_continuation = 0;
 
     /* Initial reference count is 1 by virtue of it being the currently
@@ -258,11 +303,15 @@ void MVM_frame_invoke(MVMThreadContext *tc, MVMStaticFrame *static_frame,
     /* Clear frame flags. */
     frame->flags = 0;
 
+    /* Let the profiler know we're entering the frame. */
+    if (tc->instance->profiling)
+        MVM_profile_log_enter(tc, static_frame);
+
     /* Update interpreter and thread context, so next execution will use this
      * frame. */
     tc->cur_frame = frame;
-    *(tc->interp_cur_op) = static_frame_body->bytecode;
-    *(tc->interp_bytecode_start) = static_frame_body->bytecode;
+    *(tc->interp_cur_op) = frame->effective_bytecode;
+    *(tc->interp_bytecode_start) = frame->effective_bytecode;
     *(tc->interp_reg_base) = frame->work;
     *(tc->interp_cu) = static_frame_body->cu;
 
@@ -341,8 +390,10 @@ MVMFrame * MVM_frame_create_context_only(MVMThreadContext *tc, MVMStaticFrame *s
     /* Copy thread context into the frame. */
     frame->tc = tc;
 
-    /* Set static frame. */
+    /* Set static frame and bytecode. */
     frame->static_info = static_frame;
+    frame->effective_bytecode = static_frame->body.bytecode;
+    frame->jit_code = NULL;
 
     /* Store the code ref. */
     frame->code_ref = code_ref;
@@ -359,12 +410,75 @@ MVMFrame * MVM_frame_create_context_only(MVMThreadContext *tc, MVMStaticFrame *s
     return frame;
 }
 
+/* Moves the lexicals of a frame from the call stack region to the heap, if
+ * they are still there. This must happen as soon as something that may
+ * outlive the frame's invocation, or be used from another thread, captures
+ * it: a closure, a context, or a kept caller chain. Doing it then, on the
+ * thread running the frame, means that by the time the frame returns nobody
+ * else can be using its areas in the region. */
+void MVM_frame_move_env_to_heap(MVMThreadContext *tc, MVMFrame *frame) {
+    MVMuint32    env_size;
+    MVMRegister *env;
+    if (!frame->env || (void *)frame->env != frame->callstack_areas || frame->tc != tc)
+        return;
+    env_size = frame->static_info->body.env_size;
+    env      = malloc(env_size);
+    memcpy(env, frame->env, env_size);
+    frame->env = env;
+}
+
+/* Moves the lexicals of a frame and all of its callers to the heap, for when
+ * the caller chain may be kept beyond their invocations, or walked by another
+ * thread looking for dynamic variables. Frames are flagged once done, so we
+ * can stop at one next time. */
+void MVM_frame_move_caller_envs_to_heap(MVMThreadContext *tc, MVMFrame *frame) {
+    while (frame && !frame->callers_on_heap && frame->tc == tc) {
+        MVM_frame_move_env_to_heap(tc, frame);
+        frame->callers_on_heap = 1;
+        frame = frame->caller;
+    }
+}
+
+/* Moves the env and work areas of a frame from the call stack region to the
+ * heap, for when the frame is going to outlive its place on the call stack.
+ * Pointers into the work area held by the frame are updated, as are those
+ * held by the frame it called (if any is passed) and the register pointed
+ * to by res_reg (if passed). */
+static MVMRegister * rebase(MVMRegister *ptr, MVMRegister *from, MVMRegister *to, MVMuint32 size) {
+    return ptr >= from && (char *)ptr < (char *)from + size ? to + (ptr - from) : ptr;
+}
+void MVM_frame_move_to_heap(MVMThreadContext *tc, MVMFrame *frame, MVMFrame *callee,
+                            MVMRegister **res_reg) {
+    MVMStaticFrameBody *sfb = &frame->static_info->body;
+    MVMSpeshCandidate *cand = frame->spesh_cand;
+    if (!frame->callstack_areas)
+        return;
+    MVM_frame_move_env_to_heap(tc, frame);
+    if (frame->work) {
+        MVMuint32 work_size = cand ? cand->work_size : sfb->work_size;
+        MVMRegister *old_work = frame->work;
+        MVMRegister *work = malloc(work_size);
+        memcpy(work, old_work, work_size);
+        frame->work = work;
+        frame->args = work + (cand ? cand->num_locals : sfb->num_locals);
+        frame->return_value = rebase(frame->return_value, old_work, work, work_size);
+        if (callee)
+            callee->params.args = rebase(callee->params.args, old_work, work, work_size);
+        if (res_reg)
+            *res_reg = rebase(*res_reg, old_work, work, work_size);
+    }
+    frame->callstack_areas = NULL;
+}
+
 /* Removes a single frame, as part of a return or unwind. Done after any exit
  * handler has already been run. */
 static MVMuint64 remove_one_frame(MVMThreadContext *tc, MVMuint8 unwind) {
     MVMFrame *returner = tc->cur_frame;
     MVMFrame *caller   = returner->caller;
 
+    if (tc->instance->profiling)
+        MVM_profile_log_exit(tc, returner->static_info);
+
     /* Some cleanup we only need do if we're not a frame involved in a
      * continuation (otherwise we need to allow for multi-shot
      * re-invocation). */
@@ -403,11 +517,18 @@ static MVMuint64 remove_one_frame(MVMThreadContext *tc, MVMuint8 unwind) {
         }
     }
 
-#if MVM_HLL_PROFILE_CALLS
-    tc->profile_data[returner->profile_index].duration_nanos =
-        MVM_platform_now() -
-        tc->profile_data[returner->profile_index].duration_nanos;
-#endif
+    /* Release the frame's areas in the call stack region. If anything that
+     * outlives this invocation captured the frame, its lexicals were moved
+     * to the heap at that point, so nobody else can see these. */
+    if (returner->callstack_areas) {
+        void *areas = returner->callstack_areas;
+        if ((void *)returner->env == areas)
+            returner->env = NULL;
+        returner->work = NULL;
+        returner->args = NULL;
+        returner->callstack_areas = NULL;
+        MVM_callstack_free_to(tc, areas);
+    }
 
     /* Decrement the frame's ref-count by the 1 it got by virtue of being the
      * currently executing frame. */
@@ -417,7 +538,7 @@ static MVMuint64 remove_one_frame(MVMThreadContext *tc, MVMuint8 unwind) {
     if (caller && returner != tc->thread_entry_frame) {
         tc->cur_frame = caller;
         *(tc->interp_cur_op) = caller->return_address;
-        *(tc->interp_bytecode_start) = caller->static_info->body.bytecode;
+        *(tc->interp_bytecode_start) = caller->effective_bytecode;
         *(tc->interp_reg_base) = caller->work;
         *(tc->interp_cu) = caller->static_info->body.cu;
 
@@ -572,6 +693,7 @@ void MVM_frame_capturelex(MVMThreadContext *tc, MVMObject *code) {
     code_obj = (MVMCode *)code;
     if (code_obj->body.outer)
         MVM_frame_dec_ref(tc, code_obj->body.outer);
+    MVM_frame_move_env_to_heap(tc, tc->cur_frame);
     code_obj->body.outer = MVM_frame_inc_ref(tc, tc->cur_frame);
 }
 
@@ -590,6 +712,7 @@ MVMObject * MVM_frame_takeclosure(MVMThreadContext *tc, MVMObject *code) {
 
     MVM_ASSIGN_REF(tc, &(closure->common.header), closure->body.sf, ((MVMCode *)code)->body.sf);
     MVM_ASSIGN_REF(tc, &(closure->common.header), closure->body.name, ((MVMCode *)code)->body.name);
+    MVM_frame_move_env_to_heap(tc, tc->cur_frame);
     closure->body.outer = MVM_frame_inc_ref(tc, tc->cur_frame);
     MVM_ASSIGN_REF(tc, &(closure->common.header), closure->body.code_object, ((MVMCode *)code)->body.code_object);
 
@@ -877,6 +1000,9 @@ MVMObject * MVM_frame_find_invokee(MVMThreadContext *tc, MVMObject *code, MVMCal
                     new->num_pos        = orig->num_pos + 1;
                     new->has_flattening = orig->has_flattening;
                     new->with_invocant  = NULL;
+                    new->named_plan     = orig->named_plan
+                        ? calloc((orig->arg_count - orig->num_pos) / 2, sizeof(MVMString *))
+                        : NULL;
                     *tweak_cs = orig->with_invocant = new;
                 }
                 memmove(tc->cur_frame->args + 1, tc->cur_frame->args,
@@ -899,6 +1025,7 @@ MVMObject * MVM_frame_context_wrapper(MVMThreadContext *tc, MVMFrame *f) {
 
     if (!ctx) {
         ctx = MVM_repr_alloc_init(tc, tc->instance->boot_types.BOOTContext);
+        MVM_frame_move_caller_envs_to_heap(tc, f);
         ((MVMContext *)ctx)->body.context = MVM_frame_inc_ref(tc, f);
 
         if (MVM_casptr(&f->context_object, NULL, ctx) != NULL) {
@@ -923,14 +1050,17 @@ MVMFrame * MVM_frame_clone(MVMThreadContext *tc, MVMFrame *f) {
         clone->env = malloc(f->static_info->body.env_size);
         memcpy(clone->env, f->env, f->static_info->body.env_size);
     }
-    if (f->static_info->body.work_size) {
-        clone->work = malloc(f->static_info->body.work_size);
-        memcpy(clone->work, f->work, f->static_info->body.work_size);
-        clone->args = clone->work + f->static_info->body.num_locals;
+    if (f->work) {
+        MVMSpeshCandidate *cand = f->spesh_cand;
+        MVMuint32 work_size = cand ? cand->work_size : f->static_info->body.work_size;
+        clone->work = malloc(work_size);
+        memcpy(clone->work, f->work, work_size);
+        clone->args = clone->work + (cand ? cand->num_locals : f->static_info->body.num_locals);
     }
 
-    /* Ref-count of the clone is 1. */
+    /* Ref-count of the clone is 1, and its areas are on the heap. */
     clone->ref_count = 1;
+    clone->callstack_areas = NULL;
 
     /* If there's an outer, there's now an extra frame pointing at it. */
     if (clone->outer)
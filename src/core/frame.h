@@ -71,6 +71,17 @@ struct MVMFrame {
      * this kind of frame, including information needed to GC-trace it. */
     MVMStaticFrame *static_info;
 
+    /* The bytecode we are executing for this frame; either the static
+     * frame's bytecode, or that of a specialization of it. */
+    MVMuint8 *effective_bytecode;
+
+    /* The specialization we are running, if any, and its spesh slots. */
+    MVMSpeshCandidate *spesh_cand;
+    MVMCollectable   **effective_spesh_slots;
+
+    /* The JIT-compiled code for the bytecode we are executing, if any. */
+    MVMJitCode *jit_code;
+
     /* The code ref object for this frame. */
     MVMObject *code_ref;
 
@@ -110,6 +121,12 @@ struct MVMFrame {
      * for error reporting. */
     MVMuint8 *throw_address;
 
+    /* Where the frame's env and work areas start in the thread's call stack
+     * region, which they are released back to on return; NULL if they are
+     * on the heap. The env comes first, so it has been moved to the heap if
+     * it is no longer at this address. */
+    void *callstack_areas;
+
     /* Linked list of any continuation tags we have. */
     MVMContinuationTag *continuation_tags;
 
@@ -122,17 +139,16 @@ struct MVMFrame {
      * unwind; used to make sure we can get a backtrace after an exception. */
     MVMuint8 keep_caller;
 
+    /* Flags that the lexicals of this frame and all of its callers have been
+     * moved to the heap. */
+    MVMuint8 callers_on_heap;
+
     /* Flags that the frame has been captured in a continuation, and as
      * such we should keep everything in place for multiple invocations. */
     MVMuint8 in_continuation;
 
     /* Assorted frame flags. */
     MVMuint8 flags;
-
-#if MVM_HLL_PROFILE_CALLS
-    /* Index of the profile data record. */
-    MVMuint32 profile_index;
-#endif
 };
 
 /* How do we invoke this thing? Specifies either an attribute to look at for
@@ -183,3 +199,7 @@ MVMuint16 MVM_frame_lexical_primspec(MVMThreadContext *tc, MVMFrame *f, MVMStrin
 MVM_PUBLIC MVMObject * MVM_frame_find_invokee(MVMThreadContext *tc, MVMObject *code, MVMCallsite **tweak_cs);
 MVMObject * MVM_frame_context_wrapper(MVMThreadContext *tc, MVMFrame *f);
 MVMFrame * MVM_frame_clone(MVMThreadContext *tc, MVMFrame *f);
+void MVM_frame_move_env_to_heap(MVMThreadContext *tc, MVMFrame *frame);
+void MVM_frame_move_caller_envs_to_heap(MVMThreadContext *tc, MVMFrame *frame);
+void MVM_frame_move_to_heap(MVMThreadContext *tc, MVMFrame *frame, MVMFrame *callee,
+    MVMRegister **res_reg);
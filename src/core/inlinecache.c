@@ -0,0 +1,144 @@
+#include "moar.h"
+
+/* Gets the number of inline cache sites a static frame has room for. */
+static MVMuint32 num_sites(MVMStaticFrameBody *sfb) {
+    return (sfb->bytecode_size >> MVM_INLINE_CACHE_SITE_SHIFT) + 1;
+}
+
+/* Fills in an entry we have claimed, making it visible by setting the type
+ * only once the rest is in place. */
+static void fill_entry(MVMThreadContext *tc, MVMStaticFrame *sf, MVMInlineCacheEntry *entry,
+                       MVMuint64 type_cache_id, AO_t gen, MVMObject *meth) {
+    entry->meth = meth;
+    MVM_gc_write_barrier(tc, (MVMCollectable *)sf, (MVMCollectable *)meth);
+    MVM_barrier();
+    MVM_store(&entry->method_cache_gen, gen);
+    MVM_store(&entry->type_cache_id, type_cache_id);
+}
+
+/* Adds a type to method mapping to the inline cache for the given site. If
+ * the type has an entry from an older method cache it is replaced; if not, a
+ * free entry is used, if there's still one. */
+static void add_entry(MVMThreadContext *tc, MVMStaticFrame *sf, MVMuint32 offset,
+                      MVMuint64 type_cache_id, AO_t gen, MVMObject *meth) {
+    MVMStaticFrameBody *sfb = &sf->body;
+    MVMInlineCache     *ic;
+    MVMuint32           i;
+
+    /* Make sure we have the sites array and the cache for this site; other
+     * threads may be racing to do the same. */
+    if (!sfb->inline_caches) {
+        MVMInlineCache **sites = calloc(num_sites(sfb), sizeof(MVMInlineCache *));
+        if (MVM_casptr(&sfb->inline_caches, NULL, sites) != NULL)
+            free(sites);
+    }
+    ic = sfb->inline_caches[offset >> MVM_INLINE_CACHE_SITE_SHIFT];
+    if (!ic) {
+        MVMInlineCache *new_ic = calloc(1, sizeof(MVMInlineCache));
+        if (MVM_casptr(&sfb->inline_caches[offset >> MVM_INLINE_CACHE_SITE_SHIFT], NULL, new_ic) != NULL)
+            free(new_ic);
+        ic = sfb->inline_caches[offset >> MVM_INLINE_CACHE_SITE_SHIFT];
+    }
+
+    /* Entries are claimed by setting their type to 1, so other threads
+     * neither match them nor claim them while we fill them in. */
+    for (i = 0; i < MVM_INLINE_CACHE_MAX_TYPES; i++) {
+        MVMInlineCacheEntry *entry = &ic->entries[i];
+        if ((MVMuint64)MVM_load(&entry->type_cache_id) == type_cache_id) {
+            if (MVM_load(&entry->method_cache_gen) != gen &&
+                    (MVMuint64)MVM_cas(&entry->type_cache_id, type_cache_id, 1) == type_cache_id)
+                fill_entry(tc, sf, entry, type_cache_id, gen, meth);
+            return;
+        }
+    }
+    for (i = 0; i < MVM_INLINE_CACHE_MAX_TYPES; i++) {
+        MVMInlineCacheEntry *entry = &ic->entries[i];
+        if (MVM_cas(&entry->type_cache_id, 0, 1) == 0) {
+            fill_entry(tc, sf, entry, type_cache_id, gen, meth);
+            return;
+        }
+    }
+}
+
+/* Looks up a method for the findmeth instruction at the given bytecode
+ * offset in the static frame, using and updating its inline cache. Falls
+ * back to MVM_6model_find_method for anything not in the method cache. */
+void MVM_inline_cache_find_method(MVMThreadContext *tc, MVMStaticFrame *sf, MVMuint32 offset,
+                                  MVMObject *obj, MVMString *name, MVMRegister *res) {
+    MVMInlineCache **sites = sf->body.inline_caches;
+    MVMObject       *cache;
+    AO_t             gen;
+
+    if (!obj) {
+        MVM_6model_find_method(tc, obj, name, res);
+        return;
+    }
+
+    /* See if we've already seen this type at this site, since it last
+     * published a method cache. An entry may be refilled for another type
+     * while we read it, so check it still has our type once we have the
+     * method. */
+    gen = MVM_load(&STABLE(obj)->method_cache_gen);
+    if (sites) {
+        MVMInlineCache *ic = sites[offset >> MVM_INLINE_CACHE_SITE_SHIFT];
+        if (ic) {
+            MVMuint64 type_cache_id = STABLE(obj)->type_cache_id;
+            MVMuint32 i;
+            for (i = 0; i < MVM_INLINE_CACHE_MAX_TYPES; i++) {
+                MVMInlineCacheEntry *entry = &ic->entries[i];
+                if ((MVMuint64)MVM_load(&entry->type_cache_id) == type_cache_id) {
+                    if (MVM_load(&entry->method_cache_gen) == gen) {
+                        MVMObject *meth = entry->meth;
+                        MVM_barrier();
+                        if ((MVMuint64)MVM_load(&entry->type_cache_id) == type_cache_id) {
+                            res->o = meth;
+                            return;
+                        }
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    /* If not, and it's in the method cache, cache it here too. */
+    cache = STABLE(obj)->method_cache;
+    if (cache && IS_CONCRETE(cache)) {
+        MVMObject *meth = MVM_repr_at_key_o(tc, cache, name);
+        if (meth) {
+            add_entry(tc, sf, offset, STABLE(obj)->type_cache_id, gen, meth);
+            res->o = meth;
+            return;
+        }
+    }
+
+    /* Otherwise, do the full lookup. */
+    MVM_6model_find_method(tc, obj, name, res);
+}
+
+/* Adds the methods held in the inline caches of a static frame to the GC
+ * worklist. */
+void MVM_inline_cache_mark(MVMThreadContext *tc, MVMStaticFrameBody *sfb, MVMGCWorklist *worklist) {
+    MVMuint32 i, j, n;
+    if (!sfb->inline_caches)
+        return;
+    n = num_sites(sfb);
+    for (i = 0; i < n; i++) {
+        MVMInlineCache *ic = sfb->inline_caches[i];
+        if (ic)
+            for (j = 0; j < MVM_INLINE_CACHE_MAX_TYPES; j++)
+                if (ic->entries[j].meth)
+                    MVM_gc_worklist_add(tc, worklist, &ic->entries[j].meth);
+    }
+}
+
+/* Frees the inline caches of a static frame. */
+void MVM_inline_cache_destroy(MVMThreadContext *tc, MVMStaticFrameBody *sfb) {
+    MVMuint32 i, n;
+    if (!sfb->inline_caches)
+        return;
+    n = num_sites(sfb);
+    for (i = 0; i < n; i++)
+        MVM_checked_free_null(sfb->inline_caches[i]);
+    MVM_checked_free_null(sfb->inline_caches);
+}
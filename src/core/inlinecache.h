@@ -0,0 +1,34 @@
+/* Maximum number of types that a method lookup site will cache methods for;
+ * sites that see more types than this just do the full lookup. */
+#define MVM_INLINE_CACHE_MAX_TYPES  4
+
+/* Sites are found by bytecode offset shifted down by this much; no op that
+ * has an inline cache is shorter than 1 << MVM_INLINE_CACHE_SITE_SHIFT
+ * bytes, so two such ops never map to the same site. */
+#define MVM_INLINE_CACHE_SITE_SHIFT 3
+
+/* An entry in an inline cache, mapping a type to the method that was found
+ * for it. */
+struct MVMInlineCacheEntry {
+    /* The type_cache_id of the type; 0 if the entry is unused, and 1 while
+     * it's being filled in. */
+    AO_t type_cache_id;
+
+    /* The method_cache_gen of the type when the method was found. */
+    AO_t method_cache_gen;
+
+    /* The method. */
+    MVMObject *meth;
+};
+
+/* The inline cache for a single method lookup instruction. A type has at
+ * most one entry; when it publishes a new method cache, its entry stops
+ * matching and is refilled on the next lookup. */
+struct MVMInlineCache {
+    MVMInlineCacheEntry entries[MVM_INLINE_CACHE_MAX_TYPES];
+};
+
+void MVM_inline_cache_find_method(MVMThreadContext *tc, MVMStaticFrame *sf, MVMuint32 offset,
+    MVMObject *obj, MVMString *name, MVMRegister *res);
+void MVM_inline_cache_mark(MVMThreadContext *tc, MVMStaticFrameBody *sfb, MVMGCWorklist *worklist);
+void MVM_inline_cache_destroy(MVMThreadContext *tc, MVMStaticFrameBody *sfb);
@@ -20,6 +20,7 @@ struct MVMBootTypes {
     MVMObject *BOOTCompUnit;
     MVMObject *BOOTMultiCache;
     MVMObject *BOOTContinuation;
+    MVMObject *BOOTStrBuilder;
 };
 
 /* Various raw types that don't need a HOW */
@@ -48,14 +49,6 @@ struct MVMReprRegistry {
     UT_hash_handle hash_handle;
 };
 
-#if MVM_HLL_PROFILE_CALLS
-typedef struct _MVMCallsiteProfileData {
-    MVMuint32 static_frame_id;
-    MVMuint8 *cuuid, *name;
-    
-} MVMCallsiteProfileData;
-#endif
-
 /* Represents a MoarVM instance. */
 struct MVMInstance {
     /* libuv loop */
@@ -131,6 +124,63 @@ struct MVMInstance {
     AO_t gc_finish;
     /* The number of threads that have yet to acknowledge the finish. */
     AO_t gc_ack;
+    /* Threads waiting on one of the above to change spin briefly, then sleep
+     * on the condition variable. Whoever changes one bumps gc_wake_seq, and
+     * if there are any gc_sleepers, broadcasts under the mutex. */
+    AO_t gc_wake_seq;
+    AO_t gc_sleepers;
+    uv_mutex_t mutex_gc_orchestrate;
+    uv_cond_t cond_gc_orchestrate;
+    /* The generations being collected in the current GC run. */
+    AO_t gc_generations;
+    /* Whether the second generation is marked incrementally, in slices done
+     * alongside nursery collections, rather than all in one go. */
+    MVMuint32 gc_incremental;
+    /* Whether an incremental marking cycle is in progress, how many GC runs
+     * it has taken so far, and whether any thread had objects left to mark
+     * at the end of the last run. */
+    AO_t gc_marking;
+    MVMuint32 gc_mark_runs;
+    AO_t gc_mark_unfinished;
+    /* Whether gen2 is swept lazily, by the allocator, after a full
+     * collection, and the number of threads with pages left to sweep. */
+    MVMuint32 gc_lazy_sweep;
+    AO_t gc_sweeping;
+    /* Whether sweeping gives back gen2 pages left empty in size classes with
+     * much free space. */
+    MVMuint32 gc_release_pages;
+    /* The size that new threads' nurseries start out at and the most they
+     * may grow to, and whether they adapt at all. */
+    MVMuint32 nursery_size;
+    MVMuint32 nursery_max_size;
+    MVMuint32 nursery_adaptive;
+    /* The most nursery runs between full collections, and the growth of the
+     * second generation (as a percentage) that brings one on sooner. */
+    MVMuint32 gc_gen2_ratio;
+    MVMuint32 gc_gen2_growth;
+    /* The GC run that the last full collection was, the bytes of gen2 it
+     * found alive, and the bytes allocated in and marked in gen2 since. */
+    MVMuint64 gc_full_seq;
+    MVMuint64 gc_gen2_live;
+    AO_t gc_gen2_allocated;
+    AO_t gc_gen2_marked;
+    /* GC telemetry (see telemetry.c): the record of the GC run going on and
+     * of the last one to finish, the number of GC threads yet to add to the
+     * former, the bytes marked in gen2 by size class since marking began,
+     * the file the records are logged to, if any, and a mutex protecting
+     * all of these. */
+    MVMGCRunStats *gc_run_stats;
+    MVMGCRunStats *gc_last_run_stats;
+    MVMuint32 gc_stats_pending;
+    AO_t *gc_gen2_live_bins;
+    FILE *gc_log_fh;
+    uv_mutex_t mutex_gc_telemetry;
+    /* Whether the gc_free of dead objects whose REPR allows it is left
+     * until after the GC run. */
+    MVMuint32 gc_finalize_queue;
+    /* Threads whose collection any GC thread may take on in the current
+     * run, linked through their gc_work_next; used atomically. */
+    MVMThreadContext *gc_work_pool;
     /* Linked list (via forwarder) of STables to free. */
     MVMSTable *stables_to_free;
 
@@ -205,10 +255,48 @@ struct MVMInstance {
     /* Next type cache ID, to go in STable. */
     AO_t cur_type_cache_id;
 
-#if MVM_HLL_PROFILE_CALLS
-    /* allocated size of profile_data in count */
-    MVMuint32 callsite_index;
-    /* next index of record to store */
-    MVMuint32 profile_index;
-#endif
+    /* Whether we produce specializations of hot frames, and a mutex taken
+     * while installing a specialization. */
+    MVMint32   spesh_enabled;
+    uv_mutex_t mutex_spesh_install;
+
+    /* Whether we rewrite bytecode to use superinstructions. */
+    MVMint32   superinstr_enabled;
+
+    /* Whether we JIT-compile hot frames, how many invocations make a frame
+     * hot, and a mutex taken while installing JIT-compiled code. */
+    MVMint32   jit_enabled;
+    MVMuint32  jit_threshold;
+    uv_mutex_t mutex_jit_install;
+
+    /* Whether the profiler is enabled, and the files it writes the call
+     * graph (as JSON) and collapsed stacks to when we exit. Threads that end
+     * before then append their results to the done buffers, under the mutex. */
+    MVMint32    profiling;
+    const char *profile_json_file;
+    const char *profile_stacks_file;
+    char       *profile_done_json;
+    char       *profile_done_stacks;
+    uv_mutex_t  mutex_profile;
+
+    /* Static frames run by an interpreter built with the op-level profiler,
+     * and the per-opcode counts of threads that have finished (protected by
+     * the profiler mutex). */
+    MVMOpProfileFrame  *op_profile_frames;
+    MVMOpProfileThread *op_profile_done;
+
+    /* Whether the allocation profiler is on, and the static frames and
+     * types it has counted allocations for (see allocprofile.c). */
+    MVMuint32            alloc_profiling;
+    MVMAllocProfileFrame *alloc_profile_frames;
+    MVMAllocProfileType  *alloc_profile_types;
+    MVMAllocProfileType  *alloc_profile_stables;
+    AO_t                 alloc_profile_num_types;
+
+    /* Heap snapshots: the file to write one to at every full collection
+     * (from --heap-snapshot) and its handle once opened, and the path of a
+     * snapshot asked for by the heapsnapshot op, taken at the next GC run. */
+    const char *heap_snapshot_file;
+    FILE       *heap_snapshot_fh;
+    void       *heap_snapshot_request;
 };
@@ -14,7 +14,12 @@
 #define GET_N32(pc, idx)    *((MVMnum32 *)(pc + idx))
 #define GET_N64(pc, idx)    *((MVMnum64 *)(pc + idx))
 
+#if MVM_OP_PROFILE
+#define NEXT_OP (MVM_op_profile_tick(tc, cur_op, bytecode_start), \
+    op = *(MVMuint16 *)(cur_op), cur_op += 2, op)
+#else
 #define NEXT_OP (op = *(MVMuint16 *)(cur_op), cur_op += 2, op)
+#endif
 
 #if MVM_CGOTO
 #define DISPATCH(op)
@@ -411,6 +416,7 @@ void MVM_interp_run(MVMThreadContext *tc, void (*initial_invoke)(MVMThreadContex
                 cur_op += 4;
                 goto NEXT;
             OP(invoke_v):
+                GC_SYNC_POINT(tc);
                 {
                     MVMObject *code = GET_REG(cur_op, 0).o;
                     code = MVM_frame_find_invokee(tc, code, &cur_callsite);
@@ -422,6 +428,7 @@ void MVM_interp_run(MVMThreadContext *tc, void (*initial_invoke)(MVMThreadContex
                 }
                 goto NEXT;
             OP(invoke_i):
+                GC_SYNC_POINT(tc);
                 {
                     MVMObject *code = GET_REG(cur_op, 2).o;
                     code = MVM_frame_find_invokee(tc, code, &cur_callsite);
@@ -433,6 +440,7 @@ void MVM_interp_run(MVMThreadContext *tc, void (*initial_invoke)(MVMThreadContex
                 }
                 goto NEXT;
             OP(invoke_n):
+                GC_SYNC_POINT(tc);
                 {
                     MVMObject *code = GET_REG(cur_op, 2).o;
                     code = MVM_frame_find_invokee(tc, code, &cur_callsite);
@@ -444,6 +452,7 @@ void MVM_interp_run(MVMThreadContext *tc, void (*initial_invoke)(MVMThreadContex
                 }
                 goto NEXT;
             OP(invoke_s):
+                GC_SYNC_POINT(tc);
                 {
                     MVMObject *code = GET_REG(cur_op, 2).o;
                     code = MVM_frame_find_invokee(tc, code, &cur_callsite);
@@ -455,6 +464,7 @@ void MVM_interp_run(MVMThreadContext *tc, void (*initial_invoke)(MVMThreadContex
                 }
                 goto NEXT;
             OP(invoke_o):
+                GC_SYNC_POINT(tc);
                 {
                     MVMObject *code = GET_REG(cur_op, 2).o;
                     code = MVM_frame_find_invokee(tc, code, &cur_callsite);
@@ -1354,7 +1364,7 @@ void MVM_interp_run(MVMThreadContext *tc, void (*initial_invoke)(MVMThreadContex
                 cur_op += 8;
                 goto NEXT;
             OP(graphs_s):
-                GET_REG(cur_op, 0).i64 = GET_REG(cur_op, 2).s->body.graphs;
+                GET_REG(cur_op, 0).i64 = NUM_GRAPHS(GET_REG(cur_op, 2).s);
                 cur_op += 4;
                 goto NEXT;
             OP(codes_s):
@@ -1938,8 +1948,9 @@ void MVM_interp_run(MVMThreadContext *tc, void (*initial_invoke)(MVMThreadContex
                 MVMRegister *res  = &GET_REG(cur_op, 0);
                 MVMObject   *obj  = GET_REG(cur_op, 2).o;
                 MVMString   *name = cu->body.strings[GET_UI32(cur_op, 4)];
+                MVMuint32    offset = cur_op - bytecode_start;
                 cur_op += 8;
-                MVM_6model_find_method(tc, obj, name, res);
+                MVM_inline_cache_find_method(tc, tc->cur_frame->static_info, offset, obj, name, res);
                 goto NEXT;
             }
             OP(findmeth_s):  {
@@ -2727,6 +2738,10 @@ void MVM_interp_run(MVMThreadContext *tc, void (*initial_invoke)(MVMThreadContex
                 MVM_ASSIGN_REF(tc, &(stable->header), stable->method_cache, cache);
                 MVM_SC_WB_ST(tc, stable);
 
+                /* Inline caches holding methods from the old method cache
+                 * see this and refill their entries for the type. */
+                MVM_incr(&stable->method_cache_gen);
+
                 cur_op += 4;
                 goto NEXT;
             }
@@ -2961,6 +2976,7 @@ void MVM_interp_run(MVMThreadContext *tc, void (*initial_invoke)(MVMThreadContex
             }
             OP(ctx): {
                 MVMObject *ctx = MVM_repr_alloc_init(tc, tc->instance->boot_types.BOOTContext);
+                MVM_frame_move_caller_envs_to_heap(tc, tc->cur_frame);
                 ((MVMContext *)ctx)->body.context = MVM_frame_inc_ref(tc, tc->cur_frame);
                 GET_REG(cur_op, 0).o = ctx;
                 cur_op += 2;
@@ -2974,6 +2990,7 @@ void MVM_interp_run(MVMThreadContext *tc, void (*initial_invoke)(MVMThreadContex
                 }
                 if ((frame = ((MVMContext *)this_ctx)->body.context->outer)) {
                     ctx = MVM_repr_alloc_init(tc, tc->instance->boot_types.BOOTContext);
+                    MVM_frame_move_caller_envs_to_heap(tc, frame);
                     ((MVMContext *)ctx)->body.context = MVM_frame_inc_ref(tc, frame);
                     GET_REG(cur_op, 0).o = ctx;
                 }
@@ -2991,6 +3008,7 @@ void MVM_interp_run(MVMThreadContext *tc, void (*initial_invoke)(MVMThreadContex
                 }
                 if ((frame = ((MVMContext *)this_ctx)->body.context->caller)) {
                     ctx = MVM_repr_alloc_init(tc, tc->instance->boot_types.BOOTContext);
+                    MVM_frame_move_caller_envs_to_heap(tc, frame);
                     ((MVMContext *)ctx)->body.context = MVM_frame_inc_ref(tc, frame);
                 }
                 GET_REG(cur_op, 0).o = ctx;
@@ -3941,6 +3959,180 @@ void MVM_interp_run(MVMThreadContext *tc, void (*initial_invoke)(MVMThreadContex
                     MVM_args_assert_nameds_used(tc, ctx);
                 goto NEXT;
             }
+            OP(const_i64_16):
+                GET_REG(cur_op, 0).i64 = GET_I16(cur_op, 2);
+                cur_op += 4;
+                goto NEXT;
+            OP(gcstats):
+                GET_REG(cur_op, 0).o = MVM_gc_telemetry_last_run(tc);
+                cur_op += 2;
+                goto NEXT;
+            OP(heapsnapshot):
+                MVM_profile_heap_request(tc, GET_REG(cur_op, 0).s);
+                cur_op += 2;
+                goto NEXT;
+            OP(allocprofile):
+                GET_REG(cur_op, 0).s = MVM_alloc_profile_report(tc);
+                cur_op += 2;
+                goto NEXT;
+            OP(bootstrbuilder):
+                GET_REG(cur_op, 0).o = tc->instance->boot_types.BOOTStrBuilder;
+                cur_op += 2;
+                goto NEXT;
+            OP(strbuilderappend):
+                MVM_strbuilder_append_s(tc, GET_REG(cur_op, 0).o, GET_REG(cur_op, 2).s);
+                cur_op += 4;
+                goto NEXT;
+            OP(strbuilderappendcp):
+                MVM_strbuilder_append_cp(tc, GET_REG(cur_op, 0).o, GET_REG(cur_op, 2).i64);
+                cur_op += 4;
+                goto NEXT;
+            OP(strbuilderappendint):
+                MVM_strbuilder_append_i(tc, GET_REG(cur_op, 0).o, GET_REG(cur_op, 2).i64);
+                cur_op += 4;
+                goto NEXT;
+            OP(strbuildertostr):
+                GET_REG(cur_op, 0).s = MVM_strbuilder_to_str(tc, GET_REG(cur_op, 2).o);
+                cur_op += 4;
+                goto NEXT;
+            OP(sp_getspeshslot):
+                GET_REG(cur_op, 0).o = (MVMObject *)tc->cur_frame->effective_spesh_slots[GET_UI16(cur_op, 2)];
+                cur_op += 4;
+                goto NEXT;
+            OP(sp_jit_enter): {
+                MVMJitEntry entry = tc->cur_frame->jit_code->entries[GET_UI16(cur_op, 0)];
+                cur_op = bytecode_start + entry(tc, reg_base);
+                GC_SYNC_POINT(tc);
+                goto NEXT;
+            }
+            /* Superinstructions (see superinstructions.c). Each replaces
+             * only the opcode of the first instruction of a sequence, and
+             * steps over the opcodes of the rest, leaving cur_op where it
+             * would be had the instructions been dispatched one by one. */
+            OP(sp_getlex_decont): {
+                MVMFrame *f = tc->cur_frame;
+                MVMuint16 outers = GET_UI16(cur_op, 4);
+                MVMObject *obj;
+                MVMRegister *r;
+                while (outers) {
+                    if (!f)
+                        MVM_exception_throw_adhoc(tc, "getlex: outer index out of range");
+                    f = f->outer;
+                    outers--;
+                }
+                GET_REG(cur_op, 0) = GET_LEX(cur_op, 2, f);
+                cur_op += 8;
+                obj = GET_REG(cur_op, 2).o;
+                r = &GET_REG(cur_op, 0);
+                cur_op += 4;
+                if (obj && IS_CONCRETE(obj) && STABLE(obj)->container_spec)
+                    STABLE(obj)->container_spec->fetch(tc, obj, r);
+                else
+                    r->o = obj;
+                goto NEXT;
+            }
+            OP(sp_getlex_decont_findmeth): {
+                MVMFrame *f = tc->cur_frame;
+                MVMuint16 outers = GET_UI16(cur_op, 4);
+                MVMObject *obj;
+                MVMRegister *r;
+                MVMString *name;
+                MVMuint32 offset;
+                while (outers) {
+                    if (!f)
+                        MVM_exception_throw_adhoc(tc, "getlex: outer index out of range");
+                    f = f->outer;
+                    outers--;
+                }
+                GET_REG(cur_op, 0) = GET_LEX(cur_op, 2, f);
+                cur_op += 8;
+                obj = GET_REG(cur_op, 2).o;
+                r = &GET_REG(cur_op, 0);
+                cur_op += 4;
+                if (obj && IS_CONCRETE(obj) && STABLE(obj)->container_spec) {
+                    /* The fetch may invoke code, so leave the findmeth to
+                     * be dispatched on its own. */
+                    STABLE(obj)->container_spec->fetch(tc, obj, r);
+                    goto NEXT;
+                }
+                r->o = obj;
+                cur_op += 2;
+                r      = &GET_REG(cur_op, 0);
+                obj    = GET_REG(cur_op, 2).o;
+                name   = cu->body.strings[GET_UI32(cur_op, 4)];
+                offset = cur_op - bytecode_start;
+                cur_op += 8;
+                MVM_inline_cache_find_method(tc, tc->cur_frame->static_info, offset, obj, name, r);
+                goto NEXT;
+            }
+            OP(sp_const_i64_add_i):
+                GET_REG(cur_op, 0).i64 = GET_I64(cur_op, 2);
+                cur_op += 12;
+                GET_REG(cur_op, 0).i64 = GET_REG(cur_op, 2).i64 + GET_REG(cur_op, 4).i64;
+                cur_op += 6;
+                goto NEXT;
+            OP(sp_const_i64_add_i_set):
+                GET_REG(cur_op, 0).i64 = GET_I64(cur_op, 2);
+                cur_op += 12;
+                GET_REG(cur_op, 0).i64 = GET_REG(cur_op, 2).i64 + GET_REG(cur_op, 4).i64;
+                cur_op += 8;
+                GET_REG(cur_op, 0) = GET_REG(cur_op, 2);
+                cur_op += 4;
+                goto NEXT;
+            OP(sp_eq_i_unless_i):
+                GET_REG(cur_op, 0).i64 = GET_REG(cur_op, 2).i64 == GET_REG(cur_op, 4).i64;
+                cur_op += 8;
+                if (GET_REG(cur_op, 0).i64)
+                    cur_op += 6;
+                else
+                    cur_op = bytecode_start + GET_UI32(cur_op, 2);
+                GC_SYNC_POINT(tc);
+                goto NEXT;
+            OP(sp_ne_i_unless_i):
+                GET_REG(cur_op, 0).i64 = GET_REG(cur_op, 2).i64 != GET_REG(cur_op, 4).i64;
+                cur_op += 8;
+                if (GET_REG(cur_op, 0).i64)
+                    cur_op += 6;
+                else
+                    cur_op = bytecode_start + GET_UI32(cur_op, 2);
+                GC_SYNC_POINT(tc);
+                goto NEXT;
+            OP(sp_lt_i_unless_i):
+                GET_REG(cur_op, 0).i64 = GET_REG(cur_op, 2).i64 <  GET_REG(cur_op, 4).i64;
+                cur_op += 8;
+                if (GET_REG(cur_op, 0).i64)
+                    cur_op += 6;
+                else
+                    cur_op = bytecode_start + GET_UI32(cur_op, 2);
+                GC_SYNC_POINT(tc);
+                goto NEXT;
+            OP(sp_le_i_unless_i):
+                GET_REG(cur_op, 0).i64 = GET_REG(cur_op, 2).i64 <= GET_REG(cur_op, 4).i64;
+                cur_op += 8;
+                if (GET_REG(cur_op, 0).i64)
+                    cur_op += 6;
+                else
+                    cur_op = bytecode_start + GET_UI32(cur_op, 2);
+                GC_SYNC_POINT(tc);
+                goto NEXT;
+            OP(sp_gt_i_unless_i):
+                GET_REG(cur_op, 0).i64 = GET_REG(cur_op, 2).i64 >  GET_REG(cur_op, 4).i64;
+                cur_op += 8;
+                if (GET_REG(cur_op, 0).i64)
+                    cur_op += 6;
+                else
+                    cur_op = bytecode_start + GET_UI32(cur_op, 2);
+                GC_SYNC_POINT(tc);
+                goto NEXT;
+            OP(sp_ge_i_unless_i):
+                GET_REG(cur_op, 0).i64 = GET_REG(cur_op, 2).i64 >= GET_REG(cur_op, 4).i64;
+                cur_op += 8;
+                if (GET_REG(cur_op, 0).i64)
+                    cur_op += 6;
+                else
+                    cur_op = bytecode_start + GET_UI32(cur_op, 2);
+                GC_SYNC_POINT(tc);
+                goto NEXT;
 #if MVM_CGOTO
             OP_CALL_EXTOP: {
                 /* Bounds checking? Never heard of that. */
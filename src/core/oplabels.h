@@ -560,27 +560,27 @@ static const void * const LABELS[] = {
     &&OP_assertparamcheck,
     &&OP_hintfor,
     &&OP_paramnamesused,
-    NULL,
-    NULL,
-    NULL,
-    NULL,
-    NULL,
-    NULL,
-    NULL,
-    NULL,
-    NULL,
-    NULL,
-    NULL,
-    NULL,
-    NULL,
-    NULL,
-    NULL,
-    NULL,
-    NULL,
-    NULL,
-    NULL,
-    NULL,
-    NULL,
+    &&OP_const_i64_16,
+    &&OP_gcstats,
+    &&OP_heapsnapshot,
+    &&OP_allocprofile,
+    &&OP_bootstrbuilder,
+    &&OP_strbuilderappend,
+    &&OP_strbuilderappendcp,
+    &&OP_strbuilderappendint,
+    &&OP_strbuildertostr,
+    &&OP_sp_getspeshslot,
+    &&OP_sp_jit_enter,
+    &&OP_sp_getlex_decont,
+    &&OP_sp_getlex_decont_findmeth,
+    &&OP_sp_const_i64_add_i,
+    &&OP_sp_const_i64_add_i_set,
+    &&OP_sp_eq_i_unless_i,
+    &&OP_sp_ne_i_unless_i,
+    &&OP_sp_lt_i_unless_i,
+    &&OP_sp_le_i_unless_i,
+    &&OP_sp_gt_i_unless_i,
+    &&OP_sp_ge_i_unless_i,
     NULL,
     NULL,
     NULL,
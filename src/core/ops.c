@@ -3916,9 +3916,156 @@ static MVMOpInfo MVM_op_infos[] = {
         "  ",
         0,
     },
+    {
+        MVM_OP_const_i64_16,
+        "const_i64_16",
+        "  ",
+        2,
+        { MVM_operand_write_reg | MVM_operand_int64, MVM_operand_int16 }
+    },
+    {
+        MVM_OP_gcstats,
+        "gcstats",
+        "  ",
+        1,
+        { MVM_operand_write_reg | MVM_operand_obj }
+    },
+    {
+        MVM_OP_heapsnapshot,
+        "heapsnapshot",
+        "  ",
+        1,
+        { MVM_operand_read_reg | MVM_operand_str }
+    },
+    {
+        MVM_OP_allocprofile,
+        "allocprofile",
+        "  ",
+        1,
+        { MVM_operand_write_reg | MVM_operand_str }
+    },
+    {
+        MVM_OP_bootstrbuilder,
+        "bootstrbuilder",
+        "  ",
+        1,
+        { MVM_operand_write_reg | MVM_operand_obj }
+    },
+    {
+        MVM_OP_strbuilderappend,
+        "strbuilderappend",
+        "  ",
+        2,
+        { MVM_operand_read_reg | MVM_operand_obj, MVM_operand_read_reg | MVM_operand_str }
+    },
+    {
+        MVM_OP_strbuilderappendcp,
+        "strbuilderappendcp",
+        "  ",
+        2,
+        { MVM_operand_read_reg | MVM_operand_obj, MVM_operand_read_reg | MVM_operand_int64 }
+    },
+    {
+        MVM_OP_strbuilderappendint,
+        "strbuilderappendint",
+        "  ",
+        2,
+        { MVM_operand_read_reg | MVM_operand_obj, MVM_operand_read_reg | MVM_operand_int64 }
+    },
+    {
+        MVM_OP_strbuildertostr,
+        "strbuildertostr",
+        "  ",
+        2,
+        { MVM_operand_write_reg | MVM_operand_str, MVM_operand_read_reg | MVM_operand_obj }
+    },
+    {
+        MVM_OP_sp_getspeshslot,
+        "sp_getspeshslot",
+        ".s",
+        2,
+        { MVM_operand_write_reg | MVM_operand_obj, MVM_operand_int16 }
+    },
+    {
+        MVM_OP_sp_jit_enter,
+        "sp_jit_enter",
+        ".s",
+        1,
+        { MVM_operand_int16 }
+    },
+    {
+        MVM_OP_sp_getlex_decont,
+        "sp_getlex_decont",
+        ".s",
+        2,
+        { MVM_operand_write_reg | MVM_operand_type_var, MVM_operand_read_lex | MVM_operand_type_var }
+    },
+    {
+        MVM_OP_sp_getlex_decont_findmeth,
+        "sp_getlex_decont_findmeth",
+        ".s",
+        2,
+        { MVM_operand_write_reg | MVM_operand_type_var, MVM_operand_read_lex | MVM_operand_type_var }
+    },
+    {
+        MVM_OP_sp_const_i64_add_i,
+        "sp_const_i64_add_i",
+        ".s",
+        2,
+        { MVM_operand_write_reg | MVM_operand_int64, MVM_operand_int64 }
+    },
+    {
+        MVM_OP_sp_const_i64_add_i_set,
+        "sp_const_i64_add_i_set",
+        ".s",
+        2,
+        { MVM_operand_write_reg | MVM_operand_int64, MVM_operand_int64 }
+    },
+    {
+        MVM_OP_sp_eq_i_unless_i,
+        "sp_eq_i_unless_i",
+        ".s",
+        3,
+        { MVM_operand_write_reg | MVM_operand_int64, MVM_operand_read_reg | MVM_operand_int64, MVM_operand_read_reg | MVM_operand_int64 }
+    },
+    {
+        MVM_OP_sp_ne_i_unless_i,
+        "sp_ne_i_unless_i",
+        ".s",
+        3,
+        { MVM_operand_write_reg | MVM_operand_int64, MVM_operand_read_reg | MVM_operand_int64, MVM_operand_read_reg | MVM_operand_int64 }
+    },
+    {
+        MVM_OP_sp_lt_i_unless_i,
+        "sp_lt_i_unless_i",
+        ".s",
+        3,
+        { MVM_operand_write_reg | MVM_operand_int64, MVM_operand_read_reg | MVM_operand_int64, MVM_operand_read_reg | MVM_operand_int64 }
+    },
+    {
+        MVM_OP_sp_le_i_unless_i,
+        "sp_le_i_unless_i",
+        ".s",
+        3,
+        { MVM_operand_write_reg | MVM_operand_int64, MVM_operand_read_reg | MVM_operand_int64, MVM_operand_read_reg | MVM_operand_int64 }
+    },
+    {
+        MVM_OP_sp_gt_i_unless_i,
+        "sp_gt_i_unless_i",
+        ".s",
+        3,
+        { MVM_operand_write_reg | MVM_operand_int64, MVM_operand_read_reg | MVM_operand_int64, MVM_operand_read_reg | MVM_operand_int64 }
+    },
+    {
+        MVM_OP_sp_ge_i_unless_i,
+        "sp_ge_i_unless_i",
+        ".s",
+        3,
+        { MVM_operand_write_reg | MVM_operand_int64, MVM_operand_read_reg | MVM_operand_int64, MVM_operand_read_reg | MVM_operand_int64 }
+    },
 };
 
-static unsigned short MVM_op_counts = 559;
+static unsigned short MVM_op_counts = 580;
 
 MVMOpInfo * MVM_op_get_op(unsigned short op) {
     if (op >= MVM_op_counts)
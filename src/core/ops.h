@@ -560,6 +560,27 @@
 #define MVM_OP_assertparamcheck 556
 #define MVM_OP_hintfor 557
 #define MVM_OP_paramnamesused 558
+#define MVM_OP_const_i64_16 559
+#define MVM_OP_gcstats 560
+#define MVM_OP_heapsnapshot 561
+#define MVM_OP_allocprofile 562
+#define MVM_OP_bootstrbuilder 563
+#define MVM_OP_strbuilderappend 564
+#define MVM_OP_strbuilderappendcp 565
+#define MVM_OP_strbuilderappendint 566
+#define MVM_OP_strbuildertostr 567
+#define MVM_OP_sp_getspeshslot 568
+#define MVM_OP_sp_jit_enter 569
+#define MVM_OP_sp_getlex_decont 570
+#define MVM_OP_sp_getlex_decont_findmeth 571
+#define MVM_OP_sp_const_i64_add_i 572
+#define MVM_OP_sp_const_i64_add_i_set 573
+#define MVM_OP_sp_eq_i_unless_i 574
+#define MVM_OP_sp_ne_i_unless_i 575
+#define MVM_OP_sp_lt_i_unless_i 576
+#define MVM_OP_sp_le_i_unless_i 577
+#define MVM_OP_sp_gt_i_unless_i 578
+#define MVM_OP_sp_ge_i_unless_i 579
 
 #define MVM_OP_EXT_BASE 1024
 #define MVM_OP_EXT_CU_LIMIT 1024
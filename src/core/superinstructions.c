@@ -0,0 +1,96 @@
+#include "moar.h"
+
+/* Superinstructions stand for a common sequence of instructions, saving all
+ * but one of the dispatches it would take to run them. Rather than moving
+ * any bytecode around, we replace just the opcode of the first instruction
+ * of the sequence with that of the superinstruction; the interpreter then
+ * reads the operands of each instruction from where they already are and
+ * steps over the opcodes of all but the first. As such, the bytecode keeps
+ * its layout and every instruction in it still decodes as before, so that
+ * branches into the middle of a sequence, handlers, annotations and the
+ * offsets seen by exceptions all work out unchanged.
+ *
+ * The table of sequences is best tuned using the op histograms of the op
+ * profiler (see opprofile.c). Where one sequence is a prefix of another, the
+ * longer one must come first. */
+typedef struct {
+    MVMuint16 fused;
+    MVMuint16 num_ops;
+    MVMuint16 ops[MVM_SUPERINSTR_MAX_OPS];
+} Superinstruction;
+
+static const Superinstruction superinstrs[] = {
+    { MVM_OP_sp_getlex_decont_findmeth, 3, { MVM_OP_getlex, MVM_OP_decont, MVM_OP_findmeth } },
+    { MVM_OP_sp_getlex_decont,          2, { MVM_OP_getlex, MVM_OP_decont } },
+    { MVM_OP_sp_const_i64_add_i_set,    3, { MVM_OP_const_i64, MVM_OP_add_i, MVM_OP_set } },
+    { MVM_OP_sp_const_i64_add_i,        2, { MVM_OP_const_i64, MVM_OP_add_i } },
+    { MVM_OP_sp_eq_i_unless_i,          2, { MVM_OP_eq_i, MVM_OP_unless_i } },
+    { MVM_OP_sp_ne_i_unless_i,          2, { MVM_OP_ne_i, MVM_OP_unless_i } },
+    { MVM_OP_sp_lt_i_unless_i,          2, { MVM_OP_lt_i, MVM_OP_unless_i } },
+    { MVM_OP_sp_le_i_unless_i,          2, { MVM_OP_le_i, MVM_OP_unless_i } },
+    { MVM_OP_sp_gt_i_unless_i,          2, { MVM_OP_gt_i, MVM_OP_unless_i } },
+    { MVM_OP_sp_ge_i_unless_i,          2, { MVM_OP_ge_i, MVM_OP_unless_i } }
+};
+#define NUM_SUPERINSTRS (sizeof(superinstrs) / sizeof(Superinstruction))
+
+/* Gets the size of the instruction at the specified position, or 0 if it's
+ * not one we know. */
+static MVMuint32 instruction_size(MVMThreadContext *tc, MVMCompUnit *cu, MVMuint8 *bytecode, MVMuint32 pos) {
+    const MVMOpInfo *info = MVM_spesh_get_op_info(tc, cu, *(MVMuint16 *)(bytecode + pos));
+    MVMuint32 size = 2;
+    MVMuint32 i;
+    if (!info)
+        return 0;
+    for (i = 0; i < info->num_operands; i++)
+        size += MVM_spesh_operand_size(tc, info->operands[i]);
+    return size;
+}
+
+/* Looks through some (valid) bytecode for sequences that we have a
+ * superinstruction for. If any are found, returns a copy of the bytecode
+ * that uses the superinstructions; otherwise, returns NULL. */
+MVMuint8 * MVM_superinstr_fuse(MVMThreadContext *tc, MVMCompUnit *cu, MVMuint8 *bytecode, MVMuint32 size) {
+    MVMuint8  *fused = NULL;
+    MVMuint32  pos   = 0;
+    while (pos < size) {
+        /* Decode as many instructions as a superinstruction may stand for;
+         * starts[i + 1] is where the i-th of them ends. */
+        MVMuint32 starts[MVM_SUPERINSTR_MAX_OPS + 1];
+        MVMuint16 opcodes[MVM_SUPERINSTR_MAX_OPS];
+        MVMuint32 num_decoded = 0;
+        MVMuint32 i, j, next;
+        starts[0] = pos;
+        while (num_decoded < MVM_SUPERINSTR_MAX_OPS && starts[num_decoded] < size) {
+            MVMuint32 ins_size = instruction_size(tc, cu, bytecode, starts[num_decoded]);
+            if (!ins_size)
+                break;
+            opcodes[num_decoded] = *(MVMuint16 *)(bytecode + starts[num_decoded]);
+            starts[num_decoded + 1] = starts[num_decoded] + ins_size;
+            num_decoded++;
+        }
+        if (!num_decoded)
+            break;
+
+        /* Use the first superinstruction that matches, if any. */
+        next = starts[1];
+        for (i = 0; i < NUM_SUPERINSTRS; i++) {
+            const Superinstruction *si = &superinstrs[i];
+            if (si->num_ops > num_decoded)
+                continue;
+            for (j = 0; j < si->num_ops; j++)
+                if (opcodes[j] != si->ops[j])
+                    break;
+            if (j == si->num_ops) {
+                if (!fused) {
+                    fused = malloc(size);
+                    memcpy(fused, bytecode, size);
+                }
+                *(MVMuint16 *)(fused + pos) = si->fused;
+                next = starts[si->num_ops];
+                break;
+            }
+        }
+        pos = next;
+    }
+    return fused;
+}
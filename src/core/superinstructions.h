@@ -0,0 +1,4 @@
+/* Maximum number of instructions that a superinstruction stands for. */
+#define MVM_SUPERINSTR_MAX_OPS  3
+
+MVMuint8 * MVM_superinstr_fuse(MVMThreadContext *tc, MVMCompUnit *cu, MVMuint8 *bytecode, MVMuint32 size);
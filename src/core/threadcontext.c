@@ -10,10 +10,13 @@ MVMThreadContext * MVM_tc_create(MVMInstance *instance) {
     tc->instance = instance;
 
     /* Set up GC nursery. */
-    tc->nursery_fromspace   = calloc(1, MVM_NURSERY_SIZE);
-    tc->nursery_tospace     = calloc(1, MVM_NURSERY_SIZE);
-    tc->nursery_alloc       = tc->nursery_tospace;
-    tc->nursery_alloc_limit = (char *)tc->nursery_alloc + MVM_NURSERY_SIZE;
+    tc->nursery_size           = instance->nursery_size;
+    tc->nursery_fromspace_size = instance->nursery_size;
+    tc->nursery_wanted_size    = instance->nursery_size;
+    tc->nursery_fromspace      = calloc(1, tc->nursery_fromspace_size);
+    tc->nursery_tospace        = calloc(1, tc->nursery_size);
+    tc->nursery_alloc          = tc->nursery_tospace;
+    tc->nursery_alloc_limit    = (char *)tc->nursery_alloc + tc->nursery_size;
 
     /* Set up temporary root handling. */
     tc->num_temproots   = 0;
@@ -27,6 +30,7 @@ MVMThreadContext * MVM_tc_create(MVMInstance *instance) {
 
     /* Set up the second generation allocator. */
     tc->gen2 = MVM_gc_gen2_create(instance);
+    tc->gc_gen2_marked_bins = calloc(MVM_GC_STATS_CLASSES, sizeof(MVMuint64));
 
     /* Set up table of per-static-frame chains. */
     /* XXX For non-first threads, make them start with the size of the
@@ -34,6 +38,9 @@ MVMThreadContext * MVM_tc_create(MVMInstance *instance) {
     tc->frame_pool_table_size = MVMInitialFramePoolTableSize;
     tc->frame_pool_table = calloc(MVMInitialFramePoolTableSize, sizeof(MVMFrame *));
 
+    /* Set up the call stack region. */
+    MVM_callstack_init(tc);
+
     tc->loop = instance->default_loop ? uv_loop_new() : uv_default_loop();
 
     /* Create a CallCapture for usecapture instructions in this thread (needs
@@ -44,13 +51,6 @@ MVMThreadContext * MVM_tc_create(MVMInstance *instance) {
     /* Initialize random number generator state. */
     MVM_proc_seed(tc, (MVM_platform_now() / 10000) * MVM_proc_getpid(tc));
 
-#if MVM_HLL_PROFILE_CALLS
-#define PROFILE_INITIAL_SIZE (1 << 29)
-    tc->profile_data_size = PROFILE_INITIAL_SIZE;
-    tc->profile_data = malloc(sizeof(MVMProfileRecord) * PROFILE_INITIAL_SIZE);
-    tc->profile_index = 0;
-#endif
-
     return tc;
 }
 
@@ -60,6 +60,9 @@ MVMThreadContext * MVM_tc_create(MVMInstance *instance) {
  * objects from this nursery to the second generation. Only after
  * that is true should this be called. */
 void MVM_tc_destroy(MVMThreadContext *tc) {
+    /* Free anything still waiting on us to do so. */
+    MVM_gc_finalize_run_queue(tc);
+
     /* We run once again (non-blocking) to eventually close filehandles. */
     uv_run(tc->loop, UV_RUN_NOWAIT);
 
@@ -74,7 +77,14 @@ void MVM_tc_destroy(MVMThreadContext *tc) {
     MVM_checked_free_null(tc->gc_work);
     MVM_checked_free_null(tc->temproots);
     MVM_checked_free_null(tc->gen2roots);
+    MVM_checked_free_null(tc->gc_grey);
+    MVM_checked_free_null(tc->gc_shaded);
+    MVM_checked_free_null(tc->gc_shaded_taken);
+    MVM_checked_free_null(tc->finalize);
+    MVM_checked_free_null(tc->gc_gen2_marked_bins);
+    MVM_alloc_profile_thread_destroy(tc);
     MVM_checked_free_null(tc->frame_pool_table);
+    MVM_callstack_destroy(tc);
 
     /* destroy the libuv event loop */
     uv_loop_delete(tc->loop);
@@ -44,14 +44,6 @@ typedef enum {
 #define MVMInitialFramePoolTableSize    64
 #define MVMFramePoolLengthLimit         64
 
-#if MVM_HLL_PROFILE_CALLS
-typedef struct _MVMProfileRecord {
-    MVMuint32 callsite_id;
-    MVMuint32 code_id;
-    MVMuint64 duration_nanos;
-} MVMProfileRecord;
-#endif
-
 /* Information associated with an executing thread. */
 struct MVMThreadContext {
     /* The current allocation pointer, where the next object to be allocated
@@ -143,6 +135,48 @@ struct MVMThreadContext {
     MVMuint32             alloc_gen2roots;
     MVMCollectable      **gen2roots;
 
+    /* Generation 2 objects that were marked live during an incremental
+     * marking cycle, but whose children have not been marked yet, and the
+     * number of them to process alongside each nursery collection. */
+    MVMuint32             num_gc_grey;
+    MVMuint32             alloc_gc_grey;
+    MVMCollectable      **gc_grey;
+    MVMuint32             gc_mark_budget;
+
+    /* Unmarked generation 2 objects that the write barrier saw stored into
+     * other generation 2 objects during an incremental marking cycle. The
+     * next GC run marks them; it keeps the list it takes around until the
+     * run is over, since other threads may be passed pointers into it. */
+    MVMuint32             num_gc_shaded;
+    MVMuint32             alloc_gc_shaded;
+    MVMCollectable      **gc_shaded;
+    MVMCollectable      **gc_shaded_taken;
+
+    /* The sizes of the nursery's tospace and fromspace, the size tospace
+     * should be at the next collection, and when we last collected. */
+    MVMuint32             nursery_size;
+    MVMuint32             nursery_fromspace_size;
+    MVMuint32             nursery_wanted_size;
+    MVMuint64             gc_last_run_time;
+
+    /* Bytes allocated in and marked in gen2 by us that we're yet to add to
+     * the instance's counts. */
+    MVMuint64             gc_gen2_allocated;
+    MVMuint64             gc_gen2_marked;
+
+    /* For telemetry (see telemetry.c): the bytes marked in gen2 by size
+     * class, and promoted to gen2, by us that we're yet to add to the
+     * instance's counts, and when we entered the current GC run. */
+    MVMuint64            *gc_gen2_marked_bins;
+    MVMuint64             gc_promoted_bytes;
+    MVMuint64             gc_enter_time;
+
+    /* Dead objects whose gc_free is to be run once we're out of the GC run
+     * that found them (see finalize.c). */
+    MVMuint32             num_finalize;
+    MVMuint32             alloc_finalize;
+    MVMGCFinalizeItem    *finalize;
+
     /* The GC's cross-thread in-tray of processing work. */
     MVMGCPassedWork *gc_in_tray;
 
@@ -155,12 +189,21 @@ struct MVMThreadContext {
     MVMuint32                gc_work_size;
     MVMuint32                gc_work_count;
 
+    /* Link to the next thread in the instance's pool of threads whose
+     * collection is up for grabs in this gc run. */
+    MVMThreadContext        *gc_work_next;
+
     /* Pool table of chains of frames for each static frame. */
     MVMFrame **frame_pool_table;
 
     /* Size of the pool table, so it can grow on demand. */
     MVMuint32          frame_pool_table_size;
 
+    /* The first block of the call stack region, where frame env and work
+     * areas are allocated, and the block we're currently allocating in. */
+    MVMCallStackBlock *stack_first;
+    MVMCallStackBlock *stack_current;
+
     /* Serialization context write barrier disabled depth (anything non-zero
      * means disabled). */
     MVMint32           sc_wb_disable_depth;
@@ -180,14 +223,14 @@ struct MVMThreadContext {
     /* Random number generator state. */
     MVMuint64 rand_state[2];
 
-#if MVM_HLL_PROFILE_CALLS
-    /* storage of profile timings */
-    MVMProfileRecord *profile_data;
-    /* allocated size of profile_data in count */
-    MVMuint32 profile_data_size;
-    /* next index of record to store */
-    MVMuint32 profile_index;
-#endif
+    /* Data collected by the profiler, if it is enabled. */
+    MVMProfileThreadData *prof_data;
+
+    /* Per-opcode counts of the op-level profiler, if it is compiled in. */
+    MVMOpProfileThread *op_prof;
+
+    /* Objects allocated in the nursery, if the allocation profiler is on. */
+    MVMAllocProfileThread *alloc_prof;
 };
 
 MVMThreadContext * MVM_tc_create(MVMInstance *instance);
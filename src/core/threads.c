@@ -26,6 +26,8 @@ static void thread_initial_invoke(MVMThreadContext *tc, void *data) {
     ts->no_arg_callsite.arg_count = 0;
     ts->no_arg_callsite.num_pos   = 0;
     ts->no_arg_callsite.has_flattening = 0;
+    ts->no_arg_callsite.with_invocant = NULL;
+    ts->no_arg_callsite.named_plan = NULL;
 
     /* Create initial frame, which sets up all of the interpreter state also. */
     STABLE(invokee)->invoke(tc, invokee, &ts->no_arg_callsite, NULL);
@@ -52,6 +54,11 @@ static void start_thread(void *data) {
     /* Enter the interpreter, to run code. */
     MVM_interp_run(tc, &thread_initial_invoke, ts);
 
+    /* Hand over anything the profiler collected for the thread. */
+    if (tc->instance->profiling)
+        MVM_profile_thread_done(tc);
+    MVM_op_profile_thread_done(tc);
+
     /* mark as exited, so the GC will know to clear our stuff. */
     tc->thread_obj->body.stage = MVM_thread_stage_exited;
 
@@ -97,6 +104,7 @@ MVMObject * MVM_thread_start(MVMThreadContext *tc, MVMObject *invokee, MVMObject
          * the thread is done. */
         ts = malloc(sizeof(ThreadStart));
         ts->tc = child_tc;
+        MVM_frame_move_caller_envs_to_heap(tc, tc->cur_frame);
         ts->caller = MVM_frame_inc_ref(tc, tc->cur_frame);
         ts->thread_obj = child_obj;
 
@@ -585,6 +585,10 @@ void MVM_validate_static_frame(MVMThreadContext *tc,
     while (val->cur_op < val->bc_end) {
         read_op(val);
 
+        if (val->cur_mark[0] == MARK_special && val->cur_mark[1] == 's')
+            fail(val, MSG(val, "op '%s' is only valid in specialized bytecode"),
+                    val->cur_info->name);
+
         switch (val->cur_mark[0]) {
             case MARK_regular:
             case MARK_special:
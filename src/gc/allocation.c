@@ -27,8 +27,19 @@ void * MVM_gc_allocate_nursery(MVMThreadContext *tc, size_t size) {
          * second generation. Note that this circumstance is exceptionally
          * unlikely in any non-contrived situation. */
         while ((char *)tc->nursery_alloc + size >= (char *)tc->nursery_alloc_limit) {
-            if (size > MVM_NURSERY_SIZE)
+            if (size >= tc->instance->nursery_max_size)
                 MVM_panic(MVM_exitcode_gcalloc, "Attempt to allocate more than the maximum nursery size");
+
+            /* If this is big for the nursery we have, have it grow. */
+            if (size >= tc->nursery_size / 2) {
+                MVMuint64 wanted = (MVMuint64)tc->nursery_size * 2;
+                while (wanted < 2 * size)
+                    wanted *= 2;
+                tc->nursery_wanted_size = wanted < tc->instance->nursery_max_size
+                    ? (MVMuint32)wanted
+                    : tc->instance->nursery_max_size;
+            }
+
             MVM_gc_enter_from_allocator(tc);
         }
 
@@ -63,6 +74,8 @@ MVMSTable * MVM_gc_allocate_stable(MVMThreadContext *tc, const MVMREPROps *repr,
         st->type_cache_id = MVM_6model_next_type_cache_id(tc);
         MVM_ASSIGN_REF(tc, &(st->header), st->HOW, how);
     });
+    if (tc->instance->alloc_profiling)
+        MVM_alloc_profile_log(tc, &st->header, NULL);
     return st;
 }
 
@@ -76,6 +89,8 @@ MVMObject * MVM_gc_allocate_type_object(MVMThreadContext *tc, MVMSTable *st) {
         obj->header.owner  = tc->thread_id;
         MVM_ASSIGN_REF(tc, &(obj->header), obj->st, st);
     });
+    if (tc->instance->alloc_profiling)
+        MVM_alloc_profile_log(tc, &obj->header, st);
     return obj;
 }
 
@@ -91,6 +106,10 @@ MVMObject * MVM_gc_allocate_object(MVMThreadContext *tc, MVMSTable *st) {
             if (REPR(obj)->refs_frames)
                 MVM_gc_root_gen2_add(tc, (MVMCollectable *)obj);
     });
+    if (tc->instance->profiling)
+        MVM_profile_log_allocated(tc, obj);
+    if (tc->instance->alloc_profiling)
+        MVM_alloc_profile_log(tc, &obj->header, STABLE(obj));
     return obj;
 }
 
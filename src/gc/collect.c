@@ -1,4 +1,5 @@
 #include "moar.h"
+#include <platform/time.h>
 
 /* Combines a piece of work that will be passed to another thread with the
  * ID of the target thread to pass it to. */
@@ -13,11 +14,22 @@ typedef struct {
     ThreadWork *target_work;
 } WorkToPass;
 
+/* Counts a gen2 object that was just marked live towards the bytes marked,
+ * overall and in its size class (the last counting the large objects). */
+MVM_STATIC_INLINE void count_marked(MVMThreadContext *tc, MVMCollectable *item) {
+    MVMuint32 bin = item->size >> MVM_GEN2_BIN_BITS;
+    if ((item->size & MVM_GEN2_BIN_MASK) == 0)
+        bin--;
+    tc->gc_gen2_marked += item->size;
+    tc->gc_gen2_marked_bins[bin < MVM_GEN2_BINS ? bin : MVM_GEN2_BINS] += item->size;
+}
+
 /* Forward decls. */
 static void process_worklist(MVMThreadContext *tc, MVMGCWorklist *worklist, WorkToPass *wtp, MVMuint8 gen);
 static void pass_work_item(MVMThreadContext *tc, WorkToPass *wtp, MVMCollectable **item_ptr);
 static void pass_leftover_work(MVMThreadContext *tc, WorkToPass *wtp);
 static void add_in_tray_to_worklist(MVMThreadContext *tc, MVMGCWorklist *worklist);
+static void mark_incrementally(MVMThreadContext *tc, MVMGCWorklist *worklist, WorkToPass *wtp, MVMuint8 gen);
 
 /* Does a garbage collection run. Exactly what it does is configured by the
  * couple of arguments that it takes.
@@ -37,11 +49,20 @@ static void add_in_tray_to_worklist(MVMThreadContext *tc, MVMGCWorklist *worklis
  * fragmentation that makes finding a right-sized gap problematic will not
  * happen.
  *
+ * However, with a large second generation, marking all of it at once makes
+ * for long pauses, so it is usually marked incrementally instead; see
+ * mark_incrementally for how that works.
+ *
  * Note that it adds the roots and processes them in phases, to try to avoid
  * building up a huge worklist. */
 void MVM_gc_collect(MVMThreadContext *tc, MVMuint8 what_to_do, MVMuint8 gen) {
+    /* Are we in the middle of marking gen2 incrementally? If so, we need to
+     * see gen2 objects even in a nursery collection. */
+    MVMuint8 marking = (MVMuint8)MVM_load(&tc->instance->gc_marking);
+
     /* Create a GC worklist. */
-    MVMGCWorklist *worklist = MVM_gc_worklist_create(tc, gen != MVMGCGenerations_Nursery);
+    MVMGCWorklist *worklist = MVM_gc_worklist_create(tc,
+        gen != MVMGCGenerations_Nursery || marking);
 
     /* Initialize work passing data structure. */
     WorkToPass wtp;
@@ -51,15 +72,25 @@ void MVM_gc_collect(MVMThreadContext *tc, MVMuint8 what_to_do, MVMuint8 gen) {
     /* If we're starting a run (as opposed to just coming back here to do a
      * little more work we got after we first thought we were done...) */
     if (what_to_do != MVMGCWhatToDo_InTray) {
-        /* Swap fromspace and tospace. */
+        /* Swap fromspace and tospace. If we want a different size of nursery,
+         * what becomes tospace is replaced with one of that size, though it
+         * must still be able to hold all of fromspace, should it survive. */
         void * fromspace = tc->nursery_tospace;
         void * tospace   = tc->nursery_fromspace;
-        tc->nursery_fromspace = fromspace;
-        tc->nursery_tospace   = tospace;
+        MVMuint32 used   = (char *)tc->nursery_alloc - (char *)fromspace;
+        MVMuint32 size   = tc->nursery_wanted_size > used ? tc->nursery_wanted_size : used;
+        if (size != tc->nursery_fromspace_size) {
+            free(tospace);
+            tospace = malloc(size);
+        }
+        tc->nursery_fromspace      = fromspace;
+        tc->nursery_fromspace_size = tc->nursery_size;
+        tc->nursery_tospace        = tospace;
+        tc->nursery_size           = size;
 
         /* Reset nursery allocation pointers to the new tospace. */
         tc->nursery_alloc       = tospace;
-        tc->nursery_alloc_limit = (char *)tc->nursery_alloc + MVM_NURSERY_SIZE;
+        tc->nursery_alloc_limit = (char *)tc->nursery_alloc + size;
 
         MVM_gc_worklist_add(tc, worklist, &tc->thread_obj);
         GCDEBUG_LOG(tc, MVM_GC_DEBUG_COLLECT, "Thread %d run %d : processing %d items from thread_obj\n", worklist->items);
@@ -109,6 +140,10 @@ void MVM_gc_collect(MVMThreadContext *tc, MVMuint8 what_to_do, MVMuint8 gen) {
 			process_worklist(tc, worklist, &wtp, gen);
 		}
 
+        /* Do our part of any incremental marking of gen2. */
+        if (marking || gen == MVMGCGenerations_Both)
+            mark_incrementally(tc, worklist, &wtp, gen);
+
         /* Process anything in the in-tray. */
         add_in_tray_to_worklist(tc, worklist);
         GCDEBUG_LOG(tc, MVM_GC_DEBUG_COLLECT, "Thread %d run %d : processing %d items from in tray \n", worklist->items);
@@ -140,6 +175,108 @@ void MVM_gc_collect(MVMThreadContext *tc, MVMuint8 what_to_do, MVMuint8 gen) {
      * due to point to gen1 objects may be dead. */
     if (gen != MVMGCGenerations_Nursery)
         MVM_gc_root_gen2_cleanup(tc);
+
+    /* If we're marking incrementally and have objects left to mark, then
+     * the marking cycle can't end yet. */
+    else if (marking && tc->num_gc_grey)
+        MVM_store(&tc->instance->gc_mark_unfinished, 1);
+
+    /* Add what we allocated in and marked in gen2 to the instance's counts,
+     * which decide when the next full collection is. */
+    if (tc->gc_gen2_allocated) {
+        MVM_add(&tc->instance->gc_gen2_allocated, tc->gc_gen2_allocated);
+        tc->gc_gen2_allocated = 0;
+    }
+    if (tc->gc_gen2_marked) {
+        MVMuint32 i;
+        MVM_add(&tc->instance->gc_gen2_marked, tc->gc_gen2_marked);
+        tc->gc_gen2_marked = 0;
+        for (i = 0; i < MVM_GC_STATS_CLASSES; i++) {
+            if (tc->gc_gen2_marked_bins[i]) {
+                MVM_add(&tc->instance->gc_gen2_live_bins[i], tc->gc_gen2_marked_bins[i]);
+                tc->gc_gen2_marked_bins[i] = 0;
+            }
+        }
+    }
+}
+
+/* Adds a gen2 object that was just marked live to the list of those whose
+ * children still need marking. */
+void MVM_gc_collect_push_grey(MVMThreadContext *tc, MVMCollectable *item) {
+    if (tc->num_gc_grey == tc->alloc_gc_grey) {
+        tc->alloc_gc_grey = tc->alloc_gc_grey ? tc->alloc_gc_grey * 2 : 256;
+        tc->gc_grey = realloc(tc->gc_grey,
+            sizeof(MVMCollectable *) * tc->alloc_gc_grey);
+    }
+    tc->gc_grey[tc->num_gc_grey++] = item;
+}
+
+/* Incremental marking of gen2 happens in a cycle that starts where there
+ * would otherwise be a full collection, and spans a number of nursery
+ * collections. During the cycle, a nursery collection that reaches an
+ * unmarked gen2 object marks it live, but rather than marking its children
+ * right away, puts it on the owning thread's grey list. Each nursery
+ * collection then marks the children of a slice of the grey objects. An
+ * object promoted to gen2 during the cycle is marked live, and has its
+ * children marked, as it is promoted.
+ *
+ * Objects the mutator stores into gen2 objects during the cycle would escape
+ * marking if the object they're stored into already had its children marked
+ * and they became unreachable from anywhere else. Thus, the write barrier
+ * records any unmarked gen2 objects stored into gen2 objects, and we mark
+ * them in the next run. Frames and nursery objects are not covered by the
+ * barrier, but are scanned in full anyway.
+ *
+ * Once no thread has grey objects left, the cycle ends with a full
+ * collection, which finishes the marking: it marks anything still unmarked
+ * that the roots, the nursery or the recorded stores lead to, and the rest
+ * of the grey list if the cycle was cut short. Since objects marked in the
+ * cycle don't get their children marked again, it also scans those that
+ * are inter-generational roots, for references into the nursery. After
+ * that, the unmarked objects are swept as usual. */
+static void mark_incrementally(MVMThreadContext *tc, MVMGCWorklist *worklist, WorkToPass *wtp, MVMuint8 gen) {
+    MVMCollectable **shaded     = tc->gc_shaded;
+    MVMuint32        num_shaded = tc->num_gc_shaded;
+    MVMuint32        limit, i;
+
+    /* Take the objects the write barrier recorded, and mark them. Other
+     * threads may get pointers into the list, so keep it until the end of
+     * the run. */
+    tc->gc_shaded_taken = shaded;
+    tc->gc_shaded       = NULL;
+    tc->num_gc_shaded   = 0;
+    tc->alloc_gc_shaded = 0;
+    for (i = 0; i < num_shaded; i++)
+        MVM_gc_worklist_add(tc, worklist, &shaded[i]);
+    GCDEBUG_LOG(tc, MVM_GC_DEBUG_COLLECT, "Thread %d run %d : processing %d items from write barrier \n", worklist->items);
+    process_worklist(tc, worklist, wtp, gen);
+
+    if (gen == MVMGCGenerations_Both) {
+        /* Finishing a cycle; scan inter-generational roots that were marked
+         * in it, and then all that remains of the grey list. */
+        for (i = 0; i < tc->num_gen2roots; i++) {
+            if (tc->gen2roots[i]->flags & MVM_CF_GEN2_LIVE) {
+                MVM_gc_mark_collectable(tc, worklist, tc->gen2roots[i]);
+                process_worklist(tc, worklist, wtp, gen);
+            }
+        }
+        limit = 0;
+    }
+    else {
+        /* At the start of a cycle, work out how much to do in each slice. */
+        if (tc->instance->gc_mark_runs == 0 || !tc->gc_mark_budget)
+            tc->gc_mark_budget = (MVMuint32)(MVM_gc_gen2_num_slots(tc->gen2) / MVM_GC_MARK_RUNS)
+                + MVM_GC_MARK_SLICE_MIN;
+        limit = tc->gc_mark_budget;
+    }
+
+    /* Mark the children of grey objects. */
+    for (i = 0; tc->num_gc_grey && (!limit || i < limit); i++) {
+        MVMCollectable *item = tc->gc_grey[--tc->num_gc_grey];
+        MVM_gc_mark_collectable(tc, worklist, item);
+        process_worklist(tc, worklist, wtp, gen);
+    }
+    GCDEBUG_LOG(tc, MVM_GC_DEBUG_COLLECT, "Thread %d run %d : marked children of %d grey objects\n", i);
 }
 
 /* Processes the current worklist. */
@@ -150,6 +287,10 @@ static void process_worklist(MVMThreadContext *tc, MVMGCWorklist *worklist, Work
     MVMuint32          gen2count;
     MVMuint16          i;
 
+    /* Are we marking gen2 incrementally? */
+    MVMuint8 marking = gen == MVMGCGenerations_Nursery
+        && MVM_load(&tc->instance->gc_marking);
+
     /* Grab the second generation allocator; we may move items into the
      * old generation. */
     gen2 = tc->gen2;
@@ -168,10 +309,11 @@ static void process_worklist(MVMThreadContext *tc, MVMGCWorklist *worklist, Work
             continue;
 
         /* If it's in the second generation and we're only doing a nursery,
-         * collection, we have nothing to do. */
+         * collection, we have nothing to do (unless we're marking gen2
+         * incrementally). */
         item_gen2 = item->flags & MVM_CF_SECOND_GEN;
         if (item_gen2) {
-            if (gen == MVMGCGenerations_Nursery)
+            if (gen == MVMGCGenerations_Nursery && !marking)
                 continue;
             if (item->flags & MVM_CF_GEN2_LIVE) {
                 /* gen2 and marked as live. */
@@ -223,7 +365,15 @@ static void process_worklist(MVMThreadContext *tc, MVMGCWorklist *worklist, Work
                 GCDEBUG_LOG(tc, MVM_GC_DEBUG_COLLECT, "Thread %d run %d : handle %p was already %p\n", item_ptr, new_addr);
             }
             item->flags |= MVM_CF_GEN2_LIVE;
+            count_marked(tc, item);
             assert(*item_ptr == new_addr);
+
+            /* If we're marking incrementally, its children get marked in
+             * some later slice. */
+            if (marking) {
+                MVM_gc_collect_push_grey(tc, item);
+                continue;
+            }
         } else {
             /* Catch NULL stable (always sign of trouble) in debug mode. */
             if (MVM_GC_DEBUG_ENABLED(MVM_GC_DEBUG_COLLECT) && !STABLE(item)) {
@@ -236,7 +386,7 @@ static void process_worklist(MVMThreadContext *tc, MVMGCWorklist *worklist, Work
                 /* Yes; we should move it to the second generation. Allocate
                  * space in the second generation. */
                 to_gen2 = 1;
-                new_addr = MVM_gc_gen2_allocate(gen2, item->size);
+                new_addr = MVM_gc_gen2_allocate(tc, gen2, item->size);
 
                 /* Copy the object to the second generation and mark it as
                  * living there. */
@@ -245,6 +395,7 @@ static void process_worklist(MVMThreadContext *tc, MVMGCWorklist *worklist, Work
                 memcpy(new_addr, item, item->size);
                 new_addr->flags ^= MVM_CF_NURSERY_SEEN;
                 new_addr->flags |= MVM_CF_SECOND_GEN;
+                tc->gc_promoted_bytes += item->size;
 
                 /* If it references frames or static frames, we need to keep
                  * on visiting it. */
@@ -255,9 +406,12 @@ static void process_worklist(MVMThreadContext *tc, MVMGCWorklist *worklist, Work
                 }
 
                 /* If we're going to sweep the second generation, also need
-                 * to mark it as live. */
-                if (gen == MVMGCGenerations_Both)
+                 * to mark it as live. The same goes if we're marking it
+                 * incrementally; we mark its children just below. */
+                if (gen == MVMGCGenerations_Both || marking) {
                     new_addr->flags |= MVM_CF_GEN2_LIVE;
+                    count_marked(tc, new_addr);
+                }
             }
             else {
                 /* No, so it will live in the nursery for another GC
@@ -307,7 +461,7 @@ static void process_worklist(MVMThreadContext *tc, MVMGCWorklist *worklist, Work
 
             for (k = gen2count; k < max; k++) {
                 j = worklist->list[k];
-                if (*j)
+                if (*j && !((*j)->flags & MVM_CF_SECOND_GEN))
                     MVM_gc_write_barrier(tc, new_addr, *j);
             }
         }
@@ -414,8 +568,9 @@ static void push_work_to_thread_in_tray(MVMThreadContext *tc, MVMuint32 target,
         MVMGCPassedWork *orig = *target_tray;
         work->next = orig;
         if (MVM_casptr(target_tray, orig, work) == orig)
-            return;
+            break;
     }
+    MVM_gc_wake_waiters(tc->instance);
 }
 
 /* Adds work to list of items to pass over to another thread, and if we
@@ -495,6 +650,9 @@ static void add_in_tray_to_worklist(MVMThreadContext *tc, MVMGCWorklist *worklis
         MVM_store(&head->completed, 1);
         head = next;
     }
+
+    /* Let the threads that passed it know it's done. */
+    MVM_gc_wake_waiters(tc->instance);
 }
 
 /* Save dead STable pointers to delete later.. */
@@ -529,8 +687,8 @@ void MVM_gc_collect_free_nursery_uncopied(MVMThreadContext *tc, void *limit) {
              * incremented by object size. */
             MVMObject *obj = (MVMObject *)item;
             GCDEBUG_LOG(tc, MVM_GC_DEBUG_COLLECT, "Thread %d run %d : collecting an object %p in the nursery with reprid %d\n", item, REPR(obj)->ID);
-            if (dead && REPR(obj)->gc_free)
-                REPR(obj)->gc_free(tc, obj);
+            if (dead)
+                MVM_gc_finalize_dead(tc, obj);
         }
         else if (item->flags & MVM_CF_TYPE_OBJECT) {
             /* Type object; doesn't have anything extra that needs freeing. */
@@ -552,6 +710,42 @@ void MVM_gc_collect_free_nursery_uncopied(MVMThreadContext *tc, void *limit) {
     }
 }
 
+/* Works out how big a thread's nursery should be at its next collection,
+ * from how it allocated since the last one; limit is where allocation had
+ * got to in what is now fromspace. A thread that fills its nursery quickly
+ * gets a bigger one, so it collects less often; an idle one gets a smaller
+ * one, giving memory back. */
+void MVM_gc_collect_adapt_nursery(MVMThreadContext *tc, void *limit) {
+    MVMInstance *instance = tc->instance;
+    MVMuint64    now      = MVM_platform_now();
+    MVMuint64    interval = now - tc->gc_last_run_time;
+    MVMuint32    used     = (char *)limit - (char *)tc->nursery_fromspace;
+    MVMuint32    survived = (char *)tc->nursery_alloc - (char *)tc->nursery_tospace;
+    MVMuint32    filled   = tc->nursery_fromspace_size;
+    MVMuint32    idle     = tc->nursery_fromspace_size / MVM_NURSERY_IDLE_FRACTION;
+    MVMuint32    wanted   = tc->nursery_size;
+    tc->gc_last_run_time  = now;
+    if (!instance->nursery_adaptive)
+        return;
+
+    if (used >= filled - idle && interval < MVM_NURSERY_GROW_INTERVAL) {
+        wanted = tc->nursery_size < instance->nursery_max_size / 2
+            ? tc->nursery_size * 2
+            : instance->nursery_max_size;
+    }
+    else if (used < idle) {
+        wanted = tc->nursery_size / 2;
+        if (wanted < MVM_NURSERY_MIN_SIZE)
+            wanted = MVM_NURSERY_MIN_SIZE;
+        if (wanted < 2 * survived)
+            wanted = 2 * survived;
+    }
+    if (wanted != tc->nursery_size)
+        GCDEBUG_LOG(tc, MVM_GC_DEBUG_COLLECT, "Thread %d run %d : resizing nursery from %u to %u bytes\n",
+            tc->nursery_size, wanted);
+    tc->nursery_wanted_size = wanted;
+}
+
 /* Goes through the inter-generational roots and removes any that have been
 * determined dead. Should run just after gen2 GC has run but before building
 * the free list (which clears the marks). */
@@ -566,9 +760,13 @@ void MVM_gc_collect_cleanup_gen2roots(MVMThreadContext *tc) {
     tc->num_gen2roots = ins_pos;
 }
 
-/* Free STables (in any thread/generation!) queued to be freed. */
+/* Free STables (in any thread/generation!) queued to be freed. While any
+ * thread has second generation pages left to sweep, there may be dead
+ * objects still to be freed that need their STable, so we wait. */
 void MVM_gc_collect_free_stables(MVMThreadContext *tc) {
     MVMSTable *st = tc->instance->stables_to_free;
+    if (MVM_load(&tc->instance->gc_sweeping))
+        return;
     while (st) {
         MVMSTable *st_to_free = st;
         st = st_to_free->header.sc_forward_u.st;
@@ -578,123 +776,225 @@ void MVM_gc_collect_free_stables(MVMThreadContext *tc) {
     tc->instance->stables_to_free = NULL;
 }
 
-/* Goes through the unmarked objects in the second generation heap and builds
- * free lists out of them. Also does any required finalization. */
-void MVM_gc_collect_free_gen2_unmarked(MVMThreadContext *tc) {
-    /* Visit each of the size class bins. */
-    MVMGen2Allocator *gen2 = tc->gen2;
-    MVMuint32 bin, obj_size, page, i;
-    char ***freelist_insert_pos;
-    for (bin = 0; bin < MVM_GEN2_BINS; bin++) {
-        /* If we've nothing allocated in this size class, skip it. */
-        if (gen2->size_classes[bin].pages == NULL)
-            continue;
+/* Gives back to the OS a page of a size class bin that has nothing in it,
+ * and which has already been taken out of the free list. This is never the
+ * last page, which is the one being allocated from. */
+static void release_gen2_page(MVMThreadContext *tc, MVMGen2SizeClass *sc, MVMuint32 obj_size, MVMuint32 page) {
+    GCDEBUG_LOG(tc, MVM_GC_DEBUG_COLLECT, "Thread %d run %d : releasing gen2 page %p\n", sc->pages[page]);
+    MVM_gc_gen2_free_page(sc->pages[page], (obj_size >> MVM_GEN2_BIN_BITS) - 1);
+    memmove(sc->pages + page, sc->pages + page + 1,
+        (sc->num_pages - page - 1) * sizeof(char *));
+    sc->num_pages--;
+    if (sc->cur_page > page)
+        sc->cur_page--;
+}
 
-        /* Calculate object size for this bin. */
-        obj_size = (bin + 1) << MVM_GEN2_BIN_BITS;
-
-        /* freelist_insert_pos is a pointer to a memory location that
-         * stores the address of the last traversed free list node (char **). */
-        /* Initialize freelist insertion position to free list head. */
-        freelist_insert_pos = &gen2->size_classes[bin].free_list;
-
-        /* Visit each page. */
-        for (page = 0; page < gen2->size_classes[bin].num_pages; page++) {
-            /* Visit all the objects, looking for dead ones and reset the
-             * mark for each of them. */
-            char *cur_ptr = gen2->size_classes[bin].pages[page];
-            char *end_ptr = page + 1 == gen2->size_classes[bin].num_pages
-                ? gen2->size_classes[bin].alloc_pos
-                : cur_ptr + obj_size * MVM_GEN2_PAGE_ITEMS;
-            char **last_insert_pos = NULL;
-            while (cur_ptr < end_ptr) {
-                MVMCollectable *col = (MVMCollectable *)cur_ptr;
-
-                /* Is this already a free list slot? If so, it becomes the
-                 * new free list insert position. */
-                if (*freelist_insert_pos == (char **)cur_ptr) {
-                    freelist_insert_pos = (char ***)cur_ptr;
-                }
+/* Sweeps a page of a size class bin in the second generation, adding the
+ * unmarked objects in it to the free list and clearing the marks of the
+ * others. Also does any required finalization. If all is set, treats all
+ * objects as unmarked, as in global destruction.
+ *
+ * If the page turns out to have nothing alive in it and the size class has
+ * plenty of free slots already, it is taken back out of the free list and
+ * released, and we return 1 (so the caller knows the following pages moved
+ * down); otherwise we return 0. */
+static MVMuint32 sweep_gen2_page(MVMThreadContext *tc, MVMGen2SizeClass *sc, MVMuint32 obj_size, MVMuint32 page, MVMuint8 all) {
+    /* freelist_insert_pos is a pointer to a memory location that
+     * stores the address of the last traversed free list node (char **). */
+    char ***freelist_insert_pos = sc->sweep_insert_pos;
+
+    /* The free list link before the first of this page's slots, and the
+     * number of free slots found in it. */
+    char ***page_insert_pos = freelist_insert_pos;
+    MVMuint32 free_slots = 0;
+
+    /* Visit all the objects, looking for dead ones and reset the
+     * mark for each of them. */
+    char *cur_ptr = sc->pages[page];
+    char *end_ptr = page + 1 == sc->num_pages
+        ? sc->alloc_pos
+        : cur_ptr + obj_size * MVM_GEN2_PAGE_ITEMS;
+    while (cur_ptr < end_ptr) {
+        MVMCollectable *col = (MVMCollectable *)cur_ptr;
+
+        /* Is this already a free list slot? If so, it becomes the
+         * new free list insert position. */
+        if (*freelist_insert_pos == (char **)cur_ptr) {
+            freelist_insert_pos = (char ***)cur_ptr;
+            free_slots++;
+        }
 
-                /* Otherwise, it must be a collectable of some kind. Is it
-                 * live? */
-                else if (col->flags & MVM_CF_GEN2_LIVE) {
-                    /* Yes; clear the mark. */
-                    col->flags &= ~MVM_CF_GEN2_LIVE;
+        /* Otherwise, it must be a collectable of some kind. Is it
+         * live? */
+        else if ((col->flags & MVM_CF_GEN2_LIVE) && !all) {
+            /* Yes; clear the mark. */
+            col->flags &= ~MVM_CF_GEN2_LIVE;
+        }
+        else {
+            GCDEBUG_LOG(tc, MVM_GC_DEBUG_COLLECT, "Thread %d run %d : collecting an object %p in the gen2\n", col);
+            /* No, it's dead. Do any cleanup. */
+            if (!(col->flags & (MVM_CF_TYPE_OBJECT | MVM_CF_STABLE))) {
+                /* Object instance; call gc_free if needed. */
+                MVM_gc_finalize_dead(tc, (MVMObject *)col);
+            }
+            else if (col->flags & MVM_CF_TYPE_OBJECT) {
+                /* Type object; doesn't have anything extra that needs freeing. */
+            }
+            else if (col->flags & MVM_CF_STABLE) {
+                if (col->sc_forward_u.sc == (MVMSerializationContext *)3) {
+                    /* We marked it dead last time, kill it. */
+                    MVM_6model_stable_gc_free(tc, (MVMSTable *)col);
                 }
                 else {
-                    GCDEBUG_LOG(tc, MVM_GC_DEBUG_COLLECT, "Thread %d run %d : collecting an object %p in the gen2\n", col);
-                    /* No, it's dead. Do any cleanup. */
-                    if (!(col->flags & (MVM_CF_TYPE_OBJECT | MVM_CF_STABLE))) {
-                        /* Object instance; call gc_free if needed. */
-                        MVMObject *obj = (MVMObject *)col;
-                        if (REPR(obj)->gc_free)
-                            REPR(obj)->gc_free(tc, obj);
-                    }
-                    else if (col->flags & MVM_CF_TYPE_OBJECT) {
-                        /* Type object; doesn't have anything extra that needs freeing. */
-                    }
-                    else if (col->flags & MVM_CF_STABLE) {
-                        if (col->sc_forward_u.sc == (MVMSerializationContext *)3) {
-                            /* We marked it dead last time, kill it. */
-                            MVM_6model_stable_gc_free(tc, (MVMSTable *)col);
-                        }
-                        else {
-                            if (MVM_load(&tc->gc_status) == MVMGCStatus_NONE) {
-                                /* We're in global destruction, so enqueue to the end
-                                 * like we do in the nursery */
-                                MVM_gc_collect_enqueue_stable_for_deletion(tc, (MVMSTable *)col);
-                            } else {
-                                /* There will definitely be another gc run, so mark it as "died last time". */
-                                col->sc_forward_u.sc = (MVMSerializationContext *)3;
-                            }
-                            /* Skip the freelist updating. */
-                            cur_ptr += obj_size;
-                            continue;
-                        }
-                    }
-                    else {
-                        printf("item flags: %d\n", col->flags);
-                        MVM_panic(MVM_exitcode_gcnursery, "Internal error: impossible case encountered in gen2 GC free");
+                    if (all) {
+                        /* We're in global destruction, so enqueue to the end
+                         * like we do in the nursery */
+                        MVM_gc_collect_enqueue_stable_for_deletion(tc, (MVMSTable *)col);
+                    } else {
+                        /* There will definitely be another gc run, so mark it as "died last time". */
+                        col->sc_forward_u.sc = (MVMSerializationContext *)3;
                     }
+                    /* Skip the freelist updating. */
+                    cur_ptr += obj_size;
+                    continue;
+                }
+            }
+            else {
+                printf("item flags: %d\n", col->flags);
+                MVM_panic(MVM_exitcode_gcnursery, "Internal error: impossible case encountered in gen2 GC free");
+            }
 
-                    /* Chain in to the free list. */
-                    *((char **)cur_ptr) = (char *)*freelist_insert_pos;
-                    *freelist_insert_pos = (char **)cur_ptr;
+            /* Chain in to the free list. */
+            *((char **)cur_ptr) = (char *)*freelist_insert_pos;
+            *freelist_insert_pos = (char **)cur_ptr;
 
-                    /* Update the pointer to the insert position to point to us */
-                    freelist_insert_pos = (char ***)cur_ptr;
-                }
+            /* Update the pointer to the insert position to point to us */
+            freelist_insert_pos = (char ***)cur_ptr;
+            free_slots++;
+        }
 
-                /* Move to the next object. */
-                cur_ptr += obj_size;
-            }
+        /* Move to the next object. */
+        cur_ptr += obj_size;
+    }
+
+    sc->sweep_slots += (end_ptr - sc->pages[page]) / obj_size;
+    sc->sweep_free  += free_slots;
+
+    /* If the page is empty and the size class fragmented enough that we'd
+     * rather not keep it, unlink its slots (which are all together in the
+     * free list) and give it back. */
+    if (free_slots == MVM_GEN2_PAGE_ITEMS && !all && page + 1 < sc->num_pages
+            && tc->instance->gc_release_pages
+            && (MVMuint64)sc->sweep_free * 100
+                > (MVMuint64)sc->sweep_slots * MVM_GEN2_RELEASE_FREE_PERCENT) {
+        *page_insert_pos     = *freelist_insert_pos;
+        sc->sweep_insert_pos = page_insert_pos;
+        sc->sweep_slots     -= MVM_GEN2_PAGE_ITEMS;
+        sc->sweep_free      -= MVM_GEN2_PAGE_ITEMS;
+        release_gen2_page(tc, sc, obj_size, page);
+        return 1;
+    }
+
+    sc->sweep_insert_pos = freelist_insert_pos;
+    return 0;
+}
+
+/* Sweeps up to the specified number of the pages of a size class bin that
+ * are still to be swept after the last full collection, or all of them if
+ * it is zero. */
+static void sweep_gen2_bin(MVMThreadContext *tc, MVMGen2Allocator *gen2, MVMuint32 bin, MVMuint32 max_pages, MVMuint8 all) {
+    MVMGen2SizeClass *sc       = &gen2->size_classes[bin];
+    MVMuint32         obj_size = (bin + 1) << MVM_GEN2_BIN_BITS;
+    MVMuint32         swept    = 0;
+    while (sc->sweeping && (!max_pages || swept < max_pages)) {
+        /* If the page was released, the next one took its place. */
+        if (!sweep_gen2_page(tc, sc, obj_size, sc->sweep_page, all))
+            sc->sweep_page++;
+        swept++;
+        if (sc->sweep_page == sc->num_pages) {
+            /* All done; the free list is in order again. */
+            sc->sweeping         = 0;
+            sc->sweep_page       = 0;
+            sc->sweep_insert_pos = NULL;
+            if (--gen2->num_sweeping == 0)
+                MVM_decr(&tc->instance->gc_sweeping);
         }
     }
-    
-    /* Also need to consider overflows. */
-    for (i = 0; i < gen2->num_overflows; i++) {
-        if (gen2->overflows[i]) {
-            MVMCollectable *col = gen2->overflows[i];
-            if (col->flags & MVM_CF_GEN2_LIVE) {
-                /* A living over-sized object; just clear the mark. */
-                col->flags &= ~MVM_CF_GEN2_LIVE;
+}
+void MVM_gc_collect_sweep_gen2_bin(MVMThreadContext *tc, MVMGen2Allocator *gen2, MVMuint32 bin, MVMuint32 max_pages) {
+    sweep_gen2_bin(tc, gen2, bin, max_pages, 0);
+}
+
+/* Sweeps any pages of the second generation still to be swept after the last
+ * full collection. This must be done before marking it again, since the
+ * marks left in those pages would otherwise be taken as new ones. */
+void MVM_gc_collect_finish_gen2_sweep(MVMThreadContext *tc, MVMGen2Allocator *gen2) {
+    MVMuint32 bin;
+    for (bin = 0; gen2->num_sweeping && bin < MVM_GEN2_BINS; bin++)
+        sweep_gen2_bin(tc, gen2, bin, 0, 0);
+}
+
+/* Goes through the unmarked objects in the second generation heap and builds
+ * free lists out of them. Also does any required finalization. If all is
+ * set, treats all objects as unmarked, as in global destruction.
+ *
+ * Unless lazy sweeping is disabled (or this is global destruction), the size
+ * class bins are not swept here, which would mean visiting every object in
+ * the heap while the other threads wait for us. Instead, they are set up to
+ * be swept a page at a time by the allocator, as it needs more free slots;
+ * see MVM_gc_gen2_allocate. */
+void MVM_gc_collect_free_gen2_unmarked(MVMThreadContext *tc, MVMuint8 all) {
+    /* Visit each of the size class bins. */
+    MVMGen2Allocator *gen2 = tc->gen2;
+    MVMGen2LargeObject *lo;
+    MVMuint32 bin;
+
+    /* Anything left over from the last full collection has to be swept
+     * using its marks, not these ones. */
+    MVM_gc_collect_finish_gen2_sweep(tc, gen2);
+
+    for (bin = 0; bin < MVM_GEN2_BINS; bin++) {
+        MVMGen2SizeClass *sc = &gen2->size_classes[bin];
+
+        /* If we've nothing allocated in this size class, skip it. */
+        if (sc->pages == NULL)
+            continue;
+
+        /* Sweeping starts from the first page, inserting into the free list
+         * from its head. */
+        sc->sweeping         = 1;
+        sc->sweep_page       = 0;
+        sc->sweep_insert_pos = &sc->free_list;
+        sc->sweep_slots      = 0;
+        sc->sweep_free       = 0;
+        if (gen2->num_sweeping++ == 0)
+            MVM_incr(&tc->instance->gc_sweeping);
+
+        if (all || !tc->instance->gc_lazy_sweep)
+            sweep_gen2_bin(tc, gen2, bin, 0, all);
+    }
+
+    /* Also need to consider the large object space. */
+    lo = gen2->large_objects;
+    while (lo) {
+        MVMGen2LargeObject *next = lo->next;
+        MVMCollectable     *col  = MVM_GEN2_LARGE_OBJECT(lo);
+        if ((col->flags & MVM_CF_GEN2_LIVE) && !all) {
+            /* A living large object; just clear the mark. */
+            col->flags &= ~MVM_CF_GEN2_LIVE;
+        }
+        else {
+            /* Dead large object. We know if it's this big it cannot be a
+             * type object or STable, so only need handle the simple object
+             * case. */
+            if (!(col->flags & (MVM_CF_TYPE_OBJECT | MVM_CF_STABLE))) {
+                MVM_gc_finalize_dead(tc, (MVMObject *)col);
             }
             else {
-                /* Dead over-sized object. We know if it's this big it cannot
-                 * be a type object or STable, so only need handle the simple
-                 * object case. */
-                if (!(col->flags & (MVM_CF_TYPE_OBJECT | MVM_CF_STABLE))) {
-                    MVMObject *obj = (MVMObject *)col;
-                    if (REPR(obj)->gc_free)
-                        REPR(obj)->gc_free(tc, obj);
-                }
-                else {
-                    MVM_panic(MVM_exitcode_gcnursery, "Internal error: gen2 overflow contains non-object");
-                }
-                free(col);
-                gen2->overflows[i] = NULL;
+                MVM_panic(MVM_exitcode_gcnursery, "Internal error: gen2 large object space contains non-object");
             }
+            MVM_gc_gen2_free_large(gen2, lo);
         }
+        lo = next;
     }
 }
@@ -1,12 +1,41 @@
 /* How big is the nursery area? Note that since it's semi-space copying, we
- * actually have double this amount allocated. Also it is per thread. (In
- * the future, we'll make this adaptive rather than a constant.) */
-#define MVM_NURSERY_SIZE 4194304
+ * actually have double this amount allocated. Also it is per thread. This is
+ * the size a thread's nursery starts out at; after that, it adapts to how
+ * the thread allocates, staying between the minimum and maximum sizes. The
+ * starting and maximum sizes can be set with MVM_NURSERY_SIZE and
+ * MVM_NURSERY_MAX_SIZE in the environment, and MVM_NURSERY_ADAPTIVE_DISABLE
+ * keeps nurseries at the starting size. */
+#define MVM_NURSERY_SIZE        4194304
+#define MVM_NURSERY_MIN_SIZE    262144
+#define MVM_NURSERY_MAX_SIZE    67108864
+
+/* A thread that fills its nursery within this many nanoseconds of its last
+ * collection gets its nursery doubled, so it collects less often. One that
+ * used less than 1/MVM_NURSERY_IDLE_FRACTION of it gets it halved, though
+ * never to less than twice what survived the collection. */
+#define MVM_NURSERY_GROW_INTERVAL   20000000
+#define MVM_NURSERY_IDLE_FRACTION   8
 
 /* How often do we collect the second generation? This is specified as the
  * number of nursery runs that happen per full collection. For example, if
- * this is set to 10 then every tenth collection will involve the full heap. */
-#define MVM_GC_GEN2_RATIO 25
+ * this is set to 10 then every tenth collection will involve the full heap.
+ * A full collection also comes sooner if more has been allocated in the
+ * second generation since the last one than MVM_GC_GEN2_GROWTH percent of
+ * what that one found alive (counting at least MVM_GC_GEN2_MIN_GROWTH
+ * bytes). Both can be set in the environment, under the same names; a
+ * growth of 0 leaves just the ratio. */
+#define MVM_GC_GEN2_RATIO       25
+#define MVM_GC_GEN2_GROWTH      100
+#define MVM_GC_GEN2_MIN_GROWTH  33554432
+
+/* When the second generation is marked incrementally, a marking cycle starts
+ * where a full collection would otherwise happen. Each thread then spreads
+ * the marking of its part of the second generation over about this many
+ * nursery collections, doing at least MVM_GC_MARK_SLICE_MIN objects in each.
+ * If marking is not done after twice that many, the rest of it is done in
+ * one go. */
+#define MVM_GC_MARK_RUNS        16
+#define MVM_GC_MARK_SLICE_MIN   1024
 
 /* What things should be processed in this GC run? */
 typedef enum {
@@ -50,6 +79,10 @@ struct MVMGCPassedWork {
 void MVM_gc_collect(MVMThreadContext *tc, MVMuint8 what_to_do, MVMuint8 gen);
 void MVM_gc_collect_free_nursery_uncopied(MVMThreadContext *tc, void *limit);
 void MVM_gc_collect_cleanup_gen2roots(MVMThreadContext *tc);
-void MVM_gc_collect_free_gen2_unmarked(MVMThreadContext *tc);
+void MVM_gc_collect_free_gen2_unmarked(MVMThreadContext *tc, MVMuint8 all);
+void MVM_gc_collect_sweep_gen2_bin(MVMThreadContext *tc, MVMGen2Allocator *gen2, MVMuint32 bin, MVMuint32 max_pages);
+void MVM_gc_collect_finish_gen2_sweep(MVMThreadContext *tc, MVMGen2Allocator *gen2);
+void MVM_gc_collect_push_grey(MVMThreadContext *tc, MVMCollectable *item);
 void MVM_gc_mark_collectable(MVMThreadContext *tc, MVMGCWorklist *worklist, MVMCollectable *item);
 void MVM_gc_collect_free_stables(MVMThreadContext *tc);
+void MVM_gc_collect_adapt_nursery(MVMThreadContext *tc, void *limit);
@@ -0,0 +1,49 @@
+#include "moar.h"
+
+/* Freeing the resources held by dead objects (calling their REPR's gc_free)
+ * happens as the GC finds them, which is mostly during a GC run, when every
+ * thread waits for it to finish. For representations where this may take a
+ * while (tearing down hash tables, closing handles and so forth), that would
+ * stretch the pause, so they can set defer_free in their REPR ops. A dead
+ * object of such a REPR is copied onto the owning thread's finalization
+ * queue, and the gc_free is run on the copy by that thread once it has left
+ * the GC run (or, if it was blocked, once it unblocks). Since a copy is made,
+ * the gc_free must only deal with the object's body and not expect it to be
+ * at the same address, nor look at its STable. */
+
+/* Called for each dead object (not type object or STable). Frees it now, or
+ * queues it to be freed after the GC run. */
+void MVM_gc_finalize_dead(MVMThreadContext *tc, MVMObject *obj) {
+    const MVMREPROps *repr = REPR(obj);
+    if (!repr->gc_free)
+        return;
+    if (repr->defer_free && tc->instance->gc_finalize_queue
+            && MVM_load(&tc->gc_status) != MVMGCStatus_NONE) {
+        MVMObject *copy = malloc(obj->header.size);
+        memcpy(copy, obj, obj->header.size);
+        if (tc->num_finalize == tc->alloc_finalize) {
+            tc->alloc_finalize = tc->alloc_finalize
+                ? tc->alloc_finalize * 2
+                : MVM_GC_FINALIZE_QUEUE_SIZE;
+            tc->finalize = realloc(tc->finalize,
+                tc->alloc_finalize * sizeof(MVMGCFinalizeItem));
+        }
+        tc->finalize[tc->num_finalize].repr = repr;
+        tc->finalize[tc->num_finalize].copy = copy;
+        tc->num_finalize++;
+    }
+    else {
+        repr->gc_free(tc, obj);
+    }
+}
+
+/* Runs the gc_free of everything in a thread's finalization queue. */
+void MVM_gc_finalize_run_queue(MVMThreadContext *tc) {
+    MVMuint32 i;
+    for (i = 0; i < tc->num_finalize; i++) {
+        MVMGCFinalizeItem *item = &tc->finalize[i];
+        item->repr->gc_free(tc, item->copy);
+        free(item->copy);
+    }
+    tc->num_finalize = 0;
+}
@@ -0,0 +1,13 @@
+/* A dead object whose representation's gc_free is yet to be run, along with
+ * the representation (since its STable may be gone by then). The object is
+ * a copy of the dead one, which lived in memory the GC has reused since. */
+struct MVMGCFinalizeItem {
+    const MVMREPROps *repr;
+    MVMObject        *copy;
+};
+
+/* Initial size of a thread's finalization queue. */
+#define MVM_GC_FINALIZE_QUEUE_SIZE  64
+
+void MVM_gc_finalize_dead(MVMThreadContext *tc, MVMObject *obj);
+void MVM_gc_finalize_run_queue(MVMThreadContext *tc);
@@ -1,4 +1,5 @@
 #include "moar.h"
+#include "platform/mmap.h"
 
 /* Creates a new second generation allocator. */
 MVMGen2Allocator * MVM_gc_gen2_create(MVMInstance *i) {
@@ -9,23 +10,37 @@ MVMGen2Allocator * MVM_gc_gen2_create(MVMInstance *i) {
     al->size_classes = malloc(sizeof(MVMGen2SizeClass) * MVM_GEN2_BINS);
     memset(al->size_classes, 0, sizeof(MVMGen2SizeClass) * MVM_GEN2_BINS);
 
-    /* Set up overflows area. */
-    al->alloc_overflows = MVM_GEN2_OVERFLOWS;
-    al->num_overflows = 0;
-    al->overflows = malloc(al->alloc_overflows * sizeof(MVMCollectable *));
+    /* Set up the large object space. */
+    al->large_objects     = NULL;
+    al->num_large_objects = 0;
+    al->large_free        = calloc(MVM_GEN2_LARGE_CLASSES, sizeof(MVMGen2LargeObject *));
+    al->large_free_bytes  = 0;
 
     return al;
 }
 
+/* Maps a page for a size class bin from the OS. */
+static char * alloc_page(MVMuint32 bin) {
+    char *page = MVM_platform_alloc_pages(MVM_GEN2_PAGE_SIZE(bin), 0);
+    if (!page)
+        MVM_panic(MVM_exitcode_gcalloc, "Could not allocate a second generation page");
+    return page;
+}
+
+/* Gives a page of a size class bin back to the OS. */
+void MVM_gc_gen2_free_page(char *page, MVMuint32 bin) {
+    MVM_platform_free_pages(page, MVM_GEN2_PAGE_SIZE(bin));
+}
+
 /* Sets up a size class bin in the second generation. */
 static void setup_bin(MVMGen2Allocator *al, MVMuint32 bin) {
     /* Work out page size we want. */
-    MVMuint32 page_size = MVM_GEN2_PAGE_ITEMS * ((bin + 1) << MVM_GEN2_BIN_BITS);
+    MVMuint32 page_size = MVM_GEN2_PAGE_SIZE(bin);
 
     /* We'll just allocate a single page to start off with. */
     al->size_classes[bin].num_pages = 1;
     al->size_classes[bin].pages     = malloc(sizeof(void *) * al->size_classes[bin].num_pages);
-    al->size_classes[bin].pages[0]  = malloc(page_size);
+    al->size_classes[bin].pages[0]  = alloc_page(bin);
 
     /* Set up allocation position and limit. */
     al->size_classes[bin].alloc_pos = al->size_classes[bin].pages[0];
@@ -38,14 +53,14 @@ static void setup_bin(MVMGen2Allocator *al, MVMuint32 bin) {
 /* Adds a new page to a size class bin. */
 static void add_page(MVMGen2Allocator *al, MVMuint32 bin) {
     /* Work out page size. */
-    MVMuint32 page_size = MVM_GEN2_PAGE_ITEMS * ((bin + 1) << MVM_GEN2_BIN_BITS);
+    MVMuint32 page_size = MVM_GEN2_PAGE_SIZE(bin);
 
     /* Add the extra page. */
     MVMuint32 cur_page = al->size_classes[bin].num_pages;
     al->size_classes[bin].num_pages++;
     al->size_classes[bin].pages = realloc(al->size_classes[bin].pages,
         sizeof(void *) * al->size_classes[bin].num_pages);
-    al->size_classes[bin].pages[cur_page] = malloc(page_size);
+    al->size_classes[bin].pages[cur_page] = alloc_page(bin);
 
     /* Set up allocation position and limit. */
     al->size_classes[bin].alloc_pos = al->size_classes[bin].pages[cur_page];
@@ -55,10 +70,63 @@ static void add_page(MVMGen2Allocator *al, MVMuint32 bin) {
     al->size_classes[bin].cur_page = cur_page;
 }
 
+/* Allocates an object in the large object space, reusing a free block of
+ * the right size if we have one. */
+static void * allocate_large(MVMGen2Allocator *al, MVMuint32 size) {
+    MVMuint64 granules = (size + MVM_GEN2_LARGE_GRANULE - 1) / MVM_GEN2_LARGE_GRANULE;
+    MVMGen2LargeObject *lo;
+    if (granules < MVM_GEN2_LARGE_CLASSES && al->large_free[granules]) {
+        lo = al->large_free[granules];
+        al->large_free[granules] = lo->next;
+        al->large_free_bytes -= granules * MVM_GEN2_LARGE_GRANULE;
+    }
+    else {
+        lo = malloc(sizeof(MVMGen2LargeObject) + granules * MVM_GEN2_LARGE_GRANULE);
+        lo->granules = granules;
+    }
+
+    /* Add it to the list of large objects. */
+    lo->prev = NULL;
+    lo->next = al->large_objects;
+    if (al->large_objects)
+        al->large_objects->prev = lo;
+    al->large_objects = lo;
+    al->num_large_objects++;
+
+    return MVM_GEN2_LARGE_OBJECT(lo);
+}
+
+/* Frees an object in the large object space, keeping its block for reuse if
+ * we're not keeping too much already. */
+void MVM_gc_gen2_free_large(MVMGen2Allocator *al, MVMGen2LargeObject *lo) {
+    MVMuint64 bytes = lo->granules * MVM_GEN2_LARGE_GRANULE;
+
+    /* Take it out of the list of large objects. */
+    if (lo->prev)
+        lo->prev->next = lo->next;
+    else
+        al->large_objects = lo->next;
+    if (lo->next)
+        lo->next->prev = lo->prev;
+    al->num_large_objects--;
+
+    /* Either keep it or give it back. */
+    if (lo->granules < MVM_GEN2_LARGE_CLASSES
+            && al->large_free_bytes + bytes <= MVM_GEN2_LARGE_FREE_MAX) {
+        lo->prev = NULL;
+        lo->next = al->large_free[lo->granules];
+        al->large_free[lo->granules] = lo;
+        al->large_free_bytes += bytes;
+    }
+    else {
+        free(lo);
+    }
+}
+
 /* Allocates space using the second generation allocator and returns
  * a pointer to the allocated space. Does not zero the space or set
  * it up in any way. */
-void * MVM_gc_gen2_allocate(MVMGen2Allocator *al, MVMuint32 size) {
+void * MVM_gc_gen2_allocate(MVMThreadContext *tc, MVMGen2Allocator *al, MVMuint32 size) {
     void *result;
 
     /* Determine the bin. If we hit a bin exactly then it's off-by-one,
@@ -68,16 +136,32 @@ void * MVM_gc_gen2_allocate(MVMGen2Allocator *al, MVMuint32 size) {
     if ((size & MVM_GEN2_BIN_MASK) == 0)
         bin--;
 
+    /* Count it towards the growth of gen2 since the last full collection. */
+    tc->gc_gen2_allocated += size;
+
     /* If the selected bin is in range... */
     if (bin < MVM_GEN2_BINS) {
         /* If we've no pages yet, never encountered this bin; set it up. */
         if (al->size_classes[bin].pages == NULL)
             setup_bin(al, bin);
 
+        /* If we've no free slots from pages swept since the last full
+         * collection, sweep some more pages. We mustn't hand out any free
+         * slot in a page not yet swept, as the sweep would take the new
+         * object there, being unmarked, for dead. */
+        while (al->size_classes[bin].sweeping
+                && al->size_classes[bin].sweep_insert_pos == &al->size_classes[bin].free_list)
+            MVM_gc_collect_sweep_gen2_bin(tc, al, bin, 1);
+
         /* If there's a free list entry, use that. */
         if (al->size_classes[bin].free_list) {
             result = (void *)al->size_classes[bin].free_list;
             al->size_classes[bin].free_list = (char **)*(al->size_classes[bin].free_list);
+
+            /* If it was the only free slot in the swept pages, the next
+             * one found by sweeping goes at the head of the free list. */
+            if (al->size_classes[bin].sweep_insert_pos == (char ***)result)
+                al->size_classes[bin].sweep_insert_pos = &al->size_classes[bin].free_list;
         }
         else {
             /* If we're at the page limit, add a new page. */
@@ -90,16 +174,8 @@ void * MVM_gc_gen2_allocate(MVMGen2Allocator *al, MVMuint32 size) {
         }
     }
     else {
-        /* We're beyond the size class bins, so resort to malloc. */
-        result = malloc(size);
-
-        /* Add to overflows list. */
-        if (al->num_overflows == al->alloc_overflows) {
-            al->alloc_overflows *= 2;
-            al->overflows = realloc(al->overflows,
-                al->alloc_overflows * sizeof(MVMCollectable *));
-        }
-        al->overflows[al->num_overflows++] = result;
+        /* We're beyond the size class bins, so use the large object space. */
+        result = allocate_large(al, size);
     }
 
     return result;
@@ -108,30 +184,48 @@ void * MVM_gc_gen2_allocate(MVMGen2Allocator *al, MVMuint32 size) {
 /* Allocates space using the second generation allocator and returns
  * a pointer to the allocated space. Promises the memory will be
  * zeroed, except that the MVMCollectable gen 2 flag will get set. */
-void * MVM_gc_gen2_allocate_zeroed(MVMGen2Allocator *al, MVMuint32 size) {
-    void *a = MVM_gc_gen2_allocate(al, size);
+void * MVM_gc_gen2_allocate_zeroed(MVMThreadContext *tc, MVMGen2Allocator *al, MVMuint32 size) {
+    void *a = MVM_gc_gen2_allocate(tc, al, size);
     memset(a, 0, size);
     ((MVMCollectable *)a)->flags = MVM_CF_SECOND_GEN;
     return a;
 }
 
+/* Gets the number of object slots in the second generation, whether in use
+ * or not, as a rough measure of its size. */
+MVMuint64 MVM_gc_gen2_num_slots(MVMGen2Allocator *al) {
+    MVMuint64 slots = al->num_large_objects;
+    MVMuint32 bin;
+    for (bin = 0; bin < MVM_GEN2_BINS; bin++)
+        slots += (MVMuint64)al->size_classes[bin].num_pages * MVM_GEN2_PAGE_ITEMS;
+    return slots;
+}
+
 /* Frees all memory associated with the second generation. */
 void MVM_gc_gen2_destroy(MVMInstance *i, MVMGen2Allocator *al) {
+    MVMGen2LargeObject *lo;
     MVMint32 j;
     
     /* Remove all pages. */
     /* Usually the GC transfers all pages to another thread. */
 
-    /* Free any allocated overflows. */
-    for (j = 0; j < al->num_overflows; j++)
-        if (al->overflows[j])
-            free(al->overflows[j]);
+    /* Free any large objects, and any free blocks we kept. */
+    while ((lo = al->large_objects)) {
+        al->large_objects = lo->next;
+        free(lo);
+    }
+    for (j = 0; j < MVM_GEN2_LARGE_CLASSES; j++) {
+        while ((lo = al->large_free[j])) {
+            al->large_free[j] = lo->next;
+            free(lo);
+        }
+    }
 
     /* Clean up allocator data structure. */
     free(al->size_classes);
     al->size_classes = NULL;
-    free(al->overflows);
-    al->overflows = NULL;
+    free(al->large_free);
+    al->large_free = NULL;
     free(al);
 }
 
@@ -141,6 +235,11 @@ void MVM_gc_gen2_transfer(MVMThreadContext *src, MVMThreadContext *dest) {
     MVMuint32 bin, obj_size, page;
     char ***freelist_insert_pos;
 
+    /* The pages must all be swept first, so that the free lists can be
+     * trusted to hold all of the free slots. */
+    MVM_gc_collect_finish_gen2_sweep(src, gen2);
+    MVM_gc_collect_finish_gen2_sweep(dest, dest_gen2);
+
     for (bin = 0; bin < MVM_GEN2_BINS; bin++) {
         MVMuint32 orig_dest_num_pages = dest_gen2->size_classes[bin].num_pages;
         char *cur_ptr, *end_ptr;
@@ -224,6 +323,23 @@ void MVM_gc_gen2_transfer(MVMThreadContext *src, MVMThreadContext *dest) {
         gen2->size_classes[bin].pages = NULL;
         gen2->size_classes[bin].num_pages = 0;
     }
+    { /* move the large objects over... */
+        MVMGen2LargeObject *lo = gen2->large_objects, *last = NULL;
+        while (lo) {
+            MVM_GEN2_LARGE_OBJECT(lo)->owner = dest->thread_id;
+            last = lo;
+            lo = lo->next;
+        }
+        if (last) {
+            last->next = dest_gen2->large_objects;
+            if (dest_gen2->large_objects)
+                dest_gen2->large_objects->prev = last;
+            dest_gen2->large_objects = gen2->large_objects;
+            dest_gen2->num_large_objects += gen2->num_large_objects;
+            gen2->large_objects = NULL;
+            gen2->num_large_objects = 0;
+        }
+    }
     { /* copy the roots... */
         MVMuint32 i, n = src->num_gen2roots;
         for ( i = 0; i < n; i++) {
@@ -234,4 +350,11 @@ void MVM_gc_gen2_transfer(MVMThreadContext *src, MVMThreadContext *dest) {
         free(src->gen2roots);
         src->gen2roots = NULL;
     }
+    { /* ...and any objects still to be marked in an incremental marking
+       * cycle, which the destination now owns. */
+        MVMuint32 i, n = src->num_gc_grey;
+        for (i = 0; i < n; i++)
+            MVM_gc_collect_push_grey(dest, src->gc_grey[i]);
+        src->num_gc_grey = 0;
+    }
 }
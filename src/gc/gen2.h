@@ -20,8 +20,39 @@ struct MVMGen2SizeClass {
 
     /* The number of pages allocated. */
     MVMuint32 num_pages;
+
+    /* After a full collection, the pages are swept lazily, in order, as the
+     * allocator runs out of slots already known to be free. This is whether
+     * there are pages left to sweep, the next one to sweep, and the link in
+     * the free list after which the next free slot found goes (everything
+     * on the free list before that is in pages already swept). */
+    MVMuint32   sweeping;
+    MVMuint32   sweep_page;
+    char     ***sweep_insert_pos;
+
+    /* The number of slots in the pages swept so far in this sweep, and how
+     * many of them were free. Used to decide whether a page found to be
+     * entirely free is worth keeping around. */
+    MVMuint32   sweep_slots;
+    MVMuint32   sweep_free;
+};
+
+/* The header of a block in the large object space, which holds objects too
+ * big for any size class, each in a block of its own. It links the object
+ * that follows it into its allocator's list of large objects, or, once the
+ * object is dead, the block into the list of free blocks of its size. */
+struct MVMGen2LargeObject {
+    MVMGen2LargeObject *prev;
+    MVMGen2LargeObject *next;
+
+    /* Size of the block, not counting this header, in granules. */
+    MVMuint64           granules;
 };
 
+/* Gets the large object space header for a large object, and vice versa. */
+#define MVM_GEN2_LARGE_HEADER(col) ((MVMGen2LargeObject *)(col) - 1)
+#define MVM_GEN2_LARGE_OBJECT(lo)  ((MVMCollectable *)((MVMGen2LargeObject *)(lo) + 1))
+
 /* An "instance" of the fixed size allocator. */
 struct MVMGen2Allocator {
     /* Size classes for the fixed size allocator. Each one represents
@@ -30,15 +61,21 @@ struct MVMGen2Allocator {
      * past the limit. */
     MVMGen2SizeClass *size_classes;
 
-    /* Array of objects that were malloc'd instead, because they did
-     * not fit in a size class due to being too large. */
-    MVMCollectable **overflows;
+    /* The large object space, for objects that did not fit in a size
+     * class due to being too large: a list of the objects in it, and how
+     * many there are. */
+    MVMGen2LargeObject  *large_objects;
+    MVMuint32            num_large_objects;
 
-    /* The number of objects in the overflow array. */
-    MVMuint32        num_overflows;
+    /* Blocks freed up in the large object space, listed by their size in
+     * granules, for reuse by objects of the same size, and their total
+     * size in bytes. Anything beyond MVM_GEN2_LARGE_FREE_MAX bytes is
+     * given back to the system instead. */
+    MVMGen2LargeObject **large_free;
+    MVMuint64            large_free_bytes;
 
-    /* The amount of space allocated in the overflow array. */
-    MVMuint32        alloc_overflows;
+    /* The number of size classes with pages left to sweep. */
+    MVMuint32        num_sweeping;
 };
 
 /* The number of bits we discard from the requested size when binning
@@ -58,15 +95,34 @@ struct MVMGen2Allocator {
 /* Number of bins in the FSA. Beyond this, we just degrade to malloc/free. */
 #define MVM_GEN2_BINS       32
 
-/* Default overflow list size. */
-#define MVM_GEN2_OVERFLOWS  32
+/* Blocks in the large object space are allocated in units of this many
+ * bytes. Since an object's size fits in 16 bits, this gives the number of
+ * free block lists we need. */
+#define MVM_GEN2_LARGE_GRANULE  256
+#define MVM_GEN2_LARGE_CLASSES  (65536 / MVM_GEN2_LARGE_GRANULE + 1)
+
+/* The most memory to keep around in free large object blocks. */
+#define MVM_GEN2_LARGE_FREE_MAX 4194304
+
+/* The number of items that go into each page. Pages are mapped from the OS
+ * directly, so that those released by the sweep really are given back; with
+ * this many items, the page size of every bin is a multiple of 4KB. */
+#define MVM_GEN2_PAGE_ITEMS 512
+
+/* The size of a page in a given size class bin. */
+#define MVM_GEN2_PAGE_SIZE(bin) (MVM_GEN2_PAGE_ITEMS * (((bin) + 1) << MVM_GEN2_BIN_BITS))
 
-/* The number of items that go into each page. */
-#define MVM_GEN2_PAGE_ITEMS 256
+/* When sweeping finds a page with nothing alive in it, it is given back
+ * rather than kept on the free list if more than this percentage of the
+ * slots in the size class swept so far are free. */
+#define MVM_GEN2_RELEASE_FREE_PERCENT   25
 
 /* Functions. */
 MVMGen2Allocator * MVM_gc_gen2_create(MVMInstance *i);
-void * MVM_gc_gen2_allocate(MVMGen2Allocator *al, MVMuint32 size);
-void * MVM_gc_gen2_allocate_zeroed(MVMGen2Allocator *al, MVMuint32 size);
+void * MVM_gc_gen2_allocate(MVMThreadContext *tc, MVMGen2Allocator *al, MVMuint32 size);
+void * MVM_gc_gen2_allocate_zeroed(MVMThreadContext *tc, MVMGen2Allocator *al, MVMuint32 size);
+MVMuint64 MVM_gc_gen2_num_slots(MVMGen2Allocator *al);
 void MVM_gc_gen2_destroy(MVMInstance *i, MVMGen2Allocator *allocator);
 void MVM_gc_gen2_transfer(MVMThreadContext *src, MVMThreadContext *dest);
+void MVM_gc_gen2_free_large(MVMGen2Allocator *al, MVMGen2LargeObject *lo);
+void MVM_gc_gen2_free_page(char *page, MVMuint32 bin);
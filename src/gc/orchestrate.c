@@ -1,5 +1,6 @@
 #include "moar.h"
 #include <platform/threads.h>
+#include <platform/time.h>
 
 /* If we have the job of doing GC for a thread, we add it to our work
  * list. */
@@ -15,6 +16,70 @@ static void add_work(MVMThreadContext *tc, MVMThreadContext *stolen) {
     tc->gc_work[tc->gc_work_count++].tc = stolen;
 }
 
+/* Puts a thread whose collection we were given (because it was blocked or
+ * has exited) into the instance's pool, so that whichever GC thread is free
+ * first can do it. */
+static void offer_work(MVMThreadContext *tc, MVMThreadContext *other) {
+    MVMThreadContext *head;
+    do {
+        head = (MVMThreadContext *)MVM_load(&tc->instance->gc_work_pool);
+        other->gc_work_next = head;
+    } while (MVM_casptr(&tc->instance->gc_work_pool, head, other) != head);
+}
+
+/* Takes a thread out of the instance's pool of threads to collect, or
+ * returns NULL if it is empty. Since a thread goes in the pool at most once
+ * per GC run, a thread being taken out can't have been put back in again
+ * since we looked at it. */
+static MVMThreadContext * take_work(MVMThreadContext *tc) {
+    MVMThreadContext *head;
+    do {
+        head = (MVMThreadContext *)MVM_load(&tc->instance->gc_work_pool);
+        if (!head)
+            return NULL;
+    } while (MVM_casptr(&tc->instance->gc_work_pool, head, head->gc_work_next) != head);
+    head->gc_work_next = NULL;
+    return head;
+}
+
+/* Wakes up any threads waiting for something in the GC orchestration to
+ * change. Called after changing the start, finish or acknowledgement counts,
+ * passing work to a thread, completing passed work, or handing threads back
+ * their GC status. The mutex is only taken if there is somebody asleep. */
+void MVM_gc_wake_waiters(MVMInstance *instance) {
+    MVM_incr(&instance->gc_wake_seq);
+    if (MVM_load(&instance->gc_sleepers)) {
+        uv_mutex_lock(&instance->mutex_gc_orchestrate);
+        uv_cond_broadcast(&instance->cond_gc_orchestrate);
+        uv_mutex_unlock(&instance->mutex_gc_orchestrate);
+    }
+}
+
+/* Called by a thread that found what it is waiting for has not happened yet,
+ * passing the wake sequence number it read before looking. Most waits are
+ * short, so we spin a while, then yield a few times, and only then sleep
+ * until somebody calls MVM_gc_wake_waiters. Since the sequence number is
+ * checked under the mutex, and a waker bumps it before checking for
+ * sleepers, no wake-up can be missed. */
+static void wait_for_wake(MVMThreadContext *tc, AO_t seen, MVMuint32 *spins) {
+    MVMInstance *instance = tc->instance;
+    if (*spins < MVM_GC_WAIT_SPINS) {
+        (*spins)++;
+        return;
+    }
+    if (*spins < MVM_GC_WAIT_SPINS + MVM_GC_WAIT_YIELDS) {
+        (*spins)++;
+        MVM_platform_thread_yield();
+        return;
+    }
+    uv_mutex_lock(&instance->mutex_gc_orchestrate);
+    MVM_incr(&instance->gc_sleepers);
+    while (MVM_load(&instance->gc_wake_seq) == seen)
+        uv_cond_wait(&instance->cond_gc_orchestrate, &instance->mutex_gc_orchestrate);
+    MVM_decr(&instance->gc_sleepers);
+    uv_mutex_unlock(&instance->mutex_gc_orchestrate);
+}
+
 /* Goes through all threads but the current one and notifies them that a
  * GC run is starting. Those that are blocked are considered excluded from
  * the run, and are not counted. Returns the count of threads that should be
@@ -97,8 +162,8 @@ static MVMuint32 signal_all_but(MVMThreadContext *tc, MVMThread *t, MVMThread *t
     return count;
 }
 
-/* Does work in a thread's in-tray, if any. */
-static void process_in_tray(MVMThreadContext *tc, MVMuint8 gen, MVMuint32 *put_vote) {
+/* Does work in a thread's in-tray, if any. Returns 1 if there was some. */
+static MVMuint32 process_in_tray(MVMThreadContext *tc, MVMuint8 gen, MVMuint32 *put_vote) {
     /* Do we have any more work given by another thread? If so, re-enter
      * GC loop to process it. Note that since we're now doing GC stuff
      * again, we take back our vote to finish. */
@@ -109,7 +174,9 @@ static void process_in_tray(MVMThreadContext *tc, MVMuint8 gen, MVMuint32 *put_v
             *put_vote = 1;
         }
         MVM_gc_collect(tc, MVMGCWhatToDo_InTray, gen);
+        return 1;
     }
+    return 0;
 }
 
 /* Checks whether our sent items have been completed. Returns 0 if all work is done. */
@@ -150,23 +217,34 @@ static void cleanup_sent_items(MVMThreadContext *tc) {
 /* Called by a thread when it thinks it is done with GC. It may get some more
  * work yet, though. */
 static void finish_gc(MVMThreadContext *tc, MVMuint8 gen) {
-    MVMuint32 put_vote = 1, i;
+    MVMuint32 put_vote = 1, spins = 0, i;
 
     /* Loop until other threads have terminated, processing any extra work
-     * that we are given. */
-    while (MVM_load(&tc->instance->gc_finish)) {
+     * that we are given. When there's nothing for us to do, wait for another
+     * thread to pass us work, complete work we passed, or vote. */
+    while (1) {
+        AO_t      seen   = MVM_load(&tc->instance->gc_wake_seq);
         MVMuint32 failed = 0;
+        MVMuint32 worked = 0;
         MVMuint32 i = 0;
 
+        if (!MVM_load(&tc->instance->gc_finish))
+            break;
+
         for ( ; i < tc->gc_work_count; i++) {
-            process_in_tray(tc->gc_work[i].tc, gen, &put_vote);
+            worked |= process_in_tray(tc->gc_work[i].tc, gen, &put_vote);
             failed |= process_sent_items(tc->gc_work[i].tc, &put_vote);
         }
 
         if (!failed && put_vote) {
             MVM_decr(&tc->instance->gc_finish);
+            MVM_gc_wake_waiters(tc->instance);
             put_vote = 0;
         }
+        if (worked)
+            spins = 0;
+        else
+            wait_for_wake(tc, seen, &spins);
     }
 /*    GCDEBUG_LOG(tc, MVM_GC_DEBUG_ORCHESTRATE, "Thread %d run %d : Discovered GC termination\n");*/
 
@@ -178,9 +256,12 @@ static void finish_gc(MVMThreadContext *tc, MVMuint8 gen) {
         MVMThread *thread_obj = other->thread_obj;
         cleanup_sent_items(other);
         if (MVM_load(&thread_obj->body.stage) == MVM_thread_stage_clearing_nursery) {
-            GCDEBUG_LOG(tc, MVM_GC_DEBUG_ORCHESTRATE, "Thread %d run %d : freeing gen2 of thread %d\n", other->thread_id);
-            /* always free gen2 */
-            MVM_gc_collect_free_gen2_unmarked(other);
+            /* always free gen2, unless we're part way through marking it
+             * incrementally, in which case we'll do it when that's done */
+            if (!MVM_load(&tc->instance->gc_marking)) {
+                GCDEBUG_LOG(tc, MVM_GC_DEBUG_ORCHESTRATE, "Thread %d run %d : freeing gen2 of thread %d\n", other->thread_id);
+                MVM_gc_collect_free_gen2_unmarked(other, 0);
+            }
             GCDEBUG_LOG(tc, MVM_GC_DEBUG_ORCHESTRATE, "Thread %d run %d : transferring gen2 of thread %d\n", other->thread_id);
             MVM_gc_gen2_transfer(other, tc);
             GCDEBUG_LOG(tc, MVM_GC_DEBUG_ORCHESTRATE, "Thread %d run %d : destroying thread %d\n", other->thread_id);
@@ -206,6 +287,10 @@ static void finish_gc(MVMThreadContext *tc, MVMuint8 gen) {
          * trying to write to it here). */
         MVM_store(&tc->instance->gc_ack, 0);
     }
+
+    /* Let the next coordinator and any threads we handed back their status
+     * know. */
+    MVM_gc_wake_waiters(tc->instance);
 }
 
 /* Called by a thread to indicate it is about to enter a blocking operation.
@@ -232,13 +317,22 @@ void MVM_gc_mark_thread_blocked(MVMThreadContext *tc) {
  * thus able to particpate in a GC run again. Note that this case needs some
  * special handling if it comes out of this mode when a GC run is taking place. */
 void MVM_gc_mark_thread_unblocked(MVMThreadContext *tc) {
+    MVMuint32 spins = 0;
+
     /* Try to set it from unable to running. */
-    while (MVM_cas(&tc->gc_status, MVMGCStatus_UNABLE,
-            MVMGCStatus_NONE) != MVMGCStatus_UNABLE) {
+    while (1) {
+        AO_t seen = MVM_load(&tc->instance->gc_wake_seq);
+        if (MVM_cas(&tc->gc_status, MVMGCStatus_UNABLE,
+                MVMGCStatus_NONE) == MVMGCStatus_UNABLE)
+            break;
+
         /* We can't, presumably because a GC run is going on. We should wait
          * for that to finish before we go on, but without chewing CPU. */
-        MVM_platform_thread_yield();
+        wait_for_wake(tc, seen, &spins);
     }
+
+    /* Free anything found dead while we were blocked. */
+    MVM_gc_finalize_run_queue(tc);
 }
 
 static void signal_child(MVMThreadContext *tc) {
@@ -253,32 +347,133 @@ static void signal_child(MVMThreadContext *tc) {
     }
 }
 
-static void run_gc(MVMThreadContext *tc, MVMuint8 what_to_do) {
-    MVMuint8   gen;
-    MVMThread *child;
-    MVMuint32  i, n;
+/* Decides whether a full collection is due: either enough nursery runs have
+ * happened since the last one, or enough has been allocated in gen2 since,
+ * relative to what the last one found alive. */
+static MVMuint8 full_collection_due(MVMInstance *instance) {
+    MVMuint64 runs = MVM_load(&instance->gc_seq_number) - instance->gc_full_seq;
+    if (runs >= instance->gc_gen2_ratio)
+        return 1;
+    if (instance->gc_gen2_growth) {
+        MVMuint64 threshold = instance->gc_gen2_live / 100 * instance->gc_gen2_growth;
+        if (threshold < MVM_GC_GEN2_MIN_GROWTH)
+            threshold = MVM_GC_GEN2_MIN_GROWTH;
+        if (MVM_load(&instance->gc_gen2_allocated) >= threshold)
+            return 1;
+    }
+    return 0;
+}
+
+/* Decides which generations the GC run that is starting will collect. This
+ * is done by the coordinator before the other threads are let go, so they
+ * all agree on it. A full collection is done when one is due (see
+ * full_collection_due); with incremental marking, that run instead starts a
+ * marking cycle, which ends with a full collection once marking is done. */
+static void choose_generations(MVMThreadContext *tc) {
+    MVMInstance *instance = tc->instance;
+    MVMuint8     gen      = MVMGCGenerations_Nursery;
+    MVMuint8     cycle;
+
+    /* If the last run was a full collection, what was marked is what's now
+     * alive in gen2; growth is measured against that. */
+    if (MVM_load(&instance->gc_generations) == MVMGCGenerations_Both)
+        instance->gc_gen2_live = MVM_load(&instance->gc_gen2_marked);
+
+    cycle = full_collection_due(instance);
+    if (!instance->gc_incremental) {
+        if (cycle) {
+            MVM_store(&instance->gc_gen2_marked, 0);
+            MVM_gc_telemetry_reset_live(instance);
+            gen = MVMGCGenerations_Both;
+        }
+    }
+    else if (MVM_load(&instance->gc_marking)) {
+        instance->gc_mark_runs++;
+        if (!MVM_load(&instance->gc_mark_unfinished)
+                || instance->gc_mark_runs >= 2 * MVM_GC_MARK_RUNS) {
+            GCDEBUG_LOG(tc, MVM_GC_DEBUG_ORCHESTRATE, "Thread %d run %d : finishing gen2 marking cycle after %d runs\n", instance->gc_mark_runs);
+            MVM_store(&instance->gc_marking, 0);
+            gen = MVMGCGenerations_Both;
+        }
+    }
+    else if (cycle) {
+        GCDEBUG_LOG(tc, MVM_GC_DEBUG_ORCHESTRATE, "Thread %d run %d : starting gen2 marking cycle\n");
+        instance->gc_mark_runs = 0;
+        MVM_store(&instance->gc_gen2_marked, 0);
+        MVM_gc_telemetry_reset_live(instance);
+        MVM_store(&instance->gc_marking, 1);
+    }
+    if (gen == MVMGCGenerations_Both) {
+        instance->gc_full_seq = MVM_load(&instance->gc_seq_number);
+        MVM_store(&instance->gc_gen2_allocated, 0);
+    }
+    MVM_store(&instance->gc_mark_unfinished, 0);
+    MVM_store(&instance->gc_generations, gen);
+}
 
-    /* Do GC work for this thread, or at least all we know about. */
-    gen = MVM_load(&tc->instance->gc_seq_number) % MVM_GC_GEN2_RATIO == 0
-        ? MVMGCGenerations_Both
-        : MVMGCGenerations_Nursery;
+/* Before gen2 is marked, every thread must have finished sweeping its gen2
+ * after the last full collection, since until an object's page is swept its
+ * live flag is left over from that collection, and marking would take it as
+ * already seen. A thread marks objects of others before handing them over,
+ * so it is not enough for each to finish its own sweep; the coordinator does
+ * them all while the other threads wait to start. */
+static void finish_gen2_sweeps(MVMThreadContext *tc, MVMThread *threads) {
+    MVMInstance *instance = tc->instance;
+    if (!MVM_load(&instance->gc_sweeping))
+        return;
+    if (MVM_load(&instance->gc_generations) != MVMGCGenerations_Both && !MVM_load(&instance->gc_marking))
+        return;
+    for (; threads; threads = threads->body.next) {
+        MVMThreadContext *other = threads->body.tc;
+        if (other && MVM_load(&threads->body.stage) != MVM_thread_stage_destroyed)
+            MVM_gc_collect_finish_gen2_sweep(other, other->gen2);
+    }
+}
 
-    /* Do GC work for any work threads. */
-    for (i = 0, n = tc->gc_work_count ; i < n; i++) {
-        MVMThreadContext *other = tc->gc_work[i].tc;
-        tc->gc_work[i].limit = other->nursery_alloc;
+static void run_gc(MVMThreadContext *tc, MVMuint8 what_to_do) {
+    MVMuint8          gen;
+    MVMThread        *child;
+    MVMThreadContext *stolen;
+    MVMuint32         i, n;
+    MVMuint64         start_time = MVM_platform_now();
+    MVMuint64         phase_time;
+    MVMGCRunStats     stats;
+
+    /* What are we collecting? */
+    gen = (MVMuint8)MVM_load(&tc->instance->gc_generations);
+
+    /* Start keeping track of what we do, for telemetry. */
+    memset(&stats, 0, sizeof(MVMGCRunStats));
+    stats.wait_time = start_time - tc->gc_enter_time;
+
+    /* Any other threads we were given to collect (our own thread is always
+     * first in the list) go into the pool, so that all of the GC threads
+     * share them out rather than us doing them one after the other. */
+    for (i = 1, n = tc->gc_work_count; i < n; i++)
+        offer_work(tc, tc->gc_work[i].tc);
+    tc->gc_work_count = 1;
+
+    /* Do GC work for this thread. */
+    tc->gc_work[0].limit = tc->nursery_alloc;
+    MVM_gc_collect(tc, what_to_do, gen);
+
+    /* Then for threads from the pool, until it's empty. Those we take on are
+     * ours for the rest of the run, including their in-trays and cleanup. */
+    while ((stolen = take_work(tc))) {
+        add_work(tc, stolen);
+        tc->gc_work[tc->gc_work_count - 1].limit = stolen->nursery_alloc;
         GCDEBUG_LOG(tc, MVM_GC_DEBUG_ORCHESTRATE, "Thread %d run %d : starting collection for thread %d\n",
-            other->thread_id);
-        MVM_gc_collect(other, (other == tc ? what_to_do : MVMGCWhatToDo_NoInstance), gen);
+            stolen->thread_id);
+        MVM_gc_collect(stolen, MVMGCWhatToDo_NoInstance, gen);
     }
 
     /* Wait for everybody to agree we're done. */
     finish_gc(tc, gen);
+    stats.mark_time = MVM_platform_now() - start_time;
 
     /* Now we're all done, it's safe to finalize any objects that need it. */
-	/* XXX TODO explore the feasability of doing this in a background
-	 * finalizer/destructor thread and letting the main thread(s) continue
-	 * on their merry way(s). */
+	/* Any REPR whose gc_free may take a while can have it left until we're
+	 * out of the GC run; see finalize.c. */
     for (i = 0, n = tc->gc_work_count ; i < n; i++) {
         MVMThreadContext *other = tc->gc_work[i].tc;
         MVMThread *thread_obj;
@@ -288,14 +483,40 @@ static void run_gc(MVMThreadContext *tc, MVMuint8 what_to_do) {
 
         thread_obj = other->thread_obj;
 
+        /* Other threads are done with any objects the write barrier had
+         * recorded for us. */
+        MVM_checked_free_null(other->gc_shaded_taken);
+
+        stats.threads++;
+        stats.promoted_bytes += other->gc_promoted_bytes;
+        stats.nursery_bytes  += (char *)tc->gc_work[i].limit - (char *)other->nursery_fromspace;
+        stats.survived_bytes += (char *)other->nursery_alloc - (char *)other->nursery_tospace;
+        other->gc_promoted_bytes = 0;
+
+        /* See which of the objects the allocation profiler is following
+         * got promoted, while their forwarders are still there to see. */
+        if (tc->instance->alloc_profiling)
+            MVM_alloc_profile_gc(other);
+
+        phase_time = MVM_platform_now();
         MVM_gc_collect_free_nursery_uncopied(other, tc->gc_work[i].limit);
+        stats.free_nursery_time += MVM_platform_now() - phase_time;
+        MVM_gc_collect_adapt_nursery(other, tc->gc_work[i].limit);
 
         if (gen == MVMGCGenerations_Both) {
             GCDEBUG_LOG(tc, MVM_GC_DEBUG_ORCHESTRATE, "Thread %d run %d : freeing gen2 of thread %d\n", other->thread_id);
+            phase_time = MVM_platform_now();
             MVM_gc_collect_cleanup_gen2roots(other);
-            MVM_gc_collect_free_gen2_unmarked(other);
+            MVM_gc_collect_free_gen2_unmarked(other, 0);
+            stats.sweep_time += MVM_platform_now() - phase_time;
         }
+        stats.gen2roots += other->num_gen2roots;
     }
+
+    MVM_gc_telemetry_done(tc, &stats);
+
+    if (tc->instance->profiling)
+        MVM_profile_log_gc(tc, MVM_platform_now() - start_time);
 }
 
 /* This is called when the allocator finds it has run out of memory and wants
@@ -305,11 +526,13 @@ static void run_gc(MVMThreadContext *tc, MVMuint8 what_to_do) {
 void MVM_gc_enter_from_allocator(MVMThreadContext *tc) {
 
     GCDEBUG_LOG(tc, MVM_GC_DEBUG_ORCHESTRATE, "Thread %d run %d : Entered from allocate\n");
+    tc->gc_enter_time = MVM_platform_now();
 
     /* Try to start the GC run. */
     if (MVM_trycas(&tc->instance->gc_start, 0, 1)) {
         MVMThread *last_starter = NULL;
         MVMuint32 num_threads = 0;
+        MVMuint32 spins = 0;
 
         /* We are the winner of the GC starting race. This gives us some
          * extra responsibilities as well as doing the usual things.
@@ -321,15 +544,23 @@ void MVM_gc_enter_from_allocator(MVMThreadContext *tc) {
         tc->gc_work_count = 0;
 
         /* need to wait for other threads to reset their gc_status. */
-        while (MVM_load(&tc->instance->gc_ack))
-            MVM_platform_thread_yield();
+        while (1) {
+            AO_t seen = MVM_load(&tc->instance->gc_wake_seq);
+            if (!MVM_load(&tc->instance->gc_ack))
+                break;
+            wait_for_wake(tc, seen, &spins);
+        }
+        spins = 0;
 
         add_work(tc, tc);
 
         /* grab our child (if we created one) */
         signal_child(tc);
 
-        do {
+        /* Signal the other threads, then wait for them to count themselves
+         * in, looking again for new threads each time one does. */
+        while (1) {
+            AO_t seen = MVM_load(&tc->instance->gc_wake_seq);
             MVMThread *threads = (MVMThread *)MVM_load(&tc->instance->threads);
             if (threads && threads != last_starter) {
                 MVMThread *head = threads;
@@ -343,10 +574,14 @@ void MVM_gc_enter_from_allocator(MVMThreadContext *tc) {
                 if (add) {
                     GCDEBUG_LOG(tc, MVM_GC_DEBUG_ORCHESTRATE, "Thread %d run %d : Found %d other threads\n", add);
                     MVM_add(&tc->instance->gc_start, add);
+                    MVM_gc_wake_waiters(tc->instance);
                     num_threads += add;
                 }
             }
-        } while (MVM_load(&tc->instance->gc_start) > 1);
+            if (MVM_load(&tc->instance->gc_start) <= 1)
+                break;
+            wait_for_wake(tc, seen, &spins);
+        }
 
         if (!MVM_trycas(&tc->instance->threads, NULL, last_starter))
             MVM_panic(MVM_exitcode_gcorch, "threads list corrupted\n");
@@ -360,9 +595,19 @@ void MVM_gc_enter_from_allocator(MVMThreadContext *tc) {
         MVM_store(&tc->instance->gc_ack, num_threads + 2);
         GCDEBUG_LOG(tc, MVM_GC_DEBUG_ORCHESTRATE, "Thread %d run %d : finish votes is %d\n", (int)MVM_load(&tc->instance->gc_finish));
 
+        /* Decide what we're collecting, and start the run's record. */
+        choose_generations(tc);
+        finish_gen2_sweeps(tc, last_starter);
+
+        /* Take a heap snapshot, if one is due, while all threads are stopped
+         * and nothing has been moved yet. */
+        MVM_profile_heap_snapshot_if_due(tc);
+        MVM_gc_telemetry_start(tc, num_threads + 1);
+
         /* signal to the rest to start */
         if (MVM_decr(&tc->instance->gc_start) != 1)
             MVM_panic(MVM_exitcode_gcorch, "start votes was %d\n", MVM_load(&tc->instance->gc_finish));
+        MVM_gc_wake_waiters(tc->instance);
 
         run_gc(tc, MVMGCWhatToDo_All);
 
@@ -370,6 +615,9 @@ void MVM_gc_enter_from_allocator(MVMThreadContext *tc) {
          * us to muck around in another thread's fromspace while it's mutating
          * tospace, really. */
         MVM_gc_collect_free_stables(tc);
+
+        /* Now the other threads are on their way, free what we found dead. */
+        MVM_gc_finalize_run_queue(tc);
     }
     else {
         /* Another thread beat us to starting the GC sync process. Thus, act as
@@ -383,9 +631,10 @@ void MVM_gc_enter_from_allocator(MVMThreadContext *tc) {
  * that another thread is already trying to start a GC run, so we don't need to
  * try and do that, just enlist in the run. */
 void MVM_gc_enter_from_interrupt(MVMThreadContext *tc) {
-    MVMuint8 decr = 0;
-    AO_t curr;
+    MVMuint32 spins = 0;
+    AO_t curr, seen;
 
+    tc->gc_enter_time = MVM_platform_now();
     tc->gc_work_count = 0;
 
     add_work(tc, tc);
@@ -396,22 +645,39 @@ void MVM_gc_enter_from_interrupt(MVMThreadContext *tc) {
     /* Count us in to the GC run. Wait for a vote to steal. */
     GCDEBUG_LOG(tc, MVM_GC_DEBUG_ORCHESTRATE, "Thread %d run %d : Entered from interrupt\n");
 
-    /* Only want to decrement it if it's 2 or greater... */
-    while ((curr = MVM_load(&tc->instance->gc_start)) < 2
-            || !MVM_trycas(&tc->instance->gc_start, curr, curr - 1)) {
-    /* MVM_platform_thread_yield();*/
+    /* Only want to decrement it if it's 2 or greater, which it will be once
+     * the coordinator has counted us... */
+    while (1) {
+        seen = MVM_load(&tc->instance->gc_wake_seq);
+        curr = MVM_load(&tc->instance->gc_start);
+        if (curr >= 2) {
+            if (MVM_trycas(&tc->instance->gc_start, curr, curr - 1))
+                break;
+        }
+        else {
+            wait_for_wake(tc, seen, &spins);
+        }
     }
+    MVM_gc_wake_waiters(tc->instance);
 
     /* Wait for all threads to indicate readiness to collect. */
-    while (MVM_load(&tc->instance->gc_start)) {
-    /* MVM_platform_thread_yield();*/
+    spins = 0;
+    while (1) {
+        seen = MVM_load(&tc->instance->gc_wake_seq);
+        if (!MVM_load(&tc->instance->gc_start))
+            break;
+        wait_for_wake(tc, seen, &spins);
     }
     run_gc(tc, MVMGCWhatToDo_NoInstance);
+
+    /* Now the other threads are on their way, free what we found dead. */
+    MVM_gc_finalize_run_queue(tc);
 }
 
 /* Run the global destruction phase. */
 void MVM_gc_global_destruction(MVMThreadContext *tc) {
     char *nursery_tmp;
+    MVMuint32 size_tmp;
 
     /* Must wait until we're the only thread... */
     while (tc->instance->num_user_threads) {
@@ -424,10 +690,14 @@ void MVM_gc_global_destruction(MVMThreadContext *tc) {
     nursery_tmp = tc->nursery_fromspace;
     tc->nursery_fromspace = tc->nursery_tospace;
     tc->nursery_tospace = nursery_tmp;
+    size_tmp = tc->nursery_fromspace_size;
+    tc->nursery_fromspace_size = tc->nursery_size;
+    tc->nursery_size = size_tmp;
 
     /* Run the objects' finalizers */
     MVM_gc_collect_free_nursery_uncopied(tc, tc->nursery_alloc);
     MVM_gc_collect_cleanup_gen2roots(tc);
-    MVM_gc_collect_free_gen2_unmarked(tc);
+    MVM_gc_collect_free_gen2_unmarked(tc, 1);
+    MVM_gc_finalize_run_queue(tc);
     MVM_gc_collect_free_stables(tc);
 }
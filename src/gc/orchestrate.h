@@ -3,6 +3,13 @@ void MVM_gc_enter_from_interrupt(MVMThreadContext *tc);
 void MVM_gc_mark_thread_blocked(MVMThreadContext *tc);
 void MVM_gc_mark_thread_unblocked(MVMThreadContext *tc);
 void MVM_gc_global_destruction(MVMThreadContext *tc);
+void MVM_gc_wake_waiters(MVMInstance *instance);
+
+/* How many times a thread waiting on another in GC orchestration checks
+ * again straight away, and then how many times it yields, before it goes to
+ * sleep until woken. */
+#define MVM_GC_WAIT_SPINS   256
+#define MVM_GC_WAIT_YIELDS  8
 
 struct MVMWorkThread {
     MVMThreadContext *tc;
@@ -83,6 +83,9 @@ void MVM_gc_root_add_tc_roots_to_worklist(MVMThreadContext *tc, MVMGCWorklist *w
 
     /* Current dispatcher. */
     MVM_gc_worklist_add(tc, worklist, &tc->cur_dispatcher);
+
+    /* Things the profiler has seen. */
+    MVM_profile_mark_data(tc, worklist);
 }
 
 /* Pushes a temporary root onto the thread-local roots list. */
@@ -191,8 +194,18 @@ void MVM_gc_root_add_gen2s_to_worklist(MVMThreadContext *tc, MVMGCWorklist *work
 
         assert(!(gen2roots[i]->flags & MVM_CF_FORWARDER_VALID));
 
-        /* Mark it, putting marks into temporary worklist. */
-        MVM_gc_mark_collectable(tc, per_obj_worklist, gen2roots[i]);
+        /* Mark it, putting marks into temporary worklist. If its REPR can
+         * tell where it may hold nursery references, just mark those. */
+        if (!(gen2roots[i]->flags & (MVM_CF_TYPE_OBJECT | MVM_CF_STABLE))
+                && REPR(gen2roots[i])->gc_mark_young) {
+            MVMObject *obj = (MVMObject *)gen2roots[i];
+            MVM_gc_worklist_add(tc, per_obj_worklist, &obj->header.sc_forward_u.sc);
+            MVM_gc_worklist_add(tc, per_obj_worklist, &obj->st);
+            REPR(obj)->gc_mark_young(tc, STABLE(obj), OBJECT_BODY(obj), per_obj_worklist);
+        }
+        else {
+            MVM_gc_mark_collectable(tc, per_obj_worklist, gen2roots[i]);
+        }
 
         /* For any referenced objects not in gen2, copy marks and count the
          * number of things we copy. Also copy frames, which always count as
@@ -265,6 +278,15 @@ void MVM_gc_root_add_frame_roots_to_worklist(MVMThreadContext *tc, MVMGCWorklist
     MVM_gc_worklist_add_frame(tc, worklist, cur_frame->caller);
     MVM_gc_worklist_add_frame(tc, worklist, cur_frame->outer);
 
+    /* Add the collectables the frame refers to. */
+    MVM_gc_root_add_frame_registers_to_worklist(tc, worklist, cur_frame);
+}
+
+/* Adds the collectables a frame refers to, including those in its registers,
+ * to the GC worklist. Unlike MVM_gc_root_add_frame_roots_to_worklist, this
+ * neither checks nor updates the frame's GC sequence number, nor does it add
+ * its caller and outer. */
+void MVM_gc_root_add_frame_registers_to_worklist(MVMThreadContext *tc, MVMGCWorklist *worklist, MVMFrame *cur_frame) {
     /* add code_ref to work list unless we're the top-level frame. */
     if (cur_frame->code_ref)
         MVM_gc_worklist_add(tc, worklist, &cur_frame->code_ref);
@@ -299,8 +321,14 @@ static void scan_registers(MVMThreadContext *tc, MVMGCWorklist *worklist, MVMFra
 
     /* Scan locals. */
     if (frame->work && frame->tc) {
-        type_map = frame->static_info->body.local_types;
-        count    = frame->static_info->body.num_locals;
+        if (frame->spesh_cand) {
+            type_map = frame->spesh_cand->local_types;
+            count    = frame->spesh_cand->num_locals;
+        }
+        else {
+            type_map = frame->static_info->body.local_types;
+            count    = frame->static_info->body.num_locals;
+        }
         for (i = 0; i < count; i++)
             if (type_map[i] == MVM_reg_str || type_map[i] == MVM_reg_obj)
                 MVM_gc_worklist_add(tc, worklist, &frame->work[i].o);
@@ -0,0 +1,166 @@
+#include "moar.h"
+#include "platform/time.h"
+
+/* GC telemetry. Every GC run is summed up in an MVMGCRunStats. The
+ * coordinator sets one up once all of the GC threads have entered the run,
+ * then each GC thread adds in what it did and how long it took as it leaves
+ * the run. The last to do so makes it the instance's record of the last GC
+ * run, which the gcstats op hands out as a hash, and, if MVM_GC_LOG names a
+ * file, appends it to that as a line of JSON. Marking gen2 may take several
+ * runs (see collect.c), so the bytes found alive in each size class are
+ * counted up in the instance until the full collection that ends it. */
+
+/* Sets up the record of the GC run that is starting. Called by the
+ * coordinator, once all of the GC threads have entered the run and after it
+ * has chosen what to collect. */
+void MVM_gc_telemetry_start(MVMThreadContext *tc, MVMuint32 gc_threads) {
+    MVMInstance   *instance = tc->instance;
+    MVMGCRunStats *stats    = instance->gc_run_stats;
+    memset(stats, 0, sizeof(MVMGCRunStats));
+    stats->seq        = MVM_load(&instance->gc_seq_number);
+    stats->full       = MVM_load(&instance->gc_generations) == MVMGCGenerations_Both;
+    stats->marking    = MVM_load(&instance->gc_marking) ? 1 : 0;
+    stats->gc_threads = gc_threads;
+    stats->start_time = tc->gc_enter_time;
+    instance->gc_stats_pending = gc_threads;
+}
+
+/* Clears the counts of bytes found alive in gen2, as marking it begins. */
+void MVM_gc_telemetry_reset_live(MVMInstance *instance) {
+    MVMuint32 i;
+    for (i = 0; i < MVM_GC_STATS_CLASSES; i++)
+        MVM_store(&instance->gc_gen2_live_bins[i], 0);
+}
+
+/* Writes a GC run's record as a line of JSON. */
+static void write_log(FILE *fh, MVMGCRunStats *stats) {
+    MVMuint32 i;
+    fprintf(fh, "{\"seq\":%llu,\"generation\":\"%s\",\"marking\":%u,"
+        "\"gc_threads\":%u,\"threads\":%u,\"start_ns\":%llu,\"total_ns\":%llu,"
+        "\"wait_ns\":%llu,\"mark_ns\":%llu,\"sweep_ns\":%llu,\"free_nursery_ns\":%llu,"
+        "\"promoted_bytes\":%llu,\"nursery_bytes\":%llu,\"survived_bytes\":%llu,"
+        "\"gen2roots\":%llu",
+        (unsigned long long)stats->seq, stats->full ? "full" : "nursery",
+        stats->marking, stats->gc_threads, stats->threads,
+        (unsigned long long)stats->start_time, (unsigned long long)stats->total_time,
+        (unsigned long long)stats->wait_time, (unsigned long long)stats->mark_time,
+        (unsigned long long)stats->sweep_time, (unsigned long long)stats->free_nursery_time,
+        (unsigned long long)stats->promoted_bytes, (unsigned long long)stats->nursery_bytes,
+        (unsigned long long)stats->survived_bytes, (unsigned long long)stats->gen2roots);
+    if (stats->full) {
+        fprintf(fh, ",\"gen2_live\":[");
+        for (i = 0; i < MVM_GC_STATS_CLASSES; i++)
+            fprintf(fh, i ? ",%llu" : "%llu", (unsigned long long)stats->gen2_live[i]);
+        fprintf(fh, "]");
+    }
+    fprintf(fh, "}\n");
+    fflush(fh);
+}
+
+/* Called by each GC thread as it leaves the run, to add in what it did. */
+void MVM_gc_telemetry_done(MVMThreadContext *tc, MVMGCRunStats *done) {
+    MVMInstance   *instance = tc->instance;
+    MVMGCRunStats *stats    = instance->gc_run_stats;
+    MVMuint32      i;
+
+    uv_mutex_lock(&instance->mutex_gc_telemetry);
+    stats->threads        += done->threads;
+    stats->promoted_bytes += done->promoted_bytes;
+    stats->nursery_bytes  += done->nursery_bytes;
+    stats->survived_bytes += done->survived_bytes;
+    stats->gen2roots      += done->gen2roots;
+    if (done->wait_time > stats->wait_time)
+        stats->wait_time = done->wait_time;
+    if (done->mark_time > stats->mark_time)
+        stats->mark_time = done->mark_time;
+    if (done->sweep_time > stats->sweep_time)
+        stats->sweep_time = done->sweep_time;
+    if (done->free_nursery_time > stats->free_nursery_time)
+        stats->free_nursery_time = done->free_nursery_time;
+
+    /* If we're the last one out, the record is complete. */
+    if (--instance->gc_stats_pending == 0) {
+        stats->total_time = MVM_platform_now() - stats->start_time;
+        if (stats->full)
+            for (i = 0; i < MVM_GC_STATS_CLASSES; i++)
+                stats->gen2_live[i] = MVM_load(&instance->gc_gen2_live_bins[i]);
+        memcpy(instance->gc_last_run_stats, stats, sizeof(MVMGCRunStats));
+        if (instance->gc_log_fh)
+            write_log(instance->gc_log_fh, stats);
+    }
+    uv_mutex_unlock(&instance->mutex_gc_telemetry);
+}
+
+/* Adds an integer to a hash under the given key. */
+static void bind_int(MVMThreadContext *tc, MVMObject *hash, const char *name, MVMint64 value) {
+    MVMString *key = MVM_string_ascii_decode_nt(tc, tc->instance->VMString, name);
+    MVMObject *boxed;
+    MVM_gc_root_temp_push(tc, (MVMCollectable **)&key);
+    boxed = MVM_repr_box_int(tc, MVM_hll_current(tc)->int_box_type, value);
+    MVM_repr_bind_key_o(tc, hash, key, boxed);
+    MVM_gc_root_temp_pop(tc);
+}
+
+/* Adds a string to a hash under the given key. */
+static void bind_str(MVMThreadContext *tc, MVMObject *hash, const char *name, const char *value) {
+    MVMString *key = MVM_string_ascii_decode_nt(tc, tc->instance->VMString, name);
+    MVMString *str;
+    MVMObject *boxed;
+    MVM_gc_root_temp_push(tc, (MVMCollectable **)&key);
+    str = MVM_string_ascii_decode_nt(tc, tc->instance->VMString, value);
+    MVM_gc_root_temp_push(tc, (MVMCollectable **)&str);
+    boxed = MVM_repr_box_str(tc, MVM_hll_current(tc)->str_box_type, str);
+    MVM_repr_bind_key_o(tc, hash, key, boxed);
+    MVM_gc_root_temp_pop_n(tc, 2);
+}
+
+/* Gets a hash describing the last GC run (empty if there has not been one),
+ * with the same keys as the lines of the GC log. */
+MVMObject * MVM_gc_telemetry_last_run(MVMThreadContext *tc) {
+    MVMInstance   *instance = tc->instance;
+    MVMGCRunStats  stats;
+    MVMObject     *hash, *live;
+    MVMString     *key;
+    MVMuint32      i;
+
+    /* Take a copy, so a GC run finishing meanwhile can't change it. */
+    uv_mutex_lock(&instance->mutex_gc_telemetry);
+    memcpy(&stats, instance->gc_last_run_stats, sizeof(MVMGCRunStats));
+    uv_mutex_unlock(&instance->mutex_gc_telemetry);
+
+    hash = MVM_repr_alloc_init(tc, MVM_hll_current(tc)->slurpy_hash_type);
+    if (!stats.seq)
+        return hash;
+    MVM_gc_root_temp_push(tc, (MVMCollectable **)&hash);
+
+    bind_int(tc, hash, "seq", stats.seq);
+    bind_str(tc, hash, "generation", stats.full ? "full" : "nursery");
+    bind_int(tc, hash, "marking", stats.marking);
+    bind_int(tc, hash, "gc_threads", stats.gc_threads);
+    bind_int(tc, hash, "threads", stats.threads);
+    bind_int(tc, hash, "start_ns", stats.start_time);
+    bind_int(tc, hash, "total_ns", stats.total_time);
+    bind_int(tc, hash, "wait_ns", stats.wait_time);
+    bind_int(tc, hash, "mark_ns", stats.mark_time);
+    bind_int(tc, hash, "sweep_ns", stats.sweep_time);
+    bind_int(tc, hash, "free_nursery_ns", stats.free_nursery_time);
+    bind_int(tc, hash, "promoted_bytes", stats.promoted_bytes);
+    bind_int(tc, hash, "nursery_bytes", stats.nursery_bytes);
+    bind_int(tc, hash, "survived_bytes", stats.survived_bytes);
+    bind_int(tc, hash, "gen2roots", stats.gen2roots);
+
+    /* Bytes alive by size class, the large object space last. */
+    if (stats.full) {
+        live = MVM_repr_alloc_init(tc, MVM_hll_current(tc)->slurpy_array_type);
+        MVM_gc_root_temp_push(tc, (MVMCollectable **)&live);
+        for (i = 0; i < MVM_GC_STATS_CLASSES; i++)
+            MVM_repr_push_o(tc, live, MVM_repr_box_int(tc,
+                MVM_hll_current(tc)->int_box_type, stats.gen2_live[i]));
+        key = MVM_string_ascii_decode_nt(tc, instance->VMString, "gen2_live");
+        MVM_repr_bind_key_o(tc, hash, key, live);
+        MVM_gc_root_temp_pop(tc);
+    }
+
+    MVM_gc_root_temp_pop(tc);
+    return hash;
+}
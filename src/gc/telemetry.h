@@ -0,0 +1,44 @@
+/* Number of entries in the per size class figures: one for each gen2 size
+ * class bin, and a last one for the large object space. */
+#define MVM_GC_STATS_CLASSES    (MVM_GEN2_BINS + 1)
+
+/* What happened in a GC run. Times are in nanoseconds. Each phase is timed
+ * by every GC thread, and we keep the longest, since that is the one the
+ * others waited for. */
+struct MVMGCRunStats {
+    /* The run's sequence number, whether it was a full collection, whether
+     * an incremental marking cycle was going on, how many threads did GC
+     * work and how many had their heaps collected (including blocked ones
+     * that others collected for them). */
+    MVMuint64 seq;
+    MVMuint32 full;
+    MVMuint32 marking;
+    MVMuint32 gc_threads;
+    MVMuint32 threads;
+
+    /* When the run was started, how long it took overall, and the longest
+     * any thread took to get going once it had entered the run, to collect
+     * (copying and marking, until all agreed they were done), to sweep gen2
+     * and to free the uncopied parts of the nurseries. */
+    MVMuint64 start_time;
+    MVMuint64 total_time;
+    MVMuint64 wait_time;
+    MVMuint64 mark_time;
+    MVMuint64 sweep_time;
+    MVMuint64 free_nursery_time;
+
+    /* Bytes promoted to gen2, bytes that were in use in the nurseries and
+     * bytes that survived in them, and the number of gen2 roots left. */
+    MVMuint64 promoted_bytes;
+    MVMuint64 nursery_bytes;
+    MVMuint64 survived_bytes;
+    MVMuint64 gen2roots;
+
+    /* For a full collection, the bytes found alive in gen2, by size class. */
+    MVMuint64 gen2_live[MVM_GC_STATS_CLASSES];
+};
+
+void MVM_gc_telemetry_start(MVMThreadContext *tc, MVMuint32 gc_threads);
+void MVM_gc_telemetry_done(MVMThreadContext *tc, MVMGCRunStats *stats);
+void MVM_gc_telemetry_reset_live(MVMInstance *instance);
+MVMObject * MVM_gc_telemetry_last_run(MVMThreadContext *tc);
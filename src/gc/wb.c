@@ -11,3 +11,21 @@ void MVM_gc_write_barrier_hit(MVMThreadContext *tc, MVMCollectable *update_root)
     if (!(update_root->flags & MVM_CF_IN_GEN2_ROOT_LIST))
         MVM_gc_root_gen2_add(tc, update_root);
 }
+
+/* Called when the write barrier macro sees an unmarked generation 2 object
+ * being stored into another generation 2 object during an incremental gen2
+ * marking cycle. The object being stored into may already have had its
+ * children marked, so we record the referenced object for the next GC run
+ * to mark. */
+void MVM_gc_write_barrier_shade(MVMThreadContext *tc, MVMCollectable *referenced) {
+    /* Storing the same object repeatedly is common; only record it once. */
+    if (tc->num_gc_shaded && tc->gc_shaded[tc->num_gc_shaded - 1] == referenced)
+        return;
+
+    if (tc->num_gc_shaded == tc->alloc_gc_shaded) {
+        tc->alloc_gc_shaded = tc->alloc_gc_shaded ? tc->alloc_gc_shaded * 2 : 64;
+        tc->gc_shaded = realloc(tc->gc_shaded,
+            sizeof(MVMCollectable *) * tc->alloc_gc_shaded);
+    }
+    tc->gc_shaded[tc->num_gc_shaded++] = referenced;
+}
@@ -1,12 +1,19 @@
 /* Functions for if the write barriers are hit. */
 MVM_PUBLIC void MVM_gc_write_barrier_hit(MVMThreadContext *tc, MVMCollectable *update_root);
+MVM_PUBLIC void MVM_gc_write_barrier_shade(MVMThreadContext *tc, MVMCollectable *referenced);
 
 /* Ensures that if a generation 2 object comes to hold a reference to a
  * nursery object, then the generation 2 object becomes an inter-generational
- * root. */
+ * root. While the second generation is being marked incrementally, it also
+ * ensures that a generation 2 object that has not been marked yet does not
+ * escape marking by being stored into one that has. */
 MVM_STATIC_INLINE void MVM_gc_write_barrier(MVMThreadContext *tc, MVMCollectable *update_root, const MVMCollectable *referenced) {
-    if (((update_root->flags & MVM_CF_SECOND_GEN) && referenced && !(referenced->flags & MVM_CF_SECOND_GEN)))
-        MVM_gc_write_barrier_hit(tc, update_root);
+    if ((update_root->flags & MVM_CF_SECOND_GEN) && referenced) {
+        if (!(referenced->flags & MVM_CF_SECOND_GEN))
+            MVM_gc_write_barrier_hit(tc, update_root);
+        else if (!(referenced->flags & MVM_CF_GEN2_LIVE) && tc->instance->gc_marking)
+            MVM_gc_write_barrier_shade(tc, (MVMCollectable *)referenced);
+    }
 }
 
 /* Does an assignment, but makes sure the write barrier MVM_WB is applied
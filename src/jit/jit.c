@@ -0,0 +1,576 @@
+#include "moar.h"
+#include "platform/mmap.h"
+
+/* This is a template JIT for x86-64. Once a static frame has been invoked
+ * enough times, we look through its bytecode for runs of instructions that
+ * we know how to produce machine code for (integer and floating point
+ * arithmetic, comparisons, constants, set and branches), and compile each
+ * run into a function that works directly on the frame's registers. Since
+ * the registers stay in the frame's work area, the GC sees them just as it
+ * does when interpreting.
+ *
+ * The first instruction of each run is replaced by sp_jit_enter in a copy
+ * of the bytecode. When the interpreter reaches it, it calls into machine
+ * code, which runs until it reaches an instruction outside of the run and
+ * then hands back the offset at which the interpreter should continue.
+ * Branches backwards also go back to the interpreter if a GC is wanted. */
+
+/* Macros for getting things from the bytecode stream. */
+#define GET_UI16(pc, idx)   *((MVMuint16 *)(pc + idx))
+#define GET_I16(pc, idx)    *((MVMint16 *)(pc + idx))
+#define GET_I32(pc, idx)    *((MVMint32 *)(pc + idx))
+#define GET_I64(pc, idx)    *((MVMint64 *)(pc + idx))
+
+/* A place in the machine code that needs the native location of a branch
+ * target filling in once we know it. */
+typedef struct {
+    MVMuint32 patch_pos;
+    MVMuint32 target;
+} BranchFixup;
+
+/* State held while JIT-compiling some bytecode. */
+typedef struct {
+    MVMThreadContext *tc;
+    MVMCompUnit      *cu;
+
+    /* The bytecode being compiled, and its size. */
+    MVMuint8  *bc;
+    MVMuint32  bc_size;
+
+    /* The machine code produced so far. */
+    MVMuint8  *code;
+    MVMuint32  code_size;
+    MVMuint32  code_alloc;
+
+    /* Position of the machine code that returns to the interpreter. */
+    MVMuint32  epilogue;
+
+    /* Native position of each compiled instruction of the current run,
+     * indexed by bytecode offset. */
+    MVMuint32 *native_pos;
+
+    /* Branches within the current run that need fixing up. */
+    BranchFixup *fixups;
+    MVMuint32    num_fixups;
+    MVMuint32    alloc_fixups;
+
+    /* Start of each compiled run, by bytecode and by native position. */
+    MVMuint32 *run_starts;
+    MVMuint32 *entry_pos;
+    MVMuint32  num_runs;
+    MVMuint32  alloc_runs;
+} JitState;
+
+/* Gets the size of the instruction at the given position, or 0 if it is
+ * not something we understand. */
+static MVMuint32 instruction_size(JitState *js, MVMuint32 pos, const MVMOpInfo **info_out) {
+    const MVMOpInfo *info = MVM_spesh_get_op_info(js->tc, js->cu, GET_UI16(js->bc, pos));
+    MVMuint32 size = 2;
+    MVMuint32 i;
+    if (!info)
+        return 0;
+    for (i = 0; i < info->num_operands; i++)
+        size += MVM_spesh_operand_size(js->tc, info->operands[i]);
+    *info_out = info;
+    return size;
+}
+
+/* Checks if we can produce machine code for an instruction. */
+static MVMint32 is_supported(MVMuint16 opcode) {
+    switch (opcode) {
+        case MVM_OP_no_op:
+        case MVM_OP_const_i64:
+        case MVM_OP_const_i64_16:
+        case MVM_OP_const_n64:
+        case MVM_OP_set:
+        case MVM_OP_goto:
+        case MVM_OP_if_i:
+        case MVM_OP_unless_i:
+        case MVM_OP_add_i:
+        case MVM_OP_sub_i:
+        case MVM_OP_mul_i:
+        case MVM_OP_band_i:
+        case MVM_OP_bor_i:
+        case MVM_OP_bxor_i:
+        case MVM_OP_neg_i:
+        case MVM_OP_bnot_i:
+        case MVM_OP_not_i:
+        case MVM_OP_inc_i:
+        case MVM_OP_dec_i:
+        case MVM_OP_eq_i:
+        case MVM_OP_ne_i:
+        case MVM_OP_lt_i:
+        case MVM_OP_le_i:
+        case MVM_OP_gt_i:
+        case MVM_OP_ge_i:
+        case MVM_OP_add_n:
+        case MVM_OP_sub_n:
+        case MVM_OP_mul_n:
+        case MVM_OP_div_n:
+        case MVM_OP_coerce_in:
+        case MVM_OP_coerce_ni:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+#if MVM_JIT_ARCH_X64
+
+/* Registers, as numbered in x86-64 instruction encodings. */
+#define X64_RAX     0
+#define X64_XMM0    0
+
+/* Condition codes, as used in setcc and jcc encodings. */
+#define X64_CC_E    0x4
+#define X64_CC_NE   0x5
+#define X64_CC_L    0xC
+#define X64_CC_GE   0xD
+#define X64_CC_LE   0xE
+#define X64_CC_G    0xF
+
+/* Functions for emitting machine code. */
+static void emit_byte(JitState *js, MVMuint8 b) {
+    if (js->code_size == js->code_alloc) {
+        js->code_alloc *= 2;
+        js->code = realloc(js->code, js->code_alloc);
+    }
+    js->code[js->code_size++] = b;
+}
+static void emit_int32(JitState *js, MVMint32 v) {
+    MVMuint32 i;
+    for (i = 0; i < 4; i++)
+        emit_byte(js, (MVMuint8)(((MVMuint32)v) >> (8 * i)));
+}
+static void emit_int64(JitState *js, MVMint64 v) {
+    MVMuint32 i;
+    for (i = 0; i < 8; i++)
+        emit_byte(js, (MVMuint8)(((MVMuint64)v) >> (8 * i)));
+}
+static void patch_rel32(JitState *js, MVMuint32 patch_pos, MVMuint32 target_pos) {
+    MVMint32 rel = (MVMint32)target_pos - (MVMint32)(patch_pos + 4);
+    memcpy(js->code + patch_pos, &rel, 4);
+}
+
+/* Emits the ModRM byte and displacement for addressing a frame register;
+ * while in machine code, rbx holds reg_base. */
+static void emit_frame_reg(JitState *js, MVMuint8 reg_field, MVMuint16 reg) {
+    emit_byte(js, 0x80 | (reg_field << 3) | 0x3);
+    emit_int32(js, reg * sizeof(MVMRegister));
+}
+
+/* Emits a REX.W prefixed instruction with the given opcode bytes working on
+ * a frame register. */
+static void emit_rexw_op(JitState *js, MVMuint8 op, MVMuint8 reg_field, MVMuint16 reg) {
+    emit_byte(js, 0x48);
+    emit_byte(js, op);
+    emit_frame_reg(js, reg_field, reg);
+}
+static void emit_load_rax(JitState *js, MVMuint16 reg) {
+    emit_rexw_op(js, 0x8B, X64_RAX, reg);
+}
+static void emit_store_rax(JitState *js, MVMuint16 reg) {
+    emit_rexw_op(js, 0x89, X64_RAX, reg);
+}
+
+/* Emits a scalar double SSE instruction working on a frame register. */
+static void emit_sse_op(JitState *js, MVMuint8 rexw, MVMuint8 op, MVMuint8 reg_field, MVMuint16 reg) {
+    emit_byte(js, 0xF2);
+    if (rexw)
+        emit_byte(js, 0x48);
+    emit_byte(js, 0x0F);
+    emit_byte(js, op);
+    emit_frame_reg(js, reg_field, reg);
+}
+
+/* Emits code to go back to the interpreter, continuing at the given
+ * bytecode offset. */
+static void emit_exit(JitState *js, MVMuint32 target) {
+    /* mov eax, target; jmp epilogue */
+    emit_byte(js, 0xB8);
+    emit_int32(js, (MVMint32)target);
+    emit_byte(js, 0xE9);
+    emit_int32(js, 0);
+    patch_rel32(js, js->code_size - 4, js->epilogue);
+}
+
+/* Emits an integer comparison, leaving 0 or 1 in the target register. */
+static void emit_compare_i(JitState *js, MVMuint8 cc, MVMuint8 *ins) {
+    emit_load_rax(js, GET_UI16(ins, 2));
+    emit_rexw_op(js, 0x3B, X64_RAX, GET_UI16(ins, 4));
+    /* setcc al; movzx eax, al */
+    emit_byte(js, 0x0F);
+    emit_byte(js, 0x90 | cc);
+    emit_byte(js, 0xC0);
+    emit_byte(js, 0x0F);
+    emit_byte(js, 0xB6);
+    emit_byte(js, 0xC0);
+    emit_store_rax(js, GET_UI16(ins, 0));
+}
+
+/* Emits an unconditional branch to the given bytecode offset from the
+ * instruction at pos in the run [run_start, run_end). */
+static void emit_goto(JitState *js, MVMuint32 pos, MVMuint32 target,
+                      MVMuint32 run_start, MVMuint32 run_end) {
+    if (target < run_start || target >= run_end) {
+        /* Outside of the run; let the interpreter take it. */
+        emit_exit(js, target);
+    }
+    else if (target <= pos) {
+        /* Backward branch; go back to the interpreter if a GC is wanted,
+         * so it gets to the sync point. cmp qword [r12 + gc_status], 0 */
+        emit_byte(js, 0x49);
+        emit_byte(js, 0x83);
+        emit_byte(js, 0xBC);
+        emit_byte(js, 0x24);
+        emit_int32(js, (MVMint32)offsetof(MVMThreadContext, gc_status));
+        emit_byte(js, 0x00);
+        /* je target */
+        emit_byte(js, 0x0F);
+        emit_byte(js, 0x80 | X64_CC_E);
+        emit_int32(js, 0);
+        patch_rel32(js, js->code_size - 4, js->native_pos[target]);
+        emit_exit(js, target);
+    }
+    else {
+        /* Forward branch within the run; fix it up later. */
+        if (js->num_fixups == js->alloc_fixups) {
+            js->alloc_fixups = js->alloc_fixups ? js->alloc_fixups * 2 : 16;
+            js->fixups = realloc(js->fixups, js->alloc_fixups * sizeof(BranchFixup));
+        }
+        emit_byte(js, 0xE9);
+        emit_int32(js, 0);
+        js->fixups[js->num_fixups].patch_pos = js->code_size - 4;
+        js->fixups[js->num_fixups].target    = target;
+        js->num_fixups++;
+    }
+}
+
+/* Emits a branch taken if the integer in the register is non-zero (or, if
+ * if_zero is set, zero). */
+static void emit_cond_branch(JitState *js, MVMuint32 pos, MVMuint16 reg, MVMint32 if_zero,
+                             MVMuint32 target, MVMuint32 run_start, MVMuint32 run_end) {
+    MVMuint32 skip_patch;
+
+    /* cmp qword [reg], 0 */
+    emit_rexw_op(js, 0x83, 7, reg);
+    emit_byte(js, 0x00);
+
+    /* Jump over the branch if the condition does not hold. */
+    emit_byte(js, 0x0F);
+    emit_byte(js, 0x80 | (if_zero ? X64_CC_NE : X64_CC_E));
+    emit_int32(js, 0);
+    skip_patch = js->code_size - 4;
+    emit_goto(js, pos, target, run_start, run_end);
+    patch_rel32(js, skip_patch, js->code_size);
+}
+
+/* Emits machine code for a single instruction. */
+static void emit_instruction(JitState *js, MVMuint32 pos, MVMuint32 run_start, MVMuint32 run_end) {
+    MVMuint8 *ins = js->bc + pos + 2;
+    switch (GET_UI16(js->bc, pos)) {
+        case MVM_OP_no_op:
+            break;
+        case MVM_OP_const_i64:
+        case MVM_OP_const_n64:
+            /* mov rax, imm64 */
+            emit_byte(js, 0x48);
+            emit_byte(js, 0xB8);
+            emit_int64(js, GET_I64(ins, 2));
+            emit_store_rax(js, GET_UI16(ins, 0));
+            break;
+        case MVM_OP_const_i64_16:
+            /* mov qword [reg], imm32 */
+            emit_rexw_op(js, 0xC7, 0, GET_UI16(ins, 0));
+            emit_int32(js, GET_I16(ins, 2));
+            break;
+        case MVM_OP_set:
+            emit_load_rax(js, GET_UI16(ins, 2));
+            emit_store_rax(js, GET_UI16(ins, 0));
+            break;
+        case MVM_OP_goto:
+            emit_goto(js, pos, GET_I32(ins, 0), run_start, run_end);
+            break;
+        case MVM_OP_if_i:
+            emit_cond_branch(js, pos, GET_UI16(ins, 0), 0, GET_I32(ins, 2), run_start, run_end);
+            break;
+        case MVM_OP_unless_i:
+            emit_cond_branch(js, pos, GET_UI16(ins, 0), 1, GET_I32(ins, 2), run_start, run_end);
+            break;
+        case MVM_OP_add_i:
+        case MVM_OP_sub_i:
+        case MVM_OP_band_i:
+        case MVM_OP_bor_i:
+        case MVM_OP_bxor_i: {
+            MVMuint8 op;
+            switch (GET_UI16(js->bc, pos)) {
+                case MVM_OP_add_i:  op = 0x03; break;
+                case MVM_OP_sub_i:  op = 0x2B; break;
+                case MVM_OP_band_i: op = 0x23; break;
+                case MVM_OP_bor_i:  op = 0x0B; break;
+                default:            op = 0x33; break;
+            }
+            emit_load_rax(js, GET_UI16(ins, 2));
+            emit_rexw_op(js, op, X64_RAX, GET_UI16(ins, 4));
+            emit_store_rax(js, GET_UI16(ins, 0));
+            break;
+        }
+        case MVM_OP_mul_i:
+            /* imul rax, [reg] */
+            emit_load_rax(js, GET_UI16(ins, 2));
+            emit_byte(js, 0x48);
+            emit_byte(js, 0x0F);
+            emit_byte(js, 0xAF);
+            emit_frame_reg(js, X64_RAX, GET_UI16(ins, 4));
+            emit_store_rax(js, GET_UI16(ins, 0));
+            break;
+        case MVM_OP_neg_i:
+        case MVM_OP_bnot_i:
+            /* neg rax / not rax */
+            emit_load_rax(js, GET_UI16(ins, 2));
+            emit_byte(js, 0x48);
+            emit_byte(js, 0xF7);
+            emit_byte(js, GET_UI16(js->bc, pos) == MVM_OP_neg_i ? 0xD8 : 0xD0);
+            emit_store_rax(js, GET_UI16(ins, 0));
+            break;
+        case MVM_OP_not_i:
+            /* xor eax, eax; cmp qword [reg], 0; sete al */
+            emit_byte(js, 0x31);
+            emit_byte(js, 0xC0);
+            emit_rexw_op(js, 0x83, 7, GET_UI16(ins, 2));
+            emit_byte(js, 0x00);
+            emit_byte(js, 0x0F);
+            emit_byte(js, 0x90 | X64_CC_E);
+            emit_byte(js, 0xC0);
+            emit_store_rax(js, GET_UI16(ins, 0));
+            break;
+        case MVM_OP_inc_i:
+            emit_rexw_op(js, 0xFF, 0, GET_UI16(ins, 0));
+            break;
+        case MVM_OP_dec_i:
+            emit_rexw_op(js, 0xFF, 1, GET_UI16(ins, 0));
+            break;
+        case MVM_OP_eq_i: emit_compare_i(js, X64_CC_E, ins);  break;
+        case MVM_OP_ne_i: emit_compare_i(js, X64_CC_NE, ins); break;
+        case MVM_OP_lt_i: emit_compare_i(js, X64_CC_L, ins);  break;
+        case MVM_OP_le_i: emit_compare_i(js, X64_CC_LE, ins); break;
+        case MVM_OP_gt_i: emit_compare_i(js, X64_CC_G, ins);  break;
+        case MVM_OP_ge_i: emit_compare_i(js, X64_CC_GE, ins); break;
+        case MVM_OP_add_n:
+        case MVM_OP_sub_n:
+        case MVM_OP_mul_n:
+        case MVM_OP_div_n: {
+            MVMuint8 op;
+            switch (GET_UI16(js->bc, pos)) {
+                case MVM_OP_add_n: op = 0x58; break;
+                case MVM_OP_sub_n: op = 0x5C; break;
+                case MVM_OP_mul_n: op = 0x59; break;
+                default:           op = 0x5E; break;
+            }
+            emit_sse_op(js, 0, 0x10, X64_XMM0, GET_UI16(ins, 2));
+            emit_sse_op(js, 0, op, X64_XMM0, GET_UI16(ins, 4));
+            emit_sse_op(js, 0, 0x11, X64_XMM0, GET_UI16(ins, 0));
+            break;
+        }
+        case MVM_OP_coerce_in:
+            /* cvtsi2sd xmm0, qword [reg] */
+            emit_sse_op(js, 1, 0x2A, X64_XMM0, GET_UI16(ins, 2));
+            emit_sse_op(js, 0, 0x11, X64_XMM0, GET_UI16(ins, 0));
+            break;
+        case MVM_OP_coerce_ni:
+            /* cvttsd2si rax, qword [reg] */
+            emit_sse_op(js, 1, 0x2C, X64_RAX, GET_UI16(ins, 2));
+            emit_store_rax(js, GET_UI16(ins, 0));
+            break;
+        default:
+            MVM_panic(1, "JIT: cannot compile op %d", GET_UI16(js->bc, pos));
+    }
+}
+
+/* Emits the shared epilogue, which restores the registers we use and
+ * returns the bytecode offset that is in eax. */
+static void emit_epilogue(JitState *js) {
+    js->epilogue = js->code_size;
+    emit_byte(js, 0x41); /* pop r12 */
+    emit_byte(js, 0x5C);
+    emit_byte(js, 0x5B); /* pop rbx */
+    emit_byte(js, 0xC3); /* ret */
+}
+
+/* Emits the prologue for an entry point, which saves the registers we use
+ * and puts the thread context in r12 and reg_base in rbx. */
+static void emit_prologue(JitState *js) {
+    emit_byte(js, 0x53); /* push rbx */
+    emit_byte(js, 0x41); /* push r12 */
+    emit_byte(js, 0x54);
+#ifdef _WIN32
+    emit_byte(js, 0x48); /* mov rbx, rdx */
+    emit_byte(js, 0x89);
+    emit_byte(js, 0xD3);
+    emit_byte(js, 0x49); /* mov r12, rcx */
+    emit_byte(js, 0x89);
+    emit_byte(js, 0xCC);
+#else
+    emit_byte(js, 0x48); /* mov rbx, rsi */
+    emit_byte(js, 0x89);
+    emit_byte(js, 0xF3);
+    emit_byte(js, 0x49); /* mov r12, rdi */
+    emit_byte(js, 0x89);
+    emit_byte(js, 0xFC);
+#endif
+}
+
+/* Compiles the run of instructions [run_start, run_end). */
+static void compile_run(JitState *js, MVMuint32 run_start, MVMuint32 run_end) {
+    MVMuint32 pos = run_start;
+    MVMuint32 i;
+
+    if (js->num_runs == js->alloc_runs) {
+        js->alloc_runs = js->alloc_runs ? js->alloc_runs * 2 : 8;
+        js->run_starts = realloc(js->run_starts, js->alloc_runs * sizeof(MVMuint32));
+        js->entry_pos  = realloc(js->entry_pos, js->alloc_runs * sizeof(MVMuint32));
+    }
+    js->run_starts[js->num_runs] = run_start;
+    js->entry_pos[js->num_runs]  = js->code_size;
+    js->num_runs++;
+
+    emit_prologue(js);
+    js->num_fixups = 0;
+    while (pos < run_end) {
+        const MVMOpInfo *info;
+        MVMuint32 size = instruction_size(js, pos, &info);
+        js->native_pos[pos] = js->code_size;
+        emit_instruction(js, pos, run_start, run_end);
+        pos += size;
+    }
+    emit_exit(js, run_end);
+
+    for (i = 0; i < js->num_fixups; i++)
+        patch_rel32(js, js->fixups[i].patch_pos, js->native_pos[js->fixups[i].target]);
+}
+
+#endif
+
+/* Tries to compile the given bytecode of a static frame. Always produces a
+ * MVMJitCode, so we know not to try again; it has no bytecode if there was
+ * nothing we could compile or no executable memory to put it in. */
+static MVMJitCode * compile(MVMThreadContext *tc, MVMCompUnit *cu, MVMuint8 *bytecode,
+                            MVMuint32 bytecode_size, MVMuint8 *labels) {
+    MVMJitCode *jc = calloc(1, sizeof(MVMJitCode));
+#if MVM_JIT_ARCH_X64
+    MVMuint32 pos = 0, run_start = 0, run_length = 0;
+    MVMuint32 i;
+    JitState  js;
+
+    memset(&js, 0, sizeof(JitState));
+    js.tc         = tc;
+    js.cu         = cu;
+    js.bc         = bytecode;
+    js.bc_size    = bytecode_size;
+    js.code_alloc = 256;
+    js.code       = malloc(js.code_alloc);
+    js.native_pos = malloc(js.bc_size * sizeof(MVMuint32));
+    emit_epilogue(&js);
+
+    /* Find runs of instructions that we can compile. A run never starts
+     * with a no_op, as there would be no room to plant sp_jit_enter. */
+    while (pos <= js.bc_size) {
+        const MVMOpInfo *info = NULL;
+        MVMuint32 size = pos < js.bc_size ? instruction_size(&js, pos, &info) : 0;
+        if (size && !(labels[pos] & MVM_BC_op_boundary))
+            size = 0;
+        if (size && is_supported(info->opcode) && js.num_runs < 0xFFFF) {
+            if (!run_length && info->opcode != MVM_OP_no_op)
+                run_start = pos;
+            if (run_length || info->opcode != MVM_OP_no_op)
+                run_length++;
+        }
+        else {
+            if (run_length >= MVM_JIT_MIN_RUN)
+                compile_run(&js, run_start, pos);
+            run_length = 0;
+            if (!size)
+                break;
+        }
+        pos += size;
+    }
+
+    /* If we compiled anything, produce the bytecode with the entries planted
+     * and put the machine code into executable memory. */
+    if (js.num_runs)
+        jc->machine_code = MVM_platform_alloc_pages(js.code_size, 1);
+
+    /* Failing to get executable memory just means we keep interpreting. */
+    if (jc->machine_code) {
+        jc->bytecode = malloc(js.bc_size);
+        memcpy(jc->bytecode, bytecode, js.bc_size);
+        jc->machine_code_size = js.code_size;
+        memcpy(jc->machine_code, js.code, js.code_size);
+        jc->num_entries = js.num_runs;
+        jc->entries     = malloc(js.num_runs * sizeof(MVMJitEntry));
+        for (i = 0; i < js.num_runs; i++) {
+            MVMuint32 start = js.run_starts[i];
+            const MVMOpInfo *info;
+            MVMuint32 size = instruction_size(&js, start, &info);
+            MVMuint32 pad;
+            jc->entries[i] = (MVMJitEntry)(jc->machine_code + js.entry_pos[i]);
+            GET_UI16(jc->bytecode, start)     = MVM_OP_sp_jit_enter;
+            GET_UI16(jc->bytecode, start + 2) = i;
+            for (pad = start + 4; pad < start + size; pad += 2)
+                GET_UI16(jc->bytecode, pad) = MVM_OP_no_op;
+        }
+    }
+
+    free(js.code);
+    free(js.native_pos);
+    MVM_checked_free_null(js.fixups);
+    MVM_checked_free_null(js.run_starts);
+    MVM_checked_free_null(js.entry_pos);
+#endif
+    return jc;
+}
+
+/* Selects the JIT-compiled code to use for running a static frame, given
+ * the specialization (if any) that was selected for it. Takes care of
+ * compiling the code once the frame is hot. Returns NULL if the bytecode
+ * should just be interpreted. */
+MVMJitCode * MVM_jit_select(MVMThreadContext *tc, MVMStaticFrame *sf, MVMSpeshCandidate *cand) {
+    MVMStaticFrameBody *sfb  = &sf->body;
+    MVMJitCode        **slot = cand ? &cand->jit_code : &sfb->jit_code;
+    MVMJitCode         *jc   = *slot;
+
+    if (!jc) {
+        /* Not compiled yet; see if the frame is hot. The count is just a
+         * heuristic, so it's not kept atomically. */
+        if (sfb->jit_invocations < tc->instance->jit_threshold) {
+            sfb->jit_invocations++;
+            return NULL;
+        }
+
+        /* Compile it. Nothing in here allocates GC-able memory, so we can't
+         * end up in the GC holding the mutex. */
+        uv_mutex_lock(&tc->instance->mutex_jit_install);
+        jc = *slot;
+        if (!jc) {
+            jc = cand
+                ? compile(tc, sfb->cu, cand->bytecode, cand->bytecode_size, cand->instr_offsets)
+                : compile(tc, sfb->cu, sfb->bytecode, sfb->bytecode_size, sfb->instr_offsets);
+            MVM_barrier();
+            *slot = jc;
+        }
+        uv_mutex_unlock(&tc->instance->mutex_jit_install);
+    }
+
+    return jc->bytecode ? jc : NULL;
+}
+
+/* Frees JIT-compiled code. */
+void MVM_jit_code_destroy(MVMThreadContext *tc, MVMJitCode *jc) {
+    if (!jc)
+        return;
+    if (jc->machine_code)
+        MVM_platform_free_pages(jc->machine_code, jc->machine_code_size);
+    MVM_checked_free_null(jc->bytecode);
+    MVM_checked_free_null(jc->entries);
+    free(jc);
+}
@@ -0,0 +1,39 @@
+/* We only know how to produce machine code for x86-64. */
+#if defined(__x86_64__) || defined(_M_X64)
+#define MVM_JIT_ARCH_X64            1
+#else
+#define MVM_JIT_ARCH_X64            0
+#endif
+
+/* Default number of times a static frame must be invoked before we compile
+ * its bytecode to machine code (when the JIT is enabled). */
+#define MVM_JIT_THRESHOLD           50
+
+/* Minimum number of instructions in a run of supported instructions for it
+ * to be worth entering machine code for. */
+#define MVM_JIT_MIN_RUN             2
+
+/* An entry point into JIT-compiled code. It runs from the start of a run of
+ * compiled instructions until it reaches something it can't handle (or a
+ * GC is requested), and returns the bytecode offset that the interpreter
+ * should continue at. */
+typedef MVMuint32 (*MVMJitEntry)(MVMThreadContext *tc, MVMRegister *reg_base);
+
+/* The result of JIT-compiling some bytecode. */
+struct MVMJitCode {
+    /* A copy of the bytecode with the first instruction of each compiled
+     * run replaced by a sp_jit_enter instruction. Apart from that, it has
+     * the same layout as the original. NULL if nothing could be compiled. */
+    MVMuint8 *bytecode;
+
+    /* The machine code, and the size of the memory it lives in. */
+    MVMuint8 *machine_code;
+    size_t    machine_code_size;
+
+    /* Entry points, one per compiled run. */
+    MVMJitEntry *entries;
+    MVMuint32    num_entries;
+};
+
+MVMJitCode * MVM_jit_select(MVMThreadContext *tc, MVMStaticFrame *sf, MVMSpeshCandidate *cand);
+void MVM_jit_code_destroy(MVMThreadContext *tc, MVMJitCode *code);
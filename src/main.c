@@ -1,6 +1,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <limits.h>
 #include <moar.h>
 
 #if MVM_TRACING
@@ -20,28 +22,46 @@ enum {
     FLAG_CRASH,
     FLAG_DUMP,
     FLAG_HELP,
+    FLAG_JIT,
     FLAG_TRACING,
     FLAG_VERSION,
 
-    OPT_LIBPATH
+    OPT_HEAP_SNAPSHOT,
+    OPT_JIT_THRESHOLD,
+    OPT_LIBPATH,
+    OPT_PROFILE,
+    OPT_PROFILE_STACKS
 };
 
 static const char *const FLAGS[] = {
     "--crash",
     "--dump",
     "--help",
+    "--jit",
     "--tracing",
     "--version",
 };
 
 static const char USAGE[] = "\
-USAGE: moar [--dump] [--crash] [--libpath=...] " TRACING_OPT "input.moarvm [program args]\n\
+USAGE: moar [--dump] [--crash] [--jit] [--jit-threshold=...] [--libpath=...] [--profile=...]\n\
+            [--profile-stacks=...] [--heap-snapshot=...] " TRACING_OPT "input.moarvm [program args]\n\
        moar [--help]\n\
 \n\
     --help     display this message\n\
     --dump     dump the bytecode to stdout instead of executing\n\
     --crash    abort instead of exiting on unhandled exception\n\
+    --jit      compile hot frames to machine code (x86-64 only)\n\
+    --jit-threshold\n\
+               number of invocations before a frame is compiled\n\
     --libpath  specify path loadbytecode should search in\n\
+    --heap-snapshot\n\
+               write a snapshot of the heap to the given file at every\n\
+               full collection\n\
+    --profile  profile the program, writing the call graph as JSON to\n\
+               the given file at exit\n\
+    --profile-stacks\n\
+               profile the program, writing collapsed stacks (for flame\n\
+               graph tools) to the given file at exit\n\
     --version  show version information"
     TRACING_USAGE;
 
@@ -69,8 +89,16 @@ static int parse_flag(const char *arg)
 
     if (found)
         return (int)(found - FLAGS);
+    else if (starts_with(arg, "--heap-snapshot="))
+        return OPT_HEAP_SNAPSHOT;
+    else if (starts_with(arg, "--jit-threshold="))
+        return OPT_JIT_THRESHOLD;
     else if (starts_with(arg, "--libpath="))
         return OPT_LIBPATH;
+    else if (starts_with(arg, "--profile="))
+        return OPT_PROFILE;
+    else if (starts_with(arg, "--profile-stacks="))
+        return OPT_PROFILE_STACKS;
     else
         return UNKNOWN_FLAG;
 }
@@ -82,9 +110,14 @@ int main(int argc, char *argv[])
     const char  *lib_path[8];
 
     int dump = 0;
+    int jit = 0;
+    int jit_threshold = MVM_JIT_THRESHOLD;
     int argi = 1;
     int flag;
     int lib_path_i = 0;
+    const char *profile_file = NULL;
+    const char *profile_stacks_file = NULL;
+    const char *heap_snapshot_file = NULL;
 
     for (; (flag = parse_flag(argv[argi])) != NOT_A_FLAG; ++argi) {
         switch (flag) {
@@ -100,6 +133,29 @@ int main(int argc, char *argv[])
             puts(USAGE);
             return EXIT_SUCCESS;
 
+            case FLAG_JIT:
+            jit = 1;
+            continue;
+
+            case OPT_HEAP_SNAPSHOT:
+            heap_snapshot_file = argv[argi] + strlen("--heap-snapshot=");
+            continue;
+
+            case OPT_JIT_THRESHOLD:
+            {
+                const char *value = argv[argi] + strlen("--jit-threshold=");
+                char *end;
+                long parsed;
+                errno  = 0;
+                parsed = strtol(value, &end, 10);
+                if (!*value || *end || errno || parsed < 0 || parsed > INT_MAX) {
+                    fprintf(stderr, "ERROR: --jit-threshold must be a non-negative integer.\n");
+                    return EXIT_FAILURE;
+                }
+                jit_threshold = (int)parsed;
+            }
+            continue;
+
 #if MVM_TRACING
             case FLAG_TRACING:
             MVM_interp_enable_tracing();
@@ -115,6 +171,14 @@ int main(int argc, char *argv[])
             lib_path[lib_path_i++] = argv[argi] + strlen("--libpath=");
             continue;
 
+            case OPT_PROFILE:
+            profile_file = argv[argi] + strlen("--profile=");
+            continue;
+
+            case OPT_PROFILE_STACKS:
+            profile_stacks_file = argv[argi] + strlen("--profile-stacks=");
+            continue;
+
             case FLAG_VERSION:
             printf("This is MoarVM version %s\n", MVM_VERSION);
             return EXIT_SUCCESS;
@@ -141,6 +205,12 @@ int main(int argc, char *argv[])
     instance->prog_name  = input_file;
     for( argi = 0; argi < lib_path_i; argi++)
         instance->lib_path[argi] = lib_path[argi];
+    instance->jit_enabled   = jit && MVM_JIT_ARCH_X64;
+    instance->jit_threshold = jit_threshold;
+    instance->profile_json_file   = profile_file;
+    instance->profile_stacks_file = profile_stacks_file;
+    instance->profiling           = !dump && (profile_file || profile_stacks_file);
+    instance->heap_snapshot_file  = heap_snapshot_file;
 
     if (dump) MVM_vm_dump_file(instance, input_file);
     else MVM_vm_run_file(instance, input_file);
@@ -56,8 +56,9 @@ typedef struct {
     /* Local holding block to invoke, if invokey handler. */
     unsigned short local;
 
-    /* Label, which will need resolving. */
+    /* Label, which will need resolving, and the offset it resolved to. */
     MASTNode *label;
+    unsigned int goto_offset;
 } FrameHandler;
 
 /* Handler actions. */
@@ -81,7 +82,8 @@ typedef struct {
     unsigned short *lexical_types;
     unsigned int num_lexicals;
 
-    /* Number of annotations. */
+    /* Position of the first annotation, and number of annotations. */
+    unsigned int annotation_start;
     unsigned int num_annotations;
 
     /* Number of handlers */
@@ -182,6 +184,7 @@ unsigned short type_to_local_type(VM, WriterState *ws, MASTNode *type);
 void compile_operand(VM, WriterState *ws, unsigned char op_flags, MASTNode *operand);
 unsigned short get_callsite_id(VM, WriterState *ws, MASTNode *flags);
 void compile_instruction(VM, WriterState *ws, MASTNode *node);
+void optimize_frame(VM, WriterState *ws, FrameState *fs);
 void compile_frame(VM, WriterState *ws, MASTNode *node, unsigned short idx);
 char * form_string_heap(VM, WriterState *ws, unsigned int *string_heap_size);
 char * form_bytecode_output(VM, WriterState *ws, unsigned int *bytecode_size);
@@ -875,6 +878,672 @@ void compile_instruction(VM, WriterState *ws, MASTNode *node) {
     ws->current_ins_idx++;
 }
 
+/* The code generator uses a fresh local for just about every temporary it
+ * needs, so frames often have far more locals than are ever live at once.
+ * Once the bytecode of a frame is compiled, we work out the liveness of its
+ * locals, remove instructions that only write a local that's never read
+ * afterwards, and then let locals of the same type share a register if they
+ * are never live at the same time. The smaller work area that results is
+ * cheaper to set up on each invocation and for the GC to scan. */
+
+/* Limits on the frames we'll analyse, so as not to spend lots of time and
+ * memory on huge (and usually run-once) mainline frames. */
+#define OPT_MAX_LIVENESS_WORDS  (4 * 1024 * 1024)
+#define OPT_MAX_COALESCE_LOCALS 8192
+#define OPT_MAX_DSE_ROUNDS      8
+
+/* An instruction in the bytecode of the frame being optimized. */
+typedef struct {
+    unsigned int   offset;
+    unsigned int   size;
+    unsigned int   block;
+    unsigned short opcode;
+    unsigned char  num_operands;
+    unsigned char  operands[MVM_MAX_OPERANDS];
+    unsigned char  remove;
+} OptIns;
+
+/* State of the frame optimizer. Sets of locals are bit vectors, each of
+ * words_per_set words. */
+typedef struct {
+    FrameState    *fs;
+    char          *bc;
+    unsigned int   bc_size;
+
+    /* The instructions, and the index of the instruction starting at each
+     * offset (or -1 if none does). */
+    OptIns        *ins;
+    unsigned int   num_ins;
+    unsigned int  *ins_at;
+
+    /* Basic blocks, by their first instruction. */
+    unsigned int  *block_first;
+    unsigned int   num_blocks;
+
+    /* Locals live on entry to and exit from each block. */
+    unsigned int   words_per_set;
+    unsigned int  *live_in;
+    unsigned int  *live_out;
+
+    /* Locals that must keep a register of their own, and those that are
+     * used at all. */
+    unsigned char *pinned;
+    unsigned char *referenced;
+
+    /* Interference between locals, as a num_locals by num_locals bit
+     * matrix; NULL if we aren't coalescing. */
+    unsigned int  *interferes;
+} OptState;
+
+#define OPT_SET(set, i) ((set)[(i) / 32] |= 1u << ((i) % 32))
+#define OPT_CLR(set, i) ((set)[(i) / 32] &= ~(1u << ((i) % 32)))
+#define OPT_HAS(set, i) (((set)[(i) / 32] >> ((i) % 32)) & 1)
+
+/* Reads an int16 from a buffer. */
+static unsigned short read_int16(char *buffer, size_t offset) {
+    unsigned short value;
+    memcpy_endian((char *)&value, buffer + offset, 2);
+    return value;
+}
+
+/* Reads an int32 from a buffer. */
+static unsigned int read_int32(char *buffer, size_t offset) {
+    unsigned int value;
+    memcpy_endian((char *)&value, buffer + offset, 4);
+    return value;
+}
+
+/* Reads an int64 from a buffer. */
+static unsigned long long read_int64(char *buffer, size_t offset) {
+    unsigned long long value;
+    memcpy_endian((char *)&value, buffer + offset, 8);
+    return value;
+}
+
+/* Gets the number of bytes an operand takes in the bytecode, or 0 if it is
+ * of a kind that we don't know how to deal with. */
+static unsigned int operand_size(unsigned char op_flags) {
+    switch (op_flags & MVM_operand_rw_mask) {
+        case MVM_operand_read_reg:
+        case MVM_operand_write_reg:
+            return 2;
+        case MVM_operand_read_lex:
+        case MVM_operand_write_lex:
+            return 4;
+        case MVM_operand_literal:
+            switch (op_flags & MVM_operand_type_mask) {
+                case MVM_operand_int8:     return 1;
+                case MVM_operand_int16:    return 2;
+                case MVM_operand_int32:    return 4;
+                case MVM_operand_int64:    return 8;
+                case MVM_operand_num32:    return 4;
+                case MVM_operand_num64:    return 8;
+                case MVM_operand_str:      return 4;
+                case MVM_operand_ins:      return 4;
+                case MVM_operand_coderef:  return 2;
+                case MVM_operand_callsite: return 2;
+            }
+    }
+    return 0;
+}
+
+/* Checks if an operand is a branch target. */
+static int is_ins_operand(unsigned char op_flags) {
+    return (op_flags & MVM_operand_rw_mask) == MVM_operand_literal
+        && (op_flags & MVM_operand_type_mask) == MVM_operand_ins;
+}
+
+/* Checks if an opcode returns from the frame. */
+static int is_return(unsigned short op) {
+    return op == MVM_OP_return   || op == MVM_OP_return_i || op == MVM_OP_return_n
+        || op == MVM_OP_return_s || op == MVM_OP_return_o;
+}
+
+/* Checks if an instruction may leave the locals it writes untouched, or
+ * reads them as well, in which case writing them does not end the life of
+ * their previous value. This is the case for increments, and for those ops
+ * that write a local only if they don't branch (param_op_* and friends). */
+static int is_partial_write(OptIns *ins) {
+    unsigned int i;
+    if (ins->opcode == MVM_OP_inc_i || ins->opcode == MVM_OP_inc_u ||
+            ins->opcode == MVM_OP_dec_i || ins->opcode == MVM_OP_dec_u)
+        return 1;
+    for (i = 0; i < ins->num_operands; i++)
+        if (is_ins_operand(ins->operands[i]))
+            return 1;
+    return 0;
+}
+
+/* Checks if an instruction does nothing besides compute a value from its
+ * operands into the local it writes, and so can go if that is never read. */
+static int is_pure(unsigned short op) {
+    switch (op) {
+        case MVM_OP_set:
+        case MVM_OP_null:
+        case MVM_OP_null_s:
+        case MVM_OP_const_i64:
+        case MVM_OP_const_n64:
+        case MVM_OP_const_s:
+        case MVM_OP_add_i:
+        case MVM_OP_sub_i:
+        case MVM_OP_mul_i:
+        case MVM_OP_neg_i:
+        case MVM_OP_abs_i:
+        case MVM_OP_add_n:
+        case MVM_OP_sub_n:
+        case MVM_OP_mul_n:
+        case MVM_OP_div_n:
+        case MVM_OP_neg_n:
+        case MVM_OP_abs_n:
+        case MVM_OP_band_i:
+        case MVM_OP_bor_i:
+        case MVM_OP_bxor_i:
+        case MVM_OP_bnot_i:
+        case MVM_OP_blshift_i:
+        case MVM_OP_brshift_i:
+        case MVM_OP_not_i:
+        case MVM_OP_eq_i:
+        case MVM_OP_ne_i:
+        case MVM_OP_lt_i:
+        case MVM_OP_le_i:
+        case MVM_OP_gt_i:
+        case MVM_OP_ge_i:
+        case MVM_OP_eq_n:
+        case MVM_OP_ne_n:
+        case MVM_OP_lt_n:
+        case MVM_OP_le_n:
+        case MVM_OP_gt_n:
+        case MVM_OP_ge_n:
+        case MVM_OP_coerce_in:
+        case MVM_OP_coerce_ni:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Frees the memory used by the optimizer. */
+static void opt_cleanup(OptState *os) {
+    if (os->ins)         free(os->ins);
+    if (os->ins_at)      free(os->ins_at);
+    if (os->block_first) free(os->block_first);
+    if (os->live_in)     free(os->live_in);
+    if (os->live_out)    free(os->live_out);
+    if (os->pinned)      free(os->pinned);
+    if (os->referenced)  free(os->referenced);
+    if (os->interferes)  free(os->interferes);
+}
+
+/* Splits the bytecode into instructions. Returns 0 if it contains anything
+ * we don't understand. */
+static int opt_decode(WriterState *ws, OptState *os) {
+    unsigned int pos = 0, alloc = 64, i;
+    os->ins    = (OptIns *)malloc(alloc * sizeof(OptIns));
+    os->ins_at = (unsigned int *)malloc((os->bc_size + 1) * sizeof(unsigned int));
+    for (i = 0; i <= os->bc_size; i++)
+        os->ins_at[i] = (unsigned int)-1;
+    while (pos < os->bc_size) {
+        OptIns *ins;
+        unsigned short op = read_int16(os->bc, pos);
+        if (os->num_ins == alloc) {
+            alloc *= 2;
+            os->ins = (OptIns *)realloc(os->ins, alloc * sizeof(OptIns));
+        }
+        ins = &os->ins[os->num_ins];
+        ins->offset = pos;
+        ins->opcode = op;
+        ins->block  = 0;
+        ins->remove = 0;
+        if (op >= EXTOP_BASE) {
+            if (op - EXTOP_BASE >= ws->num_extops)
+                return 0;
+            ins->num_operands = 0;
+            for (i = 0; i < MVM_MAX_OPERANDS; i++) {
+                unsigned char op_flags = (unsigned char)ws->extops_seg[(op - EXTOP_BASE) * EXTOP_SIZE + 4 + i];
+                if (!op_flags)
+                    break;
+                ins->operands[ins->num_operands++] = op_flags;
+            }
+        }
+        else {
+            MVMOpInfo *info = MVM_op_get_op(op);
+            if (!info)
+                return 0;
+            ins->num_operands = info->num_operands;
+            memcpy(ins->operands, info->operands, info->num_operands);
+        }
+        ins->size = 2;
+        for (i = 0; i < ins->num_operands; i++) {
+            unsigned int size = operand_size(ins->operands[i]);
+            if (!size)
+                return 0;
+            ins->size += size;
+        }
+        if (pos + ins->size > os->bc_size)
+            return 0;
+        os->ins_at[pos] = os->num_ins++;
+        pos += ins->size;
+    }
+    os->ins_at[os->bc_size] = os->num_ins;
+    return os->num_ins > 0;
+}
+
+/* Finds the branch target of an instruction, if it has one. */
+static unsigned int branch_target(OptState *os, OptIns *ins) {
+    unsigned int pos = ins->offset + 2, i;
+    for (i = 0; i < ins->num_operands; i++) {
+        if (is_ins_operand(ins->operands[i]))
+            return read_int32(os->bc, pos);
+        pos += operand_size(ins->operands[i]);
+    }
+    return (unsigned int)-1;
+}
+
+/* Splits the instructions into basic blocks. Returns 0 if we find a branch
+ * or handler that doesn't go to the start of an instruction. */
+static int opt_find_blocks(OptState *os) {
+    FrameState    *fs     = os->fs;
+    unsigned char *leader = (unsigned char *)calloc(os->num_ins + 1, 1);
+    unsigned int   i, b;
+    leader[0] = 1;
+    for (i = 0; i < os->num_ins; i++) {
+        OptIns      *ins    = &os->ins[i];
+        unsigned int target = branch_target(os, ins);
+        if (target != (unsigned int)-1) {
+            if (target >= os->bc_size || os->ins_at[target] == (unsigned int)-1) {
+                free(leader);
+                return 0;
+            }
+            leader[os->ins_at[target]] = 1;
+        }
+        if (target != (unsigned int)-1 || ins->opcode == MVM_OP_jumplist || is_return(ins->opcode))
+            leader[i + 1] = 1;
+    }
+    for (i = 0; i < fs->num_handlers; i++) {
+        FrameHandler *fh = &fs->handlers[i];
+        if (fh->start_offset > os->bc_size || os->ins_at[fh->start_offset] == (unsigned int)-1 ||
+                fh->end_offset > os->bc_size || os->ins_at[fh->end_offset] == (unsigned int)-1 ||
+                fh->goto_offset >= os->bc_size || os->ins_at[fh->goto_offset] == (unsigned int)-1) {
+            free(leader);
+            return 0;
+        }
+        leader[os->ins_at[fh->start_offset]] = 1;
+        leader[os->ins_at[fh->end_offset]]   = 1;
+        leader[os->ins_at[fh->goto_offset]]  = 1;
+    }
+
+    os->block_first = (unsigned int *)malloc((os->num_ins + 1) * sizeof(unsigned int));
+    for (i = 0, b = 0; i < os->num_ins; i++) {
+        if (leader[i])
+            os->block_first[b++] = i;
+        os->ins[i].block = b - 1;
+    }
+    os->num_blocks = b;
+    os->block_first[b] = os->num_ins;
+    free(leader);
+    return 1;
+}
+
+/* Gets the block that the instruction at an offset is in. */
+static unsigned int block_at(OptState *os, unsigned int offset) {
+    return os->ins[os->ins_at[offset]].block;
+}
+
+/* Adds the locals live on entry to a block to a set. */
+static void add_live_in(OptState *os, unsigned int *set, unsigned int block) {
+    unsigned int *in = os->live_in + block * os->words_per_set;
+    unsigned int  i;
+    for (i = 0; i < os->words_per_set; i++)
+        set[i] |= in[i];
+}
+
+/* Computes the locals live on leaving a block (from the blocks that may
+ * follow it), along with those live on entry to the handlers covering it,
+ * which we must treat as live throughout the block, since an exception may
+ * get us there from just about any instruction. */
+static void block_exits(OptState *os, unsigned int b, unsigned int *out, unsigned int *exc) {
+    FrameState  *fs   = os->fs;
+    unsigned int last = os->block_first[b + 1] - 1;
+    OptIns      *ins  = &os->ins[last];
+    unsigned int start_offset = os->ins[os->block_first[b]].offset;
+    unsigned int target, i;
+    memset(out, 0, os->words_per_set * sizeof(unsigned int));
+    memset(exc, 0, os->words_per_set * sizeof(unsigned int));
+    if (ins->opcode == MVM_OP_jumplist) {
+        /* Goes to one of the gotos that follow it, or past them all. */
+        unsigned long long num_labels = read_int64(os->bc, ins->offset + 2);
+        for (i = 1; i <= num_labels + 1 && last + i < os->num_ins; i++)
+            add_live_in(os, out, os->ins[last + i].block);
+    }
+    else if (!is_return(ins->opcode)) {
+        target = branch_target(os, ins);
+        if (target != (unsigned int)-1)
+            add_live_in(os, out, block_at(os, target));
+        if (ins->opcode != MVM_OP_goto && last + 1 < os->num_ins)
+            add_live_in(os, out, os->ins[last + 1].block);
+    }
+    for (i = 0; i < fs->num_handlers; i++) {
+        FrameHandler *fh = &fs->handlers[i];
+        if (start_offset >= fh->start_offset && start_offset < fh->end_offset)
+            add_live_in(os, exc, block_at(os, fh->goto_offset));
+    }
+    for (i = 0; i < os->words_per_set; i++)
+        out[i] |= exc[i];
+}
+
+/* Records that two locals are live at the same time. */
+static void add_interference(OptState *os, unsigned int a, unsigned int b) {
+    unsigned int n = os->fs->num_locals;
+    OPT_SET(os->interferes, a * n + b);
+    OPT_SET(os->interferes, b * n + a);
+}
+
+/* Walks backwards through a block, turning the set of locals live at its
+ * end into the set live at its start. If find_dead is set, instructions
+ * that only write a local that's dead are marked for removal (and treated
+ * as gone); if we're coalescing, interferences are recorded. Returns the
+ * number of instructions marked. */
+static unsigned int walk_block(OptState *os, unsigned int b, unsigned int *live,
+                               unsigned int *exc, int find_dead) {
+    unsigned short *local_types = os->fs->local_types;
+    unsigned int    num_marked  = 0;
+    unsigned int    i           = os->block_first[b + 1];
+    while (i-- > os->block_first[b]) {
+        OptIns        *ins = &os->ins[i];
+        unsigned short defs[MVM_MAX_OPERANDS], uses[MVM_MAX_OPERANDS];
+        unsigned int   num_defs = 0, num_uses = 0, pos = ins->offset + 2, j, k, w;
+        int            partial;
+        if (ins->remove)
+            continue;
+        for (j = 0; j < ins->num_operands; j++) {
+            unsigned char rw = ins->operands[j] & MVM_operand_rw_mask;
+            if (rw == MVM_operand_read_reg)
+                uses[num_uses++] = read_int16(os->bc, pos);
+            else if (rw == MVM_operand_write_reg)
+                defs[num_defs++] = read_int16(os->bc, pos);
+            pos += operand_size(ins->operands[j]);
+        }
+        partial = is_partial_write(ins);
+
+        if (find_dead && num_defs == 1 && !partial && is_pure(ins->opcode) &&
+                !os->pinned[defs[0]] && !OPT_HAS(live, defs[0])) {
+            ins->remove = 1;
+            num_marked++;
+            continue;
+        }
+
+        if (os->interferes && !find_dead) {
+            for (j = 0; j < num_defs; j++) {
+                for (k = 0; k < num_defs; k++)
+                    if (defs[j] != defs[k])
+                        add_interference(os, defs[j], defs[k]);
+                for (w = 0; w < os->words_per_set; w++) {
+                    unsigned int bits = live[w];
+                    while (bits) {
+                        unsigned int bit   = 0;
+                        unsigned int local;
+                        while (!((bits >> bit) & 1))
+                            bit++;
+                        bits &= ~(1u << bit);
+                        local = w * 32 + bit;
+                        /* A copy needn't keep its source apart from its
+                         * destination, as they hold the same value. */
+                        if (local == defs[j] || local_types[local] != local_types[defs[j]])
+                            continue;
+                        if (ins->opcode == MVM_OP_set && num_uses == 1 && local == uses[0])
+                            continue;
+                        add_interference(os, defs[j], local);
+                    }
+                }
+            }
+        }
+
+        for (j = 0; j < num_defs; j++) {
+            os->referenced[defs[j]] = 1;
+            if (partial)
+                OPT_SET(live, defs[j]);
+            else
+                OPT_CLR(live, defs[j]);
+        }
+        for (j = 0; j < num_uses; j++) {
+            os->referenced[uses[j]] = 1;
+            OPT_SET(live, uses[j]);
+        }
+        for (w = 0; w < os->words_per_set; w++)
+            live[w] |= exc[w];
+    }
+    return num_marked;
+}
+
+/* Computes liveness of locals to a fixed point. */
+static void opt_liveness(OptState *os) {
+    unsigned int *out = (unsigned int *)malloc(os->words_per_set * sizeof(unsigned int));
+    unsigned int *exc = (unsigned int *)malloc(os->words_per_set * sizeof(unsigned int));
+    unsigned int  b;
+    int           changed = 1;
+    while (changed) {
+        changed = 0;
+        b = os->num_blocks;
+        while (b-- > 0) {
+            unsigned int *in = os->live_in + b * os->words_per_set;
+            block_exits(os, b, out, exc);
+            memcpy(os->live_out + b * os->words_per_set, out, os->words_per_set * sizeof(unsigned int));
+            walk_block(os, b, out, exc, 0);
+            if (memcmp(in, out, os->words_per_set * sizeof(unsigned int))) {
+                memcpy(in, out, os->words_per_set * sizeof(unsigned int));
+                changed = 1;
+            }
+        }
+    }
+    free(out);
+    free(exc);
+}
+
+/* Runs a final walk over all blocks, either finding dead stores or recording
+ * interferences. Returns the number of dead stores found. */
+static unsigned int opt_walk_all(OptState *os, int find_dead) {
+    unsigned int *live = (unsigned int *)malloc(os->words_per_set * sizeof(unsigned int));
+    unsigned int *exc  = (unsigned int *)malloc(os->words_per_set * sizeof(unsigned int));
+    unsigned int  num_marked = 0, b;
+    for (b = 0; b < os->num_blocks; b++) {
+        block_exits(os, b, live, exc);
+        num_marked += walk_block(os, b, live, exc, find_dead);
+    }
+    free(live);
+    free(exc);
+    return num_marked;
+}
+
+/* Decodes the bytecode of the frame and computes liveness of its locals.
+ * Returns 0 if the frame is not one we can (or want to) optimize. */
+static int opt_analyse(WriterState *ws, OptState *os) {
+    FrameState  *fs = os->fs;
+    unsigned int i;
+    if (!opt_decode(ws, os) || !opt_find_blocks(os))
+        return 0;
+    os->words_per_set = (fs->num_locals + 31) / 32;
+    if ((unsigned long long)os->num_blocks * os->words_per_set > OPT_MAX_LIVENESS_WORDS)
+        return 0;
+    os->live_in    = (unsigned int *)calloc(os->num_blocks * os->words_per_set, sizeof(unsigned int));
+    os->live_out   = (unsigned int *)calloc(os->num_blocks * os->words_per_set, sizeof(unsigned int));
+    os->pinned     = (unsigned char *)calloc(fs->num_locals, 1);
+    os->referenced = (unsigned char *)calloc(fs->num_locals, 1);
+    opt_liveness(os);
+
+    /* Locals that are read before being written rely on starting out
+     * zeroed, and the local holding the block for an invoke handler is read
+     * when an exception is thrown, so these keep registers of their own. */
+    for (i = 0; i < fs->num_locals; i++)
+        if (OPT_HAS(os->live_in, i))
+            os->pinned[i] = 1;
+    for (i = 0; i < fs->num_handlers; i++) {
+        if (fs->handlers[i].action == HANDLER_INVOKE) {
+            os->pinned[fs->handlers[i].local]     = 1;
+            os->referenced[fs->handlers[i].local] = 1;
+        }
+    }
+    return 1;
+}
+
+/* Removes the instructions marked as dead stores, fixing up branches,
+ * handlers and annotations to account for the bytecode moving. */
+static void opt_remove_dead(WriterState *ws, OptState *os) {
+    FrameState   *fs     = os->fs;
+    char         *new_bc = (char *)malloc(os->bc_size);
+    unsigned int *map    = (unsigned int *)malloc((os->bc_size + 1) * sizeof(unsigned int));
+    unsigned int  new_size = 0, i;
+
+    /* Copy over the instructions we're keeping, mapping each old offset to
+     * the new one (a removed instruction's being that of what follows). */
+    for (i = 0; i < os->num_ins; i++) {
+        OptIns *ins = &os->ins[i];
+        map[ins->offset] = new_size;
+        if (!ins->remove) {
+            memcpy(new_bc + new_size, os->bc + ins->offset, ins->size);
+            new_size += ins->size;
+        }
+    }
+    map[os->bc_size] = new_size;
+
+    /* Fix up branches. */
+    for (i = 0; i < os->num_ins; i++) {
+        OptIns      *ins = &os->ins[i];
+        unsigned int pos, j;
+        if (ins->remove)
+            continue;
+        pos = map[ins->offset] + 2;
+        for (j = 0; j < ins->num_operands; j++) {
+            if (is_ins_operand(ins->operands[j]))
+                write_int32(new_bc, pos, map[read_int32(new_bc, pos)]);
+            pos += operand_size(ins->operands[j]);
+        }
+    }
+
+    /* Fix up handlers and annotations. */
+    for (i = 0; i < fs->num_handlers; i++) {
+        fs->handlers[i].start_offset = map[fs->handlers[i].start_offset];
+        fs->handlers[i].end_offset   = map[fs->handlers[i].end_offset];
+        fs->handlers[i].goto_offset  = map[fs->handlers[i].goto_offset];
+    }
+    for (i = 0; i < fs->num_annotations; i++) {
+        unsigned int pos    = fs->annotation_start + i * 12;
+        unsigned int offset = read_int32(ws->annotation_seg, pos);
+        if (offset <= os->bc_size)
+            write_int32(ws->annotation_seg, pos, map[offset]);
+    }
+
+    memcpy(os->bc, new_bc, new_size);
+    ws->bytecode_pos = fs->bytecode_start + new_size;
+    free(new_bc);
+    free(map);
+}
+
+/* Assigns each local that's used to a register, sharing registers between
+ * locals of the same type that don't interfere, then rewrites the bytecode
+ * and local types to match. Copies that end up with the same source and
+ * destination are marked for removal; returns the number of them. */
+static unsigned int opt_allocate_registers(OptState *os) {
+    FrameState     *fs          = os->fs;
+    unsigned int    num_locals  = fs->num_locals;
+    unsigned short *new_index   = (unsigned short *)malloc(num_locals * sizeof(unsigned short));
+    unsigned short *slot_types  = (unsigned short *)malloc(num_locals * sizeof(unsigned short));
+    unsigned char  *slot_pinned = (unsigned char *)malloc(num_locals);
+    unsigned int   *slot_first  = (unsigned int *)malloc(num_locals * sizeof(unsigned int));
+    unsigned int   *next_member = (unsigned int *)malloc(num_locals * sizeof(unsigned int));
+    unsigned int    num_slots   = 0, num_marked = 0, i, s;
+
+    for (i = 0; i < num_locals; i++) {
+        unsigned short type = fs->local_types[i];
+        if (!os->referenced[i])
+            continue;
+        for (s = 0; s < num_slots; s++) {
+            unsigned int m;
+            if (!os->interferes || os->pinned[i] || slot_pinned[s] || slot_types[s] != type)
+                continue;
+            for (m = slot_first[s]; m != (unsigned int)-1; m = next_member[m])
+                if (OPT_HAS(os->interferes, i * num_locals + m))
+                    break;
+            if (m == (unsigned int)-1)
+                break;
+        }
+        if (s == num_slots) {
+            slot_types[s]  = type;
+            slot_pinned[s] = os->pinned[i];
+            slot_first[s]  = (unsigned int)-1;
+            num_slots++;
+        }
+        new_index[i]   = (unsigned short)s;
+        next_member[i] = slot_first[s];
+        slot_first[s]  = i;
+    }
+
+    if (num_slots < num_locals) {
+        for (i = 0; i < os->num_ins; i++) {
+            OptIns      *ins = &os->ins[i];
+            unsigned int pos = ins->offset + 2, j;
+            for (j = 0; j < ins->num_operands; j++) {
+                unsigned char rw = ins->operands[j] & MVM_operand_rw_mask;
+                if (rw == MVM_operand_read_reg || rw == MVM_operand_write_reg)
+                    write_int16(os->bc, pos, new_index[read_int16(os->bc, pos)]);
+                pos += operand_size(ins->operands[j]);
+            }
+            if (ins->opcode == MVM_OP_set &&
+                    read_int16(os->bc, ins->offset + 2) == read_int16(os->bc, ins->offset + 4)) {
+                ins->remove = 1;
+                num_marked++;
+            }
+        }
+        for (i = 0; i < fs->num_handlers; i++)
+            if (fs->handlers[i].action == HANDLER_INVOKE)
+                fs->handlers[i].local = new_index[fs->handlers[i].local];
+        memcpy(fs->local_types, slot_types, num_slots * sizeof(unsigned short));
+        fs->num_locals = num_slots;
+    }
+
+    free(new_index);
+    free(slot_types);
+    free(slot_pinned);
+    free(slot_first);
+    free(next_member);
+    return num_marked;
+}
+
+/* Optimizes the locals of the frame we just compiled the bytecode of. */
+void optimize_frame(VM, WriterState *ws, FrameState *fs) {
+    unsigned int round;
+    for (round = 0; fs->num_locals; round++) {
+        OptState os;
+        memset(&os, 0, sizeof(OptState));
+        os.fs      = fs;
+        os.bc      = ws->bytecode_seg + fs->bytecode_start;
+        os.bc_size = ws->bytecode_pos - fs->bytecode_start;
+        if (!opt_analyse(ws, &os)) {
+            opt_cleanup(&os);
+            return;
+        }
+
+        /* Remove dead stores; doing so may make more stores dead, so we go
+         * around again if we found any. */
+        if (round < OPT_MAX_DSE_ROUNDS && opt_walk_all(&os, 1)) {
+            opt_remove_dead(ws, &os);
+            opt_cleanup(&os);
+            continue;
+        }
+
+        /* Otherwise, coalesce locals. */
+        if (fs->num_locals <= OPT_MAX_COALESCE_LOCALS) {
+            os.interferes = (unsigned int *)calloc(
+                ((unsigned long long)fs->num_locals * fs->num_locals + 31) / 32,
+                sizeof(unsigned int));
+            opt_walk_all(&os, 0);
+        }
+        if (opt_allocate_registers(&os))
+            opt_remove_dead(ws, &os);
+        opt_cleanup(&os);
+        return;
+    }
+}
+
 /* Compiles a frame. */
 void compile_frame(VM, WriterState *ws, MASTNode *node, unsigned short idx) {
     MAST_Frame  *f;
@@ -911,6 +1580,7 @@ void compile_frame(VM, WriterState *ws, MASTNode *node, unsigned short idx) {
     }
 
     /* initialize number of annotation */
+    fs->annotation_start = ws->annotation_pos;
     fs->num_annotations = 0;
 
     /* initialize number of handlers and handlers pointer */
@@ -918,13 +1588,13 @@ void compile_frame(VM, WriterState *ws, MASTNode *node, unsigned short idx) {
     fs->handlers = NULL;
 
     /* Ensure space is available to write frame entry, and write the
-     * header, apart from the bytecode length, which we'll fill in
-     * later. */
+     * header, apart from the bytecode length and number of locals, which
+     * we'll fill in later. */
     ensure_space(vm, &ws->frame_seg, &ws->frame_alloc, ws->frame_pos,
         FRAME_HEADER_SIZE + fs->num_locals * 2 + fs->num_lexicals * 6);
     write_int32(ws->frame_seg, ws->frame_pos, fs->bytecode_start);
     write_int32(ws->frame_seg, ws->frame_pos + 4, 0); /* Filled in later. */
-    write_int32(ws->frame_seg, ws->frame_pos + 8, fs->num_locals);
+    write_int32(ws->frame_seg, ws->frame_pos + 8, 0); /* Filled in later. */
     write_int32(ws->frame_seg, ws->frame_pos + 12, fs->num_lexicals);
     write_int32(ws->frame_seg, ws->frame_pos + 16,
         get_string_heap_index(vm, ws, f->cuuid));
@@ -959,26 +1629,14 @@ void compile_frame(VM, WriterState *ws, MASTNode *node, unsigned short idx) {
 
     ws->frame_pos += FRAME_HEADER_SIZE;
 
-    /* Write locals, as well as collecting our own array of type info. */
+    /* Collect our own array of local and lexical type info; they are
+     * written out once the locals have been optimized. */
     fs->local_types = (short unsigned int *)malloc(sizeof(unsigned short) * fs->num_locals);
-    for (i = 0; i < fs->num_locals; i++) {
-        unsigned short local_type = type_to_local_type(vm, ws, ATPOS(vm, f->local_types, i));
-        fs->local_types[i] = local_type;
-        write_int16(ws->frame_seg, ws->frame_pos, local_type);
-        ws->frame_pos += 2;
-    }
-
-    /* Write lexicals. */
+    for (i = 0; i < fs->num_locals; i++)
+        fs->local_types[i] = type_to_local_type(vm, ws, ATPOS(vm, f->local_types, i));
     fs->lexical_types = (short unsigned int *)malloc(sizeof(unsigned short) * fs->num_lexicals);
-    for (i = 0; i < fs->num_lexicals; i++) {
-        unsigned short lexical_type = type_to_local_type(vm, ws, ATPOS(vm, f->lexical_types, i));
-        fs->lexical_types[i] = lexical_type;
-        write_int16(ws->frame_seg, ws->frame_pos, lexical_type);
-        ws->frame_pos += 2;
-        write_int32(ws->frame_seg, ws->frame_pos,
-            get_string_heap_index(vm, ws, ATPOS_S_C(vm, f->lexical_names, i)));
-        ws->frame_pos += 4;
-    }
+    for (i = 0; i < fs->num_lexicals; i++)
+        fs->lexical_types[i] = type_to_local_type(vm, ws, ATPOS(vm, f->lexical_types, i));
 
     /* Save the location of the start of instructions */
     instructions_start = ws->bytecode_pos;
@@ -1004,6 +1662,39 @@ void compile_frame(VM, WriterState *ws, MASTNode *node, unsigned short idx) {
         ws->bytecode_pos += 2;
     }
 
+    /* Resolve handler labels. */
+    for (i = 0; i < fs->num_handlers; i++) {
+        MAST_Label *l = GET_Label(fs->handlers[i].label);
+        if (EXISTSKEY(vm, fs->known_labels, l->name)) {
+            fs->handlers[i].goto_offset = (unsigned int)ATKEY_I(vm, fs->known_labels, l->name);
+        }
+        else {
+            cleanup_all(vm, ws);
+            DIE(vm, "HandlerScope uses unresolved label");
+        }
+    }
+
+    /* Any leftover labels? */
+    if (HASHELEMS(vm, fs->labels_to_resolve)) {
+        cleanup_all(vm, ws);
+        DIE(vm, "Frame has unresolved labels");
+    }
+
+    /* Optimize the locals, then write them and the lexicals. */
+    optimize_frame(vm, ws, fs);
+    write_int32(ws->frame_seg, fs->frame_start + 8, fs->num_locals);
+    for (i = 0; i < fs->num_locals; i++) {
+        write_int16(ws->frame_seg, ws->frame_pos, fs->local_types[i]);
+        ws->frame_pos += 2;
+    }
+    for (i = 0; i < fs->num_lexicals; i++) {
+        write_int16(ws->frame_seg, ws->frame_pos, fs->lexical_types[i]);
+        ws->frame_pos += 2;
+        write_int32(ws->frame_seg, ws->frame_pos,
+            get_string_heap_index(vm, ws, ATPOS_S_C(vm, f->lexical_names, i)));
+        ws->frame_pos += 4;
+    }
+
     /* Fill in bytecode length. */
     write_int32(ws->frame_seg, fs->frame_start + 4, ws->bytecode_pos - instructions_start);
 
@@ -1027,29 +1718,10 @@ void compile_frame(VM, WriterState *ws, MASTNode *node, unsigned short idx) {
         ws->frame_pos += 2;
         write_int16(ws->frame_seg, ws->frame_pos, fs->handlers[i].local);
         ws->frame_pos += 2;
-        if (ws->cur_frame->handlers[i].label) {
-            MAST_Label *l = GET_Label(fs->handlers[i].label);
-            if (EXISTSKEY(vm, fs->known_labels, l->name)) {
-                write_int32(ws->frame_seg, ws->frame_pos,
-                    (unsigned int)ATKEY_I(vm, fs->known_labels, l->name));
-            }
-            else {
-                cleanup_all(vm, ws);
-                    DIE(vm, "HandlerScope uses unresolved label");
-            }
-        }
-        else {
-            write_int32(ws->frame_seg, ws->frame_pos, 0);
-        }
+        write_int32(ws->frame_seg, ws->frame_pos, fs->handlers[i].goto_offset);
         ws->frame_pos += 4;
     }
 
-    /* Any leftover labels? */
-    if (HASHELEMS(vm, fs->labels_to_resolve)) {
-        cleanup_all(vm, ws);
-        DIE(vm, "Frame has unresolved labels");
-    }
-
     /* Free the frame state. */
     cleanup_frame(vm, fs);
     ws->cur_frame = NULL;
@@ -8,6 +8,20 @@
 	} \
 } while (0)
 
+/* Reads a size or count from the environment, falling back to a default if
+ * it is not set or not a number, and keeping it within the given bounds. */
+static MVMuint32 env_uint(const char *name, MVMuint32 def, MVMuint32 min, MVMuint32 max) {
+    const char *value = getenv(name);
+    char *end;
+    unsigned long parsed;
+    if (!value || !*value)
+        return def;
+    parsed = strtoul(value, &end, 10);
+    if (*end)
+        return def;
+    return parsed < min ? min : parsed > max ? max : (MVMuint32)parsed;
+}
+
 /* Create a new instance of the VM. */
 static void string_consts(MVMThreadContext *tc);
 static void setup_std_handles(MVMThreadContext *tc);
@@ -18,6 +32,17 @@ MVMInstance * MVM_vm_create_instance(void) {
     /* Set up instance data structure. */
     instance = calloc(1, sizeof(MVMInstance));
 
+    /* Set up nursery sizing and how often we do full collections; these can
+     * be tuned from the environment (see gc/collect.h). Sizes are kept to a
+     * multiple of 8 bytes, which is how allocations are aligned. */
+    instance->nursery_max_size = env_uint("MVM_NURSERY_MAX_SIZE",
+        MVM_NURSERY_MAX_SIZE, MVM_NURSERY_MIN_SIZE, 0x40000000) & ~7;
+    instance->nursery_size = env_uint("MVM_NURSERY_SIZE",
+        MVM_NURSERY_SIZE, MVM_NURSERY_MIN_SIZE, instance->nursery_max_size) & ~7;
+    instance->nursery_adaptive = getenv("MVM_NURSERY_ADAPTIVE_DISABLE") ? 0 : 1;
+    instance->gc_gen2_ratio  = env_uint("MVM_GC_GEN2_RATIO", MVM_GC_GEN2_RATIO, 1, 0xFFFFFFFF);
+    instance->gc_gen2_growth = env_uint("MVM_GC_GEN2_GROWTH", MVM_GC_GEN2_GROWTH, 0, 0xFFFFFFFF);
+
     /* Create the main thread's ThreadContext and stash it. */
     instance->main_thread = MVM_tc_create(instance);
 
@@ -56,6 +81,57 @@ MVMInstance * MVM_vm_create_instance(void) {
     /* Set up container registry mutex. */
     init_mutex(instance->mutex_container_registry, "container registry");
 
+    /* Set up specializer; it's on unless disabled in the environment. */
+    init_mutex(instance->mutex_spesh_install, "spesh installations");
+    instance->spesh_enabled = getenv("MVM_SPESH_DISABLE") ? 0 : 1;
+
+    /* Superinstructions are on unless disabled in the environment. */
+    instance->superinstr_enabled = getenv("MVM_SUPERINSTR_DISABLE") ? 0 : 1;
+
+    /* Set up the mutex and condition variable GC threads sleep on. */
+    init_mutex(instance->mutex_gc_orchestrate, "GC orchestration");
+    if ((init_stat = uv_cond_init(&instance->cond_gc_orchestrate)) < 0) {
+        fprintf(stderr, "MoarVM: Initialization of GC orchestration condition variable failed\n    %s\n",
+            uv_strerror(init_stat));
+        exit(1);
+    }
+
+    /* The second generation is marked incrementally unless disabled in the
+     * environment. */
+    instance->gc_incremental = getenv("MVM_GC_INCREMENTAL_DISABLE") ? 0 : 1;
+
+    /* And it is swept lazily, unless disabled in the environment. */
+    instance->gc_lazy_sweep = getenv("MVM_GC_LAZY_SWEEP_DISABLE") ? 0 : 1;
+
+    /* Empty gen2 pages are given back to the system, unless disabled in the
+     * environment. */
+    instance->gc_release_pages = getenv("MVM_GC_PAGE_RELEASE_DISABLE") ? 0 : 1;
+
+    /* Expensive cleanup of dead objects waits until after the GC run,
+     * unless disabled in the environment. */
+    instance->gc_finalize_queue = getenv("MVM_GC_FINALIZE_QUEUE_DISABLE") ? 0 : 1;
+
+    /* The allocation profiler is off unless asked for in the environment. */
+    instance->alloc_profiling = getenv("MVM_ALLOC_PROFILE") ? 1 : 0;
+
+    /* Set up GC telemetry, logging each run if asked to in the environment. */
+    init_mutex(instance->mutex_gc_telemetry, "GC telemetry");
+    instance->gc_run_stats      = calloc(1, sizeof(MVMGCRunStats));
+    instance->gc_last_run_stats = calloc(1, sizeof(MVMGCRunStats));
+    instance->gc_gen2_live_bins = calloc(MVM_GC_STATS_CLASSES, sizeof(AO_t));
+    if (getenv("MVM_GC_LOG")) {
+        instance->gc_log_fh = fopen(getenv("MVM_GC_LOG"), "a");
+        if (!instance->gc_log_fh)
+            fprintf(stderr, "MoarVM: Could not open GC log '%s'\n", getenv("MVM_GC_LOG"));
+    }
+
+    /* Set up JIT; it's off unless asked for (see main.c). */
+    init_mutex(instance->mutex_jit_install, "JIT installations");
+    instance->jit_threshold = MVM_JIT_THRESHOLD;
+
+    /* Set up profiler; it's off unless asked for (see main.c). */
+    init_mutex(instance->mutex_profile, "profiler");
+
     /* Allocate all things during following setup steps directly in gen2, as
      * they will have program lifetime. */
     MVM_gc_allocate_gen2_default_set(instance->main_thread);
@@ -193,6 +269,16 @@ void MVM_vm_dump_file(MVMInstance *instance, const char *filename) {
 /* Destroys a VM instance. This must be called only from
  * the main thread. */
 void MVM_vm_destroy_instance(MVMInstance *instance) {
+    /* Write out the profile, if we were profiling. */
+    if (instance->profiling)
+        MVM_profile_write(instance->main_thread);
+
+    /* Write out the op-level profile, if the interpreter collected one. */
+    MVM_op_profile_write(instance->main_thread);
+
+    /* Write out the allocation profile, if we were keeping one. */
+    MVM_alloc_profile_write(instance->main_thread);
+
     /* Run the GC global destruction phase. After this,
      * no 6model object pointers should be accessed. */
     MVM_gc_global_destruction(instance->main_thread);
@@ -241,6 +327,32 @@ void MVM_vm_destroy_instance(MVMInstance *instance) {
     /* Clean up Hash of hashes of symbol tables per hll. */
     uv_mutex_destroy(&instance->mutex_hll_syms);
 
+    /* Clean up specializer mutex. */
+    uv_mutex_destroy(&instance->mutex_spesh_install);
+
+    /* Clean up JIT mutex. */
+    uv_mutex_destroy(&instance->mutex_jit_install);
+
+    /* Clean up profiler mutex. */
+    uv_mutex_destroy(&instance->mutex_profile);
+
+    /* Close any heap snapshot file. */
+    if (instance->heap_snapshot_fh)
+        fclose(instance->heap_snapshot_fh);
+    MVM_checked_free_null(instance->heap_snapshot_request);
+
+    /* Clean up GC telemetry. */
+    if (instance->gc_log_fh)
+        fclose(instance->gc_log_fh);
+    MVM_checked_free_null(instance->gc_run_stats);
+    MVM_checked_free_null(instance->gc_last_run_stats);
+    MVM_checked_free_null(instance->gc_gen2_live_bins);
+    uv_mutex_destroy(&instance->mutex_gc_telemetry);
+
+    /* Clean up GC orchestration. */
+    uv_cond_destroy(&instance->cond_gc_orchestrate);
+    uv_mutex_destroy(&instance->mutex_gc_orchestrate);
+
     /* Destroy main thread contexts. */
     MVM_tc_destroy(instance->main_thread);
 
@@ -52,13 +52,14 @@ typedef double   MVMnum64;
 
 /* Headers for various other data structures and APIs. */
 #include "6model/6model.h"
-#include "gc/wb.h"
 #include "core/threadcontext.h"
 #include "core/instance.h"
+#include "gc/wb.h"
 #include "core/interp.h"
 #include "core/args.h"
 #include "core/exceptions.h"
 #include "core/frame.h"
+#include "core/callstack.h"
 #include "core/validation.h"
 #include "core/compunit.h"
 #include "core/bytecode.h"
@@ -84,6 +85,8 @@ typedef double   MVMnum64;
 #include "gc/orchestrate.h"
 #include "gc/gen2.h"
 #include "gc/roots.h"
+#include "gc/finalize.h"
+#include "gc/telemetry.h"
 #include "strings/decode_stream.h"
 #include "strings/ascii.h"
 #include "strings/utf8.h"
@@ -104,6 +107,14 @@ typedef double   MVMnum64;
 #include "math/bigintops.h"
 #include "mast/driver.h"
 #include "core/intcache.h"
+#include "core/inlinecache.h"
+#include "core/superinstructions.h"
+#include "spesh/spesh.h"
+#include "jit/jit.h"
+#include "profiler/profile.h"
+#include "profiler/opprofile.h"
+#include "profiler/allocprofile.h"
+#include "profiler/heapsnapshot.h"
 
 MVMObject *MVM_backend_config(MVMThreadContext *tc);
 
@@ -0,0 +1,395 @@
+#include "moar.h"
+
+/* This is the allocation profiler. When MVM_ALLOC_PROFILE is set in the
+ * environment, every object, type object and STable allocated is counted,
+ * along with its size, against its type and against the instruction that
+ * the interpreter was running when it was allocated. Objects allocated in
+ * the nursery are remembered until the next GC run, which tells us whether
+ * they were promoted to the second generation; objects allocated straight
+ * into the second generation are counted as such at once. The report is
+ * written at exit, to the file named by MVM_ALLOC_PROFILE_FILE or to stderr,
+ * and the allocprofile op hands out a report of the counts so far. Counts may
+ * be updated by several threads at once without synchronization, so are only
+ * approximate for code that is run by many threads. */
+
+/* Gets a C string for a (possibly NULL) VM string. */
+static char * c_string(MVMThreadContext *tc, MVMString *s, const char *fallback) {
+    if (s && NUM_GRAPHS(s))
+        return MVM_string_utf8_encode_C_string(tc, s);
+    else {
+        char *copy = malloc(strlen(fallback) + 1);
+        strcpy(copy, fallback);
+        return copy;
+    }
+}
+
+/* Gets the allocation counts for a static frame, setting them up and adding
+ * them to the instance's list if this is the first allocation in it. */
+static MVMAllocProfileFrame * get_frame(MVMThreadContext *tc, MVMStaticFrame *sf) {
+    MVMStaticFrameBody   *sfb = &sf->body;
+    MVMAllocProfileFrame *apf = sfb->alloc_profile;
+    if (!apf) {
+        MVMuint32              size  = sfb->bytecode_size ? sfb->bytecode_size : 1;
+        MVMBytecodeAnnotation *annot = MVM_bytecode_resolve_annotation(tc, sfb, 0);
+        apf = malloc(sizeof(MVMAllocProfileFrame));
+        apf->name          = c_string(tc, sfb->name, "<anon>");
+        apf->cuuid         = c_string(tc, sfb->cuuid, "<unknown>");
+        if (annot && annot->filename_string_heap_index < sfb->cu->body.num_strings)
+            apf->file = c_string(tc, sfb->cu->body.strings[annot->filename_string_heap_index], "<unknown>");
+        else
+            apf->file = c_string(tc, sfb->cu->body.filename, "<unknown>");
+        if (annot)
+            free(annot);
+        apf->bytecode_size = sfb->bytecode_size;
+        apf->counts        = calloc(size, sizeof(MVMuint64));
+        apf->bytes         = calloc(size, sizeof(MVMuint64));
+        apf->gen2          = calloc(size, sizeof(MVMuint64));
+        apf->lines         = calloc(size, sizeof(MVMuint32));
+
+        /* Another thread may have beaten us to it; if so, use theirs. */
+        if (MVM_casptr(&sfb->alloc_profile, NULL, apf) != NULL) {
+            free(apf->name);
+            free(apf->cuuid);
+            free(apf->file);
+            free(apf->counts);
+            free(apf->bytes);
+            free(apf->gen2);
+            free(apf->lines);
+            free(apf);
+            return sfb->alloc_profile;
+        }
+        do {
+            apf->next = tc->instance->alloc_profile_frames;
+        } while (MVM_casptr(&tc->instance->alloc_profile_frames, apf->next, apf) != apf->next);
+    }
+    return apf;
+}
+
+/* Makes a new set of counts for a type, and adds it to the instance's list. */
+static MVMAllocProfileType * new_type(MVMThreadContext *tc, char *name) {
+    MVMAllocProfileType *apt = calloc(1, sizeof(MVMAllocProfileType));
+    apt->name = name;
+    do {
+        apt->next = tc->instance->alloc_profile_types;
+    } while (MVM_casptr(&tc->instance->alloc_profile_types, apt->next, apt) != apt->next);
+    return apt;
+}
+
+/* Gets the allocation counts for a type. Only types whose meta-object is a
+ * KnowHOW know their name without us having to run code, so others are
+ * described by their representation and numbered. STables themselves are
+ * all counted together. */
+static MVMAllocProfileType * get_type(MVMThreadContext *tc, MVMSTable *st) {
+    MVMInstance         *instance = tc->instance;
+    MVMAllocProfileType *apt;
+    MVMObject           *how;
+    char                *name;
+
+    if (!st) {
+        apt = instance->alloc_profile_stables;
+        if (!apt) {
+            apt = new_type(tc, c_string(tc, NULL, "<STable>"));
+            if (MVM_casptr(&instance->alloc_profile_stables, NULL, apt) != NULL)
+                apt = instance->alloc_profile_stables;
+        }
+        return apt;
+    }
+
+    apt = st->alloc_profile;
+    if (!apt) {
+        how = st->HOW;
+        if (how && IS_CONCRETE(how) && REPR(how)->ID == MVM_REPR_ID_KnowHOWREPR &&
+                ((MVMKnowHOWREPR *)how)->body.name) {
+            name = MVM_string_utf8_encode_C_string(tc, ((MVMKnowHOWREPR *)how)->body.name);
+        }
+        else {
+            name = malloc(strlen(st->REPR->name) + 32);
+            sprintf(name, "<%s type %u>", st->REPR->name,
+                (unsigned)MVM_incr(&instance->alloc_profile_num_types) + 1);
+        }
+
+        /* Another thread may have beaten us to it; if so, count in theirs,
+         * and leave ours in the list with nothing counted. */
+        apt = new_type(tc, name);
+        if (MVM_casptr(&st->alloc_profile, NULL, apt) != NULL)
+            apt = st->alloc_profile;
+    }
+    return apt;
+}
+
+/* Called after a collectable is allocated, with its STable, or NULL if it
+ * is itself an STable. */
+void MVM_alloc_profile_log(MVMThreadContext *tc, MVMCollectable *c, MVMSTable *st) {
+    MVMAllocProfileType   *apt  = get_type(tc, st);
+    MVMuint64             *gen2 = NULL;
+    MVMAllocProfileThread *prof;
+    MVMFrame              *f    = tc->cur_frame;
+
+    apt->counts++;
+    apt->bytes += c->size;
+
+    /* Work out where we are, if we're in the interpreter. As in the op
+     * profiler, beyond the end of the original bytecode we're in the body of
+     * an inlined call. */
+    if (f && tc->interp_cur_op && tc->interp_bytecode_start
+            && *tc->interp_bytecode_start == f->effective_bytecode) {
+        MVMStaticFrame       *sf     = f->static_info;
+        MVMuint32             offset = *tc->interp_cur_op - *tc->interp_bytecode_start;
+        MVMAllocProfileFrame *apf;
+        if (offset >= sf->body.bytecode_size && f->spesh_cand) {
+            MVMSpeshInline *inl = MVM_spesh_inline_at(tc, f->spesh_cand, offset);
+            if (inl) {
+                sf      = inl->sf;
+                offset -= inl->start;
+            }
+        }
+        apf = get_frame(tc, sf);
+        if (offset < apf->bytecode_size) {
+            if (!apf->counts[offset]) {
+                MVMBytecodeAnnotation *annot = MVM_bytecode_resolve_annotation(tc,
+                    &sf->body, offset > 0 ? offset - 1 : 0);
+                if (annot) {
+                    apf->lines[offset] = annot->line_number;
+                    free(annot);
+                }
+            }
+            apf->counts[offset]++;
+            apf->bytes[offset] += c->size;
+            gen2 = &apf->gen2[offset];
+        }
+    }
+
+    /* If it went straight into the second generation, that's that; if not,
+     * remember it so that we can see if it gets there. */
+    if (c->flags & MVM_CF_SECOND_GEN) {
+        apt->gen2++;
+        if (gen2)
+            (*gen2)++;
+        return;
+    }
+    prof = tc->alloc_prof;
+    if (!prof)
+        prof = tc->alloc_prof = calloc(1, sizeof(MVMAllocProfileThread));
+    if (prof->num_live == prof->alloc_live) {
+        prof->alloc_live = prof->alloc_live ? prof->alloc_live * 2 : 1024;
+        prof->live = realloc(prof->live, prof->alloc_live * sizeof(MVMAllocProfileLive));
+    }
+    prof->live[prof->num_live].obj       = c;
+    prof->live[prof->num_live].site_gen2 = gen2;
+    prof->live[prof->num_live].type      = apt;
+    prof->num_live++;
+}
+
+/* Called for each thread whose nursery was collected in a GC run, once
+ * everything has been copied but before the fromspace is cleaned up. Objects
+ * that got promoted are counted; those that were copied within the nursery
+ * are followed to their new home; the rest are dead and forgotten. */
+void MVM_alloc_profile_gc(MVMThreadContext *tc) {
+    MVMAllocProfileThread *prof = tc->alloc_prof;
+    MVMuint32              i, kept = 0;
+    if (!prof)
+        return;
+    for (i = 0; i < prof->num_live; i++) {
+        MVMAllocProfileLive *live = &prof->live[i];
+        MVMCollectable      *obj  = live->obj;
+        if (!(obj->flags & MVM_CF_FORWARDER_VALID))
+            continue;
+        obj = obj->sc_forward_u.forwarder;
+        if (obj->flags & MVM_CF_SECOND_GEN) {
+            live->type->gen2++;
+            if (live->site_gen2)
+                (*live->site_gen2)++;
+        }
+        else {
+            live->obj = obj;
+            prof->live[kept++] = *live;
+        }
+    }
+    prof->num_live = kept;
+}
+
+/* Called when a thread context is destroyed. */
+void MVM_alloc_profile_thread_destroy(MVMThreadContext *tc) {
+    if (tc->alloc_prof) {
+        MVM_checked_free_null(tc->alloc_prof->live);
+        MVM_checked_free_null(tc->alloc_prof);
+    }
+}
+
+/* A buffer the report is built up in. */
+typedef struct {
+    char   *data;
+    size_t  len;
+    size_t  alloc;
+} OutBuf;
+
+static void append(OutBuf *buf, const char *fmt, ...) {
+    char    tmp[1024];
+    va_list args;
+    size_t  len;
+    va_start(args, fmt);
+    vsnprintf(tmp, sizeof(tmp), fmt, args);
+    va_end(args);
+    len = strlen(tmp);
+    if (buf->len + len + 1 > buf->alloc) {
+        while (buf->len + len + 1 > buf->alloc)
+            buf->alloc = buf->alloc ? buf->alloc * 2 : 4096;
+        buf->data = realloc(buf->data, buf->alloc);
+    }
+    memcpy(buf->data + buf->len, tmp, len + 1);
+    buf->len += len;
+}
+
+static int cmp_type(const void *a, const void *b) {
+    const MVMAllocProfileType *x = *(MVMAllocProfileType * const *)a;
+    const MVMAllocProfileType *y = *(MVMAllocProfileType * const *)b;
+    if (x->bytes != y->bytes)
+        return x->bytes > y->bytes ? -1 : 1;
+    return x->counts > y->counts ? -1 : x->counts < y->counts ? 1 : 0;
+}
+
+/* An allocation site in the list of the busiest ones. */
+typedef struct {
+    MVMAllocProfileFrame *frame;
+    MVMuint32             offset;
+} Site;
+
+static int cmp_site(const void *a, const void *b) {
+    const Site *x = (const Site *)a;
+    const Site *y = (const Site *)b;
+    MVMuint64 bx = x->frame->bytes[x->offset];
+    MVMuint64 by = y->frame->bytes[y->offset];
+    if (bx != by)
+        return bx > by ? -1 : 1;
+    return 0;
+}
+
+/* Computes a percentage, without dividing by zero. */
+static double percent(MVMuint64 part, MVMuint64 whole) {
+    return whole ? 100.0 * (double)part / (double)whole : 0.0;
+}
+
+/* Builds the report: the types allocated, then the busiest allocation sites,
+ * both by the bytes allocated. */
+static void build_report(MVMThreadContext *tc, OutBuf *buf) {
+    MVMInstance           *instance = tc->instance;
+    MVMAllocProfileType   *apt, **types = NULL;
+    MVMAllocProfileFrame  *apf;
+    Site                  *sites = NULL;
+    MVMuint32              num_types = 0, alloc_types = 0;
+    MVMuint32              num_sites = 0, alloc_sites = 0, i;
+    MVMuint64              total_count = 0, total_bytes = 0, total_gen2 = 0;
+
+    for (apt = instance->alloc_profile_types; apt; apt = apt->next) {
+        if (!apt->counts)
+            continue;
+        if (num_types == alloc_types) {
+            alloc_types = alloc_types ? alloc_types * 2 : 64;
+            types = realloc(types, alloc_types * sizeof(MVMAllocProfileType *));
+        }
+        types[num_types++] = apt;
+        total_count += apt->counts;
+        total_bytes += apt->bytes;
+        total_gen2  += apt->gen2;
+    }
+    qsort(types, num_types, sizeof(MVMAllocProfileType *), cmp_type);
+    append(buf, "Allocations: %llu objects, %llu bytes, %.2f%% of objects reached gen2\n\n",
+        (unsigned long long)total_count, (unsigned long long)total_bytes,
+        percent(total_gen2, total_count));
+    append(buf, "%14s %16s %7s %14s %7s  %s\n",
+        "count", "bytes", "%", "gen2", "%", "type");
+    for (i = 0; i < num_types; i++)
+        append(buf, "%14llu %16llu %6.2f%% %14llu %6.2f%%  %s\n",
+            (unsigned long long)types[i]->counts, (unsigned long long)types[i]->bytes,
+            percent(types[i]->bytes, total_bytes),
+            (unsigned long long)types[i]->gen2, percent(types[i]->gen2, types[i]->counts),
+            types[i]->name);
+    free(types);
+
+    for (apf = instance->alloc_profile_frames; apf; apf = apf->next) {
+        for (i = 0; i < apf->bytecode_size; i++) {
+            if (!apf->counts[i])
+                continue;
+            if (num_sites == alloc_sites) {
+                alloc_sites = alloc_sites ? alloc_sites * 2 : 256;
+                sites = realloc(sites, alloc_sites * sizeof(Site));
+            }
+            sites[num_sites].frame  = apf;
+            sites[num_sites].offset = i;
+            num_sites++;
+        }
+    }
+    qsort(sites, num_sites, sizeof(Site), cmp_site);
+    append(buf, "\nBusiest allocation sites:\n\n");
+    append(buf, "%14s %16s %7s %14s %7s %8s  %s\n",
+        "count", "bytes", "%", "gen2", "%", "offset", "frame");
+    for (i = 0; i < num_sites && i < MVM_ALLOC_PROFILE_TOP_SITES; i++) {
+        MVMAllocProfileFrame *f = sites[i].frame;
+        MVMuint32             o = sites[i].offset;
+        append(buf, "%14llu %16llu %6.2f%% %14llu %6.2f%% %8u  %s %s:%u (%s)\n",
+            (unsigned long long)f->counts[o], (unsigned long long)f->bytes[o],
+            percent(f->bytes[o], total_bytes),
+            (unsigned long long)f->gen2[o], percent(f->gen2[o], f->counts[o]),
+            o, f->name, f->file, f->lines[o], f->cuuid);
+    }
+    free(sites);
+}
+
+/* Gets the report of what has been allocated so far, as a string; it's empty
+ * unless the allocation profiler is on. */
+MVMString * MVM_alloc_profile_report(MVMThreadContext *tc) {
+    OutBuf     buf = { NULL, 0, 0 };
+    MVMString *result;
+    if (!tc->instance->alloc_profiling)
+        return MVM_string_ascii_decode_nt(tc, tc->instance->VMString, "");
+    build_report(tc, &buf);
+    result = MVM_string_utf8_decode(tc, tc->instance->VMString, buf.data, buf.len);
+    free(buf.data);
+    return result;
+}
+
+/* Writes the report at exit, and cleans up. */
+void MVM_alloc_profile_write(MVMThreadContext *tc) {
+    MVMInstance          *instance = tc->instance;
+    OutBuf                buf = { NULL, 0, 0 };
+    const char           *filename;
+    FILE                 *fh;
+
+    if (!instance->alloc_profiling)
+        return;
+
+    filename = getenv("MVM_ALLOC_PROFILE_FILE");
+    fh = filename ? fopen(filename, "w") : stderr;
+    if (!fh) {
+        fprintf(stderr, "Could not write allocation profile to '%s'\n", filename);
+        fh = stderr;
+    }
+    build_report(tc, &buf);
+    fwrite(buf.data, 1, buf.len, fh);
+    free(buf.data);
+    if (fh != stderr)
+        fclose(fh);
+
+    /* We only write this once, so clean up everything. */
+    instance->alloc_profiling = 0;
+    MVM_alloc_profile_thread_destroy(tc);
+    while (instance->alloc_profile_frames) {
+        MVMAllocProfileFrame *apf = instance->alloc_profile_frames;
+        instance->alloc_profile_frames = apf->next;
+        free(apf->name);
+        free(apf->cuuid);
+        free(apf->file);
+        free(apf->counts);
+        free(apf->bytes);
+        free(apf->gen2);
+        free(apf->lines);
+        free(apf);
+    }
+    while (instance->alloc_profile_types) {
+        MVMAllocProfileType *apt = instance->alloc_profile_types;
+        instance->alloc_profile_types = apt->next;
+        free(apt->name);
+        free(apt);
+    }
+    instance->alloc_profile_stables = NULL;
+}
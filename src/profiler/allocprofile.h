@@ -0,0 +1,55 @@
+/* Number of allocation sites to show in the report. */
+#define MVM_ALLOC_PROFILE_TOP_SITES     100
+
+/* Allocation counts for a static frame, indexed by the bytecode offset the
+ * interpreter was at when the allocation was made: how many objects, how
+ * many bytes, and how many of the objects made it to the second generation.
+ * These outlive the static frame itself, so we take copies of its names. */
+struct MVMAllocProfileFrame {
+    char *name;
+    char *cuuid;
+    char *file;
+
+    MVMuint32  bytecode_size;
+    MVMuint64 *counts;
+    MVMuint64 *bytes;
+    MVMuint64 *gen2;
+    MVMuint32 *lines;
+
+    /* Next frame in the instance's list of profiled frames. */
+    MVMAllocProfileFrame *next;
+};
+
+/* Allocation counts for a type. These outlive the STable. */
+struct MVMAllocProfileType {
+    char *name;
+
+    MVMuint64 counts;
+    MVMuint64 bytes;
+    MVMuint64 gen2;
+
+    /* Next type in the instance's list of profiled types. */
+    MVMAllocProfileType *next;
+};
+
+/* An object a thread allocated in its nursery, which we look for after the
+ * next GC run to see if it got promoted, along with the counts to add to if
+ * it did. */
+typedef struct {
+    MVMCollectable      *obj;
+    MVMuint64           *site_gen2;
+    MVMAllocProfileType *type;
+} MVMAllocProfileLive;
+
+/* The objects a thread has allocated in its nursery that are still there. */
+struct MVMAllocProfileThread {
+    MVMAllocProfileLive *live;
+    MVMuint32            num_live;
+    MVMuint32            alloc_live;
+};
+
+void MVM_alloc_profile_log(MVMThreadContext *tc, MVMCollectable *c, MVMSTable *st);
+void MVM_alloc_profile_gc(MVMThreadContext *tc);
+void MVM_alloc_profile_thread_destroy(MVMThreadContext *tc);
+MVMString * MVM_alloc_profile_report(MVMThreadContext *tc);
+void MVM_alloc_profile_write(MVMThreadContext *tc);
@@ -0,0 +1,324 @@
+#include "moar.h"
+#include "platform/time.h"
+
+/* Heap snapshots. When one is wanted, the GC coordinator takes it once all
+ * of the threads have stopped for a GC run, and before anything has been
+ * moved. Starting from the roots, as roots.c finds them, it walks every live
+ * collectable and frame, using the same marking functions and worklists as
+ * the GC to find what each of them refers to, and streams out a record for
+ * each one as it goes. A snapshot is taken at the GC run following a call
+ * to the heapsnapshot op, and at every full collection if moar was run with
+ * --heap-snapshot. The format is described in docs/gc.markdown, and
+ * tools/heapsnapshot-summary.py reads it. */
+
+/* A collectable or frame we've given an ID to. */
+typedef struct {
+    void           *addr;
+    MVMuint64       id;
+    UT_hash_handle  hash_handle;
+} SeenNode;
+
+/* A name we've written out. */
+typedef struct {
+    char           *name;
+    MVMuint64       id;
+    UT_hash_handle  hash_handle;
+} SeenName;
+
+/* A node we've seen but not yet written out. */
+typedef struct {
+    void      *addr;
+    MVMuint64  id;
+    MVMuint8   is_frame;
+} PendingNode;
+
+/* State of a snapshot being taken. */
+typedef struct {
+    FILE          *fh;
+    SeenNode      *nodes;
+    SeenName      *names;
+    MVMuint64      num_nodes;
+    MVMuint64      num_names;
+
+    /* Nodes still to be written out. */
+    PendingNode   *pending;
+    MVMuint64      num_pending;
+    MVMuint64      alloc_pending;
+
+    /* The references of the node being written out. */
+    MVMuint64     *refs;
+    MVMuint64      num_refs;
+    MVMuint64      alloc_refs;
+
+    /* Worklist the roots and the references of each node are put in. */
+    MVMGCWorklist *worklist;
+} Snapshot;
+
+/* Writes an unsigned integer, 7 bits to a byte, low bits first, with the
+ * top bit set on all but the last byte. */
+static void write_uint(Snapshot *ss, MVMuint64 value) {
+    unsigned char buf[10];
+    MVMuint32     len = 0;
+    do {
+        buf[len] = value & 0x7F;
+        value  >>= 7;
+        if (value)
+            buf[len] |= 0x80;
+        len++;
+    } while (value);
+    fwrite(buf, 1, len, ss->fh);
+}
+
+/* Gets the ID of a name, writing it out first if it's new. */
+static MVMuint64 name_id(MVMThreadContext *tc, Snapshot *ss, const char *name) {
+    SeenName *entry;
+    size_t    len = strlen(name);
+    HASH_FIND(hash_handle, ss->names, name, len, entry);
+    if (!entry) {
+        entry       = malloc(sizeof(SeenName));
+        entry->name = malloc(len + 1);
+        memcpy(entry->name, name, len + 1);
+        entry->id   = ++ss->num_names;
+        HASH_ADD_KEYPTR(hash_handle, ss->names, entry->name, len, entry);
+        fputc('N', ss->fh);
+        write_uint(ss, entry->id);
+        write_uint(ss, len);
+        fwrite(name, 1, len, ss->fh);
+    }
+    return entry->id;
+}
+
+/* Gets the ID of a collectable or frame, queueing it up to be written out
+ * if this is the first time we've seen it. */
+static MVMuint64 node_id(MVMThreadContext *tc, Snapshot *ss, void *addr, MVMuint8 is_frame) {
+    SeenNode *entry;
+    HASH_FIND(hash_handle, ss->nodes, &addr, sizeof(void *), entry);
+    if (!entry) {
+        entry       = malloc(sizeof(SeenNode));
+        entry->addr = addr;
+        entry->id   = ++ss->num_nodes;
+        HASH_ADD(hash_handle, ss->nodes, addr, sizeof(void *), entry);
+        if (ss->num_pending == ss->alloc_pending) {
+            ss->alloc_pending = ss->alloc_pending ? ss->alloc_pending * 2 : 256;
+            ss->pending = realloc(ss->pending, ss->alloc_pending * sizeof(PendingNode));
+        }
+        ss->pending[ss->num_pending].addr     = addr;
+        ss->pending[ss->num_pending].id       = entry->id;
+        ss->pending[ss->num_pending].is_frame = is_frame;
+        ss->num_pending++;
+    }
+    return entry->id;
+}
+
+/* Adds a reference from the node being written out. */
+static void add_ref(Snapshot *ss, MVMuint64 id) {
+    if (ss->num_refs == ss->alloc_refs) {
+        ss->alloc_refs = ss->alloc_refs ? ss->alloc_refs * 2 : 64;
+        ss->refs = realloc(ss->refs, ss->alloc_refs * sizeof(MVMuint64));
+    }
+    ss->refs[ss->num_refs++] = id;
+}
+
+/* Takes everything out of the worklist, adding it to the references of the
+ * node being written out. */
+static void drain_refs(MVMThreadContext *tc, Snapshot *ss) {
+    MVMGCWorklist    *worklist = ss->worklist;
+    MVMCollectable  **item;
+    MVMFrame         *frame;
+    while ((item = MVM_gc_worklist_get(tc, worklist)))
+        add_ref(ss, node_id(tc, ss, *item, 0));
+    while ((frame = MVM_gc_worklist_get_frame(tc, worklist)))
+        add_ref(ss, node_id(tc, ss, frame, 1));
+}
+
+/* Takes everything out of the worklist, writing it out as roots of the
+ * given category. */
+static void drain_roots(MVMThreadContext *tc, Snapshot *ss, MVMuint32 category, MVMuint32 thread_id) {
+    MVMuint64 i;
+    ss->num_refs = 0;
+    drain_refs(tc, ss);
+    for (i = 0; i < ss->num_refs; i++) {
+        fputc('R', ss->fh);
+        write_uint(ss, category);
+        write_uint(ss, thread_id);
+        write_uint(ss, ss->refs[i]);
+    }
+}
+
+/* Writes out a node, along with its references. */
+static void write_node(Snapshot *ss, MVMuint64 id, MVMuint32 kind, MVMuint64 name,
+                       MVMuint64 st, MVMuint64 size) {
+    MVMuint64 i;
+    fputc('O', ss->fh);
+    write_uint(ss, id);
+    write_uint(ss, kind);
+    write_uint(ss, name);
+    write_uint(ss, st);
+    write_uint(ss, size);
+    write_uint(ss, ss->num_refs);
+    for (i = 0; i < ss->num_refs; i++)
+        write_uint(ss, ss->refs[i]);
+}
+
+/* Writes out a collectable. */
+static void write_collectable(MVMThreadContext *tc, Snapshot *ss, MVMuint64 id, MVMCollectable *c) {
+    MVMuint32 kind;
+    MVMuint64 name, st = 0, size;
+
+    ss->num_refs = 0;
+    MVM_gc_mark_collectable(tc, ss->worklist, c);
+    drain_refs(tc, ss);
+
+    if (c->flags & MVM_CF_STABLE) {
+        kind = MVM_HEAP_SNAPSHOT_STABLE;
+        name = name_id(tc, ss, ((MVMSTable *)c)->REPR->name);
+        size = sizeof(MVMSTable);
+    }
+    else {
+        MVMObject *obj = (MVMObject *)c;
+        kind = c->flags & MVM_CF_TYPE_OBJECT
+            ? MVM_HEAP_SNAPSHOT_TYPE_OBJECT
+            : MVM_HEAP_SNAPSHOT_OBJECT;
+        name = name_id(tc, ss, REPR(obj)->name);
+        st   = node_id(tc, ss, STABLE(obj), 0);
+        size = c->size;
+    }
+    write_node(ss, id, kind, name, st, size);
+}
+
+/* Writes out a frame. */
+static void write_frame(MVMThreadContext *tc, Snapshot *ss, MVMuint64 id, MVMFrame *f) {
+    MVMStaticFrameBody *sfb  = &f->static_info->body;
+    char               *name = sfb->name && NUM_GRAPHS(sfb->name)
+        ? MVM_string_utf8_encode_C_string(tc, sfb->name)
+        : NULL;
+
+    ss->num_refs = 0;
+    if (f->caller)
+        add_ref(ss, node_id(tc, ss, f->caller, 1));
+    if (f->outer)
+        add_ref(ss, node_id(tc, ss, f->outer, 1));
+    MVM_gc_root_add_frame_registers_to_worklist(tc, ss->worklist, f);
+    drain_refs(tc, ss);
+
+    write_node(ss, id, MVM_HEAP_SNAPSHOT_FRAME, name_id(tc, ss, name ? name : "<anon>"), 0,
+        sizeof(MVMFrame) + (f->work ? sfb->work_size : 0) + (f->env ? sfb->env_size : 0));
+    free(name);
+}
+
+/* Writes out the roots of a thread. */
+static void thread_roots(MVMThreadContext *tc, Snapshot *ss, MVMThreadContext *other) {
+    MVMGCWorklist *worklist = ss->worklist;
+
+    MVM_gc_worklist_add(tc, worklist, &other->thread_obj);
+    drain_roots(tc, ss, MVM_HEAP_SNAPSHOT_ROOT_THREAD, other->thread_id);
+
+    MVM_gc_root_add_tc_roots_to_worklist(other, worklist);
+    drain_roots(tc, ss, MVM_HEAP_SNAPSHOT_ROOT_TC, other->thread_id);
+
+    MVM_gc_root_add_temps_to_worklist(other, worklist);
+    drain_roots(tc, ss, MVM_HEAP_SNAPSHOT_ROOT_TEMP, other->thread_id);
+
+    if (other->cur_frame)
+        MVM_gc_worklist_add_frame_no_seq_check(tc, worklist, other->cur_frame);
+    drain_roots(tc, ss, MVM_HEAP_SNAPSHOT_ROOT_STACK, other->thread_id);
+}
+
+/* Takes a heap snapshot, writing it to the given file. */
+static void take_snapshot(MVMThreadContext *tc, FILE *fh) {
+    MVMInstance *instance = tc->instance;
+    Snapshot     ss;
+    MVMThread   *thread;
+    SeenNode    *node, *tmp_node;
+    SeenName    *name, *tmp_name;
+
+    memset(&ss, 0, sizeof(Snapshot));
+    ss.fh       = fh;
+    ss.worklist = MVM_gc_worklist_create(tc, 1);
+
+    fputs("MVMHEAP", fh);
+    write_uint(&ss, MVM_HEAP_SNAPSHOT_VERSION);
+    fputc('S', fh);
+    write_uint(&ss, MVM_load(&instance->gc_seq_number));
+    write_uint(&ss, MVM_platform_now());
+
+    /* Roots held by the instance, then by each thread. */
+    MVM_gc_root_add_permanents_to_worklist(tc, ss.worklist);
+    drain_roots(tc, &ss, MVM_HEAP_SNAPSHOT_ROOT_PERMANENT, 0);
+    MVM_gc_root_add_instance_roots_to_worklist(tc, ss.worklist);
+    drain_roots(tc, &ss, MVM_HEAP_SNAPSHOT_ROOT_INSTANCE, 0);
+    for (thread = (MVMThread *)MVM_load(&instance->threads); thread; thread = thread->body.next)
+        if (thread->body.tc)
+            thread_roots(tc, &ss, thread->body.tc);
+
+    /* Then everything reachable from them. */
+    while (ss.num_pending) {
+        PendingNode p = ss.pending[--ss.num_pending];
+        if (p.is_frame)
+            write_frame(tc, &ss, p.id, (MVMFrame *)p.addr);
+        else
+            write_collectable(tc, &ss, p.id, (MVMCollectable *)p.addr);
+    }
+
+    fputc('E', fh);
+    write_uint(&ss, ss.num_nodes);
+    fflush(fh);
+
+    HASH_ITER(hash_handle, ss.nodes, node, tmp_node) {
+        HASH_DELETE(hash_handle, ss.nodes, node);
+        free(node);
+    }
+    HASH_ITER(hash_handle, ss.names, name, tmp_name) {
+        HASH_DELETE(hash_handle, ss.names, name);
+        free(name->name);
+        free(name);
+    }
+    MVM_checked_free_null(ss.pending);
+    MVM_checked_free_null(ss.refs);
+    MVM_gc_worklist_destroy(tc, ss.worklist);
+}
+
+/* Asks for a heap snapshot to be written to the given path, and starts a GC
+ * run so that it is taken right away. */
+void MVM_profile_heap_request(MVMThreadContext *tc, MVMString *path) {
+    char *c_path = MVM_string_utf8_encode_C_string(tc, path);
+    char *old    = (char *)MVM_casptr(&tc->instance->heap_snapshot_request,
+        tc->instance->heap_snapshot_request, c_path);
+    MVM_checked_free_null(old);
+    MVM_gc_enter_from_allocator(tc);
+}
+
+/* Called by the GC coordinator once all threads have stopped, and after it
+ * has chosen what to collect. Takes a heap snapshot if one was asked for, or
+ * if this is a full collection and we're to take one at each. */
+void MVM_profile_heap_snapshot_if_due(MVMThreadContext *tc) {
+    MVMInstance *instance = tc->instance;
+    char        *path     = (char *)instance->heap_snapshot_request;
+
+    if (path) {
+        FILE *fh = fopen(path, "wb");
+        instance->heap_snapshot_request = NULL;
+        if (fh) {
+            take_snapshot(tc, fh);
+            fclose(fh);
+        }
+        else {
+            fprintf(stderr, "MoarVM: Could not open heap snapshot file '%s'\n", path);
+        }
+        free(path);
+    }
+
+    if (instance->heap_snapshot_file
+            && MVM_load(&instance->gc_generations) == MVMGCGenerations_Both) {
+        if (!instance->heap_snapshot_fh) {
+            instance->heap_snapshot_fh = fopen(instance->heap_snapshot_file, "wb");
+            if (!instance->heap_snapshot_fh) {
+                fprintf(stderr, "MoarVM: Could not open heap snapshot file '%s'\n",
+                    instance->heap_snapshot_file);
+                instance->heap_snapshot_file = NULL;
+                return;
+            }
+        }
+        take_snapshot(tc, instance->heap_snapshot_fh);
+    }
+}
@@ -0,0 +1,20 @@
+/* Version of the heap snapshot format; see the Heap Snapshots section of
+ * docs/gc.markdown. */
+#define MVM_HEAP_SNAPSHOT_VERSION   1
+
+/* Kinds of node in a heap snapshot. */
+#define MVM_HEAP_SNAPSHOT_OBJECT        0
+#define MVM_HEAP_SNAPSHOT_TYPE_OBJECT   1
+#define MVM_HEAP_SNAPSHOT_STABLE        2
+#define MVM_HEAP_SNAPSHOT_FRAME         3
+
+/* Categories of root, much as roots.c groups them. */
+#define MVM_HEAP_SNAPSHOT_ROOT_PERMANENT    0
+#define MVM_HEAP_SNAPSHOT_ROOT_INSTANCE     1
+#define MVM_HEAP_SNAPSHOT_ROOT_THREAD       2
+#define MVM_HEAP_SNAPSHOT_ROOT_TC           3
+#define MVM_HEAP_SNAPSHOT_ROOT_TEMP         4
+#define MVM_HEAP_SNAPSHOT_ROOT_STACK        5
+
+void MVM_profile_heap_request(MVMThreadContext *tc, MVMString *path);
+void MVM_profile_heap_snapshot_if_due(MVMThreadContext *tc);
@@ -0,0 +1,285 @@
+#include "moar.h"
+#include "platform/time.h"
+
+/* This is the op-level profiler. In an interpreter built with
+ * MVM_OP_PROFILE=1, every dispatch calls MVM_op_profile_tick, which charges
+ * the time since the previous dispatch to the previous instruction, both per
+ * opcode and per (static frame, bytecode offset). At exit, a histogram of
+ * the opcodes and a list of the hottest instructions is written to the file
+ * named by MVM_OP_PROFILE_FILE, or to stderr. Per-instruction counts may be
+ * updated by several threads at once without synchronization, so are only
+ * approximate for code that is run by many threads. */
+
+/* Reads a cheap, monotonically increasing cycle counter where the CPU has
+ * one, falling back to the nanosecond clock elsewhere. */
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#define read_cycles() __rdtsc()
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+static MVMuint64 read_cycles(void) {
+    unsigned int lo, hi;
+    __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((MVMuint64)hi << 32) | lo;
+}
+#else
+#define read_cycles() MVM_platform_now()
+#endif
+
+/* Gets a C string for a (possibly NULL) VM string. */
+static char * c_string(MVMThreadContext *tc, MVMString *s, const char *fallback) {
+    if (s && NUM_GRAPHS(s))
+        return MVM_string_utf8_encode_C_string(tc, s);
+    else {
+        char *copy = malloc(strlen(fallback) + 1);
+        strcpy(copy, fallback);
+        return copy;
+    }
+}
+
+/* Gets the per-instruction counts for a static frame, setting them up and
+ * adding them to the instance's list if this is the first time we ran it. */
+static MVMOpProfileFrame * get_frame(MVMThreadContext *tc, MVMStaticFrame *sf) {
+    MVMStaticFrameBody *sfb = &sf->body;
+    MVMOpProfileFrame  *opf = sfb->op_profile;
+    if (!opf) {
+        MVMuint32 size = sfb->bytecode_size;
+        opf = malloc(sizeof(MVMOpProfileFrame));
+        opf->name          = c_string(tc, sfb->name, "<anon>");
+        opf->cuuid         = c_string(tc, sfb->cuuid, "<unknown>");
+        opf->bytecode_size = size;
+        opf->counts        = calloc(size ? size : 1, sizeof(MVMuint64));
+        opf->cycles        = calloc(size ? size : 1, sizeof(MVMuint64));
+        opf->opcodes       = calloc(size ? size : 1, sizeof(MVMuint16));
+
+        /* Another thread may have beaten us to it; if so, use theirs. */
+        if (MVM_casptr(&sfb->op_profile, NULL, opf) != NULL) {
+            free(opf->name);
+            free(opf->cuuid);
+            free(opf->counts);
+            free(opf->cycles);
+            free(opf->opcodes);
+            free(opf);
+            return sfb->op_profile;
+        }
+        do {
+            opf->next = tc->instance->op_profile_frames;
+        } while (MVM_casptr(&tc->instance->op_profile_frames, opf->next, opf) != opf->next);
+    }
+    return opf;
+}
+
+/* Called before dispatching each instruction. */
+void MVM_op_profile_tick(MVMThreadContext *tc, MVMuint8 *cur_op, MVMuint8 *bytecode_start) {
+    MVMOpProfileThread *opt    = tc->op_prof;
+    MVMuint64           now    = read_cycles();
+    MVMuint16           opcode = *(MVMuint16 *)cur_op;
+    MVMuint32           offset = cur_op - bytecode_start;
+    MVMStaticFrame     *sf     = tc->cur_frame->static_info;
+    MVMOpProfileFrame  *opf;
+
+    /* Charge the previous instruction for the time since it started. */
+    if (opt) {
+        MVMuint64 elapsed = now - opt->last_start;
+        opt->cycles[opt->last_opcode] += elapsed;
+        if (opt->last_frame)
+            opt->last_frame->cycles[opt->last_offset] += elapsed;
+    }
+    else {
+        opt = tc->op_prof = calloc(1, sizeof(MVMOpProfileThread));
+    }
+
+    /* Work out which static frame the instruction belongs to; beyond the
+     * end of the original bytecode, we're in the body of an inlined call. */
+    if (offset >= sf->body.bytecode_size && tc->cur_frame->spesh_cand) {
+        MVMSpeshInline *inl = MVM_spesh_inline_at(tc, tc->cur_frame->spesh_cand, offset);
+        if (inl) {
+            sf      = inl->sf;
+            offset -= inl->start;
+        }
+    }
+    opf = get_frame(tc, sf);
+
+    if (opcode >= MVM_OP_PROFILE_EXT_SLOT)
+        opcode = MVM_OP_PROFILE_EXT_SLOT;
+    opt->counts[opcode]++;
+    opt->last_opcode = opcode;
+    if (offset < opf->bytecode_size) {
+        opf->counts[offset]++;
+        opf->opcodes[offset] = opcode;
+        opt->last_frame  = opf;
+        opt->last_offset = offset;
+    }
+    else {
+        opt->last_frame = NULL;
+    }
+
+    /* Don't charge our own bookkeeping to the instruction. */
+    opt->last_start = read_cycles();
+}
+
+/* Adds the per-opcode counts of one thread to another set of them. */
+static void add_counts(MVMOpProfileThread *target, MVMOpProfileThread *source) {
+    MVMuint32 i;
+    for (i = 0; i <= MVM_OP_PROFILE_EXT_SLOT; i++) {
+        target->counts[i] += source->counts[i];
+        target->cycles[i] += source->cycles[i];
+    }
+}
+
+/* Called when a thread is finished, to add its counts to the instance's
+ * totals. */
+void MVM_op_profile_thread_done(MVMThreadContext *tc) {
+    MVMInstance *instance = tc->instance;
+    if (!tc->op_prof)
+        return;
+    uv_mutex_lock(&instance->mutex_profile);
+    if (instance->op_profile_done)
+        add_counts(instance->op_profile_done, tc->op_prof);
+    else
+        instance->op_profile_done = tc->op_prof;
+    uv_mutex_unlock(&instance->mutex_profile);
+    if (instance->op_profile_done != tc->op_prof)
+        free(tc->op_prof);
+    tc->op_prof = NULL;
+}
+
+/* Gets the name of an opcode (or of the extension ops slot). */
+static const char * opcode_name(MVMuint16 opcode) {
+    MVMOpInfo *info;
+    if (opcode == MVM_OP_PROFILE_EXT_SLOT)
+        return "<extension ops>";
+    info = MVM_op_get_op(opcode);
+    return info ? info->name : "<unknown>";
+}
+
+/* An entry in the histogram of opcodes. */
+typedef struct {
+    MVMuint16 opcode;
+    MVMuint64 count;
+    MVMuint64 cycles;
+} OpTotal;
+
+static int cmp_op_total(const void *a, const void *b) {
+    const OpTotal *x = (const OpTotal *)a;
+    const OpTotal *y = (const OpTotal *)b;
+    if (x->cycles != y->cycles)
+        return x->cycles > y->cycles ? -1 : 1;
+    return x->count > y->count ? -1 : x->count < y->count ? 1 : 0;
+}
+
+/* An instruction in the list of the hottest ones. */
+typedef struct {
+    MVMOpProfileFrame *frame;
+    MVMuint32          offset;
+} Site;
+
+static int cmp_site(const void *a, const void *b) {
+    const Site *x = (const Site *)a;
+    const Site *y = (const Site *)b;
+    MVMuint64 cx = x->frame->cycles[x->offset];
+    MVMuint64 cy = y->frame->cycles[y->offset];
+    if (cx != cy)
+        return cx > cy ? -1 : 1;
+    return 0;
+}
+
+/* Computes a percentage, without dividing by zero. */
+static double percent(MVMuint64 part, MVMuint64 whole) {
+    return whole ? 100.0 * (double)part / (double)whole : 0.0;
+}
+
+/* Writes the histogram of opcodes and the hottest instructions, using the
+ * counts of the main thread and of any threads that finished before it. */
+void MVM_op_profile_write(MVMThreadContext *tc) {
+    MVMInstance        *instance = tc->instance;
+    MVMOpProfileThread *totals;
+    MVMOpProfileFrame  *opf;
+    OpTotal            *ops;
+    Site               *sites;
+    MVMuint32           num_ops = 0, num_sites = 0, alloc_sites = 0, i;
+    MVMuint64           total_count = 0, total_cycles = 0;
+    const char         *filename;
+    FILE               *fh;
+
+    MVM_op_profile_thread_done(tc);
+    totals = instance->op_profile_done;
+    if (!totals)
+        return;
+
+    filename = getenv("MVM_OP_PROFILE_FILE");
+    fh = filename ? fopen(filename, "w") : stderr;
+    if (!fh) {
+        fprintf(stderr, "Could not write op profile to '%s'\n", filename);
+        fh = stderr;
+    }
+
+    /* Opcodes, by the time spent in them. */
+    ops = malloc((MVM_OP_PROFILE_EXT_SLOT + 1) * sizeof(OpTotal));
+    for (i = 0; i <= MVM_OP_PROFILE_EXT_SLOT; i++) {
+        if (!totals->counts[i])
+            continue;
+        ops[num_ops].opcode = i;
+        ops[num_ops].count  = totals->counts[i];
+        ops[num_ops].cycles = totals->cycles[i];
+        total_count  += totals->counts[i];
+        total_cycles += totals->cycles[i];
+        num_ops++;
+    }
+    qsort(ops, num_ops, sizeof(OpTotal), cmp_op_total);
+    fprintf(fh, "Op histogram: %llu instructions, %llu cycles\n\n",
+        (unsigned long long)total_count, (unsigned long long)total_cycles);
+    fprintf(fh, "%14s %7s %16s %7s %10s  %s\n",
+        "count", "%", "cycles", "%", "cycles/op", "op");
+    for (i = 0; i < num_ops; i++)
+        fprintf(fh, "%14llu %6.2f%% %16llu %6.2f%% %10.1f  %s\n",
+            (unsigned long long)ops[i].count, percent(ops[i].count, total_count),
+            (unsigned long long)ops[i].cycles, percent(ops[i].cycles, total_cycles),
+            (double)ops[i].cycles / (double)ops[i].count,
+            opcode_name(ops[i].opcode));
+    free(ops);
+
+    /* Instructions, by the time spent in them. */
+    sites = NULL;
+    for (opf = instance->op_profile_frames; opf; opf = opf->next) {
+        for (i = 0; i < opf->bytecode_size; i++) {
+            if (!opf->counts[i])
+                continue;
+            if (num_sites == alloc_sites) {
+                alloc_sites = alloc_sites ? alloc_sites * 2 : 256;
+                sites = realloc(sites, alloc_sites * sizeof(Site));
+            }
+            sites[num_sites].frame  = opf;
+            sites[num_sites].offset = i;
+            num_sites++;
+        }
+    }
+    qsort(sites, num_sites, sizeof(Site), cmp_site);
+    fprintf(fh, "\nHottest instructions:\n\n");
+    fprintf(fh, "%14s %16s %7s %8s  %-20s %s\n",
+        "count", "cycles", "%", "offset", "op", "frame");
+    for (i = 0; i < num_sites && i < MVM_OP_PROFILE_TOP_SITES; i++) {
+        MVMOpProfileFrame *f = sites[i].frame;
+        MVMuint32          o = sites[i].offset;
+        fprintf(fh, "%14llu %16llu %6.2f%% %8u  %-20s %s (%s)\n",
+            (unsigned long long)f->counts[o], (unsigned long long)f->cycles[o],
+            percent(f->cycles[o], total_cycles), o,
+            opcode_name(f->opcodes[o]), f->name, f->cuuid);
+    }
+    free(sites);
+
+    if (fh != stderr)
+        fclose(fh);
+
+    /* We only write this once, so clean up everything. */
+    while (instance->op_profile_frames) {
+        opf = instance->op_profile_frames;
+        instance->op_profile_frames = opf->next;
+        free(opf->name);
+        free(opf->cuuid);
+        free(opf->counts);
+        free(opf->cycles);
+        free(opf->opcodes);
+        free(opf);
+    }
+    MVM_checked_free_null(instance->op_profile_done);
+}
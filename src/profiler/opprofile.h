@@ -0,0 +1,41 @@
+/* The op-level profiler is compiled into the interpreter only when building
+ * with MVM_OP_PROFILE=1 (make opprofile). Opcodes at or above this are
+ * extension ops, and are all counted in this one slot. */
+#define MVM_OP_PROFILE_EXT_SLOT     MVM_OP_EXT_BASE
+
+/* Number of instructions to show in the hottest instructions list. */
+#define MVM_OP_PROFILE_TOP_SITES    100
+
+/* Per-instruction counts for a static frame, indexed by bytecode offset.
+ * These outlive the static frame itself, so we take copies of its names. */
+struct MVMOpProfileFrame {
+    char *name;
+    char *cuuid;
+
+    /* Size of the static frame's bytecode, and for each offset in it the
+     * number of times we executed the instruction there, the cycles it took
+     * and its opcode (as specialization may have replaced the original). */
+    MVMuint32  bytecode_size;
+    MVMuint64 *counts;
+    MVMuint64 *cycles;
+    MVMuint16 *opcodes;
+
+    /* Next frame in the instance's list of profiled frames. */
+    MVMOpProfileFrame *next;
+};
+
+/* Per-opcode counts of a thread, along with where the instruction that is
+ * currently running was and when it started. */
+struct MVMOpProfileThread {
+    MVMuint64 counts[MVM_OP_PROFILE_EXT_SLOT + 1];
+    MVMuint64 cycles[MVM_OP_PROFILE_EXT_SLOT + 1];
+
+    MVMuint16          last_opcode;
+    MVMOpProfileFrame *last_frame;
+    MVMuint32          last_offset;
+    MVMuint64          last_start;
+};
+
+void MVM_op_profile_tick(MVMThreadContext *tc, MVMuint8 *cur_op, MVMuint8 *bytecode_start);
+void MVM_op_profile_thread_done(MVMThreadContext *tc);
+void MVM_op_profile_write(MVMThreadContext *tc);
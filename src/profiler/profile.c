@@ -0,0 +1,621 @@
+#include "moar.h"
+#include "platform/time.h"
+
+/* This is the call graph profiler. When enabled, each thread builds a tree
+ * with a node for each distinct path of calls it makes, recording how many
+ * times the node was entered, the time spent in it and the allocations made
+ * while in it. At exit, the trees are aggregated per static frame and written
+ * out as JSON, along with the paths in the collapsed stack format that is
+ * understood by flame graph tools. */
+
+/* Gets the slot in a table's hash to start looking for something at. */
+static MVMuint32 hash_slot(MVMProfileTable *table, MVMCollectable *item) {
+    return ((MVMuint32)((uintptr_t)item >> 3) * 2654435761U) & (table->hash_size - 1);
+}
+
+/* Rebuilds the hash of a table, growing it to keep it at most half full. */
+static void rehash(MVMProfileTable *table) {
+    MVMuint32 size = table->hash_size ? table->hash_size : 64;
+    MVMuint32 i;
+    while (size < table->num_items * 2)
+        size *= 2;
+    if (size != table->hash_size) {
+        free(table->hash);
+        table->hash      = malloc(size * sizeof(MVMuint32));
+        table->hash_size = size;
+    }
+    memset(table->hash, 0, size * sizeof(MVMuint32));
+    for (i = 0; i < table->num_items; i++) {
+        MVMuint32 slot;
+        if (!table->items[i])
+            continue;
+        slot = hash_slot(table, table->items[i]);
+        while (table->hash[slot])
+            slot = (slot + 1) & (table->hash_size - 1);
+        table->hash[slot] = i + 1;
+    }
+    table->hash_stale = 0;
+}
+
+/* Gets the index of a static frame or type in a table, adding it if it's
+ * not there yet. */
+static MVMuint32 table_index(MVMProfileTable *table, MVMCollectable *item) {
+    MVMuint32 slot, index;
+    if (!table->hash || table->hash_stale)
+        rehash(table);
+    slot = hash_slot(table, item);
+    while ((index = table->hash[slot])) {
+        if (table->items[index - 1] == item)
+            return index - 1;
+        slot = (slot + 1) & (table->hash_size - 1);
+    }
+    if (table->num_items == table->alloc_items) {
+        table->alloc_items = table->alloc_items ? table->alloc_items * 2 : 16;
+        table->items = realloc(table->items, table->alloc_items * sizeof(MVMCollectable *));
+    }
+    index = table->num_items++;
+    table->items[index] = item;
+    if (table->num_items * 2 > table->hash_size)
+        rehash(table);
+    else
+        table->hash[slot] = index + 1;
+    return index;
+}
+
+/* Gets the profiling data for a thread, setting it up if needed. Index 0 of
+ * the static frames is taken by the root of the call graph, which has none. */
+static MVMProfileThreadData * get_thread_data(MVMThreadContext *tc) {
+    if (!tc->prof_data) {
+        tc->prof_data = calloc(1, sizeof(MVMProfileThreadData));
+        tc->prof_data->call_graph   = calloc(1, sizeof(MVMProfileCallNode));
+        tc->prof_data->current_call = tc->prof_data->call_graph;
+        tc->prof_data->start_time   = MVM_platform_now();
+        tc->prof_data->static_frames.items       = calloc(16, sizeof(MVMCollectable *));
+        tc->prof_data->static_frames.alloc_items = 16;
+        tc->prof_data->static_frames.num_items   = 1;
+    }
+    return tc->prof_data;
+}
+
+/* Logs the entry of a static frame. */
+void MVM_profile_log_enter(MVMThreadContext *tc, MVMStaticFrame *sf) {
+    MVMProfileThreadData *ptd    = get_thread_data(tc);
+    MVMProfileTable      *frames = &ptd->static_frames;
+    MVMProfileCallNode   *pred   = ptd->current_call;
+    MVMProfileCallNode   *node   = NULL;
+    MVMuint32 i;
+
+    /* See if we've been here before on this path; make a node if not. */
+    for (i = 0; i < pred->num_succ; i++) {
+        if (frames->items[pred->succ[i]->sf] == (MVMCollectable *)sf) {
+            node = pred->succ[i];
+            break;
+        }
+    }
+    if (!node) {
+        node = calloc(1, sizeof(MVMProfileCallNode));
+        node->sf   = table_index(frames, (MVMCollectable *)sf);
+        node->pred = pred;
+        if (pred->num_succ == pred->alloc_succ) {
+            pred->alloc_succ = pred->alloc_succ ? pred->alloc_succ * 2 : 4;
+            pred->succ = realloc(pred->succ, pred->alloc_succ * sizeof(MVMProfileCallNode *));
+        }
+        pred->succ[pred->num_succ++] = node;
+    }
+
+    node->total_entries++;
+    node->cur_entry_time = MVM_platform_now();
+    ptd->current_call    = node;
+}
+
+/* Logs the exit of a static frame. Continuations mean that we may leave
+ * several frames at once, so we look up the path for the frame that is being
+ * left; if it's not there (because it was entered before the profiler saw
+ * it), we ignore the exit. */
+void MVM_profile_log_exit(MVMThreadContext *tc, MVMStaticFrame *sf) {
+    MVMProfileThreadData *ptd = tc->prof_data;
+    MVMProfileCallNode   *node, *leave;
+    MVMuint64 now;
+
+    if (!ptd)
+        return;
+    leave = ptd->current_call;
+    while (leave && ptd->static_frames.items[leave->sf] != (MVMCollectable *)sf)
+        leave = leave->pred;
+    if (!leave || !leave->pred)
+        return;
+
+    now = MVM_platform_now();
+    node = ptd->current_call;
+    while (node != leave->pred) {
+        node->total_time += now - node->cur_entry_time;
+        node = node->pred;
+    }
+    ptd->current_call = leave->pred;
+}
+
+/* Logs an allocation of an object. */
+void MVM_profile_log_allocated(MVMThreadContext *tc, MVMObject *obj) {
+    MVMProfileThreadData *ptd  = get_thread_data(tc);
+    MVMProfileCallNode   *node = ptd->current_call;
+    MVMCollectable       *st   = (MVMCollectable *)STABLE(obj);
+    MVMuint32 i;
+    for (i = 0; i < node->num_alloc; i++) {
+        if (ptd->types.items[node->alloc[i].type] == st) {
+            node->alloc[i].count++;
+            return;
+        }
+    }
+    if (node->num_alloc == node->alloc_alloc) {
+        node->alloc_alloc = node->alloc_alloc ? node->alloc_alloc * 2 : 4;
+        node->alloc = realloc(node->alloc, node->alloc_alloc * sizeof(MVMProfileAllocations));
+    }
+    node->alloc[node->num_alloc].type  = table_index(&ptd->types, st);
+    node->alloc[node->num_alloc].count = 1;
+    node->num_alloc++;
+}
+
+/* Logs a GC run that the thread took part in. */
+void MVM_profile_log_gc(MVMThreadContext *tc, MVMuint64 duration) {
+    MVMProfileThreadData *ptd = get_thread_data(tc);
+    ptd->num_gc_runs++;
+    ptd->gc_time += duration;
+}
+
+/* Collects all of the nodes of a call graph, parents before children. We do
+ * this without recursion, as the graph may be as deep as the deepest
+ * recursion in the program. */
+static MVMProfileCallNode ** all_nodes(MVMProfileCallNode *root, MVMuint32 *num_nodes) {
+    MVMuint32            alloc = 64;
+    MVMuint32            num   = 0;
+    MVMuint32            pos   = 0;
+    MVMProfileCallNode **nodes = malloc(alloc * sizeof(MVMProfileCallNode *));
+    nodes[num++] = root;
+    while (pos < num) {
+        MVMProfileCallNode *node = nodes[pos++];
+        MVMuint32 i;
+        if (num + node->num_succ > alloc) {
+            while (num + node->num_succ > alloc)
+                alloc *= 2;
+            nodes = realloc(nodes, alloc * sizeof(MVMProfileCallNode *));
+        }
+        for (i = 0; i < node->num_succ; i++)
+            nodes[num++] = node->succ[i];
+    }
+    *num_nodes = num;
+    return nodes;
+}
+
+/* Adds the static frames and types the profiling data of a thread refers to
+ * to the GC worklist. They may be moved, so the hashes to find them by have
+ * to be rebuilt before they are next used. */
+void MVM_profile_mark_data(MVMThreadContext *tc, MVMGCWorklist *worklist) {
+    MVMProfileThreadData *ptd = tc->prof_data;
+    MVMuint32 i;
+    if (!ptd)
+        return;
+    for (i = 0; i < ptd->static_frames.num_items; i++)
+        MVM_gc_worklist_add(tc, worklist, &ptd->static_frames.items[i]);
+    for (i = 0; i < ptd->types.num_items; i++)
+        MVM_gc_worklist_add(tc, worklist, &ptd->types.items[i]);
+    ptd->static_frames.hash_stale = 1;
+    ptd->types.hash_stale         = 1;
+}
+
+/* A growable buffer that we produce output in. */
+typedef struct {
+    char   *data;
+    size_t  len;
+    size_t  alloc;
+} OutBuf;
+
+static void append(OutBuf *buf, const char *str) {
+    size_t len = strlen(str);
+    if (buf->len + len + 1 > buf->alloc) {
+        while (buf->len + len + 1 > buf->alloc)
+            buf->alloc = buf->alloc ? buf->alloc * 2 : 4096;
+        buf->data = realloc(buf->data, buf->alloc);
+    }
+    memcpy(buf->data + buf->len, str, len + 1);
+    buf->len += len;
+}
+static void append_u64(OutBuf *buf, MVMuint64 value) {
+    char tmp[24];
+    snprintf(tmp, sizeof(tmp), "%llu", (unsigned long long)value);
+    append(buf, tmp);
+}
+static void append_json_string(OutBuf *buf, const char *str) {
+    char tmp[8];
+    append(buf, "\"");
+    for (; *str; str++) {
+        unsigned char c = (unsigned char)*str;
+        if (c == '"' || c == '\\') {
+            tmp[0] = '\\';
+            tmp[1] = c;
+            tmp[2] = 0;
+        }
+        else if (c < 0x20) {
+            snprintf(tmp, sizeof(tmp), "\\u%04x", c);
+        }
+        else {
+            tmp[0] = c;
+            tmp[1] = 0;
+        }
+        append(buf, tmp);
+    }
+    append(buf, "\"");
+}
+
+/* Per-static frame totals, produced while writing out the profile. */
+typedef struct {
+    MVMuint32       sf;
+    MVMuint64       entries;
+    MVMuint64       inclusive_time;
+    MVMuint64       exclusive_time;
+
+    /* Name, compilation unit ID, location, and a label for the collapsed
+     * stacks. */
+    char     *name;
+    char     *cuuid;
+    char     *file;
+    MVMuint32 line;
+    char     *label;
+} FrameTotal;
+
+/* A caller/callee edge, or allocations of a type in a static frame, by
+ * their indexes in the thread's tables. */
+typedef struct {
+    MVMuint32  from;
+    MVMuint32  to;
+    MVMuint64  count;
+} Edge;
+
+static int cmp_index(MVMuint32 a, MVMuint32 b) {
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+static int cmp_edge(const void *a, const void *b) {
+    const Edge *ea = (const Edge *)a, *eb = (const Edge *)b;
+    int c = cmp_index(ea->from, eb->from);
+    return c ? c : cmp_index(ea->to, eb->to);
+}
+static int cmp_total_exclusive(const void *a, const void *b) {
+    MVMuint64 ea = ((FrameTotal *)a)->exclusive_time, eb = ((FrameTotal *)b)->exclusive_time;
+    return ea > eb ? -1 : ea < eb ? 1 : 0;
+}
+
+/* Sorts edges and merges those with the same ends, returning the new count. */
+static MVMuint32 merge_edges(Edge *edges, MVMuint32 num) {
+    MVMuint32 i, out = 0;
+    qsort(edges, num, sizeof(Edge), cmp_edge);
+    for (i = 0; i < num; i++) {
+        if (out && edges[out - 1].from == edges[i].from && edges[out - 1].to == edges[i].to)
+            edges[out - 1].count += edges[i].count;
+        else
+            edges[out++] = edges[i];
+    }
+    return out;
+}
+
+/* Finds the first of the (sorted) edges starting at the given place. */
+static MVMuint32 first_edge(Edge *edges, MVMuint32 num, MVMuint32 from) {
+    MVMuint32 lo = 0, hi = num;
+    while (lo < hi) {
+        MVMuint32 mid = (lo + hi) / 2;
+        if (edges[mid].from < from)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* Gets a C string for a (possibly NULL) VM string. */
+static char * c_string(MVMThreadContext *tc, MVMString *s, const char *fallback) {
+    if (s && NUM_GRAPHS(s))
+        return MVM_string_utf8_encode_C_string(tc, s);
+    else {
+        char *copy = malloc(strlen(fallback) + 1);
+        strcpy(copy, fallback);
+        return copy;
+    }
+}
+
+/* Gets a name for a type. Only types whose meta-object is a KnowHOW know
+ * their name without us having to run code, so for others we describe the
+ * representation. */
+static void append_type_name(MVMThreadContext *tc, OutBuf *buf, MVMSTable *st) {
+    MVMObject *how = st->HOW;
+    char      *name;
+    if (how && IS_CONCRETE(how) && REPR(how)->ID == MVM_REPR_ID_KnowHOWREPR &&
+            ((MVMKnowHOWREPR *)how)->body.name) {
+        name = MVM_string_utf8_encode_C_string(tc, ((MVMKnowHOWREPR *)how)->body.name);
+    }
+    else {
+        name = malloc(strlen(st->REPR->name) + 32);
+        sprintf(name, "<%s type %p>", st->REPR->name, (void *)st);
+    }
+    append_json_string(buf, name);
+    free(name);
+}
+
+/* Fills out the names and location of a static frame. */
+static void describe_frame(MVMThreadContext *tc, FrameTotal *total, MVMStaticFrame *sf) {
+    MVMStaticFrameBody    *sfb   = &sf->body;
+    MVMBytecodeAnnotation *annot = MVM_bytecode_resolve_annotation(tc, sfb, 0);
+    char *c;
+    total->name  = c_string(tc, sfb->name, "<anon>");
+    total->cuuid = c_string(tc, sfb->cuuid, "<unknown>");
+    if (annot && annot->filename_string_heap_index < sfb->cu->body.num_strings)
+        total->file = c_string(tc, sfb->cu->body.strings[annot->filename_string_heap_index], "<unknown>");
+    else
+        total->file = c_string(tc, sfb->cu->body.filename, "<unknown>");
+    total->line = annot ? annot->line_number : 0;
+    if (annot)
+        free(annot);
+
+    /* The label has to be free of the separators of the collapsed format. */
+    total->label = malloc(strlen(total->name) + strlen(total->file) + 16);
+    sprintf(total->label, "%s %s:%u", total->name, total->file, total->line);
+    for (c = total->label; *c; c++)
+        if (*c == ';' || *c == '\n' || *c == '\r')
+            *c = '_';
+}
+
+/* Writes out the profile of a thread, as a JSON object to one buffer and as
+ * collapsed stacks to another. */
+static void write_thread(MVMThreadContext *tc, OutBuf *json, OutBuf *stacks) {
+    MVMProfileThreadData *ptd        = tc->prof_data;
+    MVMuint64             now        = MVM_platform_now();
+    MVMuint32             num_frames = ptd->static_frames.num_items;
+    MVMProfileCallNode  **nodes, **path;
+    MVMProfileCallNode   *node;
+    FrameTotal           *totals, *by_time;
+    Edge                 *calls, *allocs, *type_allocs;
+    MVMuint32 num_nodes, num_calls = 0, num_allocs = 0, num_type_allocs = 0;
+    MVMuint32 i, j;
+
+    /* Close off the time for nodes we are still in. */
+    for (node = ptd->current_call; node->pred; node = node->pred)
+        node->total_time += now - node->cur_entry_time;
+
+    /* Total up per static frame, indexed like the table of them. A frame's
+     * time only counts towards its inclusive time if it is not already
+     * counted by a recursive call. */
+    nodes  = all_nodes(ptd->call_graph, &num_nodes);
+    totals = calloc(num_frames, sizeof(FrameTotal));
+    for (i = 1; i < num_frames; i++) {
+        totals[i].sf = i;
+        describe_frame(tc, &totals[i], (MVMStaticFrame *)ptd->static_frames.items[i]);
+    }
+    for (i = 0; i < num_nodes; i++) {
+        MVMProfileCallNode *pred;
+        MVMuint64 children = 0;
+        FrameTotal *total;
+        node = nodes[i];
+        if (!node->sf)
+            continue;
+        total = &totals[node->sf];
+        total->entries += node->total_entries;
+        for (j = 0; j < node->num_succ; j++)
+            children += node->succ[j]->total_time;
+        total->exclusive_time += node->total_time > children
+            ? node->total_time - children : 0;
+        for (pred = node->pred; pred && pred->sf != node->sf; pred = pred->pred)
+            ;
+        if (!pred)
+            total->inclusive_time += node->total_time;
+    }
+
+    /* Gather the call and allocation edges. */
+    calls       = malloc((num_nodes ? num_nodes : 1) * sizeof(Edge));
+    allocs      = NULL;
+    type_allocs = NULL;
+    for (i = 0; i < num_nodes; i++) {
+        node = nodes[i];
+        if (node->sf && node->pred->sf) {
+            calls[num_calls].from  = node->pred->sf;
+            calls[num_calls].to    = node->sf;
+            calls[num_calls].count = node->total_entries;
+            num_calls++;
+        }
+        if (node->num_alloc) {
+            allocs      = realloc(allocs, (num_allocs + node->num_alloc) * sizeof(Edge));
+            type_allocs = realloc(type_allocs, (num_type_allocs + node->num_alloc) * sizeof(Edge));
+            for (j = 0; j < node->num_alloc; j++) {
+                allocs[num_allocs].from  = node->sf;
+                allocs[num_allocs].to    = node->alloc[j].type;
+                allocs[num_allocs].count = node->alloc[j].count;
+                num_allocs++;
+                type_allocs[num_type_allocs].from  = 0;
+                type_allocs[num_type_allocs].to    = node->alloc[j].type;
+                type_allocs[num_type_allocs].count = node->alloc[j].count;
+                num_type_allocs++;
+            }
+        }
+    }
+    num_calls       = merge_edges(calls, num_calls);
+    num_allocs      = merge_edges(allocs, num_allocs);
+    num_type_allocs = merge_edges(type_allocs, num_type_allocs);
+
+    /* Collapsed stacks: one line per path, with its exclusive time. */
+    path = malloc(num_nodes * sizeof(MVMProfileCallNode *));
+    for (i = 0; i < num_nodes; i++) {
+        MVMProfileCallNode *pred;
+        MVMuint64 children = 0;
+        MVMuint32 depth = 0;
+        node = nodes[i];
+        if (!node->sf)
+            continue;
+        for (j = 0; j < node->num_succ; j++)
+            children += node->succ[j]->total_time;
+        if (node->total_time <= children)
+            continue;
+        for (pred = node; pred->sf; pred = pred->pred)
+            path[depth++] = pred;
+        while (depth--) {
+            append(stacks, totals[path[depth]->sf].label);
+            append(stacks, depth ? ";" : " ");
+        }
+        append_u64(stacks, node->total_time - children);
+        append(stacks, "\n");
+    }
+    free(path);
+
+    /* The JSON, with the frames in order of exclusive time. We still need
+     * the totals by index to look up callees, so sort a copy. */
+    by_time = malloc(num_frames * sizeof(FrameTotal));
+    memcpy(by_time, totals + 1, (num_frames - 1) * sizeof(FrameTotal));
+    qsort(by_time, num_frames - 1, sizeof(FrameTotal), cmp_total_exclusive);
+    append(json, "{\"thread\":");
+    append_u64(json, tc->thread_id);
+    append(json, ",\"total_time\":");
+    append_u64(json, now - ptd->start_time);
+    append(json, ",\"gc_runs\":");
+    append_u64(json, ptd->num_gc_runs);
+    append(json, ",\"gc_time\":");
+    append_u64(json, ptd->gc_time);
+    append(json, ",\"frames\":[");
+    for (i = 0; i < num_frames - 1; i++) {
+        FrameTotal *total = &by_time[i];
+        MVMuint32   first;
+        append(json, i ? ",{\"name\":" : "{\"name\":");
+        append_json_string(json, total->name);
+        append(json, ",\"cuuid\":");
+        append_json_string(json, total->cuuid);
+        append(json, ",\"file\":");
+        append_json_string(json, total->file);
+        append(json, ",\"line\":");
+        append_u64(json, total->line);
+        append(json, ",\"entries\":");
+        append_u64(json, total->entries);
+        append(json, ",\"inclusive_time\":");
+        append_u64(json, total->inclusive_time);
+        append(json, ",\"exclusive_time\":");
+        append_u64(json, total->exclusive_time);
+        append(json, ",\"callees\":[");
+        first = first_edge(calls, num_calls, total->sf);
+        for (j = first; j < num_calls && calls[j].from == total->sf; j++) {
+            FrameTotal *callee = &totals[calls[j].to];
+            append(json, j != first ? ",{\"name\":" : "{\"name\":");
+            append_json_string(json, callee->name);
+            append(json, ",\"cuuid\":");
+            append_json_string(json, callee->cuuid);
+            append(json, ",\"calls\":");
+            append_u64(json, calls[j].count);
+            append(json, "}");
+        }
+        append(json, "],\"allocations\":[");
+        first = first_edge(allocs, num_allocs, total->sf);
+        for (j = first; j < num_allocs && allocs[j].from == total->sf; j++) {
+            append(json, j != first ? ",{\"type\":" : "{\"type\":");
+            append_type_name(tc, json, (MVMSTable *)ptd->types.items[allocs[j].to]);
+            append(json, ",\"count\":");
+            append_u64(json, allocs[j].count);
+            append(json, "}");
+        }
+        append(json, "]}");
+    }
+    append(json, "],\"allocations\":[");
+    for (i = 0; i < num_type_allocs; i++) {
+        append(json, i ? ",{\"type\":" : "{\"type\":");
+        append_type_name(tc, json, (MVMSTable *)ptd->types.items[type_allocs[i].to]);
+        append(json, ",\"count\":");
+        append_u64(json, type_allocs[i].count);
+        append(json, "}");
+    }
+    append(json, "]}");
+
+    /* Clean up, including the profiling data itself. */
+    for (i = 1; i < num_frames; i++) {
+        free(totals[i].name);
+        free(totals[i].cuuid);
+        free(totals[i].file);
+        free(totals[i].label);
+    }
+    free(totals);
+    free(by_time);
+    free(calls);
+    MVM_checked_free_null(allocs);
+    MVM_checked_free_null(type_allocs);
+    for (i = 0; i < num_nodes; i++) {
+        MVM_checked_free_null(nodes[i]->succ);
+        MVM_checked_free_null(nodes[i]->alloc);
+        free(nodes[i]);
+    }
+    free(nodes);
+    free(ptd->static_frames.items);
+    MVM_checked_free_null(ptd->static_frames.hash);
+    MVM_checked_free_null(ptd->types.items);
+    MVM_checked_free_null(ptd->types.hash);
+    free(ptd);
+    tc->prof_data = NULL;
+}
+
+/* Called when a thread other than the main one is done. Its profile goes
+ * into the instance, to be written out at exit. */
+void MVM_profile_thread_done(MVMThreadContext *tc) {
+    MVMInstance *instance = tc->instance;
+    OutBuf json, stacks;
+    if (!tc->prof_data)
+        return;
+    memset(&json, 0, sizeof(OutBuf));
+    memset(&stacks, 0, sizeof(OutBuf));
+    uv_mutex_lock(&instance->mutex_profile);
+    if (instance->profile_done_json) {
+        append(&json, instance->profile_done_json);
+        append(&json, ",");
+        free(instance->profile_done_json);
+    }
+    if (instance->profile_done_stacks) {
+        append(&stacks, instance->profile_done_stacks);
+        free(instance->profile_done_stacks);
+    }
+    write_thread(tc, &json, &stacks);
+    instance->profile_done_json   = json.data;
+    instance->profile_done_stacks = stacks.data;
+    uv_mutex_unlock(&instance->mutex_profile);
+}
+
+/* Writes out a file, complaining if we can't. */
+static void write_file(const char *filename, OutBuf *buf) {
+    FILE *fh = fopen(filename, "w");
+    if (!fh) {
+        fprintf(stderr, "Could not write profile to '%s'\n", filename);
+        return;
+    }
+    if (buf->len)
+        fwrite(buf->data, 1, buf->len, fh);
+    fclose(fh);
+}
+
+/* Writes out the profile of the main thread, along with those of any that
+ * finished before it, to the requested files. */
+void MVM_profile_write(MVMThreadContext *tc) {
+    MVMInstance *instance = tc->instance;
+    OutBuf json, stacks;
+    memset(&json, 0, sizeof(OutBuf));
+    memset(&stacks, 0, sizeof(OutBuf));
+
+    uv_mutex_lock(&instance->mutex_profile);
+    append(&json, "[");
+    if (instance->profile_done_json)
+        append(&json, instance->profile_done_json);
+    if (instance->profile_done_stacks)
+        append(&stacks, instance->profile_done_stacks);
+    if (tc->prof_data) {
+        if (instance->profile_done_json)
+            append(&json, ",");
+        write_thread(tc, &json, &stacks);
+    }
+    append(&json, "]\n");
+    MVM_checked_free_null(instance->profile_done_json);
+    MVM_checked_free_null(instance->profile_done_stacks);
+    uv_mutex_unlock(&instance->mutex_profile);
+
+    if (instance->profile_json_file)
+        write_file(instance->profile_json_file, &json);
+    if (instance->profile_stacks_file)
+        write_file(instance->profile_stacks_file, &stacks);
+    free(json.data);
+    MVM_checked_free_null(stacks.data);
+}
@@ -0,0 +1,73 @@
+/* Number of allocations of a given type made while in a call graph node. The
+ * type is an index into the thread's table of types. */
+struct MVMProfileAllocations {
+    MVMuint32 type;
+    MVMuint64 count;
+};
+
+/* A node in the call graph of a thread. There is one for each distinct path
+ * of calls through the program. */
+struct MVMProfileCallNode {
+    /* The static frame that was called, as an index into the thread's table
+     * of static frames. The root node has none, which is index 0. */
+    MVMuint32 sf;
+
+    /* The node of the caller, and those of the callees. */
+    MVMProfileCallNode  *pred;
+    MVMProfileCallNode **succ;
+    MVMuint32            num_succ;
+    MVMuint32            alloc_succ;
+
+    /* Number of times we entered this node, the total (inclusive) time we
+     * spent in it, and when the current entry happened. */
+    MVMuint64 total_entries;
+    MVMuint64 total_time;
+    MVMuint64 cur_entry_time;
+
+    /* Allocations made while in this node (not counting callees). */
+    MVMProfileAllocations *alloc;
+    MVMuint32              num_alloc;
+    MVMuint32              alloc_alloc;
+};
+
+/* The distinct static frames or types the profiler has seen on a thread.
+ * Call graph nodes refer to them by index, so the GC only has to mark these
+ * rather than walk the call graph. To find the index of something, there is
+ * a hash of the indexes keyed on its address; since GC may move things, it
+ * is rebuilt when first needed after a GC run. */
+struct MVMProfileTable {
+    MVMCollectable **items;
+    MVMuint32        num_items;
+    MVMuint32        alloc_items;
+
+    /* Open addressed, holding index + 1, or 0 for an empty slot. */
+    MVMuint32 *hash;
+    MVMuint32  hash_size;
+    MVMuint32  hash_stale;
+};
+
+/* The profiling data collected for a thread. */
+struct MVMProfileThreadData {
+    /* The root of the call graph, and the node we are currently in. */
+    MVMProfileCallNode *call_graph;
+    MVMProfileCallNode *current_call;
+
+    /* The static frames and types the call graph refers to. */
+    MVMProfileTable static_frames;
+    MVMProfileTable types;
+
+    /* When profiling of the thread started. */
+    MVMuint64 start_time;
+
+    /* Number of GC runs the thread took part in, and time spent in them. */
+    MVMuint64 num_gc_runs;
+    MVMuint64 gc_time;
+};
+
+void MVM_profile_log_enter(MVMThreadContext *tc, MVMStaticFrame *sf);
+void MVM_profile_log_exit(MVMThreadContext *tc, MVMStaticFrame *sf);
+void MVM_profile_log_allocated(MVMThreadContext *tc, MVMObject *obj);
+void MVM_profile_log_gc(MVMThreadContext *tc, MVMuint64 duration);
+void MVM_profile_mark_data(MVMThreadContext *tc, MVMGCWorklist *worklist);
+void MVM_profile_thread_done(MVMThreadContext *tc);
+void MVM_profile_write(MVMThreadContext *tc);
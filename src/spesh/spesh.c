@@ -0,0 +1,997 @@
+#include "moar.h"
+
+/* This is the type specializer ("spesh"). Once a static frame has been
+ * invoked enough times, we take the argument types of a call to it as being
+ * representative, and produce a copy of its bytecode that is specialized on
+ * those types, guarded by checks on the incoming arguments. Facts about the
+ * types are propagated from the parameter fetching instructions through set
+ * and decont, and are then used to:
+ *
+ *   * eliminate decont instructions on things that are not containers
+ *   * resolve findmeth against the method cache at specialization time
+ *   * turn getwhat and isconcrete into constants
+ *   * inline calls to small leaf routines whose code object we know
+ *
+ * Rather than building a full SSA representation, we only establish facts
+ * about registers that are written exactly once, by an instruction in the
+ * straight-line prefix of the frame (before any branch instruction or branch
+ * target). Such a write dominates every instruction that comes after it. */
+
+/* Macros for getting things from the bytecode stream. */
+#define GET_UI16(pc, idx)   *((MVMuint16 *)(pc + idx))
+#define GET_I16(pc, idx)    *((MVMint16 *)(pc + idx))
+#define GET_UI32(pc, idx)   *((MVMuint32 *)(pc + idx))
+
+/* Maximum number of positional arguments of a call that we'll inline. */
+#define INLINE_MAX_ARGS     8
+
+/* Facts we may know about the content of a register. */
+#define FACT_KNOWN_TYPE     1
+#define FACT_CONCRETE       2
+#define FACT_TYPEOBJ        4
+
+typedef struct {
+    /* Fact flags. */
+    MVMuint16 flags;
+
+    /* Index of the guard that the fact depends on. */
+    MVMuint16 guard;
+
+    /* Bytecode offset of the (single) write to the register. */
+    MVMuint32 def_offset;
+} RegFact;
+
+/* A call that we are going to inline. */
+typedef struct {
+    /* The code object being called, and its static frame. */
+    MVMObject      *code;
+    MVMStaticFrame *sf;
+
+    /* Where the call sequence (from prepargs through to the invoke) lives
+     * in the caller. */
+    MVMuint32 call_start;
+    MVMuint32 call_end;
+
+    /* The invoke instruction, and the register it puts its result in. */
+    MVMuint16 invoke_op;
+    MVMuint16 res_reg;
+
+    /* The registers holding the arguments. */
+    MVMuint16 arg_regs[INLINE_MAX_ARGS];
+
+    /* Offset and register of the return instruction of the callee. */
+    MVMuint32 ret_pos;
+    MVMuint16 ret_reg;
+
+    /* The first register of the caller that the callee's registers are
+     * mapped to, and the region of the bytecode holding the inlined body. */
+    MVMuint16 base;
+    MVMuint32 start;
+    MVMuint32 end;
+} InlineCall;
+
+/* State held while we are producing a specialization. */
+typedef struct {
+    MVMThreadContext *tc;
+    MVMStaticFrame   *sf;
+    MVMCompUnit      *cu;
+
+    /* The bytecode being specialized (a copy of the original). */
+    MVMuint8  *bc;
+    MVMuint32  bc_size;
+
+    /* End of the straight-line prefix of the bytecode. */
+    MVMuint32  prefix_end;
+
+    /* Per-register write counts and facts. */
+    MVMuint32 *write_counts;
+    RegFact   *facts;
+
+    /* Potential guards (one per positional argument), and whether each was
+     * actually relied upon. */
+    MVMSpeshGuard *guards;
+    MVMuint8      *guard_used;
+    MVMuint16      num_guards;
+
+    /* Spesh slots. */
+    MVMCollectable **slots;
+    MVMuint32        num_slots;
+    MVMuint32        alloc_slots;
+
+    /* Calls that we are going to inline, and the number of locals we'll
+     * need once we have done so. */
+    InlineCall inlines[MVM_SPESH_MAX_INLINES];
+    MVMuint32  num_inlines;
+    MVMuint32  num_locals;
+
+    /* Instruction boundaries and local types of the specialized bytecode,
+     * once calls have been inlined into it. */
+    MVMuint8  *labels;
+    MVMuint16 *local_types;
+
+    /* Number of instructions we managed to specialize. */
+    MVMuint32 num_rewrites;
+} SpeshState;
+
+/* Gets the op info for an opcode, including extension ops. Returns NULL if
+ * the op is unknown. */
+const MVMOpInfo * MVM_spesh_get_op_info(MVMThreadContext *tc, MVMCompUnit *cu, MVMuint16 opcode) {
+    if (opcode < MVM_OP_EXT_BASE) {
+        return MVM_op_get_op(opcode);
+    }
+    else {
+        MVMuint16 index = opcode - MVM_OP_EXT_BASE;
+        if (index >= cu->body.num_extops)
+            return NULL;
+        return MVM_ext_resolve_extop_record(tc, &cu->body.extops[index]);
+    }
+}
+
+/* Gets the size in bytes that an operand with the given flags takes up in
+ * the bytecode stream. */
+MVMuint32 MVM_spesh_operand_size(MVMThreadContext *tc, MVMuint8 flags) {
+    switch (flags & MVM_operand_rw_mask) {
+        case MVM_operand_read_reg:
+        case MVM_operand_write_reg:
+            return 2;
+        case MVM_operand_read_lex:
+        case MVM_operand_write_lex:
+            return 4;
+        default:
+            switch (flags & MVM_operand_type_mask) {
+                case MVM_operand_int8:
+                    return 1;
+                case MVM_operand_int16:
+                case MVM_operand_callsite:
+                case MVM_operand_coderef:
+                    return 2;
+                case MVM_operand_int32:
+                case MVM_operand_num32:
+                case MVM_operand_str:
+                case MVM_operand_ins:
+                    return 4;
+                case MVM_operand_int64:
+                case MVM_operand_num64:
+                    return 8;
+                default:
+                    return 0;
+            }
+    }
+}
+
+/* Gets the total size of the instruction at the given position of some
+ * bytecode, or 0 if it cannot be determined. Also hands back the op info. */
+static MVMuint32 bytecode_instruction_size(SpeshState *ss, MVMuint8 *bc, MVMuint32 pos,
+                                           const MVMOpInfo **info_out) {
+    const MVMOpInfo *info = MVM_spesh_get_op_info(ss->tc, ss->cu, GET_UI16(bc, pos));
+    MVMuint32 size = 2;
+    MVMuint32 i;
+    if (!info)
+        return 0;
+    for (i = 0; i < info->num_operands; i++)
+        size += MVM_spesh_operand_size(ss->tc, info->operands[i]);
+    *info_out = info;
+    return size;
+}
+static MVMuint32 instruction_size(SpeshState *ss, MVMuint32 pos, const MVMOpInfo **info_out) {
+    return bytecode_instruction_size(ss, ss->bc, pos, info_out);
+}
+
+/* Checks if an instruction may branch somewhere other than the instruction
+ * that follows it. */
+static MVMint32 is_branch(const MVMOpInfo *info) {
+    MVMuint32 i;
+    if (info->opcode == MVM_OP_jumplist)
+        return 1;
+    for (i = 0; i < info->num_operands; i++)
+        if ((info->operands[i] & MVM_operand_rw_mask) == MVM_operand_literal &&
+                (info->operands[i] & MVM_operand_type_mask) == MVM_operand_ins)
+            return 1;
+    return 0;
+}
+
+/* Walks the bytecode, counting writes to each register and finding the end
+ * of the straight-line prefix. Returns zero if we failed to understand the
+ * bytecode. */
+static MVMint32 analyze_writes(SpeshState *ss) {
+    MVMStaticFrameBody *sfb    = &ss->sf->body;
+    MVMuint8           *labels = sfb->instr_offsets;
+    MVMuint32           pos    = 0;
+    MVMuint32           i;
+
+    /* The prefix certainly ends at the first branch target or handler
+     * target. */
+    ss->prefix_end = ss->bc_size;
+    for (i = 0; i < ss->bc_size; i++) {
+        if (labels[i] & MVM_BC_branch_target) {
+            ss->prefix_end = i;
+            break;
+        }
+    }
+    for (i = 0; i < sfb->num_handlers; i++)
+        if (sfb->handlers[i].goto_offset && sfb->handlers[i].goto_offset < ss->prefix_end)
+            ss->prefix_end = sfb->handlers[i].goto_offset;
+
+    while (pos < ss->bc_size) {
+        const MVMOpInfo *info;
+        MVMuint32 size = instruction_size(ss, pos, &info);
+        MVMuint32 operand_pos = pos + 2;
+        if (!size || !(labels[pos] & MVM_BC_op_boundary))
+            return 0;
+
+        /* It also ends at the first instruction that may branch. */
+        if (pos < ss->prefix_end && is_branch(info))
+            ss->prefix_end = pos;
+
+        for (i = 0; i < info->num_operands; i++) {
+            MVMuint8 flags = info->operands[i];
+            if ((flags & MVM_operand_rw_mask) == MVM_operand_write_reg) {
+                MVMuint16 reg = GET_UI16(ss->bc, operand_pos);
+                ss->write_counts[reg]++;
+                ss->facts[reg].def_offset = pos;
+            }
+            operand_pos += MVM_spesh_operand_size(ss->tc, flags);
+        }
+
+        pos += size;
+    }
+
+    return 1;
+}
+
+/* Establishes facts about registers whose single write happens in the
+ * straight-line prefix. */
+static void establish_facts(SpeshState *ss) {
+    MVMuint32 pos = 0;
+    while (pos < ss->prefix_end) {
+        const MVMOpInfo *info;
+        MVMuint32 size = instruction_size(ss, pos, &info);
+        MVMuint16 target, source;
+
+        switch (info->opcode) {
+            case MVM_OP_param_rp_o: {
+                MVMuint16 idx = GET_UI16(ss->bc, pos + 4);
+                target = GET_UI16(ss->bc, pos + 2);
+                if (ss->write_counts[target] == 1 && idx < ss->num_guards && ss->guards[idx].match) {
+                    ss->facts[target].flags = FACT_KNOWN_TYPE |
+                        (ss->guards[idx].kind == MVM_SPESH_GUARD_CONC ? FACT_CONCRETE : FACT_TYPEOBJ);
+                    ss->facts[target].guard = idx;
+                }
+                break;
+            }
+            case MVM_OP_set:
+            case MVM_OP_decont:
+                target = GET_UI16(ss->bc, pos + 2);
+                source = GET_UI16(ss->bc, pos + 4);
+                if (ss->write_counts[target] == 1 && (ss->facts[source].flags & FACT_KNOWN_TYPE)) {
+                    /* A decont of something that is not a container just
+                     * gives us the thing itself. */
+                    MVMSTable *st = ss->guards[ss->facts[source].guard].match;
+                    if (info->opcode == MVM_OP_decont && (ss->facts[source].flags & FACT_CONCRETE) &&
+                            st->container_spec)
+                        break;
+                    ss->facts[target].flags = ss->facts[source].flags;
+                    ss->facts[target].guard = ss->facts[source].guard;
+                }
+                break;
+        }
+
+        pos += size;
+    }
+}
+
+/* Looks up the facts for a register read at the given position, if they
+ * are valid there. */
+static RegFact * known_at(SpeshState *ss, MVMuint16 reg, MVMuint32 pos) {
+    RegFact *fact = &ss->facts[reg];
+    return (fact->flags & FACT_KNOWN_TYPE) && pos > fact->def_offset ? fact : NULL;
+}
+
+/* Adds something to the spesh slots, returning its index. */
+static MVMuint16 add_slot(SpeshState *ss, MVMCollectable *c) {
+    MVMuint32 i;
+    for (i = 0; i < ss->num_slots; i++)
+        if (ss->slots[i] == c)
+            return i;
+    if (ss->num_slots == ss->alloc_slots) {
+        ss->alloc_slots = ss->alloc_slots ? ss->alloc_slots * 2 : 8;
+        ss->slots = realloc(ss->slots, ss->alloc_slots * sizeof(MVMCollectable *));
+    }
+    ss->slots[ss->num_slots] = c;
+    return ss->num_slots++;
+}
+
+/* Rewrites an instruction to load a spesh slot, padding out any space left
+ * over with no_op. */
+static void rewrite_to_slot(SpeshState *ss, MVMuint32 pos, MVMuint32 size, MVMCollectable *c) {
+    MVMuint32 pad;
+    GET_UI16(ss->bc, pos)     = MVM_OP_sp_getspeshslot;
+    GET_UI16(ss->bc, pos + 4) = add_slot(ss, c);
+    for (pad = pos + 6; pad < pos + size; pad += 2)
+        GET_UI16(ss->bc, pad) = MVM_OP_no_op;
+}
+
+/* Walks the bytecode, rewriting instructions that we have facts to be able
+ * to specialize. */
+static void rewrite(SpeshState *ss) {
+    MVMuint32 pos = 0;
+    while (pos < ss->bc_size) {
+        const MVMOpInfo *info;
+        MVMuint32 size = instruction_size(ss, pos, &info);
+        RegFact  *fact;
+
+        switch (info->opcode) {
+            case MVM_OP_decont:
+                if ((fact = known_at(ss, GET_UI16(ss->bc, pos + 4), pos))) {
+                    MVMSTable *st = ss->guards[fact->guard].match;
+                    if ((fact->flags & FACT_TYPEOBJ) || !st->container_spec) {
+                        GET_UI16(ss->bc, pos) = MVM_OP_set;
+                        ss->guard_used[fact->guard] = 1;
+                        ss->num_rewrites++;
+                    }
+                }
+                break;
+            case MVM_OP_isconcrete:
+                if ((fact = known_at(ss, GET_UI16(ss->bc, pos + 4), pos))) {
+                    GET_UI16(ss->bc, pos)    = MVM_OP_const_i64_16;
+                    GET_I16(ss->bc, pos + 4) = fact->flags & FACT_CONCRETE ? 1 : 0;
+                    ss->guard_used[fact->guard] = 1;
+                    ss->num_rewrites++;
+                }
+                break;
+            case MVM_OP_getwhat:
+                if ((fact = known_at(ss, GET_UI16(ss->bc, pos + 4), pos))) {
+                    MVMSTable *st = ss->guards[fact->guard].match;
+                    rewrite_to_slot(ss, pos, size, (MVMCollectable *)st->WHAT);
+                    ss->guard_used[fact->guard] = 1;
+                    ss->num_rewrites++;
+                }
+                break;
+            case MVM_OP_findmeth:
+                if ((fact = known_at(ss, GET_UI16(ss->bc, pos + 4), pos))) {
+                    MVMSpeshGuard *guard = &ss->guards[fact->guard];
+                    MVMObject     *cache = guard->match->method_cache;
+                    if (cache && IS_CONCRETE(cache)) {
+                        MVMString *name = ss->cu->body.strings[GET_UI32(ss->bc, pos + 6)];
+                        MVMObject *meth = MVM_repr_at_key_o(ss->tc, cache, name);
+                        if (meth) {
+                            rewrite_to_slot(ss, pos, size, (MVMCollectable *)meth);
+                            guard->method_cache = cache;
+                            ss->guard_used[fact->guard] = 1;
+                            ss->num_rewrites++;
+                        }
+                    }
+                }
+                break;
+        }
+
+        pos += size;
+    }
+}
+
+/* Gets the code object that a register is known to hold when it is read at
+ * the given position, if any. This is the case when its single write is in
+ * the straight-line prefix and loads a constant. */
+static MVMObject * known_code_at(SpeshState *ss, MVMuint16 reg, MVMuint32 pos) {
+    MVMuint32 def = ss->facts[reg].def_offset;
+    if (ss->write_counts[reg] != 1 || def >= ss->prefix_end || def >= pos)
+        return NULL;
+    switch (GET_UI16(ss->bc, def)) {
+        case MVM_OP_sp_getspeshslot:
+            return (MVMObject *)ss->slots[GET_UI16(ss->bc, def + 4)];
+        case MVM_OP_getcode:
+            return ss->cu->body.coderefs[GET_UI16(ss->bc, def + 4)];
+        default:
+            return NULL;
+    }
+}
+
+/* Checks if an instruction may appear in the body of an inlined frame. We
+ * only allow things that neither look at the frame they run in nor transfer
+ * control anywhere. */
+static MVMint32 is_inlinable(MVMuint16 opcode) {
+    switch (opcode) {
+        case MVM_OP_no_op:
+        case MVM_OP_set:
+        case MVM_OP_decont:
+        case MVM_OP_null:
+        case MVM_OP_null_s:
+        case MVM_OP_wval:
+        case MVM_OP_wval_wide:
+        case MVM_OP_getwhat:
+        case MVM_OP_isconcrete:
+        case MVM_OP_getattr_i:
+        case MVM_OP_getattr_n:
+        case MVM_OP_getattr_s:
+        case MVM_OP_getattr_o:
+        case MVM_OP_bindattr_i:
+        case MVM_OP_bindattr_n:
+        case MVM_OP_bindattr_s:
+        case MVM_OP_bindattr_o:
+        case MVM_OP_const_i64:
+        case MVM_OP_const_i64_16:
+        case MVM_OP_const_n64:
+        case MVM_OP_const_s:
+        case MVM_OP_add_i:
+        case MVM_OP_sub_i:
+        case MVM_OP_mul_i:
+        case MVM_OP_neg_i:
+        case MVM_OP_not_i:
+        case MVM_OP_add_n:
+        case MVM_OP_sub_n:
+        case MVM_OP_mul_n:
+        case MVM_OP_neg_n:
+        case MVM_OP_eq_i:
+        case MVM_OP_ne_i:
+        case MVM_OP_lt_i:
+        case MVM_OP_le_i:
+        case MVM_OP_gt_i:
+        case MVM_OP_ge_i:
+        case MVM_OP_eq_n:
+        case MVM_OP_ne_n:
+        case MVM_OP_lt_n:
+        case MVM_OP_le_n:
+        case MVM_OP_gt_n:
+        case MVM_OP_ge_n:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* Checks that a static frame can be inlined for a call with the given
+ * callsite and invoke instruction, filling out the details of its return
+ * instruction if so. The body must be a straight line of instructions that
+ * we know to be safe to inline, ending in a return that matches the kind
+ * of invoke; parameters must be required positionals whose types exactly
+ * match the callsite, so that binding them is just a register copy. */
+static MVMint32 can_inline(SpeshState *ss, MVMStaticFrame *callee, MVMCallsite *cs, InlineCall *ic) {
+    MVMStaticFrameBody *cfb = &callee->body;
+    MVMuint8  *written;
+    MVMuint32  pos = 0;
+    MVMint32   ok  = 1;
+    MVMint32   returns = 0;
+
+    if (callee == ss->sf || !cfb->invoked || cfb->cu != ss->cu || cfb->num_handlers ||
+            cfb->has_exit_handler || cfb->bytecode_size > MVM_SPESH_INLINE_MAX_SIZE ||
+            ss->num_locals + cfb->num_locals > 0xFFFF)
+        return 0;
+
+    /* We track the registers written so far, so as to refuse bodies that
+     * read a register before writing it; when inlined, such a register may
+     * hold a value left over from a previous execution of the body. */
+    written = calloc(cfb->num_locals ? cfb->num_locals : 1, 1);
+    while (ok && pos < cfb->bytecode_size) {
+        const MVMOpInfo *info;
+        MVMuint32 size = bytecode_instruction_size(ss, cfb->bytecode, pos, &info);
+        MVMuint32 operand_pos = pos + 2;
+        MVMuint16 opcode;
+        MVMuint32 i;
+        if (!size) {
+            ok = 0;
+            break;
+        }
+        opcode = info->opcode;
+
+        switch (opcode) {
+            case MVM_OP_checkarity:
+                if (cs->num_pos < GET_UI16(cfb->bytecode, pos + 2) ||
+                        cs->num_pos > GET_UI16(cfb->bytecode, pos + 4))
+                    ok = 0;
+                break;
+            case MVM_OP_paramnamesused:
+                break;
+            case MVM_OP_param_rp_i:
+            case MVM_OP_param_rp_n:
+            case MVM_OP_param_rp_s:
+            case MVM_OP_param_rp_o: {
+                static const MVMuint8 wanted[] = {
+                    MVM_CALLSITE_ARG_INT, MVM_CALLSITE_ARG_NUM,
+                    MVM_CALLSITE_ARG_STR, MVM_CALLSITE_ARG_OBJ
+                };
+                MVMuint16 idx = GET_UI16(cfb->bytecode, pos + 4);
+                if (idx >= cs->num_pos ||
+                        (cs->arg_flags[idx] & MVM_CALLSITE_ARG_MASK) != wanted[opcode - MVM_OP_param_rp_i])
+                    ok = 0;
+                break;
+            }
+            case MVM_OP_return_i:
+            case MVM_OP_return_n:
+            case MVM_OP_return_s:
+            case MVM_OP_return_o:
+            case MVM_OP_return:
+                /* Must be the last instruction, and give the invoke what it
+                 * wants (an invoke_v is happy with anything). */
+                if (pos + size != cfb->bytecode_size)
+                    ok = 0;
+                else if (ic->invoke_op != MVM_OP_invoke_v &&
+                        opcode - MVM_OP_return_i != ic->invoke_op - MVM_OP_invoke_i)
+                    ok = 0;
+                returns = 1;
+                ic->ret_pos = pos;
+                ic->ret_reg = opcode == MVM_OP_return ? 0 : GET_UI16(cfb->bytecode, pos + 2);
+                break;
+            default:
+                if (!is_inlinable(opcode))
+                    ok = 0;
+        }
+
+        for (i = 0; ok && i < info->num_operands; i++) {
+            MVMuint8 flags = info->operands[i];
+            if ((flags & MVM_operand_rw_mask) == MVM_operand_read_reg &&
+                    !written[GET_UI16(cfb->bytecode, operand_pos)])
+                ok = 0;
+            operand_pos += MVM_spesh_operand_size(ss->tc, flags);
+        }
+        operand_pos = pos + 2;
+        for (i = 0; ok && i < info->num_operands; i++) {
+            MVMuint8 flags = info->operands[i];
+            if ((flags & MVM_operand_rw_mask) == MVM_operand_write_reg)
+                written[GET_UI16(cfb->bytecode, operand_pos)] = 1;
+            operand_pos += MVM_spesh_operand_size(ss->tc, flags);
+        }
+
+        pos += size;
+    }
+    free(written);
+
+    return ok && returns;
+}
+
+/* Looks at the call sequence starting with the prepargs at the given
+ * position, and records it as a call to inline if we can. */
+static void consider_call(SpeshState *ss, MVMuint32 start) {
+    MVMStaticFrameBody *sfb    = &ss->sf->body;
+    MVMuint8           *labels = sfb->instr_offsets;
+    MVMCallsite        *cs     = ss->cu->body.callsites[GET_UI16(ss->bc, start + 2)];
+    InlineCall         *ic     = &ss->inlines[ss->num_inlines];
+    MVMuint32           pos    = start + 4;
+    MVMuint32           seen   = 0;
+    MVMuint16           code_reg;
+    MVMObject          *code;
+    MVMuint32           i;
+
+    if (cs->arg_count != cs->num_pos || cs->has_flattening || cs->num_pos > INLINE_MAX_ARGS)
+        return;
+
+    /* Collect the argument registers; the sequence must set up all of the
+     * arguments and then invoke, with nothing jumping into the middle. */
+    while (pos < ss->bc_size) {
+        MVMuint16 opcode = GET_UI16(ss->bc, pos);
+        MVMuint16 idx;
+        if (opcode != MVM_OP_arg_i && opcode != MVM_OP_arg_n &&
+                opcode != MVM_OP_arg_s && opcode != MVM_OP_arg_o)
+            break;
+        idx = GET_UI16(ss->bc, pos + 2);
+        if ((labels[pos] & MVM_BC_branch_target) || idx >= cs->num_pos || (seen & (1 << idx)))
+            return;
+        seen |= 1 << idx;
+        ic->arg_regs[idx] = GET_UI16(ss->bc, pos + 4);
+        pos += 6;
+    }
+    if (pos >= ss->bc_size || seen != (1u << cs->num_pos) - 1 || (labels[pos] & MVM_BC_branch_target))
+        return;
+    ic->invoke_op = GET_UI16(ss->bc, pos);
+    switch (ic->invoke_op) {
+        case MVM_OP_invoke_v:
+            code_reg     = GET_UI16(ss->bc, pos + 2);
+            ic->call_end = pos + 4;
+            break;
+        case MVM_OP_invoke_i:
+        case MVM_OP_invoke_n:
+        case MVM_OP_invoke_s:
+        case MVM_OP_invoke_o:
+            ic->res_reg  = GET_UI16(ss->bc, pos + 2);
+            code_reg     = GET_UI16(ss->bc, pos + 4);
+            ic->call_end = pos + 6;
+            break;
+        default:
+            return;
+    }
+    ic->call_start = start;
+
+    /* The inlined body lives outside of the region covered by any handler,
+     * so the call must not be covered by one either. Handler ends are
+     * inclusive, and while the callee runs our pc is call_end. */
+    for (i = 0; i < sfb->num_handlers; i++) {
+        MVMFrameHandler *fh = &sfb->handlers[i];
+        if (fh->start_offset <= ic->call_end && fh->end_offset >= start)
+            return;
+        if (fh->goto_offset > start && fh->goto_offset < ic->call_end)
+            return;
+    }
+
+    /* We need to know what we're calling, and be able to inline it. */
+    code = known_code_at(ss, code_reg, pos);
+    if (!code || !IS_CONCRETE(code) || REPR(code)->ID != MVM_REPR_ID_MVMCode ||
+            ((MVMCode *)code)->body.is_compiler_stub)
+        return;
+    ic->code = code;
+    ic->sf   = ((MVMCode *)code)->body.sf;
+    if (!can_inline(ss, ic->sf, cs, ic))
+        return;
+
+    ic->base = ss->num_locals;
+    ss->num_locals += ic->sf->body.num_locals;
+    ss->num_inlines++;
+}
+
+/* Finds calls that we can inline. */
+static void find_inlines(SpeshState *ss) {
+    MVMuint32 pos = 0;
+    MVMuint16 last_op = MVM_OP_no_op;
+    while (pos < ss->bc_size) {
+        const MVMOpInfo *info;
+        MVMuint32 size = instruction_size(ss, pos, &info);
+        if (info->opcode == MVM_OP_prepargs && ss->num_inlines < MVM_SPESH_MAX_INLINES)
+            consider_call(ss, pos);
+        last_op = info->opcode;
+        pos += size;
+    }
+
+    /* The inlined bodies go after the end of the bytecode, so it had better
+     * not be possible to run off the end of it into them. */
+    if (last_op != MVM_OP_goto && last_op != MVM_OP_return && last_op != MVM_OP_return_i &&
+            last_op != MVM_OP_return_n && last_op != MVM_OP_return_s && last_op != MVM_OP_return_o) {
+        ss->num_inlines = 0;
+        ss->num_locals  = ss->sf->body.num_locals;
+    }
+}
+
+/* Marks the instruction boundaries of a region of the specialized bytecode. */
+static void mark_boundaries(SpeshState *ss, MVMuint32 from, MVMuint32 to) {
+    while (from < to) {
+        const MVMOpInfo *info;
+        ss->labels[from] |= MVM_BC_op_boundary;
+        from += instruction_size(ss, from, &info);
+    }
+}
+
+/* Inlines the calls we decided to inline. Each call sequence is replaced by
+ * a goto to a copy of the callee's body placed after the end of the caller's
+ * bytecode, with the callee's registers renumbered to come after those of
+ * the caller, its parameters bound by copying from the argument registers,
+ * and its return turned into a copy to the result register and a goto back
+ * to after the call sequence. Apart from that, the copy of the body has the
+ * same layout as the callee's bytecode, which lets us map back to it. */
+static void apply_inlines(SpeshState *ss) {
+    MVMStaticFrameBody *sfb      = &ss->sf->body;
+    MVMuint32           new_size = ss->bc_size;
+    MVMuint32           i;
+
+    for (i = 0; i < ss->num_inlines; i++) {
+        InlineCall *ic = &ss->inlines[i];
+        ic->start = new_size;
+        new_size += ic->ret_pos + (ic->invoke_op == MVM_OP_invoke_v ? 0 : 6) + 6;
+        ic->end   = new_size;
+    }
+    ss->bc          = realloc(ss->bc, new_size);
+    ss->labels      = calloc(new_size, 1);
+    ss->local_types = malloc(ss->num_locals * sizeof(MVMuint16));
+    memcpy(ss->labels, sfb->instr_offsets, ss->bc_size);
+    memcpy(ss->local_types, sfb->local_types, sfb->num_locals * sizeof(MVMuint16));
+
+    for (i = 0; i < ss->num_inlines; i++) {
+        InlineCall         *ic  = &ss->inlines[i];
+        MVMStaticFrameBody *cfb = &ic->sf->body;
+        MVMuint8           *bc  = ss->bc + ic->start;
+        MVMuint32           pos = 0;
+        MVMuint32           pad;
+
+        memcpy(ss->local_types + ic->base, cfb->local_types, cfb->num_locals * sizeof(MVMuint16));
+
+        /* Replace the call sequence with a goto to the inlined body. */
+        GET_UI16(ss->bc, ic->call_start)     = MVM_OP_goto;
+        GET_UI32(ss->bc, ic->call_start + 2) = ic->start;
+        for (pad = ic->call_start + 6; pad < ic->call_end; pad += 2)
+            GET_UI16(ss->bc, pad) = MVM_OP_no_op;
+        memset(ss->labels + ic->call_start + 1, 0, ic->call_end - ic->call_start - 1);
+        mark_boundaries(ss, ic->call_start, ic->call_end);
+        ss->labels[ic->call_end] |= MVM_BC_branch_target;
+
+        /* Copy in the body, renumbering registers and binding parameters. */
+        memcpy(bc, cfb->bytecode, ic->ret_pos);
+        while (pos < ic->ret_pos) {
+            const MVMOpInfo *info;
+            MVMuint32 size = bytecode_instruction_size(ss, bc, pos, &info);
+            MVMuint32 operand_pos = pos + 2;
+            MVMuint32 j;
+            for (j = 0; j < info->num_operands; j++) {
+                MVMuint8 rw = info->operands[j] & MVM_operand_rw_mask;
+                if (rw == MVM_operand_read_reg || rw == MVM_operand_write_reg)
+                    GET_UI16(bc, operand_pos) += ic->base;
+                operand_pos += MVM_spesh_operand_size(ss->tc, info->operands[j]);
+            }
+            switch (info->opcode) {
+                case MVM_OP_checkarity:
+                case MVM_OP_paramnamesused:
+                    for (pad = pos; pad < pos + size; pad += 2)
+                        GET_UI16(bc, pad) = MVM_OP_no_op;
+                    break;
+                case MVM_OP_param_rp_i:
+                case MVM_OP_param_rp_n:
+                case MVM_OP_param_rp_s:
+                case MVM_OP_param_rp_o:
+                    GET_UI16(bc, pos)     = MVM_OP_set;
+                    GET_UI16(bc, pos + 4) = ic->arg_regs[GET_UI16(bc, pos + 4)];
+                    break;
+            }
+            pos += size;
+        }
+        if (ic->invoke_op != MVM_OP_invoke_v) {
+            GET_UI16(bc, pos)     = MVM_OP_set;
+            GET_UI16(bc, pos + 2) = ic->res_reg;
+            GET_UI16(bc, pos + 4) = ic->base + ic->ret_reg;
+            pos += 6;
+        }
+        GET_UI16(bc, pos)     = MVM_OP_goto;
+        GET_UI32(bc, pos + 2) = ic->call_end;
+
+        mark_boundaries(ss, ic->start, ic->end);
+        ss->labels[ic->start] |= MVM_BC_branch_target;
+    }
+
+    ss->bc_size = new_size;
+}
+
+/* Checks if the shape of two callsites is the same. */
+static MVMuint16 flag_count(MVMCallsite *cs) {
+    return cs->num_pos + (cs->arg_count - cs->num_pos) / 2;
+}
+static MVMint32 callsite_matches(MVMCallsite *want, MVMCallsite *got) {
+    return want == got || (
+        want->arg_count == got->arg_count &&
+        want->num_pos == got->num_pos &&
+        want->has_flattening == got->has_flattening &&
+        memcmp(want->arg_flags, got->arg_flags, flag_count(want)) == 0);
+}
+
+/* Checks if the guards of a specialization are satisfied by the args. */
+static MVMint32 guards_match(MVMSpeshCandidate *cand, MVMRegister *args) {
+    MVMuint32 i;
+    for (i = 0; i < cand->num_guards; i++) {
+        MVMSpeshGuard *guard = &cand->guards[i];
+        MVMObject     *arg   = args[guard->slot].o;
+        if (!arg || STABLE(arg) != guard->match)
+            return 0;
+        if ((guard->kind == MVM_SPESH_GUARD_CONC) != (IS_CONCRETE(arg) ? 1 : 0))
+            return 0;
+        if (guard->method_cache && guard->match->method_cache != guard->method_cache)
+            return 0;
+    }
+    return 1;
+}
+
+/* Tries to produce a specialization of the static frame for the argument
+ * types of the current call. Returns NULL if there was nothing worth
+ * specializing. */
+static MVMSpeshCandidate * generate(MVMThreadContext *tc, MVMStaticFrame *sf,
+                                    MVMCallsite *callsite, MVMRegister *args) {
+    MVMStaticFrameBody *sfb  = &sf->body;
+    MVMSpeshCandidate  *cand = NULL;
+    SpeshState ss;
+    MVMuint32  i;
+
+    /* Set up specialization state, with a potential guard for each of the
+     * positional object arguments. */
+    memset(&ss, 0, sizeof(SpeshState));
+    ss.tc           = tc;
+    ss.sf           = sf;
+    ss.cu           = sfb->cu;
+    ss.bc_size      = sfb->bytecode_size;
+    ss.bc           = malloc(ss.bc_size);
+    ss.write_counts = calloc(sfb->num_locals ? sfb->num_locals : 1, sizeof(MVMuint32));
+    ss.facts        = calloc(sfb->num_locals ? sfb->num_locals : 1, sizeof(RegFact));
+    ss.num_guards   = callsite->num_pos;
+    ss.guards       = calloc(ss.num_guards ? ss.num_guards : 1, sizeof(MVMSpeshGuard));
+    ss.guard_used   = calloc(ss.num_guards ? ss.num_guards : 1, 1);
+    ss.num_locals   = sfb->num_locals;
+    memcpy(ss.bc, sfb->bytecode, ss.bc_size);
+    for (i = 0; i < ss.num_guards; i++) {
+        if (callsite->arg_flags[i] & MVM_CALLSITE_ARG_OBJ) {
+            MVMObject *arg = args[i].o;
+            if (arg) {
+                ss.guards[i].kind  = IS_CONCRETE(arg) ? MVM_SPESH_GUARD_CONC : MVM_SPESH_GUARD_TYPE;
+                ss.guards[i].slot  = i;
+                ss.guards[i].match = STABLE(arg);
+            }
+        }
+    }
+
+    /* Analyze and specialize. */
+    if (analyze_writes(&ss)) {
+        establish_facts(&ss);
+        rewrite(&ss);
+        find_inlines(&ss);
+        if (ss.num_inlines) {
+            apply_inlines(&ss);
+            ss.num_rewrites += ss.num_inlines;
+        }
+    }
+
+    /* If we specialized anything, build the candidate. */
+    if (ss.num_rewrites) {
+        MVMuint16 num_flags = flag_count(callsite);
+        MVMuint32 num_used  = 0;
+
+        cand = malloc(sizeof(MVMSpeshCandidate));
+        cand->cs            = malloc(sizeof(MVMCallsite));
+        memcpy(cand->cs, callsite, sizeof(MVMCallsite));
+        cand->cs->arg_flags     = num_flags ? malloc(num_flags) : NULL;
+        cand->cs->with_invocant = NULL;
+        cand->cs->named_plan    = NULL;
+        if (num_flags)
+            memcpy(cand->cs->arg_flags, callsite->arg_flags, num_flags);
+
+        for (i = 0; i < ss.num_guards; i++)
+            if (ss.guard_used[i])
+                num_used++;
+        cand->num_guards = num_used;
+        cand->guards     = malloc((num_used ? num_used : 1) * sizeof(MVMSpeshGuard));
+        num_used = 0;
+        for (i = 0; i < ss.num_guards; i++)
+            if (ss.guard_used[i])
+                cand->guards[num_used++] = ss.guards[i];
+
+        cand->num_spesh_slots = ss.num_slots;
+        cand->spesh_slots     = ss.slots;
+        cand->bytecode        = ss.bc;
+        cand->bytecode_size   = ss.bc_size;
+        cand->jit_code        = NULL;
+        cand->superinstr_bytecode = tc->instance->superinstr_enabled
+            ? MVM_superinstr_fuse(tc, ss.cu, ss.bc, ss.bc_size)
+            : NULL;
+
+        /* If we inlined nothing, the labels and locals are just those of
+         * the static frame. */
+        if (!ss.labels) {
+            ss.labels = malloc(ss.bc_size);
+            memcpy(ss.labels, sfb->instr_offsets, ss.bc_size);
+        }
+        if (!ss.local_types) {
+            ss.local_types = malloc((ss.num_locals ? ss.num_locals : 1) * sizeof(MVMuint16));
+            memcpy(ss.local_types, sfb->local_types, ss.num_locals * sizeof(MVMuint16));
+        }
+        cand->instr_offsets = ss.labels;
+        cand->local_types   = ss.local_types;
+        cand->num_locals    = ss.num_locals;
+        cand->work_size     = sizeof(MVMRegister) * (ss.num_locals + ss.cu->body.max_callsite_size);
+
+        cand->num_inlines = ss.num_inlines;
+        cand->inlines     = ss.num_inlines ? malloc(ss.num_inlines * sizeof(MVMSpeshInline)) : NULL;
+        for (i = 0; i < ss.num_inlines; i++) {
+            cand->inlines[i].code          = ss.inlines[i].code;
+            cand->inlines[i].sf            = ss.inlines[i].sf;
+            cand->inlines[i].start         = ss.inlines[i].start;
+            cand->inlines[i].end           = ss.inlines[i].end;
+            cand->inlines[i].return_offset = ss.inlines[i].call_end;
+        }
+    }
+    else {
+        MVM_checked_free_null(ss.slots);
+        MVM_checked_free_null(ss.bc);
+        MVM_checked_free_null(ss.labels);
+        MVM_checked_free_null(ss.local_types);
+    }
+
+    free(ss.write_counts);
+    free(ss.facts);
+    free(ss.guards);
+    free(ss.guard_used);
+    return cand;
+}
+
+/* Selects a specialization of the static frame for a call with the given
+ * callsite and arguments, if we have one. Also takes care of producing a
+ * new specialization when the frame gets hot enough. Returns NULL if the
+ * unspecialized bytecode should be used. */
+MVMSpeshCandidate * MVM_spesh_candidate_select(MVMThreadContext *tc, MVMStaticFrame *sf,
+                                               MVMCallsite *callsite, MVMRegister *args) {
+    MVMStaticFrameBody *sfb = &sf->body;
+    MVMuint32 num_cands = sfb->num_spesh_candidates;
+    MVMuint32 i;
+    MVMSpeshCandidate *cand;
+
+    for (i = 0; i < num_cands; i++) {
+        cand = &sfb->spesh_candidates[i];
+        if (callsite_matches(cand->cs, callsite) && guards_match(cand, args))
+            return cand;
+    }
+
+    /* No match. Count the invocation; the count is not kept atomically, as
+     * it is only a heuristic. */
+    if (!tc->instance->spesh_enabled || ++sfb->spesh_invocations < MVM_SPESH_THRESHOLD ||
+            callsite->has_flattening || num_cands >= MVM_SPESH_MAX_CANDIDATES ||
+            sfb->spesh_attempts >= MVM_SPESH_MAX_ATTEMPTS)
+        return NULL;
+    sfb->spesh_invocations = 0;
+
+    /* Try to produce a specialization. We hold the install mutex while doing
+     * so; nothing in here allocates, so we can't end up in the GC holding it. */
+    uv_mutex_lock(&tc->instance->mutex_spesh_install);
+    if (sfb->num_spesh_candidates != num_cands ||
+            sfb->spesh_attempts >= MVM_SPESH_MAX_ATTEMPTS) {
+        /* Another thread got there first. */
+        uv_mutex_unlock(&tc->instance->mutex_spesh_install);
+        return NULL;
+    }
+    sfb->spesh_attempts++;
+    cand = generate(tc, sf, callsite, args);
+    if (cand) {
+        /* Install it, making sure it is all in place before the count is
+         * increased and other threads may see it. */
+        if (!sfb->spesh_candidates)
+            sfb->spesh_candidates = calloc(MVM_SPESH_MAX_CANDIDATES, sizeof(MVMSpeshCandidate));
+        sfb->spesh_candidates[num_cands] = *cand;
+        free(cand);
+        cand = &sfb->spesh_candidates[num_cands];
+        MVM_barrier();
+        sfb->num_spesh_candidates = num_cands + 1;
+
+        /* The static frame may well be in gen2, and now references the
+         * things in the guards and spesh slots. */
+        for (i = 0; i < cand->num_guards; i++) {
+            MVM_gc_write_barrier(tc, (MVMCollectable *)sf, (MVMCollectable *)cand->guards[i].match);
+            MVM_gc_write_barrier(tc, (MVMCollectable *)sf, (MVMCollectable *)cand->guards[i].method_cache);
+        }
+        for (i = 0; i < cand->num_spesh_slots; i++)
+            MVM_gc_write_barrier(tc, (MVMCollectable *)sf, cand->spesh_slots[i]);
+        for (i = 0; i < cand->num_inlines; i++) {
+            MVM_gc_write_barrier(tc, (MVMCollectable *)sf, (MVMCollectable *)cand->inlines[i].code);
+            MVM_gc_write_barrier(tc, (MVMCollectable *)sf, (MVMCollectable *)cand->inlines[i].sf);
+        }
+    }
+    uv_mutex_unlock(&tc->instance->mutex_spesh_install);
+
+    return cand;
+}
+
+/* Adds the things that the specializations of a static frame reference to
+ * the GC worklist. */
+void MVM_spesh_candidate_mark(MVMThreadContext *tc, MVMStaticFrameBody *sfb, MVMGCWorklist *worklist) {
+    MVMuint32 i, j;
+    for (i = 0; i < sfb->num_spesh_candidates; i++) {
+        MVMSpeshCandidate *cand = &sfb->spesh_candidates[i];
+        for (j = 0; j < cand->num_guards; j++) {
+            MVM_gc_worklist_add(tc, worklist, &cand->guards[j].match);
+            MVM_gc_worklist_add(tc, worklist, &cand->guards[j].method_cache);
+        }
+        for (j = 0; j < cand->num_spesh_slots; j++)
+            MVM_gc_worklist_add(tc, worklist, &cand->spesh_slots[j]);
+        for (j = 0; j < cand->num_inlines; j++) {
+            MVM_gc_worklist_add(tc, worklist, &cand->inlines[j].code);
+            MVM_gc_worklist_add(tc, worklist, &cand->inlines[j].sf);
+        }
+    }
+}
+
+/* Finds the inlined frame, if any, that the given offset into the bytecode
+ * of a specialization falls within. */
+MVMSpeshInline * MVM_spesh_inline_at(MVMThreadContext *tc, MVMSpeshCandidate *cand, MVMuint32 offset) {
+    MVMuint32 i;
+    if (cand)
+        for (i = 0; i < cand->num_inlines; i++)
+            if (offset >= cand->inlines[i].start && offset < cand->inlines[i].end)
+                return &cand->inlines[i];
+    return NULL;
+}
+
+/* Frees all of the specializations of a static frame. */
+void MVM_spesh_candidate_destroy_all(MVMThreadContext *tc, MVMStaticFrameBody *sfb) {
+    MVMuint32 i;
+    for (i = 0; i < sfb->num_spesh_candidates; i++) {
+        MVMSpeshCandidate *cand = &sfb->spesh_candidates[i];
+        MVM_checked_free_null(cand->cs->arg_flags);
+        MVM_checked_free_null(cand->cs);
+        MVM_checked_free_null(cand->guards);
+        MVM_checked_free_null(cand->spesh_slots);
+        MVM_checked_free_null(cand->bytecode);
+        MVM_checked_free_null(cand->superinstr_bytecode);
+        MVM_checked_free_null(cand->instr_offsets);
+        MVM_checked_free_null(cand->local_types);
+        MVM_checked_free_null(cand->inlines);
+        MVM_jit_code_destroy(tc, cand->jit_code);
+    }
+    MVM_checked_free_null(sfb->spesh_candidates);
+    sfb->num_spesh_candidates = 0;
+}
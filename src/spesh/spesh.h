@@ -0,0 +1,104 @@
+/* Number of times a static frame must be invoked before we consider
+ * producing a specialized version of its bytecode. */
+#define MVM_SPESH_THRESHOLD         100
+
+/* Maximum number of specializations that we'll produce for a static frame,
+ * and maximum number of times we'll try (and fail) to produce one. */
+#define MVM_SPESH_MAX_CANDIDATES    4
+#define MVM_SPESH_MAX_ATTEMPTS      8
+
+/* Maximum bytecode size of a static frame that we'll inline into a caller,
+ * and maximum number of calls we'll inline into a single specialization. */
+#define MVM_SPESH_INLINE_MAX_SIZE   64
+#define MVM_SPESH_MAX_INLINES       16
+
+/* Kinds of guard that a specialization may have. */
+#define MVM_SPESH_GUARD_CONC        1
+#define MVM_SPESH_GUARD_TYPE        2
+
+/* A guard on a positional argument, which must match for us to be able to
+ * run the specialized bytecode. */
+struct MVMSpeshGuard {
+    /* The kind of guard (concrete instance or type object). */
+    MVMuint16 kind;
+
+    /* The positional argument index that the guard applies to. */
+    MVMuint16 slot;
+
+    /* The STable the argument must have. */
+    MVMSTable *match;
+
+    /* If we resolved method lookups against this type, the method cache
+     * that we resolved them in. Publishing a new method cache on the type
+     * will thus stop the guard from matching. NULL if we did no lookups. */
+    MVMObject *method_cache;
+};
+
+/* A static frame whose bytecode was inlined into a specialization. This is
+ * the deopt information we need to present the inlined frame as if it had
+ * been called when producing backtraces. */
+struct MVMSpeshInline {
+    /* The code object that was called, and its static frame. */
+    MVMObject      *code;
+    MVMStaticFrame *sf;
+
+    /* The region of the specialized bytecode holding the inlined body. An
+     * offset in the region, less start, is the equivalent offset into the
+     * bytecode of the inlined static frame. */
+    MVMuint32 start;
+    MVMuint32 end;
+
+    /* The offset in the caller that the inlined call returns to. */
+    MVMuint32 return_offset;
+};
+
+/* A specialized version of a static frame's bytecode. Up to the size of the
+ * original bytecode, the specialized bytecode always has exactly the same
+ * layout as the original (we only ever replace an instruction with one of
+ * the same size, or a smaller one padded out with no_op), so that handlers,
+ * annotations and instruction offsets of the static frame stay valid for it.
+ * The bodies of any inlined calls are placed after that. */
+struct MVMSpeshCandidate {
+    /* The callsite shape that this specialization is for. */
+    MVMCallsite *cs;
+
+    /* Guards on the incoming arguments. */
+    MVMSpeshGuard *guards;
+    MVMuint32      num_guards;
+
+    /* The number of spesh slots, and the slots themselves. These hold the
+     * results of things we resolved while specializing (methods, type
+     * objects) and are read by the sp_getspeshslot instruction. */
+    MVMuint32        num_spesh_slots;
+    MVMCollectable **spesh_slots;
+
+    /* The specialized bytecode, its size and its instruction boundaries. */
+    MVMuint8  *bytecode;
+    MVMuint32  bytecode_size;
+    MVMuint8  *instr_offsets;
+
+    /* A copy of the specialized bytecode using superinstructions, which is
+     * what the interpreter runs; NULL if there was nothing to fuse. */
+    MVMuint8  *superinstr_bytecode;
+
+    /* The locals of the specialization; the registers of inlined frames
+     * come after those of the static frame itself. */
+    MVMuint16 *local_types;
+    MVMuint32  num_locals;
+    MVMuint32  work_size;
+
+    /* Static frames that were inlined. */
+    MVMSpeshInline *inlines;
+    MVMuint32       num_inlines;
+
+    /* JIT-compiled code for the specialized bytecode, if any. */
+    MVMJitCode *jit_code;
+};
+
+MVMSpeshCandidate * MVM_spesh_candidate_select(MVMThreadContext *tc, MVMStaticFrame *sf,
+    MVMCallsite *callsite, MVMRegister *args);
+void MVM_spesh_candidate_mark(MVMThreadContext *tc, MVMStaticFrameBody *sfb, MVMGCWorklist *worklist);
+MVMSpeshInline * MVM_spesh_inline_at(MVMThreadContext *tc, MVMSpeshCandidate *cand, MVMuint32 offset);
+void MVM_spesh_candidate_destroy_all(MVMThreadContext *tc, MVMStaticFrameBody *sfb);
+const MVMOpInfo * MVM_spesh_get_op_info(MVMThreadContext *tc, MVMCompUnit *cu, MVMuint16 opcode);
+MVMuint32 MVM_spesh_operand_size(MVMThreadContext *tc, MVMuint8 flags);
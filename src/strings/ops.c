@@ -1,14 +1,9 @@
 #include "moar.h"
 
 /*  TODO:
-- add a tunable global determining at what depth it should
-    start flattening.  Write a rope-tree-flattening function
-    (not like string_flatten) that puts all the sub strands
-    in one MVMStrand array.
-    (optimization)
 - add a tunable global determining under which size result
     string should it just do the old copying behavior, for
-    join, concat, split, and repeat.
+    join, split, and repeat, as concat does.
     This might be related to MVMString object size?
     (optimization)
 - make the uc, lc, tc functions intelligently
@@ -23,6 +18,8 @@ static MVMStrandIndex find_strand_index(MVMString *s, MVMStringIndex index);
  * to find the first starting strand index of the desired substring.
  * Then recursively traverses more strands until the desired number of
  * characters are passed to the consumer function from the strand tree.
+ * top_index is the offset of start from wherever the outermost traversal
+ * began, so consumers can tell where they are however deep the tree is.
  * Both this and the consumer function return a boolean saying whether
  * to abort the traversal early. */
 MVMuint8 MVM_string_traverse_substring(MVMThreadContext *tc, MVMString *a, MVMStringIndex start, MVMStringIndex length, MVMStringIndex top_index, MVMSubstringConsumer consumer, void *data) {
@@ -49,7 +46,7 @@ MVMuint8 MVM_string_traverse_substring(MVMThreadContext *tc, MVMString *a, MVMSt
                 /* call ourself on the sub-strand */
                 return_val = MVM_string_traverse_substring(tc, strand->string,
                     index - strand->compare_offset + strand->string_offset,
-                    substring_length, top_index + index, consumer, data);
+                    substring_length, top_index + (index - start), consumer, data);
                 /* if we've been instructed to, abort early */
                 if (return_val)
                     return return_val;
@@ -73,27 +70,6 @@ MVMuint8 MVM_string_traverse_substring(MVMThreadContext *tc, MVMString *a, MVMSt
     MVM_exception_throw_adhoc(tc, "internal string corruption");
 }
 
-/* stack record created with each invocation of the string descent. */
-typedef struct CompareCursor {
-    MVMString *string; /* string into which descended */
-    struct CompareCursor *parent; /* parent cursor */
-    MVMint16 *gaps; /* number of gaps can ascend */
-    MVMStringIndex string_idx; /* in string, not strand */
-    MVMStringIndex end_idx; /* index past last codepoint needed */
-    MVMStrandIndex strand_idx; /* current strand index */
-    MVMuint8 owns_buffer; /* whether it owns the last buffer.
-            for ropes, whether it's uninitialized. */
-    MVMuint8 isa; /* whether it's from string tree a */
-} CompareCursor;
-
-typedef struct {
-    CompareCursor *cursora, *cursorb; /* cursors */
-    MVMCodepoint32 *int32s; /* last physical string's buffer */
-    MVMCodepoint8 *uint8s; /* last physical string's buffer */
-    MVMStringIndex available; /* number of codepoints in the buffer */
-    MVMStringIndex needed; /* number of codepoints still needed */
-} CompareDescentState;
-
 /* uses the computed binary search table to find the strand containing the index */
 static MVMStrandIndex find_strand_index(MVMString *s, MVMStringIndex index) {
     MVMStrand *strands = s->body.strands;
@@ -107,138 +83,58 @@ static MVMStrandIndex find_strand_index(MVMString *s, MVMStringIndex index) {
     }
 }
 
-#define descend_sized_chew_success(member, other_member) \
-st->needed -= tocompare; \
-if (!st->needed) { \
-    *result = 2; \
-    return; \
-} \
-else if (wehave > tocompare) { \
-    st->member = c->string->body.member + c->string_idx + tocompare; \
-    st->available = wehave - tocompare; \
-    c->owns_buffer = 1; \
-    st->other_member = NULL; \
-} \
-else { \
-    st->other_member += tocompare; \
-    st->available -= tocompare; \
-} \
-
-#define descend_sized(member, other_member, size, other_size, cp, other_cp) \
-MVMStringIndex wehave = c->end_idx - c->string_idx; \
-if (st->available) { \
-    MVMStringIndex tocompare = st->available < wehave ? st->available : wehave; \
-    if (st->member) { \
-        if (memcmp(st->member, c->string->body.member + c->string_idx, \
-               wehave * sizeof(size))) { \
-            *result = 1; \
-            return; \
-        } \
-        descend_sized_chew_success(member, other_member) \
-    } \
-    else { \
-        size \
-            *cp = c->string->body.member + c->string_idx, \
-            *final = cp + tocompare; \
-        other_size *other_cp = st->other_member; \
-        for (; cp < final; ) { \
-            if (*cp32++ != (MVMCodepoint32) *cp8++) { \
-                *result = 1; \
-                return; \
-            } \
-        } \
-        descend_sized_chew_success(other_member, member) \
-    } \
-    if (c->isa) { st->cursora = c->parent; } \
-    else { st->cursorb = c->parent; } \
-    return; \
-} \
-st->member = c->string->body.member + c->string_idx; \
-st->other_member = NULL; \
-st->available = wehave; \
-c->owns_buffer = 1; \
-continue;
-
-/* If a is composed of strands, create a descent record, initialize it, and
- * descend into the substring. If result is set when it returns, return.
- * If a is a real string, grab some codepoints from a string, compare
- * with codepoints from the other buffer. If different, set result nonzero and
- * it will fast return. Otherwise, reset buffer indexes
- * to zero. Loop if `needed` for the current string is nonzero. */
-static void compare_descend(MVMThreadContext *tc, CompareDescentState *st,
-        MVMuint8 *result, CompareCursor *orig) {
-    /* while we still need to compare some things */
-    while (st->needed) {
-        /* pick a tree from which to get more characters. */
-        CompareCursor *c = st->cursora->owns_buffer ? st->cursorb : st->cursora;
-
-        if (*c->gaps) {
-            (*c->gaps)--;
-            if (c->isa) { st->cursora = c->parent; }
-            else { st->cursorb = c->parent; }
-            return;
-        }
+typedef struct {
+    MVMString      *other;       /* the string being compared against */
+    MVMStringIndex  other_start; /* where in it the comparison starts */
+    MVMString      *chunk;       /* a flat piece of the first string */
+    MVMStringIndex  chunk_start; /* where in that the piece starts */
+} EqualState;
+
+#define equal_chunks(member, other_member, size, other_size) { \
+    size *x = state->chunk->body.member + state->chunk_start + top_index; \
+    other_size *y = string->body.other_member + start; \
+    MVMStringIndex i; \
+    for (i = 0; i < length; i++) \
+        if ((MVMCodepoint32)x[i] != (MVMCodepoint32)y[i]) \
+            return 1; \
+    return 0; \
+}
 
-        /* get some characters, comparing as they're found */
-        switch(STR_FLAGS(c->string)) {
-            case MVM_STRING_TYPE_INT32: {
-                descend_sized(int32s, uint8s, MVMCodepoint32, MVMCodepoint8, cp32, cp8)
-            }
-            case MVM_STRING_TYPE_UINT8: {
-                descend_sized(uint8s, int32s, MVMCodepoint8, MVMCodepoint32, cp8, cp32)
-            }
-            case MVM_STRING_TYPE_ROPE: {
-                MVMStrand *strand;
-                MVMStringIndex next_compare_offset, child_length, child_idx, child_end_idx;
-                if (c->owns_buffer) { /* first time we've seen this rope */
-                    c->strand_idx = find_strand_index(c->string, c->string_idx);
-                    c->owns_buffer = 0;
-                }
-                if (c->string_idx == c->end_idx) {
-                    if (c->isa) { st->cursora = c->parent; }
-                    else { st->cursorb = c->parent; }
-                    if (orig == c)
-                        return;
-                    (*c->gaps)++;
-                    continue;
-                }
-                strand = c->string->body.strands + c->strand_idx;
-                child_idx = c->string_idx - strand->compare_offset;
-                next_compare_offset = (strand + 1)->compare_offset;
-                child_length = next_compare_offset - strand->compare_offset;
-                child_length = child_length > c->end_idx - c->string_idx
-                    ? c->end_idx - c->string_idx : child_length;
-                child_end_idx = child_idx + child_length;
-                c->string_idx += child_length;
-                c->strand_idx++;
-                {
-                    CompareCursor child = { strand->string, c, c->gaps, child_idx,
-                        child_end_idx, 0, IS_ROPE(strand->string), c->isa };
-                    if (c->isa) { st->cursora = &child; } else { st->cursorb = &child; }
-                    compare_descend(tc, st, result, &child);
-                }
-                if (*result) return;
-                continue;
-            }
-            default:
-                MVM_exception_throw_adhoc(tc, "internal string corruption");
-        }
+/* compares a flat piece of the second string with the matching part of the
+ * current piece of the first; aborts the traversal if they differ */
+static MVM_SUBSTRING_CONSUMER(equal_inner_consumer) {
+    EqualState *state = (EqualState *)data;
+    if (STR_FLAGS(state->chunk) == STR_FLAGS(string)) {
+        size_t bytes = IS_WIDE(string) ? sizeof(MVMCodepoint32) : sizeof(MVMCodepoint8);
+        return memcmp((char *)state->chunk->body.storage + (state->chunk_start + top_index) * bytes,
+            (char *)string->body.storage + start * bytes, length * bytes) ? 1 : 0;
     }
-    *result = 2;
+    if (IS_WIDE(state->chunk))
+        equal_chunks(int32s, uint8s, MVMCodepoint32, MVMCodepoint8)
+    else
+        equal_chunks(uint8s, int32s, MVMCodepoint8, MVMCodepoint32)
+}
+
+/* for each flat piece of the first string, walks the same stretch of the
+ * second, so neither is flattened however the two are split into strands */
+static MVM_SUBSTRING_CONSUMER(equal_outer_consumer) {
+    EqualState *state = (EqualState *)data;
+    state->chunk       = string;
+    state->chunk_start = start;
+    return MVM_string_traverse_substring(tc, state->other,
+        state->other_start + top_index, length, 0, equal_inner_consumer, state);
 }
 
 /* returns nonzero if two substrings are equal, doesn't check bounds */
 MVMint64 MVM_string_substrings_equal_nocheck(MVMThreadContext *tc, MVMString *a,
         MVMint64 starta, MVMint64 length, MVMString *b, MVMint64 startb) {
-    MVMint16 gapsa = 0, gapsb = 0;
-    MVMuint8 result = 0;
-    CompareCursor
-        cursora = { a, NULL, &gapsa, starta, starta + length, 0, IS_ROPE(a), 1 },
-        cursorb = { b, NULL, &gapsb, startb, startb + length, 0, IS_ROPE(b), 0 };
-    CompareDescentState st = { &cursora, &cursorb, NULL, NULL, 0, length };
-
-    compare_descend(tc, &st, &result, &cursora);
-    return result ? result - 1 : 1;
+    EqualState state;
+    if (!length)
+        return 1;
+    state.other       = b;
+    state.other_start = (MVMStringIndex)startb;
+    return !MVM_string_traverse_substring(tc, a, (MVMStringIndex)starta,
+        (MVMStringIndex)length, 0, equal_outer_consumer, &state);
 }
 
 /* returns the codepoint without doing checks, for internal VM use only. */
@@ -260,10 +156,232 @@ MVMCodepoint32 MVM_string_get_codepoint_at_nocheck(MVMThreadContext *tc, MVMStri
     return 0;
 }
 
+typedef struct {
+    MVMCodepoint32 *buffer;
+    MVMStringIndex  position;
+} GatherState;
+
+/* copies the codepoints of a substring into a 32-bit buffer, in order */
+static MVM_SUBSTRING_CONSUMER(gather_consumer) {
+    GatherState *state = (GatherState *)data;
+    MVMCodepoint32 *buffer = state->buffer + state->position;
+    MVMStringIndex i;
+    switch (STR_FLAGS(string)) {
+        case MVM_STRING_TYPE_INT32:
+            memcpy(buffer, string->body.int32s + start, length * sizeof(MVMCodepoint32));
+            break;
+        case MVM_STRING_TYPE_UINT8:
+            for (i = 0; i < length; i++)
+                buffer[i] = string->body.uint8s[start + i];
+            break;
+        default:
+            MVM_exception_throw_adhoc(tc, "internal string corruption");
+    }
+    state->position += length;
+    return 0;
+}
+
+/* copies length codepoints of s, starting at start, into a 32-bit buffer */
+static void gather_substring(MVMThreadContext *tc, MVMString *s, MVMStringIndex start,
+        MVMStringIndex length, MVMCodepoint32 *buffer) {
+    GatherState state;
+    state.buffer   = buffer;
+    state.position = 0;
+    if (length)
+        MVM_string_traverse_substring(tc, s, start, length, 0, gather_consumer, &state);
+}
+
+static MVMCodepoint32 * gather_codepoints(MVMThreadContext *tc, MVMString *s, MVMStringIndex graphs) {
+    MVMCodepoint32 *buffer = malloc(sizeof(MVMCodepoint32) * (graphs ? graphs : 1));
+    gather_substring(tc, s, 0, graphs, buffer);
+    return buffer;
+}
+
+/* Needles shorter than this are searched for by scanning for their first
+ * character and comparing the rest; longer ones use Horspool's algorithm,
+ * which can skip ahead by up to the length of the needle each time. */
+#define MVM_STRING_SEARCH_SKIP_MIN 4
+
+/* State for searching for a needle in a haystack. Both are made into
+ * contiguous buffers of the same width: flat strings are used in place,
+ * while ropes, and needles that have to be widened or narrowed to match
+ * the haystack, are copied out. The skip table is for Horspool; for wide
+ * strings it's indexed by the low byte of the codepoint, which can only
+ * make some shifts shorter than they might be, never wrong. */
+typedef struct {
+    void           *hay;
+    void           *needle;
+    MVMStringIndex  hgraphs;
+    MVMStringIndex  ngraphs;
+    MVMuint8        wide;
+    MVMuint8        impossible;
+    MVMuint8        free_hay;
+    MVMuint8        free_needle;
+    MVMStringIndex  skip[256];
+} StringSearch;
+
+/* Sets up a search. The caller must have checked that the needle is no
+ * longer than the haystack and not empty. If reverse is set, the skip table
+ * is built for searching backwards, keyed on the first character of the
+ * window rather than the last. */
+static void search_init(MVMThreadContext *tc, StringSearch *s, MVMString *haystack,
+        MVMString *needle, MVMuint8 reverse) {
+    MVMStringIndex i, ng;
+
+    s->hgraphs     = NUM_GRAPHS(haystack);
+    s->ngraphs     = ng = NUM_GRAPHS(needle);
+    s->impossible  = 0;
+    s->free_hay    = 0;
+    s->free_needle = 0;
+
+    if (IS_ROPE(haystack)) {
+        s->hay      = gather_codepoints(tc, haystack, s->hgraphs);
+        s->free_hay = 1;
+        s->wide     = 1;
+    }
+    else {
+        s->hay  = haystack->body.storage;
+        s->wide = IS_WIDE(haystack);
+    }
+
+    if (s->wide ? IS_WIDE(needle) : IS_ASCII(needle)) {
+        s->needle = needle->body.storage;
+    }
+    else {
+        MVMCodepoint32 *cps = gather_codepoints(tc, needle, ng);
+        s->free_needle = 1;
+        if (s->wide) {
+            s->needle = cps;
+        }
+        else {
+            /* a needle with anything wider than 8 bits can't be in an
+             * 8-bit haystack */
+            MVMCodepoint8 *narrow = malloc(ng);
+            for (i = 0; i < ng; i++) {
+                if (cps[i] < 0 || cps[i] > 255) {
+                    s->impossible = 1;
+                    break;
+                }
+                narrow[i] = (MVMCodepoint8)cps[i];
+            }
+            free(cps);
+            s->needle = narrow;
+        }
+    }
+
+    if (ng < MVM_STRING_SEARCH_SKIP_MIN || s->impossible)
+        return;
+    for (i = 0; i < 256; i++)
+        s->skip[i] = ng;
+    if (reverse) {
+        /* shift back so the nearest matching character after the start of
+         * the needle lines up with the one at the start of the window */
+        for (i = ng - 1; i > 0; i--)
+            s->skip[s->wide ? ((MVMCodepoint32 *)s->needle)[i] & 0xFF
+                            : ((MVMCodepoint8 *)s->needle)[i]] = i;
+    }
+    else {
+        /* shift on so the nearest matching character before the end of the
+         * needle lines up with the one at the end of the window */
+        for (i = 0; i < ng - 1; i++)
+            s->skip[s->wide ? ((MVMCodepoint32 *)s->needle)[i] & 0xFF
+                            : ((MVMCodepoint8 *)s->needle)[i]] = ng - 1 - i;
+    }
+}
+
+static void search_cleanup(StringSearch *s) {
+    if (s->free_hay)
+        free(s->hay);
+    if (s->free_needle)
+        free(s->needle);
+}
+
+/* Scans an 8-bit haystack for the first character of the needle with
+ * memchr, which the C library does a word or more at a time. */
+#define search_first_uint8(h, n, from, last) { \
+    MVMCodepoint8 *found = memchr(h + from, n[0], last - from + 1); \
+    if (!found) \
+        break; \
+    from = found - h; \
+}
+
+#define search_first_int32(h, n, from, last) { \
+    while (from <= last && h[from] != n[0]) \
+        from++; \
+    if (from > last) \
+        break; \
+}
+
+#define search_forward(type, first, key) { \
+    type *h = (type *)s->hay, *n = (type *)s->needle; \
+    if (ng < MVM_STRING_SEARCH_SKIP_MIN) { \
+        while (from <= last) { \
+            first(h, n, from, last) \
+            if (!memcmp(h + from + 1, n + 1, (ng - 1) * sizeof(type))) \
+                return (MVMint64)from; \
+            from++; \
+        } \
+    } \
+    else { \
+        while (from <= last) { \
+            type c = h[from + ng - 1]; \
+            if (c == n[ng - 1] && !memcmp(h + from, n, (ng - 1) * sizeof(type))) \
+                return (MVMint64)from; \
+            from += s->skip[key(c)]; \
+        } \
+    } \
+    return -1; \
+}
+
+#define search_backward(type, key) { \
+    type *h = (type *)s->hay, *n = (type *)s->needle; \
+    MVMint64 i = from; \
+    if (ng < MVM_STRING_SEARCH_SKIP_MIN) { \
+        for (; i >= 0; i--) \
+            if (h[i] == n[0] && !memcmp(h + i + 1, n + 1, (ng - 1) * sizeof(type))) \
+                return i; \
+    } \
+    else { \
+        while (i >= 0) { \
+            type c = h[i]; \
+            if (c == n[0] && !memcmp(h + i + 1, n + 1, (ng - 1) * sizeof(type))) \
+                return i; \
+            i -= (MVMint64)s->skip[key(c)]; \
+        } \
+    } \
+    return -1; \
+}
+
+#define search_key_uint8(c) (c)
+#define search_key_int32(c) ((c) & 0xFF)
+
+/* finds the first match at or after from, or -1 */
+static MVMint64 search_next(StringSearch *s, MVMStringIndex from) {
+    MVMStringIndex ng = s->ngraphs, last = s->hgraphs - ng;
+    if (s->impossible)
+        return -1;
+    if (s->wide)
+        search_forward(MVMCodepoint32, search_first_int32, search_key_int32)
+    else
+        search_forward(MVMCodepoint8, search_first_uint8, search_key_uint8)
+}
+
+/* finds the last match at or before from, or -1; from must be no more than
+ * the haystack length minus the needle length. */
+static MVMint64 search_prev(StringSearch *s, MVMStringIndex from) {
+    MVMStringIndex ng = s->ngraphs;
+    if (s->impossible)
+        return -1;
+    if (s->wide)
+        search_backward(MVMCodepoint32, search_key_int32)
+    else
+        search_backward(MVMCodepoint8, search_key_uint8)
+}
+
 /* Returns the location of one string in another or -1  */
 MVMint64 MVM_string_index(MVMThreadContext *tc, MVMString *haystack, MVMString *needle, MVMint64 start) {
-    MVMint64 result = -1;
-    size_t index    = (size_t)start;
+    MVMint64 result;
+    StringSearch search;
     MVMStringIndex hgraphs = NUM_GRAPHS(haystack), ngraphs = NUM_GRAPHS(needle);
 
     if (!IS_CONCRETE((MVMObject *)haystack)) {
@@ -285,21 +403,17 @@ MVMint64 MVM_string_index(MVMThreadContext *tc, MVMString *haystack, MVMString *
 
     if (ngraphs > hgraphs || ngraphs < 1)
         return -1;
-    /* brute force for now. horrible, yes. halp. */
-    while (index <= hgraphs - ngraphs) {
-        if (MVM_string_substrings_equal_nocheck(tc, needle, 0, ngraphs, haystack, index)) {
-            result = (MVMint64)index;
-            break;
-        }
-        index++;
-    }
+
+    search_init(tc, &search, haystack, needle, 0);
+    result = search_next(&search, (MVMStringIndex)start);
+    search_cleanup(&search);
     return result;
 }
 
 /* Returns the location of one string in another or -1  */
 MVMint64 MVM_string_index_from_end(MVMThreadContext *tc, MVMString *haystack, MVMString *needle, MVMint64 start) {
-    MVMint64 result = -1;
-    size_t index;
+    MVMint64 result;
+    StringSearch search;
     MVMStringIndex hgraphs = NUM_GRAPHS(haystack), ngraphs = NUM_GRAPHS(needle);
 
     if (!IS_CONCRETE((MVMObject *)haystack)) {
@@ -326,15 +440,13 @@ MVMint64 MVM_string_index_from_end(MVMThreadContext *tc, MVMString *haystack, MV
     if (ngraphs > hgraphs || ngraphs < 1)
         return -1;
 
-    index = start;
+    /* a match can't start any later than this */
+    if (start > hgraphs - ngraphs)
+        start = hgraphs - ngraphs;
 
-    /* brute force for now. horrible, yes. halp. */
-    do {
-        if (MVM_string_substrings_equal_nocheck(tc, needle, 0, ngraphs, haystack, index)) {
-            result = (MVMint64)index;
-            break;
-        }
-    } while (index-- > 0);
+    search_init(tc, &search, haystack, needle, 1);
+    result = search_prev(&search, (MVMStringIndex)start);
+    search_cleanup(&search);
     return result;
 }
 
@@ -421,25 +533,195 @@ MVMString * MVM_string_replace(MVMThreadContext *tc, MVMString *original, MVMint
 
     MVM_gc_root_temp_pop_n(tc, 3);
 
-    MVM_string_flatten(tc, result);
+    return result;
+}
+
+/* Makes a single string out of strands i and i + 1 of a rope, which are
+ * length1 and length2 graphemes long. Short ones are copied into a flat
+ * string; longer ones get a two-strand rope over them, so merging pairs
+ * that are about the same size builds up a balanced tree. */
+static MVMString * merge_strands(MVMThreadContext *tc, MVMString *rope, MVMStrandIndex i,
+        MVMStringIndex length1, MVMStringIndex length2) {
+    MVMString *result;
+    MVMStrand *x, *y;
+
+    MVMROOT(tc, rope, {
+        result = (MVMString *)REPR(rope)->allocate(tc, STABLE(rope));
+    });
+
+    /* only look at the strands now, as the GC may have updated them */
+    x = &rope->body.strands[i];
+    y = &rope->body.strands[i + 1];
+    if (length1 + length2 <= MVM_STRING_FLAT_MAX) {
+        if (IS_ASCII(x->string) && IS_ASCII(y->string)) {
+            result->body.uint8s = malloc(length1 + length2);
+            memcpy(result->body.uint8s, x->string->body.uint8s + x->string_offset, length1);
+            memcpy(result->body.uint8s + length1, y->string->body.uint8s + y->string_offset, length2);
+            result->body.flags = MVM_STRING_TYPE_UINT8;
+        }
+        else {
+            result->body.int32s = malloc(sizeof(MVMCodepoint32) * (length1 + length2));
+            gather_substring(tc, x->string, x->string_offset, length1, result->body.int32s);
+            gather_substring(tc, y->string, y->string_offset, length2, result->body.int32s + length1);
+            result->body.flags = MVM_STRING_TYPE_INT32;
+        }
+        result->body.graphs = length1 + length2;
+    }
+    else {
+        MVMStrand *strands = result->body.strands = calloc(sizeof(MVMStrand), 3);
+        strands[0].string = x->string;
+        strands[0].string_offset = x->string_offset;
+        strands[0].compare_offset = 0;
+        strands[1].string = y->string;
+        strands[1].string_offset = y->string_offset;
+        strands[1].compare_offset = length1;
+        strands[2].graphs = length1 + length2;
+        strands[2].strand_depth = (STRAND_DEPTH(x->string) > STRAND_DEPTH(y->string)
+            ? STRAND_DEPTH(x->string) : STRAND_DEPTH(y->string)) + 1;
+        result->body.num_strands = 2;
+        result->body.flags = MVM_STRING_TYPE_ROPE;
+    }
 
     return result;
 }
 
-/* Append one string to another. */
-/* XXX inline parent's strands if it's a rope too? */
+/* Keeps the strands of a rope in check. The longest strand is the peak;
+ * before it, strand lengths should more than double from each to the next,
+ * and after it they should more than halve. Going from left to right, any
+ * strand that breaks that is merged with its neighbour, and the result is
+ * checked again in turn. So appending piece by piece works like a binary
+ * counter at the end of the strands, and prepending like one at the start:
+ * there are only about 2 log(length) strands, and each grapheme is copied
+ * or re-parented a logarithmic number of times rather than once per append.
+ * Concatenating bigger ropes can still leave more strands than we'd like,
+ * so those get merged pairwise, a level of tree at a time. */
+static void balance_strands(MVMThreadContext *tc, MVMString *rope) {
+    MVMStrandIndex count = rope->body.num_strands, top = 0, peak = 0, i;
+    MVMStringIndex *lengths = malloc(sizeof(MVMStringIndex) * count);
+    MVMStringIndex position = 0, depth = 0;
+    MVMStrand *strands = rope->body.strands;
+
+    for (i = 0; i < count; i++) {
+        lengths[i] = strands[i + 1].compare_offset - strands[i].compare_offset;
+        if (lengths[i] > lengths[peak])
+            peak = i;
+    }
+
+    /* Until the end, every one of the rope's count strands points at a live
+     * string, some of them twice, so the GC can mark it as usual while we
+     * allocate the merged strings. */
+    MVMROOT(tc, rope, {
+        MVMStrandIndex kept_peak = 0;
+        for (i = 0; i < count; i++) {
+            strands[top] = strands[i];
+            lengths[top] = lengths[i];
+            top++;
+            for (;;) {
+                MVMStrandIndex x = top - 2;
+                if (top < 2)
+                    break;
+                if (i <= peak) {
+                    /* rising: merge if this one isn't twice the last */
+                    if (lengths[x + 1] > 2 * lengths[x])
+                        break;
+                }
+                else {
+                    /* falling: merge if the last isn't twice this one */
+                    if (x < kept_peak || lengths[x] > 2 * lengths[x + 1])
+                        break;
+                }
+                {
+                    MVMString *merged = merge_strands(tc, rope, x, lengths[x], lengths[x + 1]);
+                    MVM_ASSIGN_REF(tc, &(rope->common.header), strands[x].string, merged);
+                    strands[x].string_offset = 0;
+                    lengths[x] += lengths[x + 1];
+                    top--;
+                }
+            }
+            if (i == peak)
+                kept_peak = top - 1;
+        }
+        while (top > MVM_STRING_MAX_STRANDS) {
+            MVMStrandIndex paired = 0;
+            for (i = 0; i < top; i += 2) {
+                if (i + 1 < top) {
+                    MVMString *merged = merge_strands(tc, rope, i, lengths[i], lengths[i + 1]);
+                    MVM_ASSIGN_REF(tc, &(rope->common.header), strands[paired].string, merged);
+                    strands[paired].string_offset = 0;
+                    lengths[paired] = lengths[i] + lengths[i + 1];
+                }
+                else {
+                    strands[paired] = strands[i];
+                    lengths[paired] = lengths[i];
+                }
+                paired++;
+            }
+            top = paired;
+        }
+    });
+
+    for (i = 0; i < top; i++) {
+        strands[i].compare_offset = position;
+        position += lengths[i];
+        if (STRAND_DEPTH(strands[i].string) > depth)
+            depth = STRAND_DEPTH(strands[i].string);
+    }
+    strands[top].graphs = position;
+    strands[top].string = NULL;
+    strands[top].strand_depth = depth + 1;
+    rope->body.num_strands = top;
+    free(lengths);
+}
+
+/* Adds the strands making up s to a strands table, inlining those of a rope
+ * so that concatenation doesn't deepen the tree, and returns the new count. */
+static MVMStrandIndex add_strands(MVMStrand *strands, MVMStrandIndex count,
+        MVMString *s, MVMStringIndex *position) {
+    if (IS_ROPE(s)) {
+        MVMStrandIndex i;
+        for (i = 0; i < s->body.num_strands; i++) {
+            strands[count].string = s->body.strands[i].string;
+            strands[count].string_offset = s->body.strands[i].string_offset;
+            strands[count].compare_offset = *position;
+            *position += s->body.strands[i + 1].compare_offset - s->body.strands[i].compare_offset;
+            count++;
+        }
+    }
+    else {
+        strands[count].string = s;
+        strands[count].string_offset = 0;
+        strands[count].compare_offset = *position;
+        *position += s->body.graphs;
+        count++;
+    }
+    return count;
+}
+
+/* Append one string to another. Unless the result is short, it's a rope
+ * over the strands of both, which is only flattened once something needs
+ * it to be contiguous; see balance_strands for how repeated appends are
+ * kept from building up long strand tables or deep trees. */
 MVMString * MVM_string_concatenate(MVMThreadContext *tc, MVMString *a, MVMString *b) {
     MVMString *result;
-    MVMStrandIndex strand_count = 0;
+    MVMStrandIndex strand_count = 0, i;
     MVMStrand *strands;
     MVMStringIndex index = 0;
     MVMStrandIndex max_strand_depth = 0;
-    MVMStringIndex agraphs = NUM_GRAPHS(a), bgraphs = NUM_GRAPHS(b), rgraphs;
+    MVMStringIndex agraphs, bgraphs, rgraphs;
 
     if (!IS_CONCRETE((MVMObject *)a) || !IS_CONCRETE((MVMObject *)b)) {
         MVM_exception_throw_adhoc(tc, "Concatenate needs concrete strings");
     }
 
+    /* strings are immutable, so appending nothing can give back the other */
+    agraphs = NUM_GRAPHS(a);
+    bgraphs = NUM_GRAPHS(b);
+    if (!bgraphs)
+        return a;
+    if (!agraphs)
+        return b;
+    rgraphs = agraphs + bgraphs;
+
     MVM_gc_root_temp_push(tc, (MVMCollectable **)&a);
     MVM_gc_root_temp_push(tc, (MVMCollectable **)&b);
     result = (MVMString *)REPR(a)->allocate(tc, STABLE(a));
@@ -447,38 +729,44 @@ MVMString * MVM_string_concatenate(MVMThreadContext *tc, MVMString *a, MVMString
 
     /* there could be unattached combining chars at the beginning of b,
        so, XXX TODO handle this */
-    result->body.flags = MVM_STRING_TYPE_ROPE;
-    rgraphs = agraphs + bgraphs;
 
-    if (agraphs)
-        strand_count = 1;
-    if (bgraphs)
-        ++strand_count;
-    strands = result->body.strands = calloc(sizeof(MVMStrand), strand_count + 1);
-    strand_count = 0;
-    if (agraphs) {
-        strands->string = a;
-        strands->string_offset = 0;
-        strands->compare_offset = index;
-        index = agraphs;
-        strand_count = 1;
-        max_strand_depth = STRAND_DEPTH(a);
-    }
-    if (bgraphs) {
-        strands[strand_count].string = b;
-        strands[strand_count].string_offset = 0;
-        strands[strand_count].compare_offset = index;
-        index += bgraphs;
-        ++strand_count;
-        if (STRAND_DEPTH(b) > max_strand_depth)
-            max_strand_depth = STRAND_DEPTH(b);
+    /* short results are cheaper to copy than to keep strands for */
+    if (rgraphs <= MVM_STRING_CONCAT_COPY_MAX) {
+        if (IS_ASCII(a) && IS_ASCII(b)) {
+            result->body.uint8s = malloc(rgraphs);
+            memcpy(result->body.uint8s, a->body.uint8s, agraphs);
+            memcpy(result->body.uint8s + agraphs, b->body.uint8s, bgraphs);
+            result->body.flags = MVM_STRING_TYPE_UINT8;
+        }
+        else {
+            result->body.int32s = malloc(sizeof(MVMCodepoint32) * rgraphs);
+            gather_substring(tc, a, 0, agraphs, result->body.int32s);
+            gather_substring(tc, b, 0, bgraphs, result->body.int32s + agraphs);
+            result->body.flags = MVM_STRING_TYPE_INT32;
+        }
+        result->body.graphs = rgraphs;
+        return result;
     }
+
+    strands = result->body.strands = calloc(sizeof(MVMStrand),
+        (IS_ROPE(a) ? a->body.num_strands : 1) + (IS_ROPE(b) ? b->body.num_strands : 1) + 1);
+    strand_count = add_strands(strands, strand_count, a, &index);
+    strand_count = add_strands(strands, strand_count, b, &index);
+    for (i = 0; i < strand_count; i++)
+        if (STRAND_DEPTH(strands[i].string) > max_strand_depth)
+            max_strand_depth = STRAND_DEPTH(strands[i].string);
     strands[strand_count].graphs = index;
     result->body.num_strands = strand_count;
     result->body.flags = MVM_STRING_TYPE_ROPE;
     _STRAND_DEPTH(result) = max_strand_depth + 1;
 
-    MVM_string_flatten(tc, result);
+    if (strand_count > MVM_STRING_BALANCE_STRANDS)
+        balance_strands(tc, result);
+
+    /* a tree built from other sorts of rope could still get too deep to
+     * walk sensibly */
+    if (STRAND_DEPTH(result) > MVM_STRING_MAX_DEPTH)
+        MVM_string_flatten(tc, result);
 
     return result;
 }
@@ -857,6 +1145,8 @@ MVMObject * MVM_string_split(MVMThreadContext *tc, MVMString *separator, MVMStri
     MVMObject *result;
     MVMStringIndex start, end, sep_length;
     MVMHLLConfig *hll = MVM_hll_current(tc);
+    StringSearch search;
+    MVMuint8 searching;
 
     if (!IS_CONCRETE((MVMObject *)separator)) {
         MVM_exception_throw_adhoc(tc, "split needs a concrete string separator");
@@ -870,14 +1160,20 @@ MVMObject * MVM_string_split(MVMThreadContext *tc, MVMString *separator, MVMStri
             end = NUM_GRAPHS(input);
             sep_length = NUM_GRAPHS(separator);
 
+            /* Set the search up once for the whole split, rather than once
+             * per separator found. The buffers it uses are malloc'd, so it
+             * doesn't matter if the strings get moved as we allocate. */
+            searching = sep_length && sep_length <= end;
+            if (searching)
+                search_init(tc, &search, input, separator, 0);
+
             while (start < end) {
                 MVMString *portion;
-                MVMStringIndex index;
+                MVMint64 index;
                 MVMStringIndex length;
 
-                /* XXX make this use the dual-traverse iterator, but such that it
-                    can reset the index of what it's comparing... <!> */
-                index = MVM_string_index(tc, input, separator, start);
+                index = searching && start <= end - sep_length
+                    ? search_next(&search, start) : -1;
                 length = sep_length ? (index == -1 ? end : index) - start : 1;
                 if (length > 0 || (sep_length && length == 0)) {
                     portion = MVM_string_substring(tc, input, start, length);
@@ -895,6 +1191,9 @@ MVMObject * MVM_string_split(MVMThreadContext *tc, MVMString *separator, MVMStri
                     MVM_repr_push_o(tc, result, pobj);
                 }
             }
+
+            if (searching)
+                search_cleanup(&search);
         });
     });
     });
@@ -1090,7 +1389,7 @@ void MVM_string_flatten(MVMThreadContext *tc, MVMString *s) {
     /* XXX This is temporary until we can get the hashing mechanism
         to compute the hash (and test for equivalence!) using the
         codepoint iterator interface.  It's not thread-safe. */
-    MVMStringIndex position = 0, sgraphs = NUM_GRAPHS(s);
+    MVMStringIndex sgraphs = NUM_GRAPHS(s);
     void *storage = s->body.storage;
     MVMCodepoint32 *buffer;
     if (IS_WIDE(s))
@@ -1101,33 +1400,9 @@ void MVM_string_flatten(MVMThreadContext *tc, MVMString *s) {
         s->body.flags = MVM_STRING_TYPE_INT32;
         return;
     }
+    /* walks each strand once, however deep the rope is */
     buffer = malloc(sizeof(MVMCodepoint32) * sgraphs);
-    if (IS_ROPE(s) && STRAND_DEPTH(s) == 1) {
-        MVMStrandIndex strand;
-        MVMStrandIndex last  = s->body.num_strands;
-        for (strand = 0; strand < last; strand++) {
-            MVMStrand *snd = &s->body.strands[strand];
-            MVMStringIndex end = (s->body.strands[strand + 1].compare_offset - snd->compare_offset);
-            if (IS_WIDE(snd->string)) {
-                memcpy(buffer + snd->compare_offset,
-                       snd->string->body.int32s + snd->string_offset,
-                       end * 4);
-            } else if (IS_ASCII(snd->string)) {
-                MVMStringIndex copy_idx;
-                // we have to turn uint8 into int32 here.
-                for (copy_idx = 0; copy_idx < end; copy_idx++) {
-                    buffer[snd->compare_offset + copy_idx] = snd->string->body.uint8s[copy_idx + snd->string_offset];
-                }
-            } else {
-                MVM_exception_throw_adhoc(tc, "Unexpected rope in string_flatten.");
-            }
-        }
-    } else {
-        for (; position < sgraphs; position++) {
-                /* XXX make this use the iterator */
-            buffer[position] = MVM_string_get_codepoint_at_nocheck(tc, s, position);
-        }
-    }
+    gather_substring(tc, s, 0, sgraphs, buffer);
     s->body.flags = MVM_STRING_TYPE_INT32;
     s->body.graphs = sgraphs;
     s->body.int32s = buffer;
@@ -42,6 +42,20 @@ typedef MVM_SUBSTRING_CONSUMER((*MVMSubstringConsumer));
 /* whether the rope is composed of only one segment of another string */
 #define IS_ONE_STRING_ROPE(str) (IS_ROPE((str)) && (str)->body.num_strands == 1)
 
+/* Concatenations no longer than this are copied into a flat string
+ * rather than made into a rope. */
+#define MVM_STRING_CONCAT_COPY_MAX      64
+/* Once concatenation gives a rope more strands than this, neighbouring
+ * strands of similar lengths get merged (see balance_strands in ops.c). */
+#define MVM_STRING_BALANCE_STRANDS      8
+/* Balancing merges strands pairwise until there are no more than this. */
+#define MVM_STRING_MAX_STRANDS          32
+/* Merged strands no longer than this are copied into a flat string, and
+ * longer ones get a rope over them. */
+#define MVM_STRING_FLAT_MAX             1024
+/* Ropes deeper than this are flattened. */
+#define MVM_STRING_MAX_DEPTH            48
+
 struct MVMConcatState {
     MVMuint32 some_state;
 };
@@ -89,6 +103,7 @@ MVMString * MVM_string_join(MVMThreadContext *tc, MVMString *separator, MVMObjec
 MVMint64 MVM_string_char_at_in_string(MVMThreadContext *tc, MVMString *a, MVMint64 offset, MVMString *b);
 MVMint64 MVM_string_offset_has_unicode_property_value(MVMThreadContext *tc, MVMString *s, MVMint64 offset, MVMint64 property_code, MVMint64 property_value_code);
 void MVM_string_flatten(MVMThreadContext *tc, MVMString *s);
+MVMuint8 MVM_string_traverse_substring(MVMThreadContext *tc, MVMString *a, MVMStringIndex start, MVMStringIndex length, MVMStringIndex top_index, MVMSubstringConsumer consumer, void *data);
 MVMString * MVM_string_escape(MVMThreadContext *tc, MVMString *s);
 MVMString * MVM_string_flip(MVMThreadContext *tc, MVMString *s);
 MVMint64 MVM_string_compare(MVMThreadContext *tc, MVMString *a, MVMString *b);
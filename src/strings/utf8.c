@@ -337,18 +337,53 @@ void MVM_string_utf8_decodestream(MVMThreadContext *tc, MVMDecodeStream *ds,
     MVM_string_decodestream_discard_to(tc, ds, last_accept_bytes, last_accept_pos);
 }
 
+typedef struct {
+    MVMuint8       *arr;
+    MVMStringIndex  failed_at;
+    MVMCodepoint32  failed_cp;
+} EncodeState;
+
+/* encodes a piece of a string, walking the flat storage directly */
+static MVM_SUBSTRING_CONSUMER(encode_consumer) {
+    EncodeState *state = (EncodeState *)data;
+    MVMuint8 *arr = state->arr;
+    MVMStringIndex i;
+    if (IS_ASCII(string)) {
+        MVMCodepoint8 *cps = string->body.uint8s + start;
+        for (i = 0; i < length; i++) {
+            if (cps[i] < 0x80)
+                *arr++ = cps[i];
+            else
+                arr = utf8_encode(arr, cps[i]);
+        }
+    }
+    else {
+        MVMCodepoint32 *cps = string->body.int32s + start;
+        for (i = 0; i < length; i++) {
+            MVMuint8 *next = utf8_encode(arr, cps[i]);
+            if (!next) {
+                state->failed_at = top_index + i;
+                state->failed_cp = cps[i];
+                return 1;
+            }
+            arr = next;
+        }
+    }
+    state->arr = arr;
+    return 0;
+}
+
 /* Encodes the specified string to UTF-8. */
 MVMuint8 * MVM_string_utf8_encode_substr(MVMThreadContext *tc,
         MVMString *str, MVMuint64 *output_size, MVMint64 start, MVMint64 length) {
     /* XXX This is terribly wrong when we get to doing NFG properly too. One graph may
      * expand to loads of codepoints and overflow the buffer. */
     MVMuint8 *result;
-    MVMuint8 *arr;
-    size_t i = start;
+    EncodeState state;
     MVMStringIndex strgraphs = NUM_GRAPHS(str);
 
     if (length == -1)
-        length = strgraphs;
+        length = strgraphs - start;
 
     /* must check start first since it's used in the length check */
     if (start < 0 || start > strgraphs)
@@ -358,17 +393,20 @@ MVMuint8 * MVM_string_utf8_encode_substr(MVMThreadContext *tc,
 
     /* give it two spaces for padding in case `say` wants to append a \r\n or \n */
     result = malloc(sizeof(MVMint32) * length + 2);
-    arr = result;
-
     memset(result, 0, sizeof(MVMint32) * length + 2);
-    while (i < length && (arr = utf8_encode(arr, MVM_string_get_codepoint_at_nocheck(tc, str, i++))));
-    if (!arr)
+
+    /* walk the strands rather than looking each codepoint up in the rope */
+    state.arr = result;
+    if (length && MVM_string_traverse_substring(tc, str, start, length, 0,
+            encode_consumer, &state)) {
+        free(result);
         MVM_exception_throw_adhoc(tc,
             "Error encoding UTF-8 string near grapheme position %d with codepoint %d",
-                i - 1, MVM_string_get_codepoint_at_nocheck(tc, str, i-1));
+                start + state.failed_at, state.failed_cp);
+    }
 
     if (output_size)
-        *output_size = (MVMuint64)(arr ? arr - result : 0);
+        *output_size = (MVMuint64)(state.arr - result);
 
     return result;
 }
@@ -38,8 +38,11 @@ typedef struct MVMExtRegistry MVMExtRegistry;
 typedef struct MVMFrame MVMFrame;
 typedef struct MVMFrameHandler MVMFrameHandler;
 typedef struct MVMGen2Allocator MVMGen2Allocator;
+typedef struct MVMGen2LargeObject MVMGen2LargeObject;
 typedef struct MVMGen2SizeClass MVMGen2SizeClass;
+typedef struct MVMGCFinalizeItem MVMGCFinalizeItem;
 typedef struct MVMGCPassedWork MVMGCPassedWork;
+typedef struct MVMGCRunStats MVMGCRunStats;
 typedef struct MVMGCWorklist MVMGCWorklist;
 typedef struct MVMHash MVMHash;
 typedef struct MVMHashAttrStore MVMHashAttrStore;
@@ -48,6 +51,8 @@ typedef struct MVMHashBody MVMHashBody;
 typedef struct MVMHashEntry MVMHashEntry;
 typedef struct MVMHLLConfig MVMHLLConfig;
 typedef struct MVMIntConstCache MVMIntConstCache;
+typedef struct MVMInlineCache MVMInlineCache;
+typedef struct MVMInlineCacheEntry MVMInlineCacheEntry;
 typedef struct MVMInstance MVMInstance;
 typedef struct MVMInvocationSpec MVMInvocationSpec;
 typedef struct MVMIter MVMIter;
@@ -71,6 +76,11 @@ typedef struct MVMContinuationBody MVMContinuationBody;
 typedef struct MVMObject MVMObject;
 typedef struct MVMObjectStooge MVMObjectStooge;
 typedef struct MVMOpInfo MVMOpInfo;
+typedef struct MVMOpProfileFrame MVMOpProfileFrame;
+typedef struct MVMOpProfileThread MVMOpProfileThread;
+typedef struct MVMAllocProfileFrame MVMAllocProfileFrame;
+typedef struct MVMAllocProfileType MVMAllocProfileType;
+typedef struct MVMAllocProfileThread MVMAllocProfileThread;
 typedef struct MVMOSHandle MVMOSHandle;
 typedef struct MVMOSHandleBody MVMOSHandleBody;
 typedef struct MVMP6bigint MVMP6bigint;
@@ -88,6 +98,10 @@ typedef struct MVMP6opaqueNameMap MVMP6opaqueNameMap;
 typedef struct MVMP6opaqueREPRData MVMP6opaqueREPRData;
 typedef struct MVMP6str MVMP6str;
 typedef struct MVMP6strBody MVMP6strBody;
+typedef struct MVMProfileAllocations MVMProfileAllocations;
+typedef struct MVMProfileCallNode MVMProfileCallNode;
+typedef struct MVMProfileTable MVMProfileTable;
+typedef struct MVMProfileThreadData MVMProfileThreadData;
 typedef union  MVMRegister MVMRegister;
 typedef struct MVMReprRegistry MVMReprRegistry;
 typedef struct MVMREPROps MVMREPROps;
@@ -100,10 +114,16 @@ typedef struct MVMSerializationContextBody MVMSerializationContextBody;
 typedef struct MVMSerializationReader MVMSerializationReader;
 typedef struct MVMSerializationRoot MVMSerializationRoot;
 typedef struct MVMSerializationWriter MVMSerializationWriter;
+typedef struct MVMSpeshCandidate MVMSpeshCandidate;
+typedef struct MVMSpeshGuard MVMSpeshGuard;
+typedef struct MVMSpeshInline MVMSpeshInline;
+typedef struct MVMJitCode MVMJitCode;
 typedef struct MVMSTable MVMSTable;
 typedef struct MVMStaticFrame MVMStaticFrame;
 typedef struct MVMStaticFrameBody MVMStaticFrameBody;
 typedef struct MVMStorageSpec MVMStorageSpec;
+typedef struct MVMStrBuilder MVMStrBuilder;
+typedef struct MVMStrBuilderBody MVMStrBuilderBody;
 typedef struct MVMStrand MVMStrand;
 typedef struct MVMString MVMString;
 typedef struct MVMStringBody MVMStringBody;
@@ -111,6 +131,7 @@ typedef struct MVMStringConsts MVMStringConsts;
 typedef struct MVMThread MVMThread;
 typedef struct MVMThreadBody MVMThreadBody;
 typedef struct MVMThreadContext MVMThreadContext;
+typedef struct MVMCallStackBlock MVMCallStackBlock;
 typedef struct MVMUnicodeNamedValue MVMUnicodeNamedValue;
 typedef struct MVMUnicodeNameRegistry MVMUnicodeNameRegistry;
 typedef struct MVMUninstantiable MVMUninstantiable;
@@ -0,0 +1,239 @@
+#!/usr/bin/env python
+# Summarizes a MoarVM heap snapshot, as written by the heapsnapshot op or by
+# moar --heap-snapshot=... (see "Heap Snapshots" in docs/gc.markdown).
+#
+#   tools/heapsnapshot-summary.py [--top N] [--by-repr] [--all] snapshot-file
+#
+# For each type, shows how many live objects there are, the bytes they take
+# themselves, and the bytes they retain: those that would be freed if they
+# all went away, found using the dominator tree of the heap. Objects are
+# grouped by their STable unless --by-repr is given. A file written with
+# --heap-snapshot holds one snapshot per full collection; only the last is
+# summarized unless --all is given.
+
+from __future__ import print_function
+import sys
+
+KINDS = ['object', 'type object', 'STable', 'frame']
+ROOTS = ['permanent', 'instance', 'thread', 'thread context', 'temporary', 'stack']
+
+
+class Reader(object):
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def byte(self):
+        b = self.data[self.pos]
+        self.pos += 1
+        return b if isinstance(b, int) else ord(b)
+
+    def uint(self):
+        value = shift = 0
+        while True:
+            b = self.byte()
+            value |= (b & 0x7F) << shift
+            if not b & 0x80:
+                return value
+            shift += 7
+
+    def bytes(self, n):
+        s = self.data[self.pos:self.pos + n]
+        self.pos += n
+        return s
+
+
+class Snapshot(object):
+    def __init__(self):
+        self.seq = 0
+        self.names = {}
+        self.kind = {}
+        self.name = {}
+        self.st = {}
+        self.size = {}
+        self.refs = {}
+        self.roots = []
+
+
+def read_snapshots(data):
+    r = Reader(data)
+    while r.pos < len(data):
+        if r.bytes(7) != b'MVMHEAP':
+            sys.exit('Not a MoarVM heap snapshot')
+        version = r.uint()
+        if version != 1:
+            sys.exit('Unknown heap snapshot version %d' % version)
+        ss = Snapshot()
+        while True:
+            tag = chr(r.byte())
+            if tag == 'S':
+                ss.seq = r.uint()
+                r.uint()
+            elif tag == 'N':
+                id = r.uint()
+                ss.names[id] = r.bytes(r.uint()).decode('utf-8', 'replace')
+            elif tag == 'R':
+                category, thread, id = r.uint(), r.uint(), r.uint()
+                ss.roots.append((category, thread, id))
+            elif tag == 'O':
+                id = r.uint()
+                ss.kind[id] = r.uint()
+                ss.name[id] = r.uint()
+                ss.st[id] = r.uint()
+                ss.size[id] = r.uint()
+                ss.refs[id] = [r.uint() for i in range(r.uint())]
+            elif tag == 'E':
+                r.uint()
+                break
+            else:
+                sys.exit('Corrupt heap snapshot (record type %r)' % tag)
+        yield ss
+
+
+def dominators(ss):
+    """Finds the immediate dominator of every node, with 0 standing for a
+    root that leads to all of the real roots (Cooper, Harvey and Kennedy's
+    iterative algorithm)."""
+    succs = dict(ss.refs)
+    succs[0] = [id for (c, t, id) in ss.roots]
+
+    # Number the nodes in postorder.
+    order, seen, stack = [], set([0]), [(0, iter(succs[0]))]
+    while stack:
+        node, it = stack[-1]
+        for child in it:
+            if child not in seen and child in succs:
+                seen.add(child)
+                stack.append((child, iter(succs[child])))
+                break
+        else:
+            stack.pop()
+            order.append(node)
+    post = dict((node, i) for i, node in enumerate(order))
+
+    preds = dict((node, []) for node in order)
+    for node in order:
+        for child in succs[node]:
+            if child in preds:
+                preds[child].append(node)
+
+    idom = {0: 0}
+    changed = True
+    while changed:
+        changed = False
+        for node in reversed(order):
+            if node == 0:
+                continue
+            new = None
+            for p in preds[node]:
+                if p not in idom:
+                    continue
+                if new is None:
+                    new = p
+                    continue
+                a, b = p, new
+                while a != b:
+                    while post[a] < post[b]:
+                        a = idom[a]
+                    while post[b] < post[a]:
+                        b = idom[b]
+                new = a
+            if idom.get(node) != new:
+                idom[node] = new
+                changed = True
+    return order, idom
+
+
+def type_of(ss, id, by_repr):
+    name = ss.names.get(ss.name[id], '?')
+    kind = ss.kind[id]
+    if kind == 3:
+        return 'frame ' + name
+    if by_repr or kind == 2:
+        return '%s (%s)' % (name, KINDS[kind])
+    return '%s (%s of STable %d)' % (name, KINDS[kind], ss.st[id])
+
+
+def summarize(ss, top, by_repr):
+    order, idom = dominators(ss)
+
+    # Retained sizes, adding each node's into its dominator's; the postorder
+    # has every node before its dominator.
+    retained = dict((node, ss.size.get(node, 0)) for node in order)
+    for node in order:
+        if node != 0:
+            retained[idom[node]] += retained[node]
+
+    # Count retained bytes once per type, at the outermost object of that
+    # type on each path through the dominator tree.
+    children = dict((node, []) for node in order)
+    for node in order:
+        if node != 0:
+            children[idom[node]].append(node)
+    types = {}
+    active = {}
+    stack = [(0, None, False)]
+    while stack:
+        node, t, leaving = stack.pop()
+        if leaving:
+            active[t] -= 1
+            continue
+        if node != 0:
+            t = type_of(ss, node, by_repr)
+            entry = types.setdefault(t, [0, 0, 0])
+            entry[0] += 1
+            entry[1] += ss.size[node]
+            if not active.get(t):
+                entry[2] += retained[node]
+            active[t] = active.get(t, 0) + 1
+            stack.append((node, t, True))
+        for child in children[node]:
+            stack.append((child, None, False))
+
+    print('Heap snapshot at GC run %d: %d live nodes, %d bytes, %d roots'
+          % (ss.seq, len(order) - 1, retained[0], len(ss.roots)))
+    print()
+    print('%12s %14s %14s  %s' % ('count', 'bytes', 'retained', 'type'))
+    by_retained = sorted(types.items(), key=lambda kv: -kv[1][2])
+    for t, (count, size, kept) in by_retained[:top]:
+        print('%12d %14d %14d  %s' % (count, size, kept, t))
+    print()
+    print('%12s %14s %14s  %s' % ('count', 'bytes', 'retained', 'type'))
+    by_count = sorted(types.items(), key=lambda kv: -kv[1][0])
+    for t, (count, size, kept) in by_count[:top]:
+        print('%12d %14d %14d  %s' % (count, size, kept, t))
+    print()
+
+    # How much each category of root keeps alive.
+    print('%14s  %s' % ('retained', 'roots'))
+    for c, name in enumerate(ROOTS):
+        ids = set(id for (cat, t, id) in ss.roots if cat == c and idom.get(id) == 0)
+        if ids:
+            print('%14d  %s' % (sum(retained[id] for id in ids), name))
+
+
+def main(args):
+    top, by_repr, all = 25, False, False
+    while args and args[0].startswith('--'):
+        opt = args.pop(0)
+        if opt == '--top':
+            top = int(args.pop(0))
+        elif opt == '--by-repr':
+            by_repr = True
+        elif opt == '--all':
+            all = True
+        else:
+            sys.exit('Unknown option ' + opt)
+    if len(args) != 1:
+        sys.exit('Usage: heapsnapshot-summary.py [--top N] [--by-repr] [--all] snapshot-file')
+    with open(args[0], 'rb') as fh:
+        data = fh.read()
+    snapshots = list(read_snapshots(data))
+    if not snapshots:
+        sys.exit('No heap snapshots in ' + args[0])
+    for ss in (snapshots if all else snapshots[-1:]):
+        summarize(ss, top, by_repr)
+
+
+if __name__ == '__main__':
+    main(sys.argv[1:])